@@ -0,0 +1,101 @@
+#ifndef SCORE_HISTOGRAM_H
+#define SCORE_HISTOGRAM_H
+
+/// SYSTEM
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The ScoreHistogram class accumulates (score, label) pairs of a binary
+ *        classifier and derives the complete ROC and precision/recall curves
+ *        by sweeping the decision threshold over all accumulated scores.
+ *
+ * In BINNED mode the memory is fixed to two counters per bin, scores outside of
+ * [min_score, max_score] are clamped into the outermost bins.
+ * In EXACT mode the samples are kept sorted by score, new samples are sorted on
+ * their own and merged in when the curve is computed. Every distinct score becomes
+ * a threshold. At most max_samples samples are kept, the oldest ones are dropped
+ * first.
+ */
+class ScoreHistogram
+{
+public:
+    enum class Mode
+    {
+        BINNED = 0,
+        EXACT = 1
+    };
+
+    struct CurvePoint
+    {
+        double threshold;
+        double recall;
+        double false_positive_rate;
+        double precision;
+    };
+
+    struct Curve
+    {
+        /// points ordered by decreasing threshold, starting at (0,0) on the ROC curve
+        std::vector<CurvePoint> points;
+
+        double roc_auc;
+        double pr_auc;
+
+        std::size_t positives;
+        std::size_t negatives;
+    };
+
+public:
+    ScoreHistogram(Mode mode = Mode::BINNED, std::size_t bins = 1000, double min_score = 0.0, double max_score = 1.0, std::size_t max_samples = 1000000);
+
+    void configure(Mode mode, std::size_t bins, double min_score, double max_score, std::size_t max_samples = 1000000);
+    void reset();
+
+    void report(double score, bool positive);
+
+    /// number of accumulated samples, in EXACT mode including the ones not merged yet
+    std::size_t size() const;
+
+    Curve computeCurve();
+
+private:
+    struct Sample
+    {
+        double score;
+        bool positive;
+        uint64_t sequence;
+    };
+
+    static bool higherScore(const Sample& a, const Sample& b);
+
+    void merge();
+    void sweep(Curve& curve, std::size_t tp, std::size_t fp, double threshold) const;
+    void finish(Curve& curve) const;
+
+private:
+    Mode mode_;
+    double min_score_;
+    double max_score_;
+    double bin_scale_;
+
+    std::vector<std::size_t> positive_bins_;
+    std::vector<std::size_t> negative_bins_;
+
+    std::size_t max_samples_;
+    uint64_t next_sequence_;
+
+    /// sorted by decreasing score
+    std::vector<Sample> samples_;
+    std::vector<Sample> pending_;
+
+    std::size_t positives_;
+    std::size_t negatives_;
+};
+
+}  // namespace csapex
+
+#endif  // SCORE_HISTOGRAM_H
@@ -0,0 +1,147 @@
+/// HEADER
+#include "score_roc_curve.h"
+
+/// COMPONENT
+#include <csapex_ml/features_message.h>
+
+/// PROJECT
+#include <csapex/model/node_modifier.h>
+#include <csapex/msg/generic_value_message.hpp>
+#include <csapex/msg/generic_vector_message.hpp>
+#include <csapex/msg/io.h>
+#include <csapex/param/parameter_factory.h>
+#include <csapex/utility/register_apex_plugin.h>
+
+/// SYSTEM
+#include <fstream>
+
+CSAPEX_REGISTER_CLASS(csapex::ScoreROCCurve, csapex::Node)
+
+using namespace csapex;
+using namespace csapex::connection_types;
+
+ScoreROCCurve::ScoreROCCurve() : in_truth_(nullptr), in_classified_(nullptr), type_(Type::ROC), positive_class_(1)
+{
+}
+
+void ScoreROCCurve::setup(NodeModifier& node_modifier)
+{
+    in_truth_ = node_modifier.addInput<GenericVectorMessage, FeaturesMessage>("True feature");
+    in_classified_ = node_modifier.addInput<GenericVectorMessage, FeaturesMessage>("Classified feature");
+
+    out_roc_auc_ = node_modifier.addOutput<double>("ROC AUC");
+    out_pr_auc_ = node_modifier.addOutput<double>("PR AUC");
+}
+
+void ScoreROCCurve::setupParameters(Parameterizable& parameters)
+{
+    parameters.addParameter(csapex::param::factory::declareTrigger("reset"), [this](csapex::param::Parameter*) {
+        std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+        histogram_.reset();
+        curve_ = histogram_.computeCurve();
+    });
+
+    std::map<std::string, int> type = { { "ROC", (int)Type::ROC }, { "Precision/Recall", (int)Type::PR } };
+    parameters.addParameter(csapex::param::factory::declareParameterSet("type", csapex::param::ParameterDescription("Diagram type."), type, (int)Type::ROC),
+                            [this](param::Parameter* p) { type_ = static_cast<Type>(p->as<int>()); });
+
+    parameters.addParameter(param::factory::declareValue("positive class", param::ParameterDescription("Label of the positive class, all other labels count as negative."), 1),
+                            positive_class_);
+
+    std::map<std::string, int> modes = { { "binned", (int)ScoreHistogram::Mode::BINNED }, { "exact", (int)ScoreHistogram::Mode::EXACT } };
+    parameters.addParameter(csapex::param::factory::declareParameterSet("mode",
+                                                                        csapex::param::ParameterDescription("binned: fixed memory, thresholds at the bin borders.<br />"
+                                                                                                            "exact: keeps the most recent scores, thresholds at every distinct score."),
+                                                                        modes, (int)ScoreHistogram::Mode::BINNED),
+                            std::bind(&ScoreROCCurve::reconfigure, this));
+    parameters.addConditionalParameter(param::factory::declareRange("bins", 2, 100000, 1000, 1),
+                                       [this]() { return readParameter<int>("mode") == (int)ScoreHistogram::Mode::BINNED; }, std::bind(&ScoreROCCurve::reconfigure, this));
+    parameters.addConditionalParameter(param::factory::declareInterval("score range", -100.0, 100.0, 0.0, 1.0, 0.01),
+                                       [this]() { return readParameter<int>("mode") == (int)ScoreHistogram::Mode::BINNED; }, std::bind(&ScoreROCCurve::reconfigure, this));
+    parameters.addConditionalParameter(param::factory::declareRange("maximum samples",
+                                                                    param::ParameterDescription("Number of most recent samples that are kept, older ones are dropped."),
+                                                                    1000, 10000000, 1000000, 1000),
+                                       [this]() { return readParameter<int>("mode") == (int)ScoreHistogram::Mode::EXACT; }, std::bind(&ScoreROCCurve::reconfigure, this));
+
+    parameters.addParameter(param::factory::declareRange("width", 16, 4096, 128, 1));
+    parameters.addParameter(param::factory::declareRange("height", 16, 4096, 128, 1));
+    parameters.addParameter(param::factory::declareFileOutputPath("save to", "", "*.txt"), out_path_);
+    parameters.addParameter(param::factory::declareTrigger("save"), std::bind(&ScoreROCCurve::saveData, this));
+}
+
+void ScoreROCCurve::reconfigure()
+{
+    ScoreHistogram::Mode mode = static_cast<ScoreHistogram::Mode>(readParameter<int>("mode"));
+    int bins = readParameter<int>("bins");
+    int max_samples = readParameter<int>("maximum samples");
+    std::pair<double, double> range = readParameter<std::pair<double, double>>("score range");
+
+    if (range.second <= range.first) {
+        range.second = range.first + 1.0;
+    }
+
+    std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+    histogram_.configure(mode, bins, range.first, range.second, max_samples);
+    curve_ = histogram_.computeCurve();
+}
+
+void ScoreROCCurve::process()
+{
+    std::shared_ptr<std::vector<FeaturesMessage> const> truth_msg = msg::getMessage<GenericVectorMessage, FeaturesMessage>(in_truth_);
+    std::shared_ptr<std::vector<FeaturesMessage> const> classified_msg = msg::getMessage<GenericVectorMessage, FeaturesMessage>(in_classified_);
+
+    apex_assert(truth_msg->size() == classified_msg->size());
+
+    ScoreHistogram::Curve curve;
+    {
+        std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+
+        for (std::size_t i = 0, n = truth_msg->size(); i < n; ++i) {
+            const FeaturesMessage& truth = truth_msg->at(i);
+            const FeaturesMessage& classified = classified_msg->at(i);
+
+            // items with an invalid label are simply dropped so they dont influence the
+            // evaluation
+            if (truth.classification == FeaturesMessage::INVALID_LABEL || classified.classification == FeaturesMessage::INVALID_LABEL) {
+                continue;
+            }
+
+            // the confidence refers to the predicted class, turn it into a score for the positive class
+            double score = classified.classification == positive_class_ ? classified.confidence : 1.0 - classified.confidence;
+            histogram_.report(score, truth.classification == positive_class_);
+        }
+
+        curve_ = histogram_.computeCurve();
+        curve = curve_;
+    }
+
+    display_request();
+
+    msg::publish(out_roc_auc_, curve.roc_auc);
+    msg::publish(out_pr_auc_, curve.pr_auc);
+}
+
+ScoreHistogram::Curve ScoreROCCurve::getCurve() const
+{
+    std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+    return curve_;
+}
+
+ScoreROCCurve::Type ScoreROCCurve::getType() const
+{
+    return type_;
+}
+
+void ScoreROCCurve::saveData()
+{
+    ScoreHistogram::Curve curve = getCurve();
+
+    std::ofstream out(out_path_);
+    for (const ScoreHistogram::CurvePoint& p : curve.points) {
+        if (type_ == Type::ROC) {
+            out << p.false_positive_rate << " " << p.recall << " " << p.threshold << std::endl;
+        } else if (type_ == Type::PR) {
+            out << p.precision << " " << p.recall << " " << p.threshold << std::endl;
+        }
+    }
+}
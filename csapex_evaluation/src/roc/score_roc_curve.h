@@ -0,0 +1,65 @@
+#ifndef SCORE_ROC_CURVE_H
+#define SCORE_ROC_CURVE_H
+
+/// COMPONENT
+#include <csapex_evaluation/score_histogram.h>
+
+/// PROJECT
+#include <csapex/model/node.h>
+
+/// SYSTEM
+#include <mutex>
+
+namespace csapex
+{
+/**
+ * @brief The ScoreROCCurve class computes the complete ROC and precision/recall
+ *        curves of a binary classifier from the raw confidence scores.
+ *        In contrast to ROCCurve, a single replay of the data set suffices.
+ */
+class ScoreROCCurve : public Node
+{
+public:
+    enum class Type
+    {
+        ROC = 1,
+        PR = 2
+    };
+
+public:
+    ScoreROCCurve();
+
+    virtual void process() override;
+    virtual void setup(csapex::NodeModifier& node_modifier) override;
+    virtual void setupParameters(Parameterizable& parameters) override;
+
+    Type getType() const;
+    ScoreHistogram::Curve getCurve() const;
+
+public:
+    slim_signal::Signal<void()> display_request;
+
+private:
+    void reconfigure();
+    void saveData();
+
+private:
+    Input* in_truth_;
+    Input* in_classified_;
+
+    Output* out_roc_auc_;
+    Output* out_pr_auc_;
+
+    mutable std::recursive_mutex mutex_buffer_;
+
+    Type type_;
+    int positive_class_;
+    std::string out_path_;
+
+    ScoreHistogram histogram_;
+    ScoreHistogram::Curve curve_;
+};
+
+}  // namespace csapex
+
+#endif  // SCORE_ROC_CURVE_H
@@ -0,0 +1,84 @@
+/// HEADER
+#include "score_roc_curve_adapter.h"
+
+/// PROJECT
+#include <csapex/model/node_facade_impl.h>
+#include <csapex/view/utility/register_node_adapter.h>
+
+/// SYSTEM
+#include <QGridLayout>
+#include <qwt_plot.h>
+#include <qwt_plot_curve.h>
+
+using namespace csapex;
+
+CSAPEX_REGISTER_LOCAL_NODE_ADAPTER(ScoreROCCurveAdapter, csapex::ScoreROCCurve)
+
+ScoreROCCurveAdapter::ScoreROCCurveAdapter(NodeFacadeImplementationPtr worker, NodeBox* parent, std::weak_ptr<ScoreROCCurve> node)
+  : DefaultNodeAdapter(worker, parent), wrapped_(node), plot_widget_(nullptr)
+{
+    auto n = wrapped_.lock();
+    // translate to UI thread via Qt signal
+    observe(n->display_request, this, &ScoreROCCurveAdapter::displayRequest);
+}
+
+ScoreROCCurveAdapter::~ScoreROCCurveAdapter()
+{
+}
+
+void ScoreROCCurveAdapter::setupUi(QBoxLayout* layout)
+{
+    auto n = wrapped_.lock();
+
+    QGridLayout* grid = new QGridLayout;
+    layout->addLayout(grid);
+
+    plot_widget_ = new QwtPlot;
+    plot_widget_->setFixedSize(n->readParameter<int>("width"), n->readParameter<int>("height"));
+
+    plot_widget_->setAxisAutoScale(QwtPlot::xBottom, false);
+    plot_widget_->setAxisAutoScale(QwtPlot::yLeft, false);
+    plot_widget_->setAxisScale(QwtPlot::xBottom, 0.0, 1.0);
+    plot_widget_->setAxisScale(QwtPlot::yLeft, 0.0, 1.0);
+
+    roc_curve_ = new QwtPlotCurve("ROC");
+    roc_curve_->attach(plot_widget_);
+
+    grid->addWidget(plot_widget_, 1, 1);
+    connect(this, SIGNAL(displayRequest()), this, SLOT(display()));
+
+    DefaultNodeAdapter::setupUi(layout);
+}
+
+void ScoreROCCurveAdapter::display()
+{
+    auto node = wrapped_.lock();
+    if (!node) {
+        return;
+    }
+
+    ScoreHistogram::Curve curve = node->getCurve();
+
+    QVector<double> x;
+    QVector<double> y;
+    x.reserve(curve.points.size());
+    y.reserve(curve.points.size());
+
+    if (node->getType() == ScoreROCCurve::Type::ROC) {
+        for (const ScoreHistogram::CurvePoint& p : curve.points) {
+            x.push_back(p.false_positive_rate);
+            y.push_back(p.recall);
+        }
+
+    } else if (node->getType() == ScoreROCCurve::Type::PR) {
+        for (const ScoreHistogram::CurvePoint& p : curve.points) {
+            x.push_back(p.recall);
+            y.push_back(p.precision);
+        }
+    }
+
+    roc_curve_->setSamples(x, y);
+    plot_widget_->replot();
+}
+/// MOC
+#include "moc_score_roc_curve_adapter.cpp"
@@ -0,0 +1,40 @@
+#ifndef SCORE_ROC_CURVE_ADAPTER_H
+#define SCORE_ROC_CURVE_ADAPTER_H
+
+/// PROJECT
+#include <csapex/view/node/default_node_adapter.h>
+
+/// COMPONENT
+#include "score_roc_curve.h"
+
+/// SYSTEM
+#include <QWidget>
+#include <qwt_plot_curve.h>
+
+namespace csapex
+{
+class ScoreROCCurveAdapter : public QObject, public DefaultNodeAdapter
+{
+    Q_OBJECT
+
+public:
+    ScoreROCCurveAdapter(NodeFacadeImplementationPtr worker, NodeBox* parent, std::weak_ptr<ScoreROCCurve> node);
+    ~ScoreROCCurveAdapter();
+
+    virtual void setupUi(QBoxLayout* layout);
+
+public Q_SLOTS:
+    void display();
+
+Q_SIGNALS:
+    void displayRequest();
+
+protected:
+    std::weak_ptr<ScoreROCCurve> wrapped_;
+
+    QwtPlot* plot_widget_;
+    QwtPlotCurve* roc_curve_;
+};
+
+}  // namespace csapex
+#endif  // SCORE_ROC_CURVE_ADAPTER_H
@@ -0,0 +1,190 @@
+/// HEADER
+#include <csapex_evaluation/score_histogram.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace csapex;
+
+ScoreHistogram::ScoreHistogram(Mode mode, std::size_t bins, double min_score, double max_score, std::size_t max_samples)
+  : max_samples_(max_samples), next_sequence_(0), positives_(0), negatives_(0)
+{
+    configure(mode, bins, min_score, max_score, max_samples);
+}
+
+void ScoreHistogram::configure(Mode mode, std::size_t bins, double min_score, double max_score, std::size_t max_samples)
+{
+    if (bins == 0) {
+        throw std::invalid_argument("score histogram needs at least one bin");
+    }
+    if (!(max_score > min_score)) {
+        throw std::invalid_argument("score histogram needs a non-empty score range");
+    }
+    if (max_samples == 0) {
+        throw std::invalid_argument("score histogram needs to keep at least one sample");
+    }
+
+    mode_ = mode;
+    min_score_ = min_score;
+    max_score_ = max_score;
+    bin_scale_ = bins / (max_score - min_score);
+    max_samples_ = max_samples;
+
+    positive_bins_.assign(bins, 0);
+    negative_bins_.assign(bins, 0);
+
+    reset();
+}
+
+void ScoreHistogram::reset()
+{
+    std::fill(positive_bins_.begin(), positive_bins_.end(), 0);
+    std::fill(negative_bins_.begin(), negative_bins_.end(), 0);
+    samples_.clear();
+    pending_.clear();
+    next_sequence_ = 0;
+
+    positives_ = 0;
+    negatives_ = 0;
+}
+
+void ScoreHistogram::report(double score, bool positive)
+{
+    if (std::isnan(score)) {
+        return;
+    }
+
+    if (positive) {
+        ++positives_;
+    } else {
+        ++negatives_;
+    }
+
+    if (mode_ == Mode::EXACT) {
+        pending_.push_back(Sample{ score, positive, next_sequence_++ });
+        return;
+    }
+
+    const long max_bin = static_cast<long>(positive_bins_.size()) - 1;
+    long bin = static_cast<long>(std::floor((score - min_score_) * bin_scale_));
+    bin = std::max(0l, std::min(max_bin, bin));
+
+    if (positive) {
+        ++positive_bins_[bin];
+    } else {
+        ++negative_bins_[bin];
+    }
+}
+
+std::size_t ScoreHistogram::size() const
+{
+    return positives_ + negatives_;
+}
+
+bool ScoreHistogram::higherScore(const Sample& a, const Sample& b)
+{
+    return a.score > b.score;
+}
+
+void ScoreHistogram::merge()
+{
+    // drop the oldest samples, the pending ones are always newer than the merged ones
+    if (next_sequence_ > max_samples_) {
+        const uint64_t oldest = next_sequence_ - max_samples_;
+        auto is_old = [this, oldest](const Sample& s) {
+            if (s.sequence < oldest) {
+                if (s.positive) {
+                    --positives_;
+                } else {
+                    --negatives_;
+                }
+                return true;
+            }
+            return false;
+        };
+        samples_.erase(std::remove_if(samples_.begin(), samples_.end(), is_old), samples_.end());
+        pending_.erase(std::remove_if(pending_.begin(), pending_.end(), is_old), pending_.end());
+    }
+
+    std::sort(pending_.begin(), pending_.end(), higherScore);
+
+    const std::size_t middle = samples_.size();
+    samples_.insert(samples_.end(), pending_.begin(), pending_.end());
+    std::inplace_merge(samples_.begin(), samples_.begin() + middle, samples_.end(), higherScore);
+    pending_.clear();
+}
+
+ScoreHistogram::Curve ScoreHistogram::computeCurve()
+{
+    if (mode_ == Mode::EXACT) {
+        merge();
+    }
+
+    Curve curve;
+    curve.positives = positives_;
+    curve.negatives = negatives_;
+    curve.roc_auc = 0.0;
+    curve.pr_auc = 0.0;
+
+    // everything is rejected above the highest threshold
+    sweep(curve, 0, 0, std::numeric_limits<double>::infinity());
+
+    std::size_t tp = 0;
+    std::size_t fp = 0;
+
+    if (mode_ == Mode::EXACT) {
+        for (std::size_t i = 0; i < samples_.size();) {
+            const double threshold = samples_[i].score;
+            // all samples sharing a score switch class at the same threshold
+            for (; i < samples_.size() && samples_[i].score == threshold; ++i) {
+                if (samples_[i].positive) {
+                    ++tp;
+                } else {
+                    ++fp;
+                }
+            }
+            sweep(curve, tp, fp, threshold);
+        }
+
+    } else {
+        const double bin_width = 1.0 / bin_scale_;
+        for (std::size_t i = positive_bins_.size(); i > 0; --i) {
+            const std::size_t bin = i - 1;
+            if (positive_bins_[bin] == 0 && negative_bins_[bin] == 0) {
+                continue;
+            }
+            tp += positive_bins_[bin];
+            fp += negative_bins_[bin];
+            sweep(curve, tp, fp, min_score_ + bin * bin_width);
+        }
+    }
+
+    finish(curve);
+    return curve;
+}
+
+void ScoreHistogram::sweep(Curve& curve, std::size_t tp, std::size_t fp, double threshold) const
+{
+    CurvePoint point;
+    point.threshold = threshold;
+    point.recall = positives_ > 0 ? tp / static_cast<double>(positives_) : 0.0;
+    point.false_positive_rate = negatives_ > 0 ? fp / static_cast<double>(negatives_) : 0.0;
+    point.precision = (tp + fp) > 0 ? tp / static_cast<double>(tp + fp) : 1.0;
+
+    curve.points.push_back(point);
+}
+
+void ScoreHistogram::finish(Curve& curve) const
+{
+    // ROC: trapezoidal rule, PR: step-wise average precision
+    for (std::size_t i = 1; i < curve.points.size(); ++i) {
+        const CurvePoint& a = curve.points[i - 1];
+        const CurvePoint& b = curve.points[i];
+
+        curve.roc_auc += (b.false_positive_rate - a.false_positive_rate) * (a.recall + b.recall) / 2.0;
+        curve.pr_auc += (b.recall - a.recall) * b.precision;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef LINEAR_KERNELS_H
+#define LINEAR_KERNELS_H
+
+/// COMPONENT
+#include <csapex_math/csapex_math_export.h>
+
+/// SYSTEM
+#include <cstddef>
+
+namespace csapex
+{
+namespace math
+{
+namespace linear
+{
+/**
+ * Dense kernels on row-major double arrays, vectorized with AVX or SSE2 when available.
+ */
+namespace kernel
+{
+/// y += alpha * x
+CSAPEX_MATH_EXPORT void axpy(std::size_t n, double alpha, const double* x, double* y);
+/// x *= alpha
+CSAPEX_MATH_EXPORT void scale(std::size_t n, double alpha, double* x);
+/// returns x^T y
+CSAPEX_MATH_EXPORT double dot(std::size_t n, const double* x, const double* y);
+
+/// c = a * b with a (m x k), b (k x n), c (m x n), c must not overlap a or b
+CSAPEX_MATH_EXPORT void gemm(int m, int k, int n, const double* a, const double* b, double* c);
+/// y = a * x with a (m x n), y must not overlap a or x
+CSAPEX_MATH_EXPORT void gemv(int m, int n, const double* a, const double* x, double* y);
+/// dst (cols x rows) = src (rows x cols)^T, dst must not overlap src
+CSAPEX_MATH_EXPORT void transpose(int rows, int cols, const double* src, double* dst);
+
+}  // namespace kernel
+}  // namespace linear
+}  // namespace math
+}  // namespace csapex
+
+#endif  // LINEAR_KERNELS_H
@@ -0,0 +1,379 @@
+#ifndef LINEAR_ALGEBRA_H
+#define LINEAR_ALGEBRA_H
+
+/// COMPONENT
+#include <csapex_math/csapex_math_export.h>
+#include <csapex_math/model/kernels.h>
+#include <csapex_math/model/matrix.h>
+#include <csapex_math/model/vector.h>
+
+/// PROJECT
+#include <csapex/utility/assert.h>
+
+/// SYSTEM
+#include <cstddef>
+#include <vector>
+
+/**
+ * Arithmetic on Matrix and Vector is evaluated lazily: an expression like
+ * `a + 2.0 * b - c` builds a tree of small expression objects, which is
+ * evaluated in a single loop into the destination, without temporaries.
+ * Products are evaluated with the dense kernels when they are nested into
+ * another expression.
+ *
+ * Expressions reference their operands, so they must not outlive them:
+ * assign them to a Matrix instead of storing them with `auto`.
+ */
+namespace csapex
+{
+namespace math
+{
+namespace linear
+{
+template <typename L, typename R>
+class Product;
+
+namespace detail
+{
+/// how an expression is stored inside another one
+template <typename E>
+struct Nested
+{
+    typedef const E type;
+};
+template <>
+struct Nested<Matrix>
+{
+    typedef const Matrix& type;
+};
+/// products cannot be evaluated coefficient-wise, they are evaluated once when nested
+template <typename L, typename R>
+struct Nested<Product<L, R>>
+{
+    typedef const Matrix type;
+};
+
+/// operands of a product have to be stored densely
+template <typename E>
+struct Evaluated
+{
+    typedef const Matrix type;
+};
+template <>
+struct Evaluated<Matrix>
+{
+    typedef const Matrix& type;
+};
+
+template <typename E>
+void evalCoefficients(const E& expression, double* dst)
+{
+    const std::size_t n = static_cast<std::size_t>(expression.rows()) * expression.cols();
+    for (std::size_t i = 0; i < n; ++i) {
+        dst[i] = expression.coeff(i);
+    }
+}
+
+struct Add
+{
+    static double apply(double a, double b)
+    {
+        return a + b;
+    }
+};
+struct Subtract
+{
+    static double apply(double a, double b)
+    {
+        return a - b;
+    }
+};
+struct Multiply
+{
+    static double apply(double a, double b)
+    {
+        return a * b;
+    }
+};
+}  // namespace detail
+
+template <typename Op, typename L, typename R>
+class CoefficientWise : public MatrixExpression<CoefficientWise<Op, L, R>>
+{
+public:
+    CoefficientWise(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs)
+    {
+        apex_assert_equal(lhs_.rows(), rhs_.rows());
+        apex_assert_equal(lhs_.cols(), rhs_.cols());
+    }
+
+    int rows() const
+    {
+        return lhs_.rows();
+    }
+    int cols() const
+    {
+        return lhs_.cols();
+    }
+    double coeff(std::size_t index) const
+    {
+        return Op::apply(lhs_.coeff(index), rhs_.coeff(index));
+    }
+    bool references(const double* ptr) const
+    {
+        return lhs_.references(ptr) || rhs_.references(ptr);
+    }
+    bool isAliasSafe(const double* ptr) const
+    {
+        return lhs_.isAliasSafe(ptr) && rhs_.isAliasSafe(ptr);
+    }
+    void evalTo(double* dst) const
+    {
+        detail::evalCoefficients(*this, dst);
+    }
+
+private:
+    typename detail::Nested<L>::type lhs_;
+    typename detail::Nested<R>::type rhs_;
+};
+
+template <typename E>
+class Scaled : public MatrixExpression<Scaled<E>>
+{
+public:
+    Scaled(const E& expression, double factor) : expression_(expression), factor_(factor)
+    {
+    }
+
+    int rows() const
+    {
+        return expression_.rows();
+    }
+    int cols() const
+    {
+        return expression_.cols();
+    }
+    double coeff(std::size_t index) const
+    {
+        return factor_ * expression_.coeff(index);
+    }
+    bool references(const double* ptr) const
+    {
+        return expression_.references(ptr);
+    }
+    bool isAliasSafe(const double* ptr) const
+    {
+        return expression_.isAliasSafe(ptr);
+    }
+    void evalTo(double* dst) const
+    {
+        detail::evalCoefficients(*this, dst);
+    }
+
+private:
+    typename detail::Nested<E>::type expression_;
+    double factor_;
+};
+
+template <typename E>
+class Transposed : public MatrixExpression<Transposed<E>>
+{
+public:
+    Transposed(const E& expression) : expression_(expression)
+    {
+    }
+
+    int rows() const
+    {
+        return expression_.cols();
+    }
+    int cols() const
+    {
+        return expression_.rows();
+    }
+    double coeff(std::size_t index) const
+    {
+        const std::size_t row = index / cols();
+        const std::size_t col = index % cols();
+        return expression_.coeff(col * rows() + row);
+    }
+    bool references(const double* ptr) const
+    {
+        return expression_.references(ptr);
+    }
+    bool isAliasSafe(const double* ptr) const
+    {
+        // coefficients are read in a different order than they are written
+        return !expression_.references(ptr);
+    }
+    void evalTo(double* dst) const
+    {
+        evalTransposed(expression_, dst);
+    }
+
+private:
+    void evalTransposed(const Matrix& matrix, double* dst) const
+    {
+        kernel::transpose(matrix.rows(), matrix.cols(), matrix.data(), dst);
+    }
+    template <typename Other>
+    void evalTransposed(const Other& /*expression*/, double* dst) const
+    {
+        detail::evalCoefficients(*this, dst);
+    }
+
+private:
+    typename detail::Nested<E>::type expression_;
+};
+
+template <typename L, typename R>
+class Product : public MatrixExpression<Product<L, R>>
+{
+public:
+    Product(const L& lhs, const R& rhs) : lhs_(lhs), rhs_(rhs)
+    {
+        apex_assert_equal(lhs_.cols(), rhs_.rows());
+    }
+
+    int rows() const
+    {
+        return lhs_.rows();
+    }
+    int cols() const
+    {
+        return rhs_.cols();
+    }
+    bool references(const double* ptr) const
+    {
+        return lhs_.references(ptr) || rhs_.references(ptr);
+    }
+    bool isAliasSafe(const double* ptr) const
+    {
+        return !references(ptr);
+    }
+    void evalTo(double* dst) const
+    {
+        if (rhs_.cols() == 1) {
+            kernel::gemv(lhs_.rows(), lhs_.cols(), lhs_.data(), rhs_.data(), dst);
+        } else {
+            kernel::gemm(lhs_.rows(), lhs_.cols(), rhs_.cols(), lhs_.data(), rhs_.data(), dst);
+        }
+    }
+
+private:
+    typename detail::Evaluated<L>::type lhs_;
+    typename detail::Evaluated<R>::type rhs_;
+};
+
+/// OPERATORS
+template <typename L, typename R>
+CoefficientWise<detail::Add, L, R> operator+(const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+    return CoefficientWise<detail::Add, L, R>(lhs.derived(), rhs.derived());
+}
+
+template <typename L, typename R>
+CoefficientWise<detail::Subtract, L, R> operator-(const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+    return CoefficientWise<detail::Subtract, L, R>(lhs.derived(), rhs.derived());
+}
+
+template <typename E>
+Scaled<E> operator-(const MatrixExpression<E>& expression)
+{
+    return Scaled<E>(expression.derived(), -1.0);
+}
+
+template <typename E>
+Scaled<E> operator*(double factor, const MatrixExpression<E>& expression)
+{
+    return Scaled<E>(expression.derived(), factor);
+}
+
+template <typename E>
+Scaled<E> operator*(const MatrixExpression<E>& expression, double factor)
+{
+    return Scaled<E>(expression.derived(), factor);
+}
+
+template <typename E>
+Scaled<E> operator/(const MatrixExpression<E>& expression, double divisor)
+{
+    return Scaled<E>(expression.derived(), 1.0 / divisor);
+}
+
+/// matrix product
+template <typename L, typename R>
+Product<L, R> operator*(const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+    return Product<L, R>(lhs.derived(), rhs.derived());
+}
+
+/// element-wise product
+template <typename L, typename R>
+CoefficientWise<detail::Multiply, L, R> cwiseProduct(const MatrixExpression<L>& lhs, const MatrixExpression<R>& rhs)
+{
+    return CoefficientWise<detail::Multiply, L, R>(lhs.derived(), rhs.derived());
+}
+
+template <typename E>
+Transposed<E> transpose(const MatrixExpression<E>& expression)
+{
+    return Transposed<E>(expression.derived());
+}
+
+template <typename E>
+Matrix& operator+=(Matrix& lhs, const MatrixExpression<E>& rhs)
+{
+    return lhs = lhs + rhs;
+}
+
+template <typename E>
+Matrix& operator-=(Matrix& lhs, const MatrixExpression<E>& rhs)
+{
+    return lhs = lhs - rhs;
+}
+
+inline Matrix& operator*=(Matrix& lhs, double factor)
+{
+    kernel::scale(lhs.size(), factor, lhs.data());
+    return lhs;
+}
+
+/// DECOMPOSITION
+
+/**
+ * @brief The LUDecomposition class factors a square matrix with partial pivoting
+ */
+class CSAPEX_MATH_EXPORT LUDecomposition
+{
+public:
+    LUDecomposition(const Matrix& matrix);
+
+    bool isInvertible() const;
+    double determinant() const;
+
+    /// solves matrix * x = b for every column of b, throws if the matrix is singular
+    Matrix solve(const Matrix& b) const;
+    /// throws if the matrix is singular
+    Matrix inverse() const;
+
+private:
+    Matrix lu_;
+    std::vector<int> pivots_;
+    int sign_;
+    bool singular_;
+};
+
+/// solves a * x = b, throws std::runtime_error if a is not square or singular
+CSAPEX_MATH_EXPORT Matrix solve(const Matrix& a, const Matrix& b);
+/// throws std::runtime_error if a is not square or singular
+CSAPEX_MATH_EXPORT Matrix inverse(const Matrix& a);
+
+CSAPEX_MATH_EXPORT Matrix identity(int size);
+
+}  // namespace linear
+}  // namespace math
+}  // namespace csapex
+
+#endif  // LINEAR_ALGEBRA_H
@@ -3,7 +3,7 @@
 
 /// COMPONENT
 #include <csapex_math/csapex_math_export.h>
-#include <csapex_math/model/matrix.h>
+#include <csapex_math/model/matrix_expression.h>
 
 /// SYSTEM
 #include <iosfwd>
@@ -15,7 +15,7 @@ namespace math
 {
 namespace linear
 {
-class CSAPEX_MATH_EXPORT Matrix
+class CSAPEX_MATH_EXPORT Matrix : public MatrixExpression<Matrix>
 {
     friend std::ostream& operator<<(std::ostream& stream, const Matrix& v);
 
@@ -24,6 +24,20 @@ public:
     Matrix(const int rows, const int cols, std::vector<double> value);
     Matrix(const int rows, const int cols, std::initializer_list<double> value);
 
+    /// evaluates the expression, see linear_algebra.h
+    template <typename E>
+    Matrix(const MatrixExpression<E>& expression)
+    {
+        assign(expression.derived());
+    }
+
+    template <typename E>
+    Matrix& operator=(const MatrixExpression<E>& expression)
+    {
+        assign(expression.derived());
+        return *this;
+    }
+
     double operator()(const int row, const int col) const;
     double& operator()(const int row, const int col);
 
@@ -48,9 +62,54 @@ public:
     const std::vector<double>& getDataRef() const;
     std::vector<double> getData() const;
 
+    /// row-major coefficients
+    double* data()
+    {
+        return data_.data();
+    }
+    const double* data() const
+    {
+        return data_.data();
+    }
+
+    /// expression interface
+    double coeff(std::size_t index) const
+    {
+        return data_[index];
+    }
+    bool references(const double* ptr) const
+    {
+        return !data_.empty() && data_.data() == ptr;
+    }
+    bool isAliasSafe(const double* /*ptr*/) const
+    {
+        return true;
+    }
+    void evalTo(double* dst) const;
+
+protected:
+    template <typename E>
+    void assign(const E& expression)
+    {
+        if (!data_.empty() && !expression.isAliasSafe(data_.data())) {
+            // the expression reads coefficients of this matrix after they would have been overwritten
+            Matrix tmp;
+            tmp.assign(expression);
+            *this = std::move(tmp);
+            return;
+        }
+
+        rows_ = expression.rows();
+        cols_ = expression.cols();
+        data_.resize(static_cast<std::size_t>(rows_) * cols_);
+        if (!data_.empty()) {
+            expression.evalTo(data_.data());
+        }
+    }
+
 protected:
-    int rows_;
-    int cols_;
+    int rows_ = 0;
+    int cols_ = 0;
     std::vector<double> data_;
 };
 
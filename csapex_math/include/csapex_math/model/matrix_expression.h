@@ -0,0 +1,32 @@
+#ifndef MATRIX_EXPRESSION_H
+#define MATRIX_EXPRESSION_H
+
+namespace csapex
+{
+namespace math
+{
+namespace linear
+{
+/**
+ * @brief The MatrixExpression class is the base of all (lazily evaluated) matrix expressions.
+ *
+ * Every expression provides rows(), cols(), references(ptr), isAliasSafe(ptr)
+ * and evalTo(dst), which writes the row-major result to dst.
+ * Coefficient-wise expressions additionally provide coeff(i), the i-th
+ * coefficient in row-major order.
+ */
+template <typename Derived>
+class MatrixExpression
+{
+public:
+    const Derived& derived() const
+    {
+        return static_cast<const Derived&>(*this);
+    }
+};
+
+}  // namespace linear
+}  // namespace math
+}  // namespace csapex
+
+#endif  // MATRIX_EXPRESSION_H
@@ -5,6 +5,9 @@
 #include <csapex_math/csapex_math_export.h>
 #include <csapex_math/model/matrix.h>
 
+/// PROJECT
+#include <csapex/utility/assert.h>
+
 /// SYSTEM
 #include <iosfwd>
 #include <vector>
@@ -24,6 +27,21 @@ public:
     Vector(std::vector<double> value);
     Vector(std::initializer_list<double> value);
 
+    /// evaluates the expression, which has to have exactly one column
+    template <typename E>
+    Vector(const MatrixExpression<E>& expression) : Matrix(expression)
+    {
+        apex_assert_equal(cols_, 1);
+    }
+
+    template <typename E>
+    Vector& operator=(const MatrixExpression<E>& expression)
+    {
+        Matrix::operator=(expression);
+        apex_assert_equal(cols_, 1);
+        return *this;
+    }
+
     double operator()(const int row) const;
     double& operator()(const int row);
     double operator[](const int row) const;
@@ -0,0 +1,129 @@
+/// HEADER
+#include <csapex_math/model/kernels.h>
+
+/// SYSTEM
+#include <algorithm>
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace csapex;
+using namespace csapex::math;
+using namespace csapex::math::linear;
+
+namespace
+{
+// rows of b processed per pass in gemm, 128 rows of 512 doubles fit into a typical L2 cache
+const int BLOCK_K = 128;
+const int BLOCK_N = 512;
+}  // namespace
+
+void kernel::axpy(std::size_t n, double alpha, const double* x, double* y)
+{
+    std::size_t i = 0;
+#if defined(__AVX__)
+    const __m256d a = _mm256_set1_pd(alpha);
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_mul_pd(a, _mm256_loadu_pd(x + i)));
+        _mm256_storeu_pd(y + i, v);
+    }
+#elif defined(__SSE2__)
+    const __m128d a = _mm_set1_pd(alpha);
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(a, _mm_loadu_pd(x + i)));
+        _mm_storeu_pd(y + i, v);
+    }
+#endif
+    for (; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+}
+
+void kernel::scale(std::size_t n, double alpha, double* x)
+{
+    std::size_t i = 0;
+#if defined(__AVX__)
+    const __m256d a = _mm256_set1_pd(alpha);
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(x + i, _mm256_mul_pd(a, _mm256_loadu_pd(x + i)));
+    }
+#elif defined(__SSE2__)
+    const __m128d a = _mm_set1_pd(alpha);
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(x + i, _mm_mul_pd(a, _mm_loadu_pd(x + i)));
+    }
+#endif
+    for (; i < n; ++i) {
+        x[i] *= alpha;
+    }
+}
+
+double kernel::dot(std::size_t n, const double* x, const double* y)
+{
+    std::size_t i = 0;
+    double sum = 0.0;
+#if defined(__AVX__)
+    __m256d acc = _mm256_setzero_pd();
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+    }
+    double parts[4];
+    _mm256_storeu_pd(parts, acc);
+    sum = parts[0] + parts[1] + parts[2] + parts[3];
+#elif defined(__SSE2__)
+    __m128d acc = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+        acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+    }
+    double parts[2];
+    _mm_storeu_pd(parts, acc);
+    sum = parts[0] + parts[1];
+#endif
+    for (; i < n; ++i) {
+        sum += x[i] * y[i];
+    }
+    return sum;
+}
+
+void kernel::gemm(int m, int k, int n, const double* a, const double* b, double* c)
+{
+    std::fill(c, c + static_cast<std::size_t>(m) * n, 0.0);
+
+    // c(i, :) += a(i, p) * b(p, :), blocked so that the used part of b stays in cache
+    for (int p0 = 0; p0 < k; p0 += BLOCK_K) {
+        const int p1 = std::min(k, p0 + BLOCK_K);
+        for (int j0 = 0; j0 < n; j0 += BLOCK_N) {
+            const int nj = std::min(n, j0 + BLOCK_N) - j0;
+            for (int i = 0; i < m; ++i) {
+                const double* a_row = a + static_cast<std::size_t>(i) * k;
+                double* c_row = c + static_cast<std::size_t>(i) * n + j0;
+                for (int p = p0; p < p1; ++p) {
+                    axpy(nj, a_row[p], b + static_cast<std::size_t>(p) * n + j0, c_row);
+                }
+            }
+        }
+    }
+}
+
+void kernel::gemv(int m, int n, const double* a, const double* x, double* y)
+{
+    for (int i = 0; i < m; ++i) {
+        y[i] = dot(n, a + static_cast<std::size_t>(i) * n, x);
+    }
+}
+
+void kernel::transpose(int rows, int cols, const double* src, double* dst)
+{
+    const int BLOCK = 32;
+    for (int r0 = 0; r0 < rows; r0 += BLOCK) {
+        const int r1 = std::min(rows, r0 + BLOCK);
+        for (int c0 = 0; c0 < cols; c0 += BLOCK) {
+            const int c1 = std::min(cols, c0 + BLOCK);
+            for (int r = r0; r < r1; ++r) {
+                for (int c = c0; c < c1; ++c) {
+                    dst[static_cast<std::size_t>(c) * rows + r] = src[static_cast<std::size_t>(r) * cols + c];
+                }
+            }
+        }
+    }
+}
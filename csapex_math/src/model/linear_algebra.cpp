@@ -0,0 +1,145 @@
+/// HEADER
+#include <csapex_math/model/linear_algebra.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+using namespace csapex;
+using namespace csapex::math;
+using namespace csapex::math::linear;
+
+LUDecomposition::LUDecomposition(const Matrix& matrix) : lu_(matrix), sign_(1), singular_(false)
+{
+    if (matrix.rows() != matrix.cols()) {
+        throw std::runtime_error("LU decomposition requires a square matrix");
+    }
+
+    const int n = matrix.rows();
+    double* a = lu_.data();
+
+    pivots_.resize(n);
+    for (int i = 0; i < n; ++i) {
+        pivots_[i] = i;
+    }
+
+    double norm = 0.0;
+    for (std::size_t i = 0; i < lu_.size(); ++i) {
+        norm = std::max(norm, std::abs(a[i]));
+    }
+    const double tolerance = n * std::numeric_limits<double>::epsilon() * norm;
+
+    // Doolittle elimination, the row updates are done with the axpy kernel
+    for (int k = 0; k < n; ++k) {
+        int pivot = k;
+        double max = std::abs(a[k * n + k]);
+        for (int i = k + 1; i < n; ++i) {
+            const double v = std::abs(a[i * n + k]);
+            if (v > max) {
+                max = v;
+                pivot = i;
+            }
+        }
+
+        if (max <= tolerance) {
+            singular_ = true;
+            continue;
+        }
+
+        if (pivot != k) {
+            std::swap_ranges(a + pivot * n, a + (pivot + 1) * n, a + k * n);
+            std::swap(pivots_[pivot], pivots_[k]);
+            sign_ = -sign_;
+        }
+
+        const double* row_k = a + k * n;
+        for (int i = k + 1; i < n; ++i) {
+            double* row_i = a + i * n;
+            const double factor = row_i[k] / row_k[k];
+            row_i[k] = factor;
+            kernel::axpy(n - k - 1, -factor, row_k + k + 1, row_i + k + 1);
+        }
+    }
+}
+
+bool LUDecomposition::isInvertible() const
+{
+    return !singular_;
+}
+
+double LUDecomposition::determinant() const
+{
+    if (singular_) {
+        return 0.0;
+    }
+    double det = sign_;
+    for (int i = 0; i < lu_.rows(); ++i) {
+        det *= lu_(i, i);
+    }
+    return det;
+}
+
+Matrix LUDecomposition::solve(const Matrix& b) const
+{
+    if (singular_) {
+        throw std::runtime_error("cannot solve a linear system with a singular matrix");
+    }
+    if (b.rows() != lu_.rows()) {
+        throw std::runtime_error("right hand side has the wrong number of rows");
+    }
+
+    const int n = lu_.rows();
+    const int m = b.cols();
+    const double* a = lu_.data();
+
+    // permute the rows of b
+    Matrix x(n, m, std::vector<double>(static_cast<std::size_t>(n) * m));
+    for (int i = 0; i < n; ++i) {
+        std::copy(b.data() + pivots_[i] * m, b.data() + (pivots_[i] + 1) * m, x.data() + i * m);
+    }
+
+    // forward substitution with the unit lower triangle, all columns at once
+    double* xd = x.data();
+    for (int k = 0; k < n; ++k) {
+        for (int i = k + 1; i < n; ++i) {
+            kernel::axpy(m, -a[i * n + k], xd + k * m, xd + i * m);
+        }
+    }
+
+    // back substitution with the upper triangle
+    for (int k = n - 1; k >= 0; --k) {
+        kernel::scale(m, 1.0 / a[k * n + k], xd + k * m);
+        for (int i = 0; i < k; ++i) {
+            kernel::axpy(m, -a[i * n + k], xd + k * m, xd + i * m);
+        }
+    }
+
+    return x;
+}
+
+Matrix LUDecomposition::inverse() const
+{
+    return solve(identity(lu_.rows()));
+}
+
+Matrix linear::solve(const Matrix& a, const Matrix& b)
+{
+    return LUDecomposition(a).solve(b);
+}
+
+Matrix linear::inverse(const Matrix& a)
+{
+    return LUDecomposition(a).inverse();
+}
+
+Matrix linear::identity(int size)
+{
+    Matrix result(size, size, std::vector<double>(static_cast<std::size_t>(size) * size, 0.0));
+    for (int i = 0; i < size; ++i) {
+        result(i, i) = 1.0;
+    }
+    return result;
+}
@@ -3,6 +3,7 @@
 
 /// PROJECT
 #include <csapex/utility/assert.h>
+#include <cstring>
 #include <iostream>
 
 using namespace csapex;
@@ -43,6 +44,13 @@ int Matrix::cols() const
     return cols_;
 }
 
+void Matrix::evalTo(double* dst) const
+{
+    if (dst != data_.data() && !data_.empty()) {
+        std::memcpy(dst, data_.data(), data_.size() * sizeof(double));
+    }
+}
+
 const std::vector<double>& Matrix::getDataRef() const
 {
     return data_;
@@ -0,0 +1,142 @@
+/// PROJECT
+#include <csapex/model/node.h>
+#include <csapex/model/node_modifier.h>
+#include <csapex/msg/io.h>
+#include <csapex/param/parameter_factory.h>
+#include <csapex/utility/register_apex_plugin.h>
+
+/// COMPONENT
+#include <csapex_math/model/linear_algebra.h>
+#include <csapex_math/msg/linear_matrix_message.h>
+#include <csapex_math/msg/linear_vector_message.h>
+
+/// SYSTEM
+#include <cmath>
+
+using namespace csapex;
+using namespace csapex::connection_types;
+
+namespace csapex
+{
+/**
+ * @brief The BatchVectorOperation class applies one operation to every row of a matrix,
+ *        each row is treated as a vector
+ */
+class BatchVectorOperation : public Node
+{
+    enum Operation
+    {
+        ADD,
+        SUBTRACT,
+        MULTIPLY,
+        SCALE,
+        NORMALIZE,
+        DOT,
+        NORM
+    };
+
+public:
+    BatchVectorOperation()
+    {
+    }
+
+    void setup(csapex::NodeModifier& modifier) override
+    {
+        in_ = modifier.addInput<LinearMatrixMessage>("vectors");
+        in_operand_ = modifier.addOptionalInput<LinearVectorMessage>("operand");
+        out_ = modifier.addOutput<LinearMatrixMessage>("result");
+    }
+
+    void setupParameters(csapex::Parameterizable& params) override
+    {
+        std::map<std::string, int> operations = { { "add operand", ADD },          { "subtract operand", SUBTRACT }, { "multiply by operand (element-wise)", MULTIPLY },
+                                                   { "scale", SCALE },             { "normalize", NORMALIZE },       { "dot product with operand", DOT },
+                                                   { "euclidean norm", NORM } };
+        params.addParameter(param::factory::declareParameterSet("operation", operations, (int)ADD), operation_);
+
+        params.addConditionalParameter(param::factory::declareValue("factor", 1.0), [this]() { return operation_ == SCALE; }, factor_);
+    }
+
+    void process() override
+    {
+        LinearMatrixMessage::ConstPtr in = msg::getMessage<LinearMatrixMessage>(in_);
+        const math::linear::Matrix& vectors = in->value;
+
+        const int rows = vectors.rows();
+        const int cols = vectors.cols();
+
+        math::linear::Vector operand;
+        if (operation_ == ADD || operation_ == SUBTRACT || operation_ == MULTIPLY || operation_ == DOT) {
+            if (!msg::hasMessage(in_operand_)) {
+                throw std::runtime_error("the selected operation requires an operand");
+            }
+            operand = msg::getMessage<LinearVectorMessage>(in_operand_)->value;
+            if (static_cast<int>(operand.size()) != cols) {
+                throw std::runtime_error("the operand has " + std::to_string(operand.size()) + " entries, the vectors have " + std::to_string(cols));
+            }
+        }
+
+        LinearMatrixMessage::Ptr result = std::make_shared<LinearMatrixMessage>(math::linear::Matrix(), in->frame_id, in->stamp_micro_seconds);
+        math::linear::Matrix& out = result->value;
+
+        switch (operation_) {
+            case ADD:
+            case SUBTRACT: {
+                out = vectors;
+                const double sign = operation_ == ADD ? 1.0 : -1.0;
+                for (int row = 0; row < rows; ++row) {
+                    math::linear::kernel::axpy(cols, sign, operand.data(), out.data() + row * cols);
+                }
+                break;
+            }
+            case MULTIPLY: {
+                out = vectors;
+                double* data = out.data();
+                const double* factors = operand.data();
+                for (int row = 0; row < rows; ++row, data += cols) {
+                    for (int col = 0; col < cols; ++col) {
+                        data[col] *= factors[col];
+                    }
+                }
+                break;
+            }
+            case SCALE:
+                out = factor_ * vectors;
+                break;
+            case NORMALIZE:
+                out = vectors;
+                for (int row = 0; row < rows; ++row) {
+                    double* vector = out.data() + row * cols;
+                    const double norm = std::sqrt(math::linear::kernel::dot(cols, vector, vector));
+                    if (norm > 0.0) {
+                        math::linear::kernel::scale(cols, 1.0 / norm, vector);
+                    }
+                }
+                break;
+            case DOT:
+                out = vectors * operand;
+                break;
+            case NORM:
+                out.resize(rows, 1);
+                for (int row = 0; row < rows; ++row) {
+                    const double* vector = vectors.data() + row * cols;
+                    out(row, 0) = std::sqrt(math::linear::kernel::dot(cols, vector, vector));
+                }
+                break;
+        }
+
+        msg::publish(out_, result);
+    }
+
+private:
+    Input* in_;
+    Input* in_operand_;
+    Output* out_;
+
+    int operation_;
+    double factor_;
+};
+
+}  // namespace csapex
+
+CSAPEX_REGISTER_CLASS(csapex::BatchVectorOperation, csapex::Node)
@@ -0,0 +1,76 @@
+/// PROJECT
+#include <csapex/model/node.h>
+#include <csapex/model/node_modifier.h>
+#include <csapex/msg/io.h>
+#include <csapex/param/parameter_factory.h>
+#include <csapex/utility/register_apex_plugin.h>
+
+/// COMPONENT
+#include <csapex_math/model/linear_algebra.h>
+#include <csapex_math/msg/linear_matrix_message.h>
+
+using namespace csapex;
+using namespace csapex::connection_types;
+
+namespace csapex
+{
+class MatrixMultiply : public Node
+{
+public:
+    MatrixMultiply()
+    {
+    }
+
+    void setup(csapex::NodeModifier& modifier) override
+    {
+        in_a_ = modifier.addInput<LinearMatrixMessage>("A");
+        in_b_ = modifier.addInput<LinearMatrixMessage>("B");
+        out_ = modifier.addOutput<LinearMatrixMessage>("A * B");
+    }
+
+    void setupParameters(csapex::Parameterizable& params) override
+    {
+        params.addParameter(param::factory::declareBool("transpose A", false), transpose_a_);
+        params.addParameter(param::factory::declareBool("transpose B", false), transpose_b_);
+    }
+
+    void process() override
+    {
+        LinearMatrixMessage::ConstPtr a = msg::getMessage<LinearMatrixMessage>(in_a_);
+        LinearMatrixMessage::ConstPtr b = msg::getMessage<LinearMatrixMessage>(in_b_);
+
+        const math::linear::Matrix& lhs = a->value;
+        const math::linear::Matrix& rhs = b->value;
+
+        const int inner_a = transpose_a_ ? lhs.rows() : lhs.cols();
+        const int inner_b = transpose_b_ ? rhs.cols() : rhs.rows();
+        if (inner_a != inner_b) {
+            throw std::runtime_error("matrix dimensions do not match: " + std::to_string(inner_a) + " != " + std::to_string(inner_b));
+        }
+
+        LinearMatrixMessage::Ptr result = std::make_shared<LinearMatrixMessage>(math::linear::Matrix(), a->frame_id, a->stamp_micro_seconds);
+        if (transpose_a_ && transpose_b_) {
+            result->value = math::linear::transpose(lhs) * math::linear::transpose(rhs);
+        } else if (transpose_a_) {
+            result->value = math::linear::transpose(lhs) * rhs;
+        } else if (transpose_b_) {
+            result->value = lhs * math::linear::transpose(rhs);
+        } else {
+            result->value = lhs * rhs;
+        }
+
+        msg::publish(out_, result);
+    }
+
+private:
+    Input* in_a_;
+    Input* in_b_;
+    Output* out_;
+
+    bool transpose_a_;
+    bool transpose_b_;
+};
+
+}  // namespace csapex
+
+CSAPEX_REGISTER_CLASS(csapex::MatrixMultiply, csapex::Node)
@@ -0,0 +1,69 @@
+/// PROJECT
+#include <csapex/model/node.h>
+#include <csapex/model/node_modifier.h>
+#include <csapex/msg/io.h>
+#include <csapex/param/parameter_factory.h>
+#include <csapex/utility/register_apex_plugin.h>
+
+/// COMPONENT
+#include <csapex_math/model/linear_algebra.h>
+#include <csapex_math/msg/linear_matrix_message.h>
+
+using namespace csapex;
+using namespace csapex::connection_types;
+
+namespace csapex
+{
+/**
+ * @brief The SolveLinearSystem class solves A * X = B with an LU decomposition,
+ *        without B it outputs the inverse of A
+ */
+class SolveLinearSystem : public Node
+{
+public:
+    SolveLinearSystem()
+    {
+    }
+
+    void setup(csapex::NodeModifier& modifier) override
+    {
+        in_a_ = modifier.addInput<LinearMatrixMessage>("A");
+        in_b_ = modifier.addOptionalInput<LinearMatrixMessage>("B");
+        out_ = modifier.addOutput<LinearMatrixMessage>("X");
+        out_determinant_ = modifier.addOutput<double>("det(A)");
+    }
+
+    void process() override
+    {
+        LinearMatrixMessage::ConstPtr a = msg::getMessage<LinearMatrixMessage>(in_a_);
+
+        math::linear::LUDecomposition lu(a->value);
+        if (msg::isConnected(out_determinant_)) {
+            msg::publish(out_determinant_, lu.determinant());
+        }
+
+        if (!lu.isInvertible()) {
+            throw std::runtime_error("matrix A is singular");
+        }
+
+        LinearMatrixMessage::Ptr result = std::make_shared<LinearMatrixMessage>(math::linear::Matrix(), a->frame_id, a->stamp_micro_seconds);
+        if (msg::hasMessage(in_b_)) {
+            LinearMatrixMessage::ConstPtr b = msg::getMessage<LinearMatrixMessage>(in_b_);
+            result->value = lu.solve(b->value);
+        } else {
+            result->value = lu.inverse();
+        }
+
+        msg::publish(out_, result);
+    }
+
+private:
+    Input* in_a_;
+    Input* in_b_;
+    Output* out_;
+    Output* out_determinant_;
+};
+
+}  // namespace csapex
+
+CSAPEX_REGISTER_CLASS(csapex::SolveLinearSystem, csapex::Node)
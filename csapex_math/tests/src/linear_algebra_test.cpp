@@ -0,0 +1,172 @@
+#include <csapex_math/model/linear_algebra.h>
+
+#include <gtest/gtest.h>
+
+using namespace csapex;
+using namespace csapex::math::linear;
+
+namespace
+{
+Matrix naiveProduct(const Matrix& a, const Matrix& b)
+{
+    Matrix c(a.rows(), b.cols(), std::vector<double>(a.rows() * b.cols(), 0.0));
+    for (int i = 0; i < a.rows(); ++i) {
+        for (int j = 0; j < b.cols(); ++j) {
+            for (int k = 0; k < a.cols(); ++k) {
+                c(i, j) += a(i, k) * b(k, j);
+            }
+        }
+    }
+    return c;
+}
+
+Matrix makeMatrix(int rows, int cols, int seed)
+{
+    std::vector<double> data(rows * cols);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = ((i * 7919 + seed * 104729) % 201) / 100.0 - 1.0;
+    }
+    return Matrix(rows, cols, data);
+}
+
+void expectNear(const Matrix& expected, const Matrix& actual, double tolerance = 1e-9)
+{
+    ASSERT_EQ(expected.rows(), actual.rows());
+    ASSERT_EQ(expected.cols(), actual.cols());
+    for (int r = 0; r < expected.rows(); ++r) {
+        for (int c = 0; c < expected.cols(); ++c) {
+            EXPECT_NEAR(expected(r, c), actual(r, c), tolerance) << "at (" << r << ", " << c << ")";
+        }
+    }
+}
+
+}  // namespace
+
+TEST(LinearAlgebraTest, CoefficientWiseExpressions)
+{
+    Matrix a(2, 2, { 1, 2, 3, 4 });
+    Matrix b(2, 2, { 4, 3, 2, 1 });
+
+    Matrix expected(2, 2, { 8.5, 7, 5.5, 4 });
+    Matrix actual = a + 2.0 * b - a / 2.0;
+
+    ASSERT_EQ(expected, actual);
+    ASSERT_EQ(Matrix(2, 2, { 4, 6, 6, 4 }), Matrix(cwiseProduct(a, b)));
+    ASSERT_EQ(Matrix(2, 2, { -1, -2, -3, -4 }), Matrix(-a));
+}
+
+TEST(LinearAlgebraTest, CompoundAssignment)
+{
+    Matrix a(2, 2, { 1, 2, 3, 4 });
+    Matrix b(2, 2, { 1, 1, 1, 1 });
+
+    a += b;
+    ASSERT_EQ(Matrix(2, 2, { 2, 3, 4, 5 }), a);
+    a -= 2.0 * b;
+    ASSERT_EQ(Matrix(2, 2, { 0, 1, 2, 3 }), a);
+    a *= 3.0;
+    ASSERT_EQ(Matrix(2, 2, { 0, 3, 6, 9 }), a);
+}
+
+TEST(LinearAlgebraTest, Transpose)
+{
+    Matrix a(2, 3, { 1, 2, 3, 4, 5, 6 });
+    ASSERT_EQ(Matrix(3, 2, { 1, 4, 2, 5, 3, 6 }), Matrix(transpose(a)));
+
+    Matrix large = makeMatrix(70, 45, 1);
+    Matrix t = transpose(large);
+    for (int r = 0; r < large.rows(); ++r) {
+        for (int c = 0; c < large.cols(); ++c) {
+            ASSERT_EQ(large(r, c), t(c, r));
+        }
+    }
+}
+
+TEST(LinearAlgebraTest, TransposeInPlace)
+{
+    Matrix a(2, 2, { 1, 2, 3, 4 });
+    a = a + transpose(a);
+    ASSERT_EQ(Matrix(2, 2, { 2, 5, 5, 8 }), a);
+
+    Matrix b(2, 3, { 1, 2, 3, 4, 5, 6 });
+    b = transpose(b);
+    ASSERT_EQ(Matrix(3, 2, { 1, 4, 2, 5, 3, 6 }), b);
+}
+
+TEST(LinearAlgebraTest, ProductMatchesNaiveImplementation)
+{
+    Matrix a = makeMatrix(33, 150, 1);
+    Matrix b = makeMatrix(150, 17, 2);
+
+    expectNear(naiveProduct(a, b), a * b);
+}
+
+TEST(LinearAlgebraTest, ProductInsideExpression)
+{
+    Matrix a = makeMatrix(5, 7, 1);
+    Matrix b = makeMatrix(7, 5, 2);
+    Matrix c = makeMatrix(5, 5, 3);
+
+    Matrix expected = naiveProduct(a, b);
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        expected.data()[i] = 2.0 * expected.data()[i] + c.data()[i];
+    }
+
+    expectNear(expected, 2.0 * (a * b) + c);
+}
+
+TEST(LinearAlgebraTest, ProductInPlace)
+{
+    Matrix a = makeMatrix(6, 6, 1);
+    Matrix expected = naiveProduct(a, a);
+
+    a = a * a;
+    expectNear(expected, a);
+}
+
+TEST(LinearAlgebraTest, MatrixVectorProduct)
+{
+    Matrix rotation(3, 3, { 0, -1, 0, 1, 0, 0, 0, 0, 1 });
+    Vector v{ 1, 2, 3 };
+
+    Vector rotated = rotation * v;
+    ASSERT_EQ(Vector({ -2, 1, 3 }), rotated);
+}
+
+TEST(LinearAlgebraTest, Solve)
+{
+    Matrix a(3, 3, { 0, 2, 1, 1, 1, 1, 2, 1, 0 });
+    Matrix x(3, 2, { 1, 4, 2, 5, 3, 6 });
+
+    expectNear(x, solve(a, a * x));
+}
+
+TEST(LinearAlgebraTest, Inverse)
+{
+    Matrix a = makeMatrix(20, 20, 5) + 10.0 * identity(20);
+
+    expectNear(identity(20), a * inverse(a));
+    expectNear(identity(20), inverse(a) * a);
+}
+
+TEST(LinearAlgebraTest, Determinant)
+{
+    Matrix a(3, 3, { 0, 2, 1, 1, 1, 1, 2, 1, 0 });
+    EXPECT_NEAR(3.0, LUDecomposition(a).determinant(), 1e-12);
+}
+
+TEST(LinearAlgebraTest, SingularMatrixIsDetected)
+{
+    Matrix a(2, 2, { 1, 2, 2, 4 });
+
+    LUDecomposition lu(a);
+    ASSERT_FALSE(lu.isInvertible());
+    ASSERT_EQ(0.0, lu.determinant());
+    ASSERT_THROW(inverse(a), std::runtime_error);
+}
+
+TEST(LinearAlgebraTest, NonSquareMatrixCannotBeInverted)
+{
+    Matrix a(2, 3, { 1, 2, 3, 4, 5, 6 });
+    ASSERT_THROW(inverse(a), std::runtime_error);
+}
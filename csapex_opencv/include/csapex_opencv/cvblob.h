@@ -270,6 +270,19 @@ typedef std::pair<CvLabel, CvBlob*> CvLabelBlob;
 /// blobs. \return Number of pixels that has been labeled.
 CVBLOB_EXPORT unsigned int cvLabel(IplImage const* img, IplImage* imgOut, CvBlobs& blobs);
 
+/// \fn unsigned int cvLabelRuns(cv::Mat const &img, cv::Mat &imgOut, CvBlobs
+/// &blobs, unsigned int stripes=1, bool contours=true) \brief Label the
+/// connected parts (8-connectivity) of a binary image. Each row is run-length
+/// encoded and overlapping runs of adjacent rows are merged with union-find.
+/// Bounding boxes and moments are accumulated per run in the same pass, labels
+/// are numbered in the same order as cvLabel. \param img Input binary image
+/// (CV_8UC1). \param imgOut Output label image (CV_32SC1 holding CvLabel
+/// values, allocated if necessary). \param blobs List of blobs. \param stripes
+/// Number of row stripes that are encoded and merged in parallel. \param
+/// contours Trace the external contour of each blob. Internal contours are not
+/// computed. \return Number of pixels that has been labeled. \see cvLabel
+CVBLOB_EXPORT unsigned int cvLabelRuns(cv::Mat const& img, cv::Mat& imgOut, CvBlobs& blobs, unsigned int stripes = 1, bool contours = true);
+
 // IplImage *cvFilterLabel(IplImage *imgIn, CvLabel label);
 
 /// \fn void cvFilterLabels(IplImage *imgIn, IplImage *imgOut, const CvBlobs
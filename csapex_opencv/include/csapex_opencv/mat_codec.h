@@ -0,0 +1,128 @@
+#ifndef MAT_CODEC_H
+#define MAT_CODEC_H
+
+/// COMPONENT
+#include <csapex_opencv/csapex_opencv_export.h>
+
+/// SYSTEM
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief Codecs used when serializing a cv::Mat.
+ *
+ * Codecs that cannot represent a matrix (e.g. JPEG for floating point
+ * images) fall back to LZ, so every matrix can be written with every codec.
+ */
+enum class MatCodec : uint8_t
+{
+    /// uncompressed bytes
+    RAW = 0,
+    /// fast lossless byte-oriented compression (LZ77 with a hash table)
+    LZ = 1,
+    /// lossless, 8 and 16 bit images with 1, 3 or 4 channels
+    PNG = 2,
+    /// lossy, 8 bit images with 1 or 3 channels
+    JPEG = 3,
+    /// only a reference to a shared memory segment is written, same host only, see shm::store
+    SHARED_MEMORY = 4
+};
+
+/// parses "raw", "lz", "png", "jpeg" or "shared_memory", returns false for unknown names
+CSAPEX_OPENCV_EXPORT bool parseMatCodec(const std::string& name, MatCodec& codec);
+/// true for the lossless codecs that write the data itself, only those are safe for files
+CSAPEX_OPENCV_EXPORT bool isLosslessInBand(MatCodec codec);
+
+struct CSAPEX_OPENCV_EXPORT MatCodecOptions
+{
+    MatCodecOptions(MatCodec codec = MatCodec::RAW) : codec(codec), jpeg_quality(90), png_compression(1), shared_memory_segments(16)
+    {
+    }
+
+    MatCodec codec;
+    int jpeg_quality;
+    int png_compression;
+    /// number of shared memory segments the writer keeps alive
+    std::size_t shared_memory_segments;
+};
+
+/**
+ * @brief The MatCodecSelection class decides which codec the cv::Mat serializer uses.
+ *
+ * The process wide default is configured by the csapex settings (see RegisterOpenCVPlugin).
+ * It applies to everything serialized without a ScopedMatCodec, including recordings
+ * and exported files, so it is restricted to lossless in-band codecs.
+ *
+ * JPEG and shared memory are selected for the messages of a single connection:
+ * the transport serializes them inside a ScopedMatCodec.
+ */
+class CSAPEX_OPENCV_EXPORT MatCodecSelection
+{
+public:
+    static MatCodecOptions current();
+
+    static MatCodecOptions getDefault();
+    /// codecs that are not lossless in-band are replaced by LZ
+    static void setDefault(const MatCodecOptions& options);
+};
+
+class CSAPEX_OPENCV_EXPORT ScopedMatCodec
+{
+public:
+    ScopedMatCodec(const MatCodecOptions& options);
+    ~ScopedMatCodec();
+
+    ScopedMatCodec(const ScopedMatCodec&) = delete;
+    ScopedMatCodec& operator=(const ScopedMatCodec&) = delete;
+
+private:
+    const MatCodecOptions* previous_;
+    MatCodecOptions options_;
+};
+
+namespace lz
+{
+/**
+ * @brief The Compressor class keeps its hash table between calls,
+ *        so compressing many small chunks (e.g. rows) does not reallocate or clear it.
+ */
+class CSAPEX_OPENCV_EXPORT Compressor
+{
+public:
+    Compressor();
+
+    /// appends the compressed input to out, matches never refer to previous inputs
+    void compress(const uint8_t* input, std::size_t size, std::vector<uint8_t>& out);
+
+private:
+    /// positions + 1 relative to base_, entries <= base_ belong to previous inputs
+    std::vector<uint32_t> table_;
+    uint32_t base_;
+};
+
+/// decompresses exactly size bytes into output, returns false on corrupt input
+CSAPEX_OPENCV_EXPORT bool decompress(const uint8_t* input, std::size_t input_size, uint8_t* output, std::size_t size);
+}  // namespace lz
+
+/**
+ * Shared memory segments are owned by the writing process: a segment can be read
+ * by any number of readers until the writer has stored `retained` newer segments
+ * or exits, then it is unlinked. Segments of writers that crashed are removed
+ * by the next writer. Readers copy the segment into their own matrix, the saving
+ * is the socket transfer and serialization, not the copy.
+ */
+namespace shm
+{
+/// copies the matrix into a new shared memory segment, returns its name or an empty string on failure
+CSAPEX_OPENCV_EXPORT std::string store(const cv::Mat& mat, std::size_t retained);
+/// copies the segment into mat (allocated with the given size and type), the segment is left to its writer
+CSAPEX_OPENCV_EXPORT bool load(const std::string& name, cv::Mat& mat);
+}  // namespace shm
+
+}  // namespace csapex
+
+#endif  // MAT_CODEC_H
@@ -0,0 +1,64 @@
+#ifndef CSAPEX_OPENCV_PARALLEL_H
+#define CSAPEX_OPENCV_PARALLEL_H
+
+/// SYSTEM
+#include <algorithm>
+#include <cstddef>
+#include <opencv2/core/core.hpp>
+
+namespace csapex
+{
+namespace parallel
+{
+/// number of elements (e.g. points) handled by one task of forEachChunk, large enough to hide the scheduling overhead
+const std::size_t CHUNK_SIZE = 16384;
+
+/// adapts a function taking a cv::Range to cv::ParallelLoopBody
+template <typename Function>
+class LoopBody : public cv::ParallelLoopBody
+{
+public:
+    LoopBody(const Function& function) : function_(function)
+    {
+    }
+
+    void operator()(const cv::Range& range) const override
+    {
+        function_(range);
+    }
+
+private:
+    Function function_;
+};
+
+/**
+ * @brief forRange calls function(range) in parallel for disjoint ranges covering [0, n)
+ * @param stripes the number of ranges to split into, one per index by default
+ */
+template <typename Function>
+void forRange(int n, const Function& function, double stripes = -1.0)
+{
+    cv::parallel_for_(cv::Range(0, n), LoopBody<Function>(function), stripes > 0.0 ? stripes : n);
+}
+
+inline std::size_t chunkCount(std::size_t size, std::size_t chunk_size = CHUNK_SIZE)
+{
+    return (size + chunk_size - 1) / chunk_size;
+}
+
+/// calls function(chunk, begin, end) in parallel for the consecutive chunks of [0, size)
+template <typename Function>
+void forEachChunk(std::size_t size, const Function& function, std::size_t chunk_size = CHUNK_SIZE)
+{
+    forRange(static_cast<int>(chunkCount(size, chunk_size)), [&](const cv::Range& range) {
+        for (int c = range.start; c < range.end; ++c) {
+            const std::size_t begin = c * chunk_size;
+            function(static_cast<std::size_t>(c), begin, std::min(size, begin + chunk_size));
+        }
+    });
+}
+
+}  // namespace parallel
+}  // namespace csapex
+
+#endif  // CSAPEX_OPENCV_PARALLEL_H
@@ -0,0 +1,227 @@
+#ifndef ROI_SET_H
+#define ROI_SET_H
+
+/// COMPONENT
+#include <csapex_opencv/csapex_opencv_export.h>
+#include <csapex_opencv/roi.h>
+
+/// SYSTEM
+#include <cstdint>
+#include <opencv2/core/core.hpp>
+#include <string>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The RoiSet class stores many ROIs column-wise.
+ *
+ * Rectangles, classifications, scores and colors are kept in separate
+ * contiguous columns, colors are packed into four bytes (the channels of the
+ * cv::Scalar in order, saturated to [0, 255]). The label column is only
+ * allocated once a label is set.
+ * Ref is a lightweight view on one row, offering the accessors of Roi, so
+ * code written for Roi can be applied to a set without copying.
+ */
+class CSAPEX_OPENCV_EXPORT RoiSet
+{
+public:
+    class Ref
+    {
+    public:
+        Ref(RoiSet& set, std::size_t index) : set_(&set), index_(index)
+        {
+        }
+
+        int x() const
+        {
+            return set_->rects_[index_].x;
+        }
+        void setX(const int x)
+        {
+            set_->rects_[index_].x = x;
+        }
+        int y() const
+        {
+            return set_->rects_[index_].y;
+        }
+        void setY(const int y)
+        {
+            set_->rects_[index_].y = y;
+        }
+        int w() const
+        {
+            return set_->rects_[index_].width;
+        }
+        void setW(const int w)
+        {
+            set_->rects_[index_].width = w;
+        }
+        int h() const
+        {
+            return set_->rects_[index_].height;
+        }
+        void setH(const int h)
+        {
+            set_->rects_[index_].height = h;
+        }
+
+        cv::Rect rect() const
+        {
+            return set_->rects_[index_];
+        }
+        void setRect(const cv::Rect& r)
+        {
+            set_->rects_[index_] = r;
+        }
+
+        void grow(int pixels_x, int pixels_y)
+        {
+            cv::Rect& r = set_->rects_[index_];
+            r = r - cv::Point(pixels_x / 2, pixels_y / 2) + cv::Size(pixels_x, pixels_y);
+        }
+
+        int classification() const
+        {
+            return set_->classifications_[index_];
+        }
+        void setClassification(const int c)
+        {
+            set_->classifications_[index_] = c;
+        }
+
+        float score() const
+        {
+            return set_->scores_[index_];
+        }
+        void setScore(const float s)
+        {
+            set_->scores_[index_] = s;
+        }
+
+        cv::Scalar color() const
+        {
+            return unpackColor(set_->colors_[index_]);
+        }
+        void setColor(const cv::Scalar& c)
+        {
+            set_->colors_[index_] = packColor(c);
+        }
+
+        std::string label() const
+        {
+            return set_->label(index_);
+        }
+        void setLabel(const std::string& label)
+        {
+            set_->setLabel(index_, label);
+        }
+
+    private:
+        RoiSet* set_;
+        std::size_t index_;
+    };
+
+public:
+    RoiSet();
+
+    std::size_t size() const
+    {
+        return rects_.size();
+    }
+    bool empty() const
+    {
+        return rects_.empty();
+    }
+
+    void clear();
+    void reserve(std::size_t n);
+    void resize(std::size_t n);
+
+    void push_back(const Roi& roi, float score = 0.0f);
+    void push_back(const cv::Rect& rect, int classification = -1, float score = 0.0f, const cv::Scalar& color = cv::Scalar(255, 255, 0));
+
+    Ref operator[](std::size_t index)
+    {
+        return Ref(*this, index);
+    }
+
+    Roi roi(std::size_t index) const;
+
+    const cv::Rect& rect(std::size_t index) const
+    {
+        return rects_[index];
+    }
+    int classification(std::size_t index) const
+    {
+        return classifications_[index];
+    }
+    float score(std::size_t index) const
+    {
+        return scores_[index];
+    }
+    cv::Scalar color(std::size_t index) const
+    {
+        return unpackColor(colors_[index]);
+    }
+    std::string label(std::size_t index) const;
+    void setLabel(std::size_t index, const std::string& label);
+
+    /// columns
+    std::vector<cv::Rect>& rects()
+    {
+        return rects_;
+    }
+    const std::vector<cv::Rect>& rects() const
+    {
+        return rects_;
+    }
+    std::vector<int>& classifications()
+    {
+        return classifications_;
+    }
+    const std::vector<int>& classifications() const
+    {
+        return classifications_;
+    }
+    std::vector<float>& scores()
+    {
+        return scores_;
+    }
+    const std::vector<float>& scores() const
+    {
+        return scores_;
+    }
+    std::vector<uint32_t>& colors()
+    {
+        return colors_;
+    }
+    const std::vector<uint32_t>& colors() const
+    {
+        return colors_;
+    }
+    /// empty if no label has been set
+    const std::vector<std::string>& labels() const
+    {
+        return labels_;
+    }
+
+    /// keeps the rows where mask is non-zero, in order
+    void select(const std::vector<char>& mask);
+    /// splits the rows into the ones where mask is non-zero and the rest
+    void partition(const std::vector<char>& mask, RoiSet& selected, RoiSet& rejected) const;
+
+    static uint32_t packColor(const cv::Scalar& color);
+    static cv::Scalar unpackColor(uint32_t color);
+
+private:
+    std::vector<cv::Rect> rects_;
+    std::vector<int> classifications_;
+    std::vector<float> scores_;
+    std::vector<uint32_t> colors_;
+    std::vector<std::string> labels_;
+};
+
+}  // namespace csapex
+
+#endif  // ROI_SET_H
@@ -0,0 +1,56 @@
+#ifndef ROI_SET_MESSAGE_H
+#define ROI_SET_MESSAGE_H
+
+/// COMPONENT
+#include <csapex_opencv/roi_message.h>
+#include <csapex_opencv/roi_set.h>
+
+/// PROJECT
+#include <csapex/msg/message_template.hpp>
+
+namespace csapex
+{
+namespace connection_types
+{
+/**
+ * @brief The RoiSetMessage struct carries many ROIs with a single header,
+ *        instead of one header per ROI like a vector of RoiMessage.
+ */
+struct CSAPEX_OPENCV_EXPORT RoiSetMessage : public MessageTemplate<RoiSet, RoiSetMessage>
+{
+    RoiSetMessage();
+    RoiSetMessage(const std::string& frame_id, Stamp stamp_micro_seconds);
+
+    void assign(const std::vector<RoiMessage>& rois);
+    std::shared_ptr<std::vector<RoiMessage>> toRoiMessages() const;
+};
+
+/// TRAITS
+template <>
+struct CSAPEX_OPENCV_EXPORT type<RoiSetMessage>
+{
+    static std::string name()
+    {
+        return "ROI set";
+    }
+};
+
+}  // namespace connection_types
+
+/// all columns are written as one contiguous block
+SerializationBuffer& operator<<(SerializationBuffer& data, const RoiSet& rois);
+const SerializationBuffer& operator>>(const SerializationBuffer& data, RoiSet& rois);
+}  // namespace csapex
+
+/// YAML
+namespace YAML
+{
+template <>
+struct CSAPEX_OPENCV_EXPORT convert<csapex::connection_types::RoiSetMessage>
+{
+    static Node encode(const csapex::connection_types::RoiSetMessage& rhs);
+    static bool decode(const Node& node, csapex::connection_types::RoiSetMessage& rhs);
+};
+}  // namespace YAML
+
+#endif  // ROI_SET_MESSAGE_H
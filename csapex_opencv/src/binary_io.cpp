@@ -1,43 +1,239 @@
 /// HEADER
 #include <csapex_opencv/binary_io.h>
 
+/// COMPONENT
+#include <csapex_opencv/mat_codec.h>
+
 /// PROJECT
 #include <csapex/serialization/io/std_io.h>
+#include <csapex/utility/assert.h>
+
+/// SYSTEM
+#include <algorithm>
 
 using namespace csapex;
 
+namespace
+{
+// older versions start with the (non-negative) column count
+const int FORMAT_MARKER = -2;
+
+void writeRows(SerializationBuffer& data, const cv::Mat& mat)
+{
+    const std::size_t row_bytes = mat.cols * mat.elemSize();
+    if (mat.isContinuous()) {
+        data.writeRaw(mat.ptr(), mat.rows * row_bytes);
+    } else {
+        for (int row = 0; row < mat.rows; ++row) {
+            data.writeRaw(mat.ptr(row), row_bytes);
+        }
+    }
+}
+
+// the LZ compressor stores 32 bit positions, larger spans are split
+const std::size_t MAX_LZ_CHUNK = std::size_t(1) << 30;
+
+void writeLZ(SerializationBuffer& data, const cv::Mat& mat)
+{
+    // continuous matrices are compressed as one span, others row by row without a staging copy
+    const std::size_t row_bytes = mat.cols * mat.elemSize();
+    const bool continuous = mat.isContinuous();
+    const int spans = continuous ? 1 : mat.rows;
+    const std::size_t span_bytes = continuous ? mat.rows * row_bytes : row_bytes;
+    const std::size_t chunks_per_span = span_bytes == 0 ? 0 : (span_bytes + MAX_LZ_CHUNK - 1) / MAX_LZ_CHUNK;
+
+    const uint64_t chunks = spans * chunks_per_span;
+    data << chunks;
+
+    lz::Compressor compressor;
+    std::vector<uint8_t> buffer;
+    for (int span = 0; span < spans; ++span) {
+        const uint8_t* src = mat.ptr(span);
+        for (std::size_t offset = 0; offset < span_bytes; offset += MAX_LZ_CHUNK) {
+            const uint64_t chunk_bytes = std::min(MAX_LZ_CHUNK, span_bytes - offset);
+
+            buffer.clear();
+            compressor.compress(src + offset, chunk_bytes, buffer);
+
+            // incompressible chunks are stored as they are
+            const uint8_t stored = buffer.size() >= chunk_bytes;
+            const uint64_t size = stored ? chunk_bytes : buffer.size();
+            data << stored;
+            data << chunk_bytes;
+            data << size;
+            data.writeRaw(stored ? src + offset : buffer.data(), size);
+        }
+    }
+}
+
+void readLZ(const SerializationBuffer& data, cv::Mat& mat)
+{
+    uint64_t chunks;
+    data >> chunks;
+
+    std::vector<uint8_t> buffer;
+    uint8_t* dst = mat.ptr();
+    std::size_t remaining = mat.total() * mat.elemSize();
+    for (uint64_t chunk = 0; chunk < chunks; ++chunk) {
+        uint8_t stored;
+        uint64_t chunk_bytes;
+        uint64_t size;
+        data >> stored;
+        data >> chunk_bytes;
+        data >> size;
+
+        apex_assert_msg(chunk_bytes <= remaining, "corrupt compressed matrix");
+        if (stored) {
+            apex_assert_msg(size == chunk_bytes, "corrupt compressed matrix");
+            data.readRaw(dst, size);
+        } else {
+            buffer.resize(size);
+            data.readRaw(buffer.data(), size);
+            apex_assert_msg(lz::decompress(buffer.data(), size, dst, chunk_bytes), "corrupt compressed matrix");
+        }
+        dst += chunk_bytes;
+        remaining -= chunk_bytes;
+    }
+    apex_assert_msg(remaining == 0, "corrupt compressed matrix");
+}
+
+bool supportsImageCodec(const cv::Mat& mat, MatCodec codec)
+{
+    const int depth = mat.depth();
+    const int channels = mat.channels();
+    if (mat.empty()) {
+        return false;
+    }
+    if (codec == MatCodec::JPEG) {
+        return depth == CV_8U && (channels == 1 || channels == 3);
+    }
+    return (depth == CV_8U || depth == CV_16U) && (channels == 1 || channels == 3 || channels == 4);
+}
+
+}  // namespace
+
 SerializationBuffer& csapex::operator<<(SerializationBuffer& data, const cv::Mat& mat)
 {
-    const uint32_t elem_size = mat.elemSize();
+    const MatCodecOptions options = MatCodecSelection::current();
+
+    MatCodec codec = options.codec;
+    std::vector<uint8_t> encoded;
+    std::string segment;
+
+    if (codec == MatCodec::PNG || codec == MatCodec::JPEG) {
+        std::vector<int> flags;
+        if (codec == MatCodec::JPEG) {
+            flags = { cv::IMWRITE_JPEG_QUALITY, options.jpeg_quality };
+        } else {
+            flags = { cv::IMWRITE_PNG_COMPRESSION, options.png_compression };
+        }
+        if (!supportsImageCodec(mat, codec) || !cv::imencode(codec == MatCodec::JPEG ? ".jpg" : ".png", mat, encoded, flags)) {
+            codec = MatCodec::LZ;
+        }
+
+    } else if (codec == MatCodec::SHARED_MEMORY) {
+        segment = shm::store(mat, options.shared_memory_segments);
+        if (segment.empty()) {
+            codec = MatCodec::RAW;
+        }
+    }
+
     const uint32_t elem_type = mat.type();
 
+    data << FORMAT_MARKER;
+    data << static_cast<uint8_t>(codec);
     data << mat.cols;
     data << mat.rows;
-    data << elem_size;
     data << elem_type;
 
-    const uint32_t data_size = mat.cols * mat.rows * elem_size;
-    data.writeRaw(mat.ptr(), data_size);
+    switch (codec) {
+        case MatCodec::RAW:
+            writeRows(data, mat);
+            break;
+        case MatCodec::LZ:
+            writeLZ(data, mat);
+            break;
+        case MatCodec::PNG:
+        case MatCodec::JPEG: {
+            const uint32_t size = encoded.size();
+            data << size;
+            data.writeRaw(encoded.data(), size);
+            break;
+        }
+        case MatCodec::SHARED_MEMORY:
+            data << segment;
+            break;
+    }
 
     return data;
 }
 const SerializationBuffer& csapex::operator>>(const SerializationBuffer& data, cv::Mat& mat)
 {
-    uint32_t elem_size;
-    uint32_t elem_type;
+    int marker;
+    data >> marker;
 
-    int rows, cols;
+    if (marker >= 0) {
+        // uncompressed format written by older versions
+        uint32_t elem_size;
+        uint32_t elem_type;
+        int rows;
+        int cols = marker;
 
+        data >> rows;
+        data >> elem_size;
+        data >> elem_type;
+
+        mat.create(rows, cols, elem_type);
+
+        const uint32_t data_size = mat.cols * mat.rows * elem_size;
+        if (data_size > 0) {
+            data.readRaw(mat.ptr(), data_size);
+        }
+        return data;
+    }
+
+    apex_assert_msg(marker == FORMAT_MARKER, "unknown matrix format");
+
+    uint8_t codec;
+    int rows, cols;
+    uint32_t elem_type;
+    data >> codec;
     data >> cols;
     data >> rows;
-    data >> elem_size;
     data >> elem_type;
 
     mat.create(rows, cols, elem_type);
+    const std::size_t data_size = mat.total() * mat.elemSize();
+
+    switch (static_cast<MatCodec>(codec)) {
+        case MatCodec::RAW:
+            if (data_size > 0) {
+                data.readRaw(mat.ptr(), data_size);
+            }
+            break;
+        case MatCodec::LZ:
+            readLZ(data, mat);
+            break;
+        case MatCodec::PNG:
+        case MatCodec::JPEG: {
+            uint32_t size;
+            data >> size;
+            std::vector<uint8_t> encoded(size);
+            data.readRaw(encoded.data(), size);
 
-    const uint32_t data_size = mat.cols * mat.rows * elem_size;
-    if (data_size > 0) {
-        data.readRaw(mat.ptr(), data_size);
+            cv::Mat decoded = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+            apex_assert_msg(decoded.size() == mat.size() && decoded.type() == mat.type(), "cannot decode compressed image");
+            decoded.copyTo(mat);
+            break;
+        }
+        case MatCodec::SHARED_MEMORY: {
+            std::string segment;
+            data >> segment;
+            apex_assert_msg(shm::load(segment, mat), std::string("cannot read shared memory segment ") + segment);
+            break;
+        }
+        default:
+            apex_assert_msg(false, "unknown matrix codec");
     }
 
     return data;
@@ -41,6 +41,14 @@ void BlobDetector::setupParameters(Parameterizable& parameters)
     addParameter(csapex::param::factory::declareBool("RoiInformation", csapex::param::ParameterDescription("Show the information of each RoI"), false));
 
     addParameter(csapex::param::factory::declareInterval("Area", csapex::param::ParameterDescription("Area for the reduced image"), 1, 800000, 1, 800000, 1));
+
+    std::map<std::string, int> methods = { { "contour tracing", 0 }, { "run union-find", 1 } };
+    addParameter(csapex::param::factory::declareParameterSet("labelling",
+                                                             csapex::param::ParameterDescription("contour tracing: cvLabel, single threaded.<br />"
+                                                                                                 "run union-find: row runs merged with union-find, rows split into parallel stripes."),
+                                                             methods, 1));
+    addConditionalParameter(csapex::param::factory::declareRange("stripes", csapex::param::ParameterDescription("Number of row stripes labelled in parallel"), 1, 64, 8, 1),
+                            [this]() { return readParameter<int>("labelling") == 1; });
 }
 
 #define _HSV2RGB_(H, S, V, R, G, B)                                                                                                                                                                    \
@@ -111,7 +119,13 @@ void BlobDetector::process()
     IplImage grayPtr(gray);
     IplImage* labelImgPtr = cvCreateImage(cvGetSize(&grayPtr), IPL_DEPTH_LABEL, 1);
 
-    cvLabel(&grayPtr, labelImgPtr, blobs);
+    if (readParameter<int>("labelling") == 1) {
+        // the label image shares its memory with the IplImage used for rendering and filtering
+        cv::Mat labels(labelImgPtr->height, labelImgPtr->width, CV_32SC1, labelImgPtr->imageData, labelImgPtr->widthStep);
+        cvLabelRuns(gray, labels, blobs, readParameter<int>("stripes"));
+    } else {
+        cvLabel(&grayPtr, labelImgPtr, blobs);
+    }
 
     std::shared_ptr<std::vector<RoiMessage>> out(new std::vector<RoiMessage>);
 
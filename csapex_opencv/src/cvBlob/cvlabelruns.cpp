@@ -0,0 +1,398 @@
+// Run-length / union-find labelling backend for cvBlob.
+//
+// This file is part of cvBlob.
+//
+// cvBlob is free software: you can redistribute it and/or modify
+// it under the terms of the Lesser GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// cvBlob is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// Lesser GNU General Public License for more details.
+//
+// You should have received a copy of the Lesser GNU General Public License
+// along with cvBlob.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+using namespace std;
+
+#if (defined(_WIN32) || defined(__WIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__) || (defined(__APPLE__) & defined(__MACH__)))
+#include <cv.h>
+#else
+#include <opencv/cv.h>
+#endif
+
+#include <csapex_opencv/cvblob.h>
+
+namespace cvb
+{
+namespace
+{
+/// Horizontal run of foreground pixels [x0, x1) in row y.
+struct Run
+{
+    int x0;
+    int x1;
+    int y;
+};
+
+/// Moments and bounding box of a partial blob.
+struct RunStats
+{
+    unsigned int area;
+    unsigned int minx;
+    unsigned int maxx;
+    unsigned int miny;
+    unsigned int maxy;
+    double m10;
+    double m01;
+    double m11;
+    double m20;
+    double m02;
+
+    RunStats() : area(0), minx(CV_BLOB_MAX_LABEL), maxx(0), miny(CV_BLOB_MAX_LABEL), maxy(0), m10(0), m01(0), m11(0), m20(0), m02(0)
+    {
+    }
+
+    void add(const Run& run)
+    {
+        // closed form sums over x in [x0, x1)
+        const double n = run.x1 - run.x0;
+        const double a = run.x0;
+        const double b = run.x1 - 1;
+        const double sum_x = (a + b) * n / 2.0;
+        const double sum_xx = (b * (b + 1) * (2 * b + 1) - (a - 1) * a * (2 * a - 1)) / 6.0;
+        const double y = run.y;
+
+        area += run.x1 - run.x0;
+        minx = std::min(minx, (unsigned int)run.x0);
+        maxx = std::max(maxx, (unsigned int)run.x1 - 1);
+        miny = std::min(miny, (unsigned int)run.y);
+        maxy = std::max(maxy, (unsigned int)run.y);
+        m10 += sum_x;
+        m01 += y * n;
+        m11 += y * sum_x;
+        m20 += sum_xx;
+        m02 += y * y * n;
+    }
+};
+
+inline unsigned int findRoot(std::vector<unsigned int>& parent, unsigned int i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+inline void unite(std::vector<unsigned int>& parent, unsigned int a, unsigned int b)
+{
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    // the smallest run index becomes the root, so labels follow raster order
+    if (a < b) {
+        parent[b] = a;
+    } else if (b < a) {
+        parent[a] = b;
+    }
+}
+
+/// Merges the runs of row y with the 8-connected runs of row y - 1.
+void mergeRows(const std::vector<Run>& runs, const std::vector<unsigned int>& row_first, std::vector<unsigned int>& parent, int y)
+{
+    unsigned int above = row_first[y - 1];
+    const unsigned int above_end = row_first[y];
+    const unsigned int current_end = row_first[y + 1];
+
+    for (unsigned int current = row_first[y]; current < current_end; ++current) {
+        const Run& run = runs[current];
+        // skip runs that end left of the diagonal neighbour
+        while (above < above_end && runs[above].x1 < run.x0) {
+            ++above;
+        }
+        for (unsigned int a = above; a < above_end && runs[a].x0 <= run.x1; ++a) {
+            unite(parent, current, a);
+        }
+    }
+}
+
+class EncodeRowsInvoker : public cv::ParallelLoopBody
+{
+public:
+    EncodeRowsInvoker(const cv::Mat& img, const std::vector<cv::Range>& stripes, std::vector<std::vector<Run>>& runs) : img_(img), stripes_(stripes), runs_(runs)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        for (int s = range.start; s < range.end; ++s) {
+            std::vector<Run>& runs = runs_[s];
+            for (int y = stripes_[s].start; y < stripes_[s].end; ++y) {
+                const unsigned char* row = img_.ptr<unsigned char>(y);
+                int x = 0;
+                while (x < img_.cols) {
+                    while (x < img_.cols && !row[x]) {
+                        ++x;
+                    }
+                    if (x == img_.cols) {
+                        break;
+                    }
+                    Run run;
+                    run.x0 = x;
+                    run.y = y;
+                    while (x < img_.cols && row[x]) {
+                        ++x;
+                    }
+                    run.x1 = x;
+                    runs.push_back(run);
+                }
+            }
+        }
+    }
+
+private:
+    const cv::Mat& img_;
+    const std::vector<cv::Range>& stripes_;
+    std::vector<std::vector<Run>>& runs_;
+};
+
+class MergeRowsInvoker : public cv::ParallelLoopBody
+{
+public:
+    MergeRowsInvoker(const std::vector<Run>& runs, const std::vector<unsigned int>& row_first, const std::vector<cv::Range>& stripes, std::vector<unsigned int>& parent)
+      : runs_(runs), row_first_(row_first), stripes_(stripes), parent_(parent)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        // only rows inside of the stripe are merged, so each stripe touches disjoint runs
+        for (int s = range.start; s < range.end; ++s) {
+            for (int y = stripes_[s].start + 1; y < stripes_[s].end; ++y) {
+                mergeRows(runs_, row_first_, parent_, y);
+            }
+        }
+    }
+
+private:
+    const std::vector<Run>& runs_;
+    const std::vector<unsigned int>& row_first_;
+    const std::vector<cv::Range>& stripes_;
+    std::vector<unsigned int>& parent_;
+};
+
+class WriteLabelsInvoker : public cv::ParallelLoopBody
+{
+public:
+    WriteLabelsInvoker(const std::vector<Run>& runs, const std::vector<unsigned int>& row_first, const std::vector<CvLabel>& labels, const std::vector<cv::Range>& stripes, cv::Mat& out)
+      : runs_(runs), row_first_(row_first), labels_(labels), stripes_(stripes), out_(out)
+    {
+    }
+
+    void operator()(const cv::Range& range) const
+    {
+        for (int s = range.start; s < range.end; ++s) {
+            for (int y = stripes_[s].start; y < stripes_[s].end; ++y) {
+                CvLabel* row = out_.ptr<CvLabel>(y);
+                std::fill(row, row + out_.cols, 0);
+                for (unsigned int r = row_first_[y]; r < row_first_[y + 1]; ++r) {
+                    const Run& run = runs_[r];
+                    std::fill(row + run.x0, row + run.x1, labels_[r]);
+                }
+            }
+        }
+    }
+
+private:
+    const std::vector<Run>& runs_;
+    const std::vector<unsigned int>& row_first_;
+    const std::vector<CvLabel>& labels_;
+    const std::vector<cv::Range>& stripes_;
+    cv::Mat& out_;
+};
+
+/// Traces the external contour of a blob in the label image, see cvLabel.
+void traceContour(const cv::Mat& labels, CvBlob* blob)
+{
+    static const char moves[4][3][4] = { { { -1, -1, 3, CV_CHAINCODE_UP_LEFT }, { 0, -1, 0, CV_CHAINCODE_UP }, { 1, -1, 0, CV_CHAINCODE_UP_RIGHT } },
+                                         { { 1, -1, 0, CV_CHAINCODE_UP_RIGHT }, { 1, 0, 1, CV_CHAINCODE_RIGHT }, { 1, 1, 1, CV_CHAINCODE_DOWN_RIGHT } },
+                                         { { 1, 1, 1, CV_CHAINCODE_DOWN_RIGHT }, { 0, 1, 2, CV_CHAINCODE_DOWN }, { -1, 1, 2, CV_CHAINCODE_DOWN_LEFT } },
+                                         { { -1, 1, 2, CV_CHAINCODE_DOWN_LEFT }, { -1, 0, 3, CV_CHAINCODE_LEFT }, { -1, -1, 3, CV_CHAINCODE_UP_LEFT } } };
+
+    const int x = blob->contour.startingPoint.x;
+    const int y = blob->contour.startingPoint.y;
+
+    unsigned char direction = 1;
+    int xx = x;
+    int yy = y;
+
+    bool contourEnd = false;
+    do {
+        for (unsigned int numAttempts = 0; numAttempts < 3; numAttempts++) {
+            bool found = false;
+
+            for (unsigned char i = 0; i < 3; i++) {
+                int nx = xx + moves[direction][i][0];
+                int ny = yy + moves[direction][i][1];
+                if ((nx < labels.cols) && (nx >= 0) && (ny < labels.rows) && (ny >= 0) && labels.ptr<CvLabel>(ny)[nx] == blob->label) {
+                    found = true;
+
+                    blob->contour.chainCode.push_back(moves[direction][i][3]);
+
+                    xx = nx;
+                    yy = ny;
+
+                    direction = moves[direction][i][2];
+                    break;
+                }
+            }
+
+            if (!found)
+                direction = (direction + 1) % 4;
+            else
+                break;
+
+            if ((contourEnd = ((xx == x) && (yy == y) && (direction == 1))))
+                break;
+        }
+    } while (!contourEnd);
+}
+
+}  // namespace
+
+unsigned int cvLabelRuns(cv::Mat const& img, cv::Mat& imgOut, CvBlobs& blobs, unsigned int stripes, bool contours)
+{
+    CV_Assert(img.type() == CV_8UC1);
+
+    cvReleaseBlobs(blobs);
+
+    imgOut.create(img.rows, img.cols, CV_32SC1);
+
+    const int rows = img.rows;
+    const int n_stripes = std::max(1, std::min<int>(stripes, rows));
+
+    std::vector<cv::Range> stripe_rows(n_stripes);
+    for (int s = 0; s < n_stripes; ++s) {
+        stripe_rows[s] = cv::Range(s * rows / n_stripes, (s + 1) * rows / n_stripes);
+    }
+    const cv::Range all_stripes(0, n_stripes);
+
+    // 1. run-length encode the rows
+    std::vector<std::vector<Run>> stripe_runs(n_stripes);
+    cv::parallel_for_(all_stripes, EncodeRowsInvoker(img, stripe_rows, stripe_runs));
+
+    std::vector<Run> runs;
+    {
+        std::size_t total = 0;
+        for (const std::vector<Run>& r : stripe_runs) {
+            total += r.size();
+        }
+        runs.reserve(total);
+        for (const std::vector<Run>& r : stripe_runs) {
+            runs.insert(runs.end(), r.begin(), r.end());
+        }
+    }
+
+    std::vector<unsigned int> row_first(rows + 1, 0);
+    for (const Run& run : runs) {
+        ++row_first[run.y + 1];
+    }
+    for (int y = 0; y < rows; ++y) {
+        row_first[y + 1] += row_first[y];
+    }
+
+    // 2. merge overlapping runs of adjacent rows, stripe borders last
+    std::vector<unsigned int> parent(runs.size());
+    for (unsigned int i = 0; i < parent.size(); ++i) {
+        parent[i] = i;
+    }
+    cv::parallel_for_(all_stripes, MergeRowsInvoker(runs, row_first, stripe_rows, parent));
+    for (int s = 1; s < n_stripes; ++s) {
+        if (stripe_rows[s].start > 0 && stripe_rows[s].start < rows) {
+            mergeRows(runs, row_first, parent, stripe_rows[s].start);
+        }
+    }
+
+    // 3. assign consecutive labels in raster order of the first run
+    std::vector<CvLabel> labels(runs.size());
+    CvLabel label = 0;
+    for (unsigned int i = 0; i < runs.size(); ++i) {
+        unsigned int root = findRoot(parent, i);
+        if (root == i) {
+            ++label;
+            CV_Assert(label != CV_BLOB_MAX_LABEL);
+            labels[i] = label;
+        } else {
+            labels[i] = labels[root];
+        }
+    }
+
+    // 4. write the label image, then accumulate the moments per blob, which is linear in the number of runs
+    cv::parallel_for_(all_stripes, WriteLabelsInvoker(runs, row_first, labels, stripe_rows, imgOut));
+
+    std::vector<RunStats> blob_stats(label + 1);
+    for (unsigned int i = 0; i < runs.size(); ++i) {
+        blob_stats[labels[i]].add(runs[i]);
+    }
+
+    unsigned int numPixels = 0;
+    std::vector<bool> started(label + 1, false);
+    for (unsigned int i = 0; i < runs.size(); ++i) {
+        const CvLabel l = labels[i];
+        if (started[l]) {
+            continue;
+        }
+        started[l] = true;
+
+        const RunStats& stats = blob_stats[l];
+
+        CvBlob* blob = new CvBlob;
+        blob->label = l;
+        blob->area = stats.area;
+        blob->minx = stats.minx;
+        blob->maxx = stats.maxx;
+        blob->miny = stats.miny;
+        blob->maxy = stats.maxy;
+        blob->m10 = stats.m10;
+        blob->m01 = stats.m01;
+        blob->m11 = stats.m11;
+        blob->m20 = stats.m20;
+        blob->m02 = stats.m02;
+        blob->internalContours.clear();
+        blob->contour.startingPoint = cvPoint(runs[i].x0, runs[i].y);
+
+        cvCentroid(blob);
+
+        blob->u11 = blob->m11 - (blob->m10 * blob->m01) / blob->m00;
+        blob->u20 = blob->m20 - (blob->m10 * blob->m10) / blob->m00;
+        blob->u02 = blob->m02 - (blob->m01 * blob->m01) / blob->m00;
+
+        double m00_2 = blob->m00 * blob->m00;
+
+        blob->n11 = blob->u11 / m00_2;
+        blob->n20 = blob->u20 / m00_2;
+        blob->n02 = blob->u02 / m00_2;
+
+        blob->p1 = blob->n20 + blob->n02;
+
+        double nn = blob->n20 - blob->n02;
+        blob->p2 = nn * nn + 4. * (blob->n11 * blob->n11);
+
+        if (contours) {
+            traceContour(imgOut, blob);
+        }
+
+        numPixels += blob->area;
+        blobs.insert(CvLabelBlob(l, blob));
+    }
+
+    return numPixels;
+}
+
+}  // namespace cvb
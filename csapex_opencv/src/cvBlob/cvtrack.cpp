@@ -17,9 +17,13 @@
 // along with cvBlob.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#include <unordered_map>
+#include <vector>
 using namespace std;
 
 #if (defined(_WIN32) || defined(__WIN32__) || defined(__TOS_WIN__) || defined(__WINDOWS__) || (defined(__APPLE__) & defined(__MACH__)))
@@ -87,231 +91,286 @@ double distantBlobTrack(CvBlob const* b, CvTrack const* t)
     return MIN(d1, d2);
 }
 
-// Access to matrix
-#define C(blob, track) close[((blob) + (track) * (nBlobs + 2))]
-// Access to accumulators
-#define AB(label) C((label), (nTracks))
-#define AT(id) C((nBlobs), (id))
-// Access to identifications
-#define IB(label) C((label), (nTracks) + 1)
-#define IT(id) C((nBlobs) + 1, (id))
-// Access to registers
-#define B(label) blobs.find(IB(label))->second
-#define T(id) tracks.find(IT(id))->second
-
-void getClusterForTrack(unsigned int trackPos, CvID* close, unsigned int nBlobs, unsigned int nTracks, CvBlobs const& blobs, CvTracks const& tracks, list<CvBlob*>& bb, list<CvTrack*>& tt);
-
-void getClusterForBlob(unsigned int blobPos, CvID* close, unsigned int nBlobs, unsigned int nTracks, CvBlobs const& blobs, CvTracks const& tracks, list<CvBlob*>& bb, list<CvTrack*>& tt)
+namespace
 {
-    for (unsigned int j = 0; j < nTracks; j++) {
-        if (C(blobPos, j)) {
-            tt.push_back(T(j));
+/// Sparse blob/track proximity graph, each edge can be consumed once while clustering.
+struct ProximityGraph
+{
+    std::vector<std::vector<std::pair<unsigned int, unsigned int>>> blob_edges;   // (track, edge)
+    std::vector<std::vector<std::pair<unsigned int, unsigned int>>> track_edges;  // (blob, edge)
+    std::vector<char> alive;
+    std::vector<unsigned int> blob_degree;
+    std::vector<unsigned int> track_degree;
+};
+
+inline unsigned long long cellKey(long long cx, long long cy)
+{
+    // shift unsigned, negative cells would be undefined behaviour otherwise
+    return (static_cast<unsigned long long>(cx) << 32) ^ (static_cast<unsigned long long>(cy) & 0xffffffffull);
+}
 
-            unsigned int c = AT(j);
+void getClusterForTrack(unsigned int trackPos, ProximityGraph& g, std::vector<CvBlob*> const& blobs, std::vector<CvTrack*> const& tracks, list<CvBlob*>& bb, list<CvTrack*>& tt);
 
-            C(blobPos, j) = 0;
-            AB(blobPos)--;
-            AT(j)--;
+void getClusterForBlob(unsigned int blobPos, ProximityGraph& g, std::vector<CvBlob*> const& blobs, std::vector<CvTrack*> const& tracks, list<CvBlob*>& bb, list<CvTrack*>& tt)
+{
+    for (const std::pair<unsigned int, unsigned int>& e : g.blob_edges[blobPos]) {
+        if (g.alive[e.second]) {
+            unsigned int j = e.first;
+            tt.push_back(tracks[j]);
+
+            unsigned int c = g.track_degree[j];
+
+            g.alive[e.second] = 0;
+            g.blob_degree[blobPos]--;
+            g.track_degree[j]--;
 
             if (c > 1) {
-                getClusterForTrack(j, close, nBlobs, nTracks, blobs, tracks, bb, tt);
+                getClusterForTrack(j, g, blobs, tracks, bb, tt);
             }
         }
     }
 }
 
-void getClusterForTrack(unsigned int trackPos, CvID* close, unsigned int nBlobs, unsigned int nTracks, CvBlobs const& blobs, CvTracks const& tracks, list<CvBlob*>& bb, list<CvTrack*>& tt)
+void getClusterForTrack(unsigned int trackPos, ProximityGraph& g, std::vector<CvBlob*> const& blobs, std::vector<CvTrack*> const& tracks, list<CvBlob*>& bb, list<CvTrack*>& tt)
 {
-    for (unsigned int i = 0; i < nBlobs; i++) {
-        if (C(i, trackPos)) {
-            bb.push_back(B(i));
+    for (const std::pair<unsigned int, unsigned int>& e : g.track_edges[trackPos]) {
+        if (g.alive[e.second]) {
+            unsigned int i = e.first;
+            bb.push_back(blobs[i]);
 
-            unsigned int c = AB(i);
+            unsigned int c = g.blob_degree[i];
 
-            C(i, trackPos) = 0;
-            AB(i)--;
-            AT(trackPos)--;
+            g.alive[e.second] = 0;
+            g.blob_degree[i]--;
+            g.track_degree[trackPos]--;
 
             if (c > 1) {
-                getClusterForBlob(i, close, nBlobs, nTracks, blobs, tracks, bb, tt);
+                getClusterForBlob(i, g, blobs, tracks, bb, tt);
             }
         }
     }
 }
 
-void cvUpdateTracks(CvBlobs const& blobs, CvTracks& tracks, const double thDistance, const unsigned int thInactive, const unsigned int thActive)
+/// Finds all blob/track pairs closer than thDistance.
+/// Tracks are hashed into a uniform grid by their bounding box grown by thDistance, a blob
+/// can only be close to tracks sharing a cell with its own grown bounding box.
+void buildProximityGraph(std::vector<CvBlob*> const& blobs, std::vector<CvTrack*> const& tracks, const double thDistance, ProximityGraph& g)
 {
-    __CV_BEGIN__;
+    const unsigned int nBlobs = blobs.size();
+    const unsigned int nTracks = tracks.size();
 
-    unsigned int nBlobs = blobs.size();
-    unsigned int nTracks = tracks.size();
+    g.blob_edges.assign(nBlobs, std::vector<std::pair<unsigned int, unsigned int>>());
+    g.track_edges.assign(nTracks, std::vector<std::pair<unsigned int, unsigned int>>());
+    g.alive.clear();
+    g.blob_degree.assign(nBlobs, 0);
+    g.track_degree.assign(nTracks, 0);
 
-    // Proximity matrix:
-    // Last row/column is for ID/label.
-    // Last-1 "/" is for accumulation.
-    CvID* close = new unsigned int[(nBlobs + 2) * (nTracks + 2)];  // XXX Must be same type than CvLabel.
-
-    try {
-        // Inicialization:
-        unsigned int i = 0;
-        for (CvBlobs::const_iterator it = blobs.begin(); it != blobs.end(); ++it, i++) {
-            AB(i) = 0;
-            IB(i) = it->second->label;
-        }
+    if (nBlobs == 0 || nTracks == 0) {
+        return;
+    }
 
-        CvID maxTrackID = 0;
+    // cells roughly the size of an average track
+    double extent = 0.0;
+    for (CvTrack* t : tracks) {
+        extent += std::max(t->maxx - t->minx, t->maxy - t->miny);
+    }
+    const double cell = std::max(1.0, std::max(thDistance, extent / nTracks));
 
-        unsigned int j = 0;
-        for (CvTracks::const_iterator jt = tracks.begin(); jt != tracks.end(); ++jt, j++) {
-            AT(j) = 0;
-            IT(j) = jt->second->id;
-            if (jt->second->id > maxTrackID)
-                maxTrackID = jt->second->id;
+    std::unordered_map<unsigned long long, std::vector<unsigned int>> grid;
+    for (unsigned int j = 0; j < nTracks; j++) {
+        const CvTrack* t = tracks[j];
+        const long long x0 = (long long)std::floor((t->minx - thDistance) / cell);
+        const long long x1 = (long long)std::floor((t->maxx + thDistance) / cell);
+        const long long y0 = (long long)std::floor((t->miny - thDistance) / cell);
+        const long long y1 = (long long)std::floor((t->maxy + thDistance) / cell);
+        for (long long cy = y0; cy <= y1; ++cy) {
+            for (long long cx = x0; cx <= x1; ++cx) {
+                grid[cellKey(cx, cy)].push_back(j);
+            }
         }
+    }
 
-        // Proximity matrix calculation and "used blob" list inicialization:
-        for (i = 0; i < nBlobs; i++)
-            for (j = 0; j < nTracks; j++)
-                if ((C(i, j) = (distantBlobTrack(B(i), T(j)) < thDistance))) {
-                    AB(i)++;
-                    AT(j)++;
+    std::vector<unsigned int> visited(nTracks, std::numeric_limits<unsigned int>::max());
+    std::vector<unsigned int> candidates;
+    for (unsigned int i = 0; i < nBlobs; i++) {
+        const CvBlob* b = blobs[i];
+        const long long x0 = (long long)std::floor((b->minx - thDistance) / cell);
+        const long long x1 = (long long)std::floor((b->maxx + thDistance) / cell);
+        const long long y0 = (long long)std::floor((b->miny - thDistance) / cell);
+        const long long y1 = (long long)std::floor((b->maxy + thDistance) / cell);
+
+        candidates.clear();
+        for (long long cy = y0; cy <= y1; ++cy) {
+            for (long long cx = x0; cx <= x1; ++cx) {
+                auto pos = grid.find(cellKey(cx, cy));
+                if (pos == grid.end()) {
+                    continue;
+                }
+                for (unsigned int j : pos->second) {
+                    if (visited[j] != i) {
+                        visited[j] = i;
+                        candidates.push_back(j);
+                    }
                 }
-
-        /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-        // Detect inactive tracks
-        for (j = 0; j < nTracks; j++) {
-            unsigned int c = AT(j);
-
-            if (c == 0) {
-                // cout << "Inactive track: " << j << endl;
-
-                // Inactive track.
-                CvTrack* track = T(j);
-                track->inactive++;
-                track->label = 0;
             }
         }
 
-        // Detect new tracks
-        for (i = 0; i < nBlobs; i++) {
-            unsigned int c = AB(i);
-
-            if (c == 0) {
-                // cout << "Blob (new track): " << maxTrackID+1 << endl;
-                // cout << *B(i) << endl;
-
-                // New track.
-                maxTrackID++;
-                CvBlob* blob = B(i);
-                CvTrack* track = new CvTrack;
-                track->id = maxTrackID;
-                track->label = blob->label;
-                track->minx = blob->minx;
-                track->miny = blob->miny;
-                track->maxx = blob->maxx;
-                track->maxy = blob->maxy;
-                track->centroid = blob->centroid;
-                track->lifetime = 0;
-                track->active = 0;
-                track->inactive = 0;
-                tracks.insert(CvIDTrack(maxTrackID, track));
+        // keep the track order of the dense matrix
+        std::sort(candidates.begin(), candidates.end());
+        for (unsigned int j : candidates) {
+            if (distantBlobTrack(b, tracks[j]) < thDistance) {
+                unsigned int edge = g.alive.size();
+                g.alive.push_back(1);
+                g.blob_edges[i].push_back(std::make_pair(j, edge));
+                g.track_edges[j].push_back(std::make_pair(i, edge));
+                g.blob_degree[i]++;
+                g.track_degree[j]++;
             }
         }
+    }
+}
+}  // namespace
 
-        // Clustering
-        for (j = 0; j < nTracks; j++) {
-            unsigned int c = AT(j);
+void cvUpdateTracks(CvBlobs const& blobs, CvTracks& tracks, const double thDistance, const unsigned int thInactive, const unsigned int thActive)
+{
+    __CV_BEGIN__;
 
-            if (c) {
-                list<CvTrack*> tt;
-                tt.push_back(T(j));
-                list<CvBlob*> bb;
+    unsigned int nBlobs = blobs.size();
+    unsigned int nTracks = tracks.size();
 
-                getClusterForTrack(j, close, nBlobs, nTracks, blobs, tracks, bb, tt);
+    std::vector<CvBlob*> blob_list;
+    blob_list.reserve(nBlobs);
+    for (CvBlobs::const_iterator it = blobs.begin(); it != blobs.end(); ++it) {
+        blob_list.push_back(it->second);
+    }
 
-                // Select track
-                CvTrack* track = nullptr;
-                unsigned int area = 0;
-                for (list<CvTrack*>::const_iterator it = tt.begin(); it != tt.end(); ++it) {
-                    CvTrack* t = *it;
+    CvID maxTrackID = 0;
+    std::vector<CvTrack*> track_list;
+    track_list.reserve(nTracks);
+    for (CvTracks::const_iterator jt = tracks.begin(); jt != tracks.end(); ++jt) {
+        track_list.push_back(jt->second);
+        if (jt->second->id > maxTrackID)
+            maxTrackID = jt->second->id;
+    }
 
-                    unsigned int a = (t->maxx - t->minx) * (t->maxy - t->miny);
-                    if (a > area) {
-                        area = a;
-                        track = t;
-                    }
-                }
+    // Proximity graph calculation
+    ProximityGraph g;
+    buildProximityGraph(blob_list, track_list, thDistance, g);
 
-                if (!track) {
-                    // should not happend
-                    continue;
-                }
+    unsigned int i, j;
+
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Detect inactive tracks
+    for (j = 0; j < nTracks; j++) {
+        if (g.track_degree[j] == 0) {
+            // Inactive track.
+            CvTrack* track = track_list[j];
+            track->inactive++;
+            track->label = 0;
+        }
+    }
+
+    // Detect new tracks
+    for (i = 0; i < nBlobs; i++) {
+        if (g.blob_degree[i] == 0) {
+            // New track.
+            maxTrackID++;
+            CvBlob* blob = blob_list[i];
+            CvTrack* track = new CvTrack;
+            track->id = maxTrackID;
+            track->label = blob->label;
+            track->minx = blob->minx;
+            track->miny = blob->miny;
+            track->maxx = blob->maxx;
+            track->maxy = blob->maxy;
+            track->centroid = blob->centroid;
+            track->lifetime = 0;
+            track->active = 0;
+            track->inactive = 0;
+            tracks.insert(CvIDTrack(maxTrackID, track));
+        }
+    }
 
-                // Select blob
-                CvBlob* blob = nullptr;
-                area = 0;
-                // cout << "Matching blobs: ";
-                for (list<CvBlob*>::const_iterator it = bb.begin(); it != bb.end(); ++it) {
-                    CvBlob* b = *it;
+    // Clustering
+    for (j = 0; j < nTracks; j++) {
+        unsigned int c = g.track_degree[j];
 
-                    // cout << b->label << " ";
+        if (c) {
+            list<CvTrack*> tt;
+            tt.push_back(track_list[j]);
+            list<CvBlob*> bb;
 
-                    if (b->area > area) {
-                        area = b->area;
-                        blob = b;
-                    }
+            getClusterForTrack(j, g, blob_list, track_list, bb, tt);
+
+            // Select track
+            CvTrack* track = nullptr;
+            unsigned int area = 0;
+            for (list<CvTrack*>::const_iterator it = tt.begin(); it != tt.end(); ++it) {
+                CvTrack* t = *it;
+
+                unsigned int a = (t->maxx - t->minx) * (t->maxy - t->miny);
+                if (a > area) {
+                    area = a;
+                    track = t;
                 }
+            }
 
-                if (!blob) {
-                    // should not happend
-                    continue;
+            if (!track) {
+                // should not happend
+                continue;
+            }
+
+            // Select blob
+            CvBlob* blob = nullptr;
+            area = 0;
+            for (list<CvBlob*>::const_iterator it = bb.begin(); it != bb.end(); ++it) {
+                CvBlob* b = *it;
+
+                if (b->area > area) {
+                    area = b->area;
+                    blob = b;
                 }
+            }
 
-                // cout << endl;
-
-                // Update track
-                // cout << "Matching: track=" << track->id << ", blob=" << blob->label
-                // << endl;
-                track->label = blob->label;
-                track->centroid = blob->centroid;
-                track->minx = blob->minx;
-                track->miny = blob->miny;
-                track->maxx = blob->maxx;
-                track->maxy = blob->maxy;
-                if (track->inactive)
-                    track->active = 0;
-                track->inactive = 0;
-
-                // Others to inactive
-                for (list<CvTrack*>::const_iterator it = tt.begin(); it != tt.end(); ++it) {
-                    CvTrack* t = *it;
-
-                    if (t != track) {
-                        // cout << "Inactive: track=" << t->id << endl;
-                        t->inactive++;
-                        t->label = 0;
-                    }
+            if (!blob) {
+                // should not happend
+                continue;
+            }
+
+            // Update track
+            track->label = blob->label;
+            track->centroid = blob->centroid;
+            track->minx = blob->minx;
+            track->miny = blob->miny;
+            track->maxx = blob->maxx;
+            track->maxy = blob->maxy;
+            if (track->inactive)
+                track->active = 0;
+            track->inactive = 0;
+
+            // Others to inactive
+            for (list<CvTrack*>::const_iterator it = tt.begin(); it != tt.end(); ++it) {
+                CvTrack* t = *it;
+
+                if (t != track) {
+                    t->inactive++;
+                    t->label = 0;
                 }
             }
         }
-        /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-        for (CvTracks::iterator jt = tracks.begin(); jt != tracks.end();)
-            if ((jt->second->inactive >= thInactive) || ((jt->second->inactive) && (thActive) && (jt->second->active < thActive))) {
-                delete jt->second;
-                tracks.erase(jt++);
-            } else {
-                jt->second->lifetime++;
-                if (!jt->second->inactive)
-                    jt->second->active++;
-                ++jt;
-            }
-    } catch (...) {
-        delete[] close;
-        throw;  // TODO: OpenCV style.
     }
-
-    delete[] close;
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    for (CvTracks::iterator jt = tracks.begin(); jt != tracks.end();)
+        if ((jt->second->inactive >= thInactive) || ((jt->second->inactive) && (thActive) && (jt->second->active < thActive))) {
+            delete jt->second;
+            tracks.erase(jt++);
+        } else {
+            jt->second->lifetime++;
+            if (!jt->second->inactive)
+                jt->second->active++;
+            ++jt;
+        }
 
     __CV_END__;
 }
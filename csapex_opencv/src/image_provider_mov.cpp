@@ -2,6 +2,7 @@
 #include "image_provider_mov.h"
 
 /// PROJECT
+#include <csapex/param/parameter_factory.h>
 #include <csapex/param/range_parameter.h>
 
 /// SYSTEM
@@ -11,15 +12,19 @@ CSAPEX_REGISTER_CLASS(csapex::ImageProviderMov, csapex::MessageProvider)
 
 using namespace csapex;
 
-ImageProviderMov::ImageProviderMov()
+ImageProviderMov::ImageProviderMov() : last_requested_frame_(-1)
 {
+    state.addParameter(csapex::param::factory::declareRange("cache/frames", 16, 4096, 256, 1));
+    state.addParameter(csapex::param::factory::declareRange("cache/seek interval", 1, 600, 30, 1));
+    state.addParameter(csapex::param::factory::declareRange("cache/lookahead", 0, 600, 30, 1));
 }
 
 void ImageProviderMov::load(const std::string& movie_file)
 {
-    capture_.open(movie_file);
-    fps_ = capture_.get(CV_CAP_PROP_FPS);
-    frames_ = capture_.get(CV_CAP_PROP_FRAME_COUNT);
+    frame_cache_.open(movie_file, state.readParameter<int>("cache/frames"), state.readParameter<int>("cache/seek interval"), state.readParameter<int>("cache/lookahead"));
+    fps_ = frame_cache_.getFps();
+    frames_ = frame_cache_.getFrameCount();
+    last_requested_frame_ = -1;
 
     csapex::param::Parameter::Ptr p = state.getParameter("set/current_frame");
     param::RangeParameter::Ptr range_p = std::dynamic_pointer_cast<param::RangeParameter>(p);
@@ -31,7 +36,7 @@ void ImageProviderMov::load(const std::string& movie_file)
 
 ImageProviderMov::~ImageProviderMov()
 {
-    capture_.release();
+    frame_cache_.close();
 }
 
 std::vector<std::string> ImageProviderMov::getExtensions() const
@@ -41,7 +46,7 @@ std::vector<std::string> ImageProviderMov::getExtensions() const
 
 bool ImageProviderMov::hasNext()
 {
-    if (!capture_.isOpened()) {
+    if (!frame_cache_.isOpened()) {
         return false;
 
     } else {
@@ -51,7 +56,7 @@ bool ImageProviderMov::hasNext()
 
 void ImageProviderMov::reallyNext(cv::Mat& img, cv::Mat& mask)
 {
-    if (!capture_.isOpened()) {
+    if (!frame_cache_.isOpened()) {
         std::cerr << "cannot display, capture not open" << std::endl;
         return;
     }
@@ -65,15 +70,18 @@ void ImageProviderMov::reallyNext(cv::Mat& img, cv::Mat& mask)
         return;
     }
 
-    if (skip) {
-        capture_.set(CV_CAP_PROP_POS_FRAMES, requested_frame);
-    }
+    int direction = requested_frame < last_requested_frame_ ? -1 : 1;
+    last_requested_frame_ = requested_frame;
 
-    capture_ >> last_frame_;
+    if (!frame_cache_.getFrame(requested_frame, last_frame_, direction)) {
+        std::cerr << "cannot decode frame " << requested_frame << std::endl;
+        setPlaying(false);
+        return;
+    }
 
     img = last_frame_;
 
-    next_frame = (int)capture_.get(CV_CAP_PROP_POS_FRAMES);
+    next_frame = requested_frame + 1;
     state["set/current_frame"] = next_frame;
 
     if (next_frame == frames_) {
@@ -3,6 +3,7 @@
 
 /// COMPONENT
 #include "image_provider_set.h"
+#include "video_frame_cache.h"
 
 namespace csapex
 {
@@ -21,7 +22,8 @@ public:
     std::vector<std::string> getExtensions() const;
 
 private:
-    cv::VideoCapture capture_;
+    VideoFrameCache frame_cache_;
+    int last_requested_frame_;
 };
 
 }  // namespace csapex
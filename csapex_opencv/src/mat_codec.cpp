@@ -0,0 +1,381 @@
+/// HEADER
+#include <csapex_opencv/mat_codec.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits>
+#include <mutex>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace csapex;
+
+namespace
+{
+std::mutex g_default_mutex;
+MatCodecOptions g_default;
+
+thread_local const MatCodecOptions* g_override = nullptr;
+}  // namespace
+
+bool csapex::parseMatCodec(const std::string& name, MatCodec& codec)
+{
+    if (name == "raw") {
+        codec = MatCodec::RAW;
+    } else if (name == "lz") {
+        codec = MatCodec::LZ;
+    } else if (name == "png") {
+        codec = MatCodec::PNG;
+    } else if (name == "jpeg") {
+        codec = MatCodec::JPEG;
+    } else if (name == "shared_memory") {
+        codec = MatCodec::SHARED_MEMORY;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool csapex::isLosslessInBand(MatCodec codec)
+{
+    return codec == MatCodec::RAW || codec == MatCodec::LZ || codec == MatCodec::PNG;
+}
+
+MatCodecOptions MatCodecSelection::current()
+{
+    if (g_override) {
+        return *g_override;
+    }
+    return getDefault();
+}
+
+MatCodecOptions MatCodecSelection::getDefault()
+{
+    std::unique_lock<std::mutex> lock(g_default_mutex);
+    return g_default;
+}
+
+void MatCodecSelection::setDefault(const MatCodecOptions& options)
+{
+    std::unique_lock<std::mutex> lock(g_default_mutex);
+    g_default = options;
+    if (!isLosslessInBand(g_default.codec)) {
+        g_default.codec = MatCodec::LZ;
+    }
+}
+
+ScopedMatCodec::ScopedMatCodec(const MatCodecOptions& options) : previous_(g_override), options_(options)
+{
+    g_override = &options_;
+}
+
+ScopedMatCodec::~ScopedMatCodec()
+{
+    g_override = previous_;
+}
+
+/// LZ
+namespace
+{
+const std::size_t MIN_MATCH = 4;
+const std::size_t MAX_OFFSET = 65535;
+const int HASH_BITS = 14;
+
+inline uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+inline void writeLength(std::vector<uint8_t>& out, std::size_t length)
+{
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back(static_cast<uint8_t>(length));
+}
+
+inline bool readLength(const uint8_t*& ip, const uint8_t* end, std::size_t& length)
+{
+    uint8_t b;
+    do {
+        if (ip >= end) {
+            return false;
+        }
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+void writeSequence(std::vector<uint8_t>& out, const uint8_t* literals, std::size_t literal_length, std::size_t offset, std::size_t match_length)
+{
+    const std::size_t match_code = match_length > 0 ? match_length - MIN_MATCH : 0;
+
+    uint8_t token = static_cast<uint8_t>((std::min<std::size_t>(literal_length, 15) << 4) | std::min<std::size_t>(match_code, 15));
+    out.push_back(token);
+    if (literal_length >= 15) {
+        writeLength(out, literal_length - 15);
+    }
+    out.insert(out.end(), literals, literals + literal_length);
+
+    if (match_length > 0) {
+        out.push_back(static_cast<uint8_t>(offset & 0xff));
+        out.push_back(static_cast<uint8_t>(offset >> 8));
+        if (match_code >= 15) {
+            writeLength(out, match_code - 15);
+        }
+    }
+}
+}  // namespace
+
+lz::Compressor::Compressor() : table_(1 << HASH_BITS, 0), base_(0)
+{
+}
+
+void lz::Compressor::compress(const uint8_t* input, std::size_t size, std::vector<uint8_t>& out)
+{
+    out.reserve(out.size() + size / 2 + 16);
+
+    // instead of clearing the table, every input gets its own range of stored positions
+    if (size >= std::numeric_limits<uint32_t>::max() - base_) {
+        std::fill(table_.begin(), table_.end(), 0);
+        base_ = 0;
+    }
+    const uint32_t base = base_;
+    base_ += static_cast<uint32_t>(size);
+
+    std::size_t anchor = 0;
+    std::size_t i = 0;
+    while (i + MIN_MATCH <= size) {
+        const uint32_t v = read32(input + i);
+        uint32_t& slot = table_[hash(v)];
+        const std::size_t candidate = slot > base ? slot - base : 0;
+        slot = static_cast<uint32_t>(base + i + 1);
+
+        if (candidate > 0 && i - (candidate - 1) <= MAX_OFFSET && read32(input + candidate - 1) == v) {
+            const std::size_t ref = candidate - 1;
+            std::size_t length = MIN_MATCH;
+            while (i + length < size && input[ref + length] == input[i + length]) {
+                ++length;
+            }
+
+            writeSequence(out, input + anchor, i - anchor, i - ref, length);
+            i += length;
+            anchor = i;
+        } else {
+            ++i;
+        }
+    }
+
+    // the stream always ends with a literal-only sequence
+    writeSequence(out, input + anchor, size - anchor, 0, 0);
+}
+
+bool lz::decompress(const uint8_t* input, std::size_t input_size, uint8_t* output, std::size_t size)
+{
+    const uint8_t* ip = input;
+    const uint8_t* const end = input + input_size;
+    uint8_t* op = output;
+    uint8_t* const out_end = output + size;
+
+    while (ip < end) {
+        const uint8_t token = *ip++;
+
+        std::size_t literal_length = token >> 4;
+        if (literal_length == 15 && !readLength(ip, end, literal_length)) {
+            return false;
+        }
+        if (literal_length > std::size_t(end - ip) || literal_length > std::size_t(out_end - op)) {
+            return false;
+        }
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+
+        if (ip == end) {
+            break;
+        }
+
+        if (end - ip < 2) {
+            return false;
+        }
+        const std::size_t offset = ip[0] | (std::size_t(ip[1]) << 8);
+        ip += 2;
+
+        std::size_t match_length = token & 15;
+        if (match_length == 15 && !readLength(ip, end, match_length)) {
+            return false;
+        }
+        match_length += MIN_MATCH;
+
+        if (offset == 0 || offset > std::size_t(op - output) || match_length > std::size_t(out_end - op)) {
+            return false;
+        }
+
+        // the match may overlap the bytes it produces
+        const uint8_t* match = op - offset;
+        for (std::size_t k = 0; k < match_length; ++k) {
+            op[k] = match[k];
+        }
+        op += match_length;
+    }
+
+    return op == out_end;
+}
+
+/// SHARED MEMORY
+namespace
+{
+const char* const SEGMENT_PREFIX = "csapex_mat_";
+
+/// unlinks the segments of writers that no longer exist
+void removeStaleSegments()
+{
+    DIR* dir = opendir("/dev/shm");
+    if (!dir) {
+        return;
+    }
+
+    const std::size_t prefix_length = std::strlen(SEGMENT_PREFIX);
+    while (dirent* entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name.compare(0, prefix_length, SEGMENT_PREFIX) != 0) {
+            continue;
+        }
+        const pid_t pid = static_cast<pid_t>(std::strtol(name.c_str() + prefix_length, nullptr, 10));
+        if (pid > 0 && pid != getpid() && kill(pid, 0) != 0 && errno == ESRCH) {
+            shm_unlink(("/" + name).c_str());
+        }
+    }
+
+    closedir(dir);
+}
+
+/// the segments stored by this process, oldest first
+class SegmentRegistry
+{
+public:
+    SegmentRegistry()
+    {
+        removeStaleSegments();
+    }
+
+    ~SegmentRegistry()
+    {
+        for (const std::string& name : names_) {
+            shm_unlink(name.c_str());
+        }
+    }
+
+    void add(const std::string& name, std::size_t retained)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        names_.push_back(name);
+        while (names_.size() > retained) {
+            shm_unlink(names_.front().c_str());
+            names_.pop_front();
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<std::string> names_;
+};
+
+SegmentRegistry& registry()
+{
+    static SegmentRegistry instance;
+    return instance;
+}
+}  // namespace
+
+std::string shm::store(const cv::Mat& mat, std::size_t retained)
+{
+    static std::atomic<unsigned> counter(0);
+
+    const std::size_t row_bytes = mat.cols * mat.elemSize();
+    const std::size_t size = mat.rows * row_bytes;
+    if (size == 0 || retained == 0) {
+        return std::string();
+    }
+
+    SegmentRegistry& segments = registry();
+
+    const std::string name = "/" + std::string(SEGMENT_PREFIX) + std::to_string(getpid()) + "_" + std::to_string(counter++);
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return std::string();
+    }
+
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return std::string();
+    }
+
+    void* segment = mmap(nullptr, size, PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return std::string();
+    }
+
+    uint8_t* dst = static_cast<uint8_t*>(segment);
+    if (mat.isContinuous()) {
+        std::memcpy(dst, mat.ptr(), size);
+    } else {
+        for (int row = 0; row < mat.rows; ++row) {
+            std::memcpy(dst + row * row_bytes, mat.ptr(row), row_bytes);
+        }
+    }
+
+    munmap(segment, size);
+
+    segments.add(name, retained);
+    return name;
+}
+
+bool shm::load(const std::string& name, cv::Mat& mat)
+{
+    const std::size_t size = mat.total() * mat.elemSize();
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || std::size_t(info.st_size) != size) {
+        close(fd);
+        return false;
+    }
+
+    void* segment = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (segment == MAP_FAILED) {
+        return false;
+    }
+
+    std::memcpy(mat.ptr(), segment, size);
+
+    munmap(segment, size);
+    return true;
+}
@@ -0,0 +1,49 @@
+/// HEADER
+#include "register_plugin.h"
+
+/// COMPONENT
+#include <csapex_opencv/mat_codec.h>
+
+/// PROJECT
+#include <csapex/core/csapex_core.h>
+#include <csapex/core/settings.h>
+#include <csapex/utility/register_apex_plugin.h>
+
+CSAPEX_REGISTER_CLASS(csapex::RegisterOpenCVPlugin, csapex::CorePlugin)
+
+using namespace csapex;
+
+RegisterOpenCVPlugin::RegisterOpenCVPlugin() : core_(nullptr)
+{
+}
+
+void RegisterOpenCVPlugin::init(CsApexCore& core)
+{
+    core_ = &core;
+
+    applyCodecSettings();
+
+    connection_ = core_->getSettings().setting_changed.connect([this](const std::string& name) {
+        if (name.compare(0, 9, "mat_codec") == 0) {
+            applyCodecSettings();
+        }
+    });
+}
+
+void RegisterOpenCVPlugin::shutdown()
+{
+    MatCodecSelection::setDefault(MatCodecOptions());
+}
+
+void RegisterOpenCVPlugin::applyCodecSettings()
+{
+    Settings& settings = core_->getSettings();
+
+    MatCodecOptions options;
+
+    // unknown names keep the uncompressed default
+    parseMatCodec(settings.get<std::string>("mat_codec", "raw"), options.codec);
+    options.png_compression = settings.get<int>("mat_codec_png_compression", options.png_compression);
+
+    MatCodecSelection::setDefault(options);
+}
@@ -0,0 +1,35 @@
+#ifndef REGISTER_OPENCV_PLUGIN_H
+#define REGISTER_OPENCV_PLUGIN_H
+
+/// PROJECT
+#include <csapex/core/core_plugin.h>
+#include <csapex/signal/signal_fwd.h>
+
+namespace csapex
+{
+/**
+ * @brief The RegisterOpenCVPlugin class applies the default cv::Mat codec settings:
+ *        mat_codec (raw, lz or png) and mat_codec_png_compression.
+ *        The default also applies to files, so jpeg and shared_memory fall back to lz,
+ *        they can only be selected per connection (see MatCodecSelection).
+ */
+class RegisterOpenCVPlugin : public CorePlugin
+{
+public:
+    RegisterOpenCVPlugin();
+
+    void init(CsApexCore& core) override;
+    void shutdown() override;
+
+private:
+    void applyCodecSettings();
+
+private:
+    CsApexCore* core_;
+
+    slim_signal::ScopedConnection connection_;
+};
+
+}  // namespace csapex
+
+#endif  // REGISTER_OPENCV_PLUGIN_H
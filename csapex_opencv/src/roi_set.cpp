@@ -0,0 +1,157 @@
+/// HEADER
+#include <csapex_opencv/roi_set.h>
+
+/// SYSTEM
+#include <algorithm>
+
+using namespace csapex;
+
+RoiSet::RoiSet()
+{
+}
+
+void RoiSet::clear()
+{
+    rects_.clear();
+    classifications_.clear();
+    scores_.clear();
+    colors_.clear();
+    labels_.clear();
+}
+
+void RoiSet::reserve(std::size_t n)
+{
+    rects_.reserve(n);
+    classifications_.reserve(n);
+    scores_.reserve(n);
+    colors_.reserve(n);
+}
+
+void RoiSet::resize(std::size_t n)
+{
+    rects_.resize(n);
+    classifications_.resize(n, -1);
+    scores_.resize(n, 0.0f);
+    colors_.resize(n, packColor(cv::Scalar(255, 255, 0)));
+    if (!labels_.empty()) {
+        labels_.resize(n);
+    }
+}
+
+void RoiSet::push_back(const Roi& roi, float score)
+{
+    push_back(roi.rect(), roi.classification(), score, roi.color());
+
+    const std::string label = roi.label();
+    if (!label.empty()) {
+        setLabel(size() - 1, label);
+    }
+}
+
+void RoiSet::push_back(const cv::Rect& rect, int classification, float score, const cv::Scalar& color)
+{
+    rects_.push_back(rect);
+    classifications_.push_back(classification);
+    scores_.push_back(score);
+    colors_.push_back(packColor(color));
+    if (!labels_.empty()) {
+        labels_.emplace_back();
+    }
+}
+
+Roi RoiSet::roi(std::size_t index) const
+{
+    Roi roi;
+    roi.setRect(rects_[index]);
+    roi.setClassification(classifications_[index]);
+    roi.setColor(unpackColor(colors_[index]));
+    if (!labels_.empty()) {
+        roi.setLabel(labels_[index]);
+    }
+    return roi;
+}
+
+std::string RoiSet::label(std::size_t index) const
+{
+    return labels_.empty() ? std::string() : labels_[index];
+}
+
+void RoiSet::setLabel(std::size_t index, const std::string& label)
+{
+    if (labels_.empty()) {
+        if (label.empty()) {
+            return;
+        }
+        labels_.resize(size());
+    }
+    labels_[index] = label;
+}
+
+namespace
+{
+template <typename T>
+void compact(std::vector<T>& column, const std::vector<char>& mask)
+{
+    std::size_t target = 0;
+    for (std::size_t i = 0, n = column.size(); i < n; ++i) {
+        if (mask[i]) {
+            if (target != i) {
+                column[target] = std::move(column[i]);
+            }
+            ++target;
+        }
+    }
+    column.resize(target);
+}
+}  // namespace
+
+void RoiSet::select(const std::vector<char>& mask)
+{
+    compact(rects_, mask);
+    compact(classifications_, mask);
+    compact(scores_, mask);
+    compact(colors_, mask);
+    if (!labels_.empty()) {
+        compact(labels_, mask);
+    }
+}
+
+void RoiSet::partition(const std::vector<char>& mask, RoiSet& selected, RoiSet& rejected) const
+{
+    const std::size_t n = size();
+    const std::size_t n_selected = std::count_if(mask.begin(), mask.begin() + n, [](char c) { return c != 0; });
+
+    selected.clear();
+    rejected.clear();
+    selected.reserve(n_selected);
+    rejected.reserve(n - n_selected);
+    if (!labels_.empty()) {
+        selected.labels_.reserve(n_selected);
+        rejected.labels_.reserve(n - n_selected);
+    }
+
+    for (std::size_t i = 0; i < n; ++i) {
+        RoiSet& target = mask[i] ? selected : rejected;
+        target.rects_.push_back(rects_[i]);
+        target.classifications_.push_back(classifications_[i]);
+        target.scores_.push_back(scores_[i]);
+        target.colors_.push_back(colors_[i]);
+        if (!labels_.empty()) {
+            target.labels_.push_back(labels_[i]);
+        }
+    }
+}
+
+uint32_t RoiSet::packColor(const cv::Scalar& color)
+{
+    uint32_t packed = 0;
+    for (int c = 0; c < 4; ++c) {
+        packed |= uint32_t(cv::saturate_cast<uchar>(color[c])) << (8 * c);
+    }
+    return packed;
+}
+
+cv::Scalar RoiSet::unpackColor(uint32_t color)
+{
+    return cv::Scalar(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff, (color >> 24) & 0xff);
+}
@@ -0,0 +1,155 @@
+/// HEADER
+#include <csapex_opencv/roi_set_message.h>
+
+/// PROJECT
+#include <csapex/serialization/io/std_io.h>
+#include <csapex/utility/assert.h>
+#include <csapex/utility/register_msg.h>
+#include <csapex_opencv/yaml_io.hpp>
+
+CSAPEX_REGISTER_MESSAGE(csapex::connection_types::RoiSetMessage)
+
+using namespace csapex;
+using namespace connection_types;
+
+RoiSetMessage::RoiSetMessage() : MessageTemplate<RoiSet, RoiSetMessage>("/")
+{
+}
+
+RoiSetMessage::RoiSetMessage(const std::string& frame_id, Stamp stamp_micro_seconds) : MessageTemplate<RoiSet, RoiSetMessage>(frame_id, stamp_micro_seconds)
+{
+}
+
+void RoiSetMessage::assign(const std::vector<RoiMessage>& rois)
+{
+    value.clear();
+    value.reserve(rois.size());
+    for (const RoiMessage& roi : rois) {
+        value.push_back(roi.value);
+    }
+
+    if (!rois.empty()) {
+        frame_id = rois.front().frame_id;
+        stamp_micro_seconds = rois.front().stamp_micro_seconds;
+    }
+}
+
+std::shared_ptr<std::vector<RoiMessage>> RoiSetMessage::toRoiMessages() const
+{
+    std::shared_ptr<std::vector<RoiMessage>> result(new std::vector<RoiMessage>(value.size()));
+    for (std::size_t i = 0, n = value.size(); i < n; ++i) {
+        RoiMessage& roi = result->at(i);
+        roi.frame_id = frame_id;
+        roi.stamp_micro_seconds = stamp_micro_seconds;
+        roi.value = value.roi(i);
+    }
+    return result;
+}
+
+SerializationBuffer& csapex::operator<<(SerializationBuffer& data, const RoiSet& rois)
+{
+    const uint32_t size = rois.size();
+    const uint8_t has_labels = !rois.labels().empty();
+
+    data << size;
+    data << has_labels;
+
+    if (size > 0) {
+        data.writeRaw(rois.rects().data(), size * sizeof(cv::Rect));
+        data.writeRaw(rois.classifications().data(), size * sizeof(int));
+        data.writeRaw(rois.scores().data(), size * sizeof(float));
+        data.writeRaw(rois.colors().data(), size * sizeof(uint32_t));
+    }
+    if (has_labels) {
+        data << rois.labels();
+    }
+
+    return data;
+}
+
+const SerializationBuffer& csapex::operator>>(const SerializationBuffer& data, RoiSet& rois)
+{
+    uint32_t size;
+    uint8_t has_labels;
+
+    data >> size;
+    data >> has_labels;
+
+    rois.clear();
+    rois.resize(size);
+
+    if (size > 0) {
+        data.readRaw(rois.rects().data(), size * sizeof(cv::Rect));
+        data.readRaw(rois.classifications().data(), size * sizeof(int));
+        data.readRaw(rois.scores().data(), size * sizeof(float));
+        data.readRaw(rois.colors().data(), size * sizeof(uint32_t));
+    }
+    if (has_labels) {
+        std::vector<std::string> labels;
+        data >> labels;
+        apex_assert(labels.size() == size);
+        for (std::size_t i = 0; i < size; ++i) {
+            rois.setLabel(i, labels[i]);
+        }
+    }
+
+    return data;
+}
+
+/// YAML
+namespace YAML
+{
+CSAPEX_EXPORT_PLUGIN Node convert<csapex::connection_types::RoiSetMessage>::encode(const csapex::connection_types::RoiSetMessage& rhs)
+{
+    Node node = convert<csapex::connection_types::Message>::encode(rhs);
+
+    const RoiSet& rois = rhs.value;
+
+    std::vector<int> rects;
+    rects.reserve(rois.size() * 4);
+    for (const cv::Rect& r : rois.rects()) {
+        rects.push_back(r.x);
+        rects.push_back(r.y);
+        rects.push_back(r.width);
+        rects.push_back(r.height);
+    }
+
+    node["rects"] = rects;
+    node["classifications"] = rois.classifications();
+    node["scores"] = rois.scores();
+    node["colors"] = rois.colors();
+    if (!rois.labels().empty()) {
+        node["labels"] = rois.labels();
+    }
+    return node;
+}
+
+CSAPEX_EXPORT_PLUGIN bool convert<csapex::connection_types::RoiSetMessage>::decode(const Node& node, csapex::connection_types::RoiSetMessage& rhs)
+{
+    if (!node.IsMap()) {
+        return false;
+    }
+    convert<csapex::connection_types::Message>::decode(node, rhs);
+
+    std::vector<int> rects = node["rects"].as<std::vector<int>>();
+    std::size_t size = rects.size() / 4;
+
+    RoiSet& rois = rhs.value;
+    rois.clear();
+    rois.resize(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        rois.rects()[i] = cv::Rect(rects[4 * i], rects[4 * i + 1], rects[4 * i + 2], rects[4 * i + 3]);
+    }
+    rois.classifications() = node["classifications"].as<std::vector<int>>();
+    rois.scores() = node["scores"].as<std::vector<float>>();
+    rois.colors() = node["colors"].as<std::vector<uint32_t>>();
+    if (node["labels"].IsDefined()) {
+        std::vector<std::string> labels = node["labels"].as<std::vector<std::string>>();
+        for (std::size_t i = 0; i < labels.size() && i < size; ++i) {
+            rois.setLabel(i, labels[i]);
+        }
+    }
+
+    return rois.classifications().size() == size && rois.scores().size() == size && rois.colors().size() == size;
+}
+}  // namespace YAML
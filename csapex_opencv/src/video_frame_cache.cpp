@@ -0,0 +1,217 @@
+/// HEADER
+#include "video_frame_cache.h"
+
+using namespace csapex;
+
+VideoFrameCache::VideoFrameCache()
+  : decoder_position_(0), frames_(0), fps_(0.0), block_size_(1), lookahead_(0), capacity_(1), running_(false), prefetch_frame_(-1), prefetch_direction_(1)
+{
+}
+
+VideoFrameCache::~VideoFrameCache()
+{
+    close();
+}
+
+bool VideoFrameCache::open(const std::string& file, std::size_t capacity, int block_size, int lookahead)
+{
+    close();
+
+    {
+        std::unique_lock<std::mutex> lock(decoder_mutex_);
+        if (!capture_.open(file)) {
+            return false;
+        }
+        fps_ = capture_.get(CV_CAP_PROP_FPS);
+        frames_ = capture_.get(CV_CAP_PROP_FRAME_COUNT);
+        decoder_position_ = 0;
+    }
+
+    block_size_ = std::max(1, block_size);
+    lookahead_ = std::max(0, lookahead);
+
+    {
+        std::unique_lock<std::mutex> lock(cache_mutex_);
+        // a whole block has to fit, otherwise stepping backwards thrashes
+        capacity_ = std::max<std::size_t>(capacity, block_size_ + lookahead_ + 1);
+        prefetch_frame_ = -1;
+        prefetch_direction_ = 1;
+        running_ = true;
+    }
+
+    prefetcher_ = std::thread(&VideoFrameCache::run, this);
+    return true;
+}
+
+void VideoFrameCache::close()
+{
+    {
+        std::unique_lock<std::mutex> lock(cache_mutex_);
+        running_ = false;
+    }
+    prefetch_requested_.notify_all();
+    if (prefetcher_.joinable()) {
+        prefetcher_.join();
+    }
+
+    std::unique_lock<std::mutex> lock(decoder_mutex_);
+    capture_.release();
+
+    std::unique_lock<std::mutex> cache_lock(cache_mutex_);
+    lru_.clear();
+    index_.clear();
+}
+
+bool VideoFrameCache::isOpened() const
+{
+    std::unique_lock<std::mutex> lock(decoder_mutex_);
+    return capture_.isOpened();
+}
+
+int VideoFrameCache::getFrameCount() const
+{
+    return frames_;
+}
+
+double VideoFrameCache::getFps() const
+{
+    return fps_;
+}
+
+bool VideoFrameCache::getFrame(int frame, cv::Mat& img, int direction)
+{
+    if (frame < 0 || frame >= frames_) {
+        return false;
+    }
+
+    bool found = lookup(frame, img) || decode(frame, img);
+
+    {
+        std::unique_lock<std::mutex> lock(cache_mutex_);
+        prefetch_frame_ = frame;
+        prefetch_direction_ = direction < 0 ? -1 : 1;
+    }
+    prefetch_requested_.notify_one();
+
+    return found;
+}
+
+bool VideoFrameCache::lookup(int frame, cv::Mat& img)
+{
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    auto pos = index_.find(frame);
+    if (pos == index_.end()) {
+        return false;
+    }
+
+    lru_.splice(lru_.begin(), lru_, pos->second);
+    img = pos->second->second;
+    return true;
+}
+
+void VideoFrameCache::insert(int frame, const cv::Mat& img)
+{
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    auto pos = index_.find(frame);
+    if (pos != index_.end()) {
+        lru_.splice(lru_.begin(), lru_, pos->second);
+        return;
+    }
+
+    lru_.emplace_front(frame, img);
+    index_[frame] = lru_.begin();
+
+    while (lru_.size() > capacity_) {
+        index_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+int VideoFrameCache::blockStart(int frame) const
+{
+    return (frame / block_size_) * block_size_;
+}
+
+bool VideoFrameCache::decode(int frame, cv::Mat& img)
+{
+    std::unique_lock<std::mutex> lock(decoder_mutex_);
+    if (!capture_.isOpened()) {
+        return false;
+    }
+
+    // decode forward from the current position if possible, otherwise from the start of the block
+    if (decoder_position_ > frame || frame - decoder_position_ >= block_size_) {
+        decoder_position_ = blockStart(frame);
+        capture_.set(CV_CAP_PROP_POS_FRAMES, decoder_position_);
+    }
+
+    while (decoder_position_ <= frame) {
+        // always read into a fresh matrix, the capture reuses its buffers otherwise
+        cv::Mat decoded;
+        if (!capture_.read(decoded)) {
+            return false;
+        }
+        insert(decoder_position_, decoded);
+        if (decoder_position_ == frame) {
+            img = decoded;
+        }
+        ++decoder_position_;
+    }
+
+    return true;
+}
+
+int VideoFrameCache::nextPrefetchFrame() const
+{
+    // caller holds cache_mutex_
+    if (prefetch_frame_ < 0) {
+        return -1;
+    }
+
+    if (prefetch_direction_ > 0) {
+        int end = std::min(frames_, prefetch_frame_ + 1 + lookahead_);
+        for (int f = prefetch_frame_ + 1; f < end; ++f) {
+            if (index_.find(f) == index_.end()) {
+                return f;
+            }
+        }
+
+    } else {
+        // decoding happens forwards, so make sure the whole previous range is present
+        int begin = std::max(0, blockStart(std::max(0, prefetch_frame_ - lookahead_)));
+        for (int f = begin; f < prefetch_frame_; ++f) {
+            if (index_.find(f) == index_.end()) {
+                return f;
+            }
+        }
+    }
+
+    return -1;
+}
+
+void VideoFrameCache::run()
+{
+    while (true) {
+        int frame = -1;
+        {
+            std::unique_lock<std::mutex> lock(cache_mutex_);
+            prefetch_requested_.wait(lock, [this, &frame]() {
+                if (!running_) {
+                    return true;
+                }
+                frame = nextPrefetchFrame();
+                return frame >= 0;
+            });
+            if (!running_) {
+                return;
+            }
+        }
+
+        cv::Mat img;
+        if (!decode(frame, img)) {
+            // nothing more to do until the next request
+            std::unique_lock<std::mutex> lock(cache_mutex_);
+            prefetch_frame_ = -1;
+        }
+    }
+}
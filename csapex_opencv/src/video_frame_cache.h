@@ -0,0 +1,76 @@
+#ifndef VIDEO_FRAME_CACHE_H
+#define VIDEO_FRAME_CACHE_H
+
+/// SYSTEM
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include <unordered_map>
+
+namespace csapex
+{
+/**
+ * @brief The VideoFrameCache class provides random access to the frames of a video file.
+ *
+ * The file is divided into blocks of a fixed number of frames that are used as
+ * seek points. A cache miss seeks to the start of the enclosing block and decodes
+ * forward, caching every frame on the way, so that random access and stepping
+ * backwards cost at most one block decode. Decoded frames are kept in an LRU cache
+ * and a background thread decodes ahead in the current play direction.
+ */
+class VideoFrameCache
+{
+public:
+    VideoFrameCache();
+    ~VideoFrameCache();
+
+    bool open(const std::string& file, std::size_t capacity, int block_size, int lookahead);
+    void close();
+
+    bool isOpened() const;
+    int getFrameCount() const;
+    double getFps() const;
+
+    /**
+     * @brief getFrame returns a decoded frame, the image data must not be modified
+     * @param direction play direction (+1 forwards, -1 backwards), used for prefetching
+     */
+    bool getFrame(int frame, cv::Mat& img, int direction = 1);
+
+private:
+    bool lookup(int frame, cv::Mat& img);
+    void insert(int frame, const cv::Mat& img);
+
+    bool decode(int frame, cv::Mat& img);
+    int blockStart(int frame) const;
+
+    void run();
+    int nextPrefetchFrame() const;
+
+private:
+    mutable std::mutex decoder_mutex_;
+    cv::VideoCapture capture_;
+    int decoder_position_;
+
+    int frames_;
+    double fps_;
+    int block_size_;
+    int lookahead_;
+
+    mutable std::mutex cache_mutex_;
+    std::size_t capacity_;
+    std::list<std::pair<int, cv::Mat>> lru_;
+    std::unordered_map<int, std::list<std::pair<int, cv::Mat>>::iterator> index_;
+
+    std::thread prefetcher_;
+    std::condition_variable prefetch_requested_;
+    bool running_;
+    int prefetch_frame_;
+    int prefetch_direction_;
+};
+
+}  // namespace csapex
+
+#endif  // VIDEO_FRAME_CACHE_H
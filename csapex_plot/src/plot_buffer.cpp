@@ -0,0 +1,282 @@
+/// HEADER
+#include "plot_buffer.h"
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace csapex;
+
+PlotBuffer::PlotBuffer(std::size_t capacity, std::size_t columns) : capacity_(0), size_(0), pushed_(0), columns_(columns), bucket_size_(1), front_valid_(false), front_key_(0)
+{
+    setCapacity(capacity);
+}
+
+void PlotBuffer::setCapacity(std::size_t capacity)
+{
+    capacity_ = std::max<std::size_t>(1, capacity);
+    if (data_.capacity() > 2 * capacity_) {
+        std::vector<double>().swap(data_);
+    }
+    clear();
+}
+
+std::size_t PlotBuffer::capacity() const
+{
+    return capacity_;
+}
+
+void PlotBuffer::setColumns(std::size_t columns)
+{
+    if (columns != columns_) {
+        columns_ = columns;
+        rebuildBuckets();
+    }
+}
+
+std::size_t PlotBuffer::size() const
+{
+    return size_;
+}
+
+bool PlotBuffer::empty() const
+{
+    return size_ == 0;
+}
+
+void PlotBuffer::clear()
+{
+    data_.clear();
+    size_ = 0;
+    pushed_ = 0;
+    min_index_.clear();
+    max_index_.clear();
+    buckets_.clear();
+    bucket_size_ = 1;
+    front_valid_ = false;
+}
+
+void PlotBuffer::push(double value)
+{
+    const std::uint64_t index = pushed_++;
+
+    if (index < capacity_) {
+        // still growing, nothing is evicted yet
+        data_.push_back(value);
+        ++size_;
+
+    } else {
+        if (data_.size() < 2 * capacity_) {
+            // first wrap around, mirror the window so that [head, head + size) is always contiguous
+            data_.resize(2 * capacity_);
+            std::copy(data_.begin(), data_.begin() + capacity_, data_.begin() + capacity_);
+        }
+        const std::size_t slot = index % capacity_;
+        data_[slot] = value;
+        data_[slot + capacity_] = value;
+    }
+
+    const std::uint64_t oldest = pushed_ - size_;
+    while (!min_index_.empty() && min_index_.front() < oldest) {
+        min_index_.pop_front();
+    }
+    while (!max_index_.empty() && max_index_.front() < oldest) {
+        max_index_.pop_front();
+    }
+
+    if (columns_ > 0) {
+        evictFromBuckets(oldest, index);
+        addToBuckets(index, value);
+    }
+
+    if (std::isnan(value)) {
+        return;
+    }
+
+    pushMonotonic(min_index_, index, value, true);
+    pushMonotonic(max_index_, index, value, false);
+}
+
+void PlotBuffer::pushMonotonic(std::deque<std::uint64_t>& indices, std::uint64_t index, double value, bool minimum) const
+{
+    while (!indices.empty() && (minimum ? valueAt(indices.back()) >= value : valueAt(indices.back()) <= value)) {
+        indices.pop_back();
+    }
+    indices.push_back(index);
+}
+
+const double* PlotBuffer::data() const
+{
+    if (size_ == 0) {
+        return data_.data();
+    }
+    return &data_[(pushed_ - size_) % capacity_];
+}
+
+double PlotBuffer::operator[](std::size_t i) const
+{
+    return data()[i];
+}
+
+double PlotBuffer::front() const
+{
+    return data()[0];
+}
+
+double PlotBuffer::back() const
+{
+    return data()[size_ - 1];
+}
+
+double PlotBuffer::min() const
+{
+    return min_index_.empty() ? std::numeric_limits<double>::quiet_NaN() : valueAt(min_index_.front());
+}
+
+double PlotBuffer::max() const
+{
+    return max_index_.empty() ? std::numeric_limits<double>::quiet_NaN() : valueAt(max_index_.front());
+}
+
+void PlotBuffer::decimate(std::vector<std::size_t>& positions) const
+{
+    positions.clear();
+
+    if (columns_ == 0 || size_ <= 2 * columns_) {
+        positions.resize(size_);
+        for (std::size_t i = 0; i < size_; ++i) {
+            positions[i] = i;
+        }
+        return;
+    }
+
+    const std::uint64_t oldest = pushed_ - size_;
+    positions.reserve(2 * buckets_.size());
+    for (const Bucket& bucket : buckets_) {
+        const std::uint64_t first = std::min(bucket.min_index, bucket.max_index);
+        const std::uint64_t second = std::max(bucket.min_index, bucket.max_index);
+        positions.push_back(first - oldest);
+        if (second != first) {
+            positions.push_back(second - oldest);
+        }
+    }
+}
+
+double PlotBuffer::valueAt(std::uint64_t absolute_index) const
+{
+    return data_[absolute_index % capacity_];
+}
+
+void PlotBuffer::Bucket::add(std::uint64_t index, double value)
+{
+    // NaN samples are only kept if the bucket has nothing else
+    if (std::isnan(min) || value < min) {
+        min = value;
+        min_index = index;
+    }
+    if (std::isnan(max) || value > max) {
+        max = value;
+        max_index = index;
+    }
+}
+
+void PlotBuffer::addToBuckets(std::uint64_t index, double value)
+{
+    const std::uint64_t key = index / bucket_size_;
+    if (buckets_.empty() || buckets_.back().key != key) {
+        buckets_.push_back(Bucket{ key, index, index, value, value });
+    } else {
+        buckets_.back().add(index, value);
+    }
+
+    if (buckets_.size() <= columns_ + 1) {
+        return;
+    }
+
+    // too many buckets, merge neighbouring pairs
+    bucket_size_ *= 2;
+    front_valid_ = false;
+    std::deque<Bucket> merged;
+    for (const Bucket& bucket : buckets_) {
+        const std::uint64_t merged_key = bucket.key / 2;
+        if (merged.empty() || merged.back().key != merged_key) {
+            merged.push_back(bucket);
+            merged.back().key = merged_key;
+        } else {
+            merged.back().add(bucket.min_index, bucket.min);
+            merged.back().add(bucket.max_index, bucket.max);
+        }
+    }
+    buckets_.swap(merged);
+}
+
+void PlotBuffer::evictFromBuckets(std::uint64_t oldest, std::uint64_t end)
+{
+    while (!buckets_.empty() && (buckets_.front().key + 1) * bucket_size_ <= oldest) {
+        buckets_.pop_front();
+    }
+    if (buckets_.empty()) {
+        return;
+    }
+
+    Bucket& front = buckets_.front();
+    if (front.min_index >= oldest && front.max_index >= oldest) {
+        return;
+    }
+
+    const std::uint64_t last = std::min((front.key + 1) * bucket_size_, end);
+    if (last <= oldest) {
+        buckets_.pop_front();
+        return;
+    }
+
+    // an extremum of the partially evicted bucket is gone. The remaining samples are
+    // indexed once per bucket, so that every later eviction from it is amortized O(1)
+    const bool growing = buckets_.size() == 1;
+    if (growing || !front_valid_ || front_key_ != front.key) {
+        front_min_index_.clear();
+        front_max_index_.clear();
+        for (std::uint64_t i = oldest; i < last; ++i) {
+            const double value = valueAt(i);
+            if (!std::isnan(value)) {
+                pushMonotonic(front_min_index_, i, value, true);
+                pushMonotonic(front_max_index_, i, value, false);
+            }
+        }
+        // the last bucket still receives samples, its deques would be outdated by the next push
+        front_valid_ = !growing;
+        front_key_ = front.key;
+    } else {
+        while (!front_min_index_.empty() && front_min_index_.front() < oldest) {
+            front_min_index_.pop_front();
+        }
+        while (!front_max_index_.empty() && front_max_index_.front() < oldest) {
+            front_max_index_.pop_front();
+        }
+    }
+
+    if (front_min_index_.empty()) {
+        // only NaN samples are left
+        front.min_index = front.max_index = oldest;
+        front.min = front.max = valueAt(oldest);
+    } else {
+        front.min_index = front_min_index_.front();
+        front.min = valueAt(front.min_index);
+        front.max_index = front_max_index_.front();
+        front.max = valueAt(front.max_index);
+    }
+}
+
+void PlotBuffer::rebuildBuckets()
+{
+    buckets_.clear();
+    bucket_size_ = 1;
+    front_valid_ = false;
+    if (columns_ == 0) {
+        return;
+    }
+    for (std::uint64_t i = pushed_ - size_; i < pushed_; ++i) {
+        addToBuckets(i, valueAt(i));
+    }
+}
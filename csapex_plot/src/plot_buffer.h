@@ -0,0 +1,104 @@
+#ifndef PLOT_BUFFER_H
+#define PLOT_BUFFER_H
+
+/// SYSTEM
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The PlotBuffer class is a bounded ring buffer of samples.
+ *
+ * Memory grows with the pushed samples until the capacity is reached. From then
+ * on every sample is stored twice, so the buffered window is always available as
+ * one contiguous array (see data()) without copying.
+ * The extrema of the window are tracked incrementally with monotonic deques,
+ * min() and max() are O(1) and push() is amortized O(1).
+ *
+ * If a number of columns is set, the samples are also grouped into at most
+ * columns + 1 buckets of consecutive samples, each remembering its minimum and
+ * maximum. The buckets are updated on push and eviction, decimate() reads the
+ * curve to draw directly from them.
+ */
+class PlotBuffer
+{
+public:
+    explicit PlotBuffer(std::size_t capacity = 1000, std::size_t columns = 0);
+
+    void setCapacity(std::size_t capacity);
+    std::size_t capacity() const;
+
+    /// number of pixel columns the buffer is decimated to, 0 disables the buckets
+    void setColumns(std::size_t columns);
+
+    std::size_t size() const;
+    bool empty() const;
+
+    void clear();
+    void push(double value);
+
+    /// oldest sample first
+    const double* data() const;
+    double operator[](std::size_t i) const;
+    double front() const;
+    double back() const;
+
+    /// extrema of the buffered samples, NaN samples are ignored
+    double min() const;
+    double max() const;
+
+    /**
+     * @brief decimate selects the samples to draw, at most two per bucket.
+     *        The minimum and the maximum of each bucket are kept in their original order,
+     *        so the rendered curve is indistinguishable from the full one.
+     *        If there are no more than two samples per column, all of them are selected.
+     * @param positions indices into data(), in increasing order
+     */
+    void decimate(std::vector<std::size_t>& positions) const;
+
+private:
+    struct Bucket
+    {
+        std::uint64_t key;
+        std::uint64_t min_index;
+        std::uint64_t max_index;
+        double min;
+        double max;
+
+        void add(std::uint64_t index, double value);
+    };
+
+    double valueAt(std::uint64_t absolute_index) const;
+
+    void addToBuckets(std::uint64_t index, double value);
+    void evictFromBuckets(std::uint64_t oldest, std::uint64_t end);
+    void rebuildBuckets();
+
+    void pushMonotonic(std::deque<std::uint64_t>& indices, std::uint64_t index, double value, bool minimum) const;
+
+private:
+    std::vector<double> data_;
+    std::size_t capacity_;
+    std::size_t size_;
+    std::uint64_t pushed_;
+
+    std::deque<std::uint64_t> min_index_;
+    std::deque<std::uint64_t> max_index_;
+
+    // bucket k holds the samples [k * bucket_size_, (k + 1) * bucket_size_)
+    std::size_t columns_;
+    std::uint64_t bucket_size_;
+    std::deque<Bucket> buckets_;
+
+    // monotonic deques of the partially evicted first bucket
+    bool front_valid_;
+    std::uint64_t front_key_;
+    std::deque<std::uint64_t> front_min_index_;
+    std::deque<std::uint64_t> front_max_index_;
+};
+
+}  // namespace csapex
+
+#endif  // PLOT_BUFFER_H
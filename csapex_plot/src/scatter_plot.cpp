@@ -12,6 +12,8 @@
 #include <csapex_opencv/cv_mat_message.h>
 
 /// SYSTEM
+#include <cmath>
+#include <limits>
 #include <qwt_scale_engine.h>
 
 CSAPEX_REGISTER_CLASS(csapex::ScatterPlot, csapex::Node)
@@ -19,6 +21,10 @@ CSAPEX_REGISTER_CLASS(csapex::ScatterPlot, csapex::Node)
 using namespace csapex;
 using namespace csapex::connection_types;
 
+ScatterPlot::ScatterPlot() : buffer_size_(100000)
+{
+}
+
 void ScatterPlot::setup(NodeModifier& node_modifier)
 {
     in_x_ = node_modifier.addMultiInput<double, GenericVectorMessage>("x");
@@ -33,6 +39,11 @@ void ScatterPlot::setupParameters(Parameterizable& parameters)
     setupVariadicParameters(parameters);
 
     parameters.addParameter(param::factory::declareRange("point_size", 0.1, 10.0, 1.0, 0.01));
+    parameters.addParameter(param::factory::declareValue("~output/plot/number_of_points", param::ParameterDescription("Show only the last n samples."), 100000),
+                            [this](param::Parameter* p) {
+                                buffer_size_ = std::max(1, p->as<int>());
+                                reset();
+                            });
     parameters.addParameter(param::factory::declareTrigger("reset"), [this](param::Parameter*) { reset(); });
     reset();
 }
@@ -40,14 +51,42 @@ void ScatterPlot::setupParameters(Parameterizable& parameters)
 void ScatterPlot::reset()
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
-    x.clear();
-    y.clear();
-    for (std::vector<double>& var : var_y_) {
-        var.clear();
+    x.setCapacity(buffer_size_);
+    y.setCapacity(buffer_size_);
+    for (PlotBuffer& var : var_y_) {
+        var.setCapacity(buffer_size_);
+    }
+}
+
+void ScatterPlot::resizeVariadicBuffers(std::size_t count)
+{
+    std::size_t first_new = var_y_.size();
+    var_y_.resize(count, PlotBuffer(buffer_size_));
+    // inputs that are connected later have no values for the samples already buffered
+    for (std::size_t i = first_new; i < count; ++i) {
+        for (std::size_t j = 0; j < x.size(); ++j) {
+            var_y_[i].push(std::numeric_limits<double>::quiet_NaN());
+        }
+    }
+}
+
+void ScatterPlot::updateScale()
+{
+    if (x.empty()) {
+        return;
+    }
+
+    double min_y = y.min();
+    double max_y = y.max();
+    for (const PlotBuffer& var : var_y_) {
+        if (!std::isnan(var.min())) {
+            min_y = std::isnan(min_y) ? var.min() : std::min(min_y, var.min());
+            max_y = std::isnan(max_y) ? var.max() : std::max(max_y, var.max());
+        }
     }
 
-    max_x_ = max_y_ = -std::numeric_limits<double>::infinity();
-    min_x_ = min_y_ = std::numeric_limits<double>::infinity();
+    x_map.setScaleInterval(x.min() - 1, x.max() + 1);
+    y_map.setScaleInterval(min_y - 1, max_y + 1);
 }
 
 void ScatterPlot::process()
@@ -63,38 +102,24 @@ void ScatterPlot::process()
             InputPtr in = VariadicInputs::getVariadicInput(i_inputs);
             if (!msg::isConnected(in.get())) {
                 --num_plots_;
-            } else {
-                //            apex_assert(msg::isValue<double>(in.get()) ==
-                //            msg::isValue<double>(in_y_));
             }
         }
 
         updateLineColors();
-        var_y_.resize(num_plots_ - 1);
+        resizeVariadicBuffers(num_plots_ - 1);
     }
     if (msg::isValue<double>(in_x_)) {
         apex_assert(msg::isValue<double>(in_y_));
         std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
-        double value_x = msg::getValue<double>(in_x_);
-        double value_y = msg::getValue<double>(in_y_);
-
-        x.push_back(value_x);
-        y.push_back(value_y);
-
-        min_x_ = std::min(min_x_, value_x);
-        max_x_ = std::max(max_x_, value_x);
-        min_y_ = std::min(min_y_, value_y);
-        max_y_ = std::max(max_y_, value_y);
+        x.push(msg::getValue<double>(in_x_));
+        y.push(msg::getValue<double>(in_y_));
 
+        std::size_t data_counter = 0;
         for (std::size_t i_inputs = 0; i_inputs < num_inputs; ++i_inputs) {
             InputPtr in = VariadicInputs::getVariadicInput(i_inputs);
             if (msg::isConnected(in.get())) {
-                double y_i = msg::getValue<double>(in.get());
-
-                var_y_.at(i_inputs).emplace_back(y_i);
-
-                max_y_ = std::max(max_y_, y_i);
-                min_y_ = std::min(min_y_, y_i);
+                var_y_.at(data_counter).push(msg::getValue<double>(in.get()));
+                ++data_counter;
             }
         }
 
@@ -108,16 +133,11 @@ void ScatterPlot::process()
         apex_assert(message_x->nestedValueCount() == message_y->nestedValueCount());
 
         for (std::size_t i = 0, n = message_x->nestedValueCount(); i < n; ++i) {
-            if (auto pval = std::dynamic_pointer_cast<GenericValueMessage<double> const>(message_x->nestedValue(i))) {
-                x.push_back(pval->value);
-                min_x_ = std::min(min_x_, pval->value);
-                max_x_ = std::max(max_x_, pval->value);
-            }
-            if (auto pval = std::dynamic_pointer_cast<GenericValueMessage<double> const>(message_y->nestedValue(i))) {
-                y.push_back(pval->value);
-                min_y_ = std::min(min_y_, pval->value);
-                max_y_ = std::max(max_y_, pval->value);
-            }
+            auto pval_x = std::dynamic_pointer_cast<GenericValueMessage<double> const>(message_x->nestedValue(i));
+            auto pval_y = std::dynamic_pointer_cast<GenericValueMessage<double> const>(message_y->nestedValue(i));
+            // keep x and y aligned
+            x.push(pval_x ? pval_x->value : std::numeric_limits<double>::quiet_NaN());
+            y.push(pval_y ? pval_y->value : std::numeric_limits<double>::quiet_NaN());
         }
 
         std::size_t data_counter = 0;
@@ -128,21 +148,20 @@ void ScatterPlot::process()
 
                 apex_assert(std::dynamic_pointer_cast<GenericValueMessage<double>>(message_i->nestedType()));
                 apex_assert(message_x->nestedValueCount() == message_i->nestedValueCount());
-                //                var_y_[data_counter].resize(message_i->nestedValueCount());
 
                 for (std::size_t n_point = 0; n_point < message_i->nestedValueCount(); ++n_point) {
                     auto pval = std::dynamic_pointer_cast<GenericValueMessage<double> const>(message_i->nestedValue(n_point));
-                    var_y_[data_counter].push_back(pval->value);
-                    min_y_ = std::min(min_y_, pval->value);
-                    max_y_ = std::max(max_y_, pval->value);
+                    var_y_[data_counter].push(pval->value);
                 }
                 ++data_counter;
             }
         }
     }
 
-    x_map.setScaleInterval(min_x_ - 1, max_x_ + 1);
-    y_map.setScaleInterval(min_y_ - 1, max_y_ + 1);
+    {
+        std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+        updateScale();
+    }
 
     display_request();
 }
@@ -3,12 +3,12 @@
 
 /// PROJECT
 #include "plot.h"
+#include "plot_buffer.h"
 #include <csapex/model/variadic_io.h>
 
 /// SYSTEM
 #include <QColor>
 #include <chrono>
-#include <deque>
 #include <qwt_plot_curve.h>
 #include <qwt_plot_scaleitem.h>
 #include <qwt_scale_map.h>
@@ -18,6 +18,8 @@ namespace csapex
 class ScatterPlot : public Plot, public csapex::VariadicInputs
 {
 public:
+    ScatterPlot();
+
     virtual void setup(csapex::NodeModifier& node_modifier) override;
     virtual void setupParameters(Parameterizable& parameters) override;
     virtual void process() override;
@@ -32,18 +34,17 @@ public:
 
 private:
     void reset();
+    void resizeVariadicBuffers(std::size_t count);
+    void updateScale();
 
 private:
     Input* in_x_;
     Input* in_y_;
-    std::vector<double> x;
-    std::vector<double> y;
-    std::vector<std::vector<double>> var_y_;
-
-    double min_x_;
-    double min_y_;
-    double max_x_;
-    double max_y_;
+
+    std::size_t buffer_size_;
+    PlotBuffer x;
+    PlotBuffer y;
+    std::vector<PlotBuffer> var_y_;
 };
 
 }  // namespace csapex
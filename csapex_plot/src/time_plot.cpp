@@ -12,6 +12,8 @@
 #include <csapex_opencv/cv_mat_message.h>
 
 /// SYSTEM
+#include <cmath>
+#include <limits>
 #include <qwt_scale_engine.h>
 
 CSAPEX_REGISTER_CLASS(csapex::TimePlot, csapex::Node)
@@ -34,7 +36,13 @@ void TimePlot::setupParameters(Parameterizable& parameters)
     Plot::setupParameters(parameters);
 
     parameters.addParameter(param::factory::declareRange("~plot/width", 128, 4096, 640, 1), [this](param::Parameter* p) {
-        width_ = p->as<int>();
+        {
+            std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+            width_ = p->as<int>();
+            for (PlotBuffer& values : buffer_v_) {
+                values.setColumns(width_);
+            }
+        }
         update();
     });
     parameters.addParameter(param::factory::declareRange("~plot/height", 128, 4096, 320, 1), [this](param::Parameter* p) {
@@ -49,9 +57,13 @@ void TimePlot::setupParameters(Parameterizable& parameters)
 
     parameters.addParameter(param::factory::declareValue("~output/plot/number_of_points",
                                                          param::ParameterDescription("Show only the last n samples. -1 if you want to display all "
-                                                                                     "samples (might be very slow)."),
+                                                                                     "samples (bounded by 2^20 samples)."),
                                                          1000),
-                            [this](param::Parameter* p) { deque_size_ = p->as<int>(); });
+                            [this](param::Parameter* p) {
+                                int n = p->as<int>();
+                                buffer_size_ = n > 0 ? n : (1 << 20);
+                                reset();
+                            });
 
     parameters.addParameter(param::factory::declareTrigger("reset"), [this](param::Parameter*) { reset(); });
 }
@@ -59,62 +71,50 @@ void TimePlot::setupParameters(Parameterizable& parameters)
 void TimePlot::process()
 {
     timepoint time = std::chrono::system_clock::now();
-    double value;
-    if (msg::isValue<double>(in_)) {
-        std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
-        value = msg::getValue<double>(in_);
-        if (initialize_) {
-            deque_v_.resize(1);
-            data_v_.resize(1);
-            num_plots_ = 1;
-            initialize_ = false;
-            color_line_.resize(1);
-            updateLineColors();
-        }
-        deque_v_.at(0).push_back(value);
+    double ms = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+
+    // read the message before touching the buffers
+    bool single_value = msg::isValue<double>(in_);
+    std::vector<double> values;
+    if (single_value) {
+        values.push_back(msg::getValue<double>(in_));
 
     } else {
-        std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
         GenericVectorMessage::ConstPtr message = msg::getMessage<GenericVectorMessage>(in_);
         apex_assert(std::dynamic_pointer_cast<GenericValueMessage<double>>(message->nestedType()));
-        num_plots_ = message->nestedValueCount();
-
-        deque_v_.resize(num_plots_);
-        color_line_.resize(num_plots_);
-        updateLineColors();
 
-        for (std::size_t num_plot = 0; num_plot < num_plots_; ++num_plot) {
+        values.resize(message->nestedValueCount());
+        for (std::size_t num_plot = 0; num_plot < values.size(); ++num_plot) {
             auto pval = std::dynamic_pointer_cast<GenericValueMessage<double> const>(message->nestedValue(num_plot));
-            if (pval) {
-                double val = pval->value;
-                deque_v_.at(num_plot).push_back(val);
-            }
-            //            double val = tval->
+            // keep all curves aligned with the time buffer
+            values[num_plot] = pval ? pval->value : std::numeric_limits<double>::quiet_NaN();
         }
     }
 
-    double ms = std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
-
-    data_t_raw_.push_back(ms);
-
-    while (data_t_raw_.size() > deque_size_) {
-        data_t_raw_.pop_front();
-    }
-
-    for (std::size_t i = 0; i < num_plots_; ++i) {
-        while (deque_v_[i].size() > deque_size_) {
-            deque_v_[i].pop_front();
+    {
+        std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+        if (single_value) {
+            if (initialize_) {
+                num_plots_ = 1;
+                initialize_ = false;
+                color_line_.resize(1);
+                resizeBuffers();
+                updateLineColors();
+            }
+        } else {
+            num_plots_ = values.size();
+            resizeBuffers();
+            color_line_.resize(num_plots_);
+            updateLineColors();
         }
-    }
-    data_v_.resize(num_plots_);
-    for (std::size_t i = 0; i < num_plots_; ++i) {
-        data_v_[i].resize(deque_v_[i].size());
-        for (std::size_t j = 0; j < deque_v_[i].size(); ++j) {
-            data_v_[i][j] = deque_v_[i][j];
+
+        for (std::size_t num_plot = 0; num_plot < values.size(); ++num_plot) {
+            buffer_v_.at(num_plot).push(values[num_plot]);
         }
-    }
+        buffer_t_.push(ms);
 
-    preparePlot();
+        preparePlot();
+    }
 
     if (msg::isConnected(out_)) {
         renderAndSend();
@@ -125,9 +125,11 @@ void TimePlot::process()
 
 void TimePlot::reset()
 {
-    data_t_raw_.clear();
+    std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+    buffer_t_.setCapacity(buffer_size_);
+    buffer_v_.clear();
+    data_t_.clear();
     data_v_.clear();
-    deque_v_.clear();
     initialize_ = true;
     num_plots_ = 1;
     init();
@@ -139,75 +141,110 @@ void TimePlot::init()
     start_t_ = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
 }
 
+void TimePlot::resizeBuffers()
+{
+    if (buffer_v_.size() >= num_plots_) {
+        buffer_v_.resize(num_plots_);
+        return;
+    }
+
+    std::size_t first_new = buffer_v_.size();
+    buffer_v_.resize(num_plots_, PlotBuffer(buffer_size_, width_));
+    // curves that appear later have no values for the samples already buffered
+    for (std::size_t i = first_new; i < num_plots_; ++i) {
+        for (std::size_t j = 0; j < buffer_t_.size(); ++j) {
+            buffer_v_[i].push(std::numeric_limits<double>::quiet_NaN());
+        }
+    }
+}
+
 void TimePlot::preparePlot()
 {
-    std::size_t n = data_t_raw_.size();
-    data_t_.resize(n, 0.0);
     color_fill_.setAlpha(100);
 
-    double time_offset = time_relative_ ? data_t_raw_.front() : 0.0;
+    if (buffer_t_.empty()) {
+        return;
+    }
+
+    double time_offset = time_relative_ ? buffer_t_.front() : 0.0;
     double time_scale = time_seconds_ ? 1e-6 : 1.0;
 
-    for (std::size_t i = 0; i < n; ++i) {
-        data_t_[i] = (data_t_raw_[i] - time_offset) * time_scale;
-    }
+    double min = 0.0;
+    double max = 0.0;
+
+    data_t_.resize(buffer_v_.size());
+    data_v_.resize(buffer_v_.size());
+    for (std::size_t i = 0; i < buffer_v_.size(); ++i) {
+        const PlotBuffer& values = buffer_v_[i];
 
-    std::vector<double> min_list;
-    std::vector<double> max_list;
-    for (auto data : data_v_) {
-        if (data.size() != 0) {
-            min_list.push_back(std::min(0.0, *std::min_element(data.begin(), data.end())));
-            max_list.push_back(std::max(0.0, *std::max_element(data.begin(), data.end())));
+        values.decimate(positions_);
+        data_t_[i].resize(positions_.size());
+        data_v_[i].resize(positions_.size());
+        for (std::size_t j = 0; j < positions_.size(); ++j) {
+            data_t_[i][j] = (buffer_t_[positions_[j]] - time_offset) * time_scale;
+            data_v_[i][j] = values[positions_[j]];
         }
-    }
 
-    double min = std::min(0.0, *std::min_element(min_list.begin(), min_list.end()));
-    double max = std::max(0.0, *std::max_element(max_list.begin(), max_list.end()));
+        if (!std::isnan(values.min())) {
+            min = std::min(min, values.min());
+            max = std::max(max, values.max());
+        }
+    }
 
-    x_map.setScaleInterval(data_t_.front(), data_t_.back());
+    x_map.setScaleInterval((buffer_t_.front() - time_offset) * time_scale, (buffer_t_.back() - time_offset) * time_scale);
     y_map.setScaleInterval(min - 1, max + 1);
 }
 
 void TimePlot::renderAndSend()
 {
-    QImage image(width_, height_, QImage::Format_RGB32);
+    // the decimated curves are small, copy them and draw without holding the lock
+    std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+    std::vector<std::vector<double>> data_t = data_t_;
+    std::vector<std::vector<double>> data_v = data_v_;
+    QwtScaleMap x_scale = x_map;
+    QwtScaleMap y_scale = y_map;
+    const int width = width_;
+    const int height = height_;
+    if (basic_line_color_changed_) {
+        updateLineColors();
+    }
+    std::vector<QColor> color_line = color_line_;
+    lock.unlock();
+
+    QImage image(width, height, QImage::Format_RGB32);
     QPainter painter;
     painter.begin(&image);
     painter.fillRect(image.rect(), color_bg_);
 
     QRect r(0, 0, image.width(), image.height());
 
-    x_map.setPaintInterval(r.left(), r.right());
-    y_map.setPaintInterval(r.bottom(), r.top());
-
-    if (basic_line_color_changed_) {
-        updateLineColors();
-    }
+    x_scale.setPaintInterval(r.left(), r.right());
+    y_scale.setPaintInterval(r.bottom(), r.top());
 
-    std::vector<QwtPlotCurve> curve(data_v_.size());
-    for (std::size_t num_plot = 0; num_plot < data_v_.size(); ++num_plot) {
+    std::vector<QwtPlotCurve> curve(data_v.size());
+    for (std::size_t num_plot = 0; num_plot < data_v.size(); ++num_plot) {
         painter.setRenderHint(QPainter::Antialiasing, curve[num_plot].testRenderHint(QwtPlotItem::RenderAntialiased));
         painter.setRenderHint(QPainter::HighQualityAntialiasing, curve[num_plot].testRenderHint(QwtPlotItem::RenderAntialiased));
         curve[num_plot].setBaseline(0.0);
 
-        curve[num_plot].setPen(color_line_.at(num_plot), line_width_);
+        curve[num_plot].setPen(color_line.at(num_plot), line_width_);
         curve[num_plot].setStyle(QwtPlotCurve::Lines);
 
         curve[num_plot].setBrush(QBrush(color_fill_, Qt::SolidPattern));
 
-        curve[num_plot].setRawSamples(data_t_.data(), data_v_.at(num_plot).data(), data_t_.size());
-        curve[num_plot].draw(&painter, x_map, y_map, r);
+        curve[num_plot].setRawSamples(data_t.at(num_plot).data(), data_v.at(num_plot).data(), data_v.at(num_plot).size());
+        curve[num_plot].draw(&painter, x_scale, y_scale, r);
     }
 
     QwtLinearScaleEngine e;
-    QwtPlotScaleItem scale_time(QwtScaleDraw::TopScale, y_map.s1());
-    scale_time.setScaleDiv(e.divideScale(x_map.s1(), x_map.s2(), 10, 10));
+    QwtPlotScaleItem scale_time(QwtScaleDraw::TopScale, y_scale.s1());
+    scale_time.setScaleDiv(e.divideScale(x_scale.s1(), x_scale.s2(), 10, 10));
 
-    QwtPlotScaleItem scale_value(QwtScaleDraw::RightScale, x_map.s1());
-    scale_value.setScaleDiv(e.divideScale(y_map.s1(), y_map.s2(), 10, 10));
+    QwtPlotScaleItem scale_value(QwtScaleDraw::RightScale, x_scale.s1());
+    scale_value.setScaleDiv(e.divideScale(y_scale.s1(), y_scale.s2(), 10, 10));
 
-    scale_time.draw(&painter, x_map, y_map, r);
-    scale_value.draw(&painter, x_map, y_map, r);
+    scale_time.draw(&painter, x_scale, y_scale, r);
+    scale_value.draw(&painter, x_scale, y_scale, r);
 
     CvMatMessage::Ptr out_msg = std::make_shared<CvMatMessage>(enc::bgr, "plot", 0);
     out_msg->value = QtCvImageConverter::Converter::QImage2Mat(image);
@@ -220,9 +257,9 @@ double TimePlot::getLineWidth() const
     return line_width_;
 }
 
-const double* TimePlot::getTData() const
+const double* TimePlot::getTData(std::size_t idx) const
 {
-    return data_t_.data();
+    return data_t_.at(idx).data();
 }
 const double* TimePlot::getVData(std::size_t idx) const
 {
@@ -232,7 +269,7 @@ std::size_t TimePlot::getVDataCountNumCurves() const
 {
     return data_v_.size();
 }
-std::size_t TimePlot::getCount() const
+std::size_t TimePlot::getCount(std::size_t idx) const
 {
-    return data_t_.size();
+    return data_v_.at(idx).size();
 }
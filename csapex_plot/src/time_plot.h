@@ -3,11 +3,11 @@
 
 /// PROJECT
 #include "plot.h"
+#include "plot_buffer.h"
 
 /// SYSTEM
 #include <QColor>
 #include <chrono>
-#include <deque>
 #include <qwt_plot_curve.h>
 #include <qwt_plot_scaleitem.h>
 #include <qwt_scale_map.h>
@@ -26,21 +26,22 @@ public:
 
     double getLineWidth() const;
 
-    const double* getTData() const;
+    const double* getTData(std::size_t idx) const;
     const double* getVData(std::size_t idx) const;
     std::size_t getVDataCountNumCurves() const;
-    std::size_t getCount() const;
+    std::size_t getCount(std::size_t idx) const;
 
 protected:
     void reset();
     void init();
+    void resizeBuffers();
 
     void preparePlot();
     void renderAndSend();
 
 private:
     bool initialize_;
-    std::size_t deque_size_;
+    std::size_t buffer_size_;
     Input* in_;
     Output* out_;
 
@@ -50,11 +51,13 @@ private:
     bool time_seconds_;
 
     double start_t_;
-    std::deque<double> data_t_raw_;
+    PlotBuffer buffer_t_;
+    std::vector<PlotBuffer> buffer_v_;
 
-    std::vector<double> data_t_;
-    std::vector<std::deque<double>> deque_v_;
+    // decimated to the plot width
+    std::vector<std::vector<double>> data_t_;
     std::vector<std::vector<double>> data_v_;
+    std::vector<std::size_t> positions_;
 };
 
 }  // namespace csapex
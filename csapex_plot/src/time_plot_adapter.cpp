@@ -53,7 +53,7 @@ void TimePlotAdapter::display()
 
         curve[i]->setBrush(QBrush(n->getFillColor(), Qt::SolidPattern));
 
-        curve[i]->setRawSamples(n->getTData(), n->getVData(i), n->getCount());
+        curve[i]->setRawSamples(n->getTData(i), n->getVData(i), n->getCount(i));
 
         curve[i]->attach(plot_widget_);
         plot_widget_->replot();
@@ -12,6 +12,7 @@
 #include <csapex_opencv/cv_mat_message.h>
 
 /// SYSTEM
+#include <algorithm>
 #include <qwt_scale_engine.h>
 
 using namespace csapex;
@@ -40,7 +41,13 @@ void VectorPlot::setupParameters(Parameterizable& parameters)
     Plot::setupParameters(parameters);
 
     parameters.addParameter(param::factory::declareRange("~plot/width", 128, 4096, 640, 1), [this](param::Parameter* p) {
-        width_ = p->as<int>();
+        {
+            std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+            width_ = p->as<int>();
+            for (PlotBuffer& values : buffer_v_) {
+                values.setColumns(width_);
+            }
+        }
         update();
     });
     parameters.addParameter(param::factory::declareRange("~plot/height", 128, 4096, 320, 1), [this](param::Parameter* p) {
@@ -60,72 +67,62 @@ void VectorPlot::setupParameters(Parameterizable& parameters)
 
 void VectorPlot::process()
 {
+    // read the messages before touching the buffers, every curve is bucketed while it is read
+    std::size_t num_inputs = VariadicInputs::getVariadicInputCount();
+    std::size_t columns;
     {
         std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
-        std::size_t num_inputs = VariadicInputs::getVariadicInputCount();
-        num_plots_ = num_inputs;
+        columns = width_;
+    }
 
-        for (std::size_t i_inputs = 0; i_inputs < num_plots_; ++i_inputs) {
-            InputPtr in = VariadicInputs::getVariadicInput(i_inputs);
-            if (!msg::isConnected(in.get())) {
-                --num_plots_;
-            }
-        }
+    std::vector<PlotBuffer> values;
+    for (std::size_t i_inputs = 0; i_inputs < num_inputs; ++i_inputs) {
+        InputPtr in = VariadicInputs::getVariadicInput(i_inputs);
+        if (msg::isConnected(in.get())) {
+            GenericVectorMessage::ConstPtr message = msg::getMessage<GenericVectorMessage>(in.get());
 
-        data_v_.resize(num_plots_);
-        updateLineColors();
+            apex_assert(std::dynamic_pointer_cast<GenericValueMessage<double>>(message->nestedType()));
 
-        std::size_t data_counter = 0;
-
-        for (std::size_t i_inputs = 0; i_inputs < num_inputs; ++i_inputs) {
-            InputPtr in = VariadicInputs::getVariadicInput(i_inputs);
-            if (msg::isConnected(in.get())) {
-                GenericVectorMessage::ConstPtr message = msg::getMessage<GenericVectorMessage>(in.get());
+            values.emplace_back(message->nestedValueCount(), columns);
+            PlotBuffer& buffer = values.back();
+            for (std::size_t n_point = 0; n_point < message->nestedValueCount(); ++n_point) {
+                auto pval = std::dynamic_pointer_cast<GenericValueMessage<double> const>(message->nestedValue(n_point));
+                buffer.push(pval->value);
+            }
+        }
+    }
 
-                apex_assert(std::dynamic_pointer_cast<GenericValueMessage<double>>(message->nestedType()));
+    std::vector<double> time;
+    bool has_time = msg::hasMessage(in_time_);
+    if (has_time) {
+        std::shared_ptr<std::vector<double> const> time_msg = msg::getMessage<GenericVectorMessage, double>(in_time_);
+        time.assign(time_msg->begin(), time_msg->end());
+
+        apex_assert(!values.empty());
+        apex_assert(time.size() == values.front().size());
+    } else if (!values.empty()) {
+        time.resize(values.front().size());
+        for (std::size_t i = 0; i < time.size(); ++i) {
+            time[i] = i;
+        }
+    }
 
-                data_v_[data_counter].resize(message->nestedValueCount());
+    {
+        std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+        num_plots_ = values.size();
+        buffer_v_.swap(values);
+        updateLineColors();
 
-                for (std::size_t n_point = 0; n_point < message->nestedValueCount(); ++n_point) {
-                    auto pval = std::dynamic_pointer_cast<GenericValueMessage<double> const>(message->nestedValue(n_point));
-                    data_v_[data_counter][n_point] = pval->value;
-                }
-                //            if(data_counter > 0){
-                //                apex_assert(data_v_[data_counter].size() ==
-                //                data_v_[data_counter -1].size());
-                //            }
-                ++data_counter;
-            }
+        if (buffer_v_.empty()) {
+            return;
         }
 
-        data_t_raw_.clear();
-        if (msg::hasMessage(in_time_)) {
-            has_time_in_ = true;
-            std::shared_ptr<std::vector<double> const> time = msg::getMessage<GenericVectorMessage, double>(in_time_);
-            data_t_raw_.resize(time->size());
-            for (std::size_t n = 0; n < time->size(); ++n) {
-                data_t_raw_[n] = time->at(n);
-            }
+        data_t_raw_.swap(time);
+        has_time_in_ = has_time;
 
-            apex_assert(!data_v_.empty());
-            apex_assert(data_t_raw_.size() == data_v_.front().size());
-        } else {
-            if (data_v_.empty()) {
-                return;
-            }
-            has_time_in_ = false;
-            std::size_t n_elments = data_v_.front().size();
-            data_t_.resize(n_elments);
-            std::size_t i = 0;
-            for (auto& v : data_t_) {
-                v = i;
-                ++i;
-            }
-        }
+        preparePlot();
     }
 
-    preparePlot();
-
     if (msg::isConnected(out_)) {
         renderAndSend();
     }
@@ -135,9 +132,11 @@ void VectorPlot::process()
 
 void VectorPlot::reset()
 {
+    std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+    buffer_v_.clear();
+    data_t_raw_.clear();
     data_v_.clear();
     data_t_.clear();
-    data_t_raw_.clear();
     initialize_ = true;
     num_plots_ = 1;
     init();
@@ -154,82 +153,97 @@ void VectorPlot::preparePlot()
 {
     color_fill_.setAlpha(100);
 
-    if (has_time_in_) {
-        std::size_t n = data_t_raw_.size();
-        data_t_.resize(n, 0.0);
+    std::size_t n = data_t_raw_.size();
+    double time_offset = 0.0;
+    double time_scale = 1.0;
+    if (has_time_in_ && n > 0) {
+        time_offset = time_relative_ ? data_t_raw_.front() : 0.0;
+        time_scale = time_seconds_ ? 1e-6 : 1.0;
+    }
+
+    double min = 0;
+    double max = 0;
+
+    data_t_.resize(buffer_v_.size());
+    data_v_.resize(buffer_v_.size());
+    for (std::size_t i = 0; i < buffer_v_.size(); ++i) {
+        const PlotBuffer& values = buffer_v_[i];
 
-        double time_offset = time_relative_ ? data_t_raw_.front() : 0.0;
-        double time_scale = time_seconds_ ? 1e-6 : 1.0;
+        values.decimate(positions_);
+        positions_.erase(std::lower_bound(positions_.begin(), positions_.end(), n), positions_.end());
 
-        for (std::size_t i = 0; i < n; ++i) {
-            data_t_[i] = (data_t_raw_[i] - time_offset) * time_scale;
+        data_t_[i].resize(positions_.size());
+        data_v_[i].resize(positions_.size());
+        for (std::size_t j = 0; j < positions_.size(); ++j) {
+            data_t_[i][j] = (data_t_raw_[positions_[j]] - time_offset) * time_scale;
+            data_v_[i][j] = values[positions_[j]];
         }
-    }
 
-    std::vector<double> min_list;
-    std::vector<double> max_list;
-    for (auto data : data_v_) {
-        if (data.size() != 0) {
-            min_list.push_back(std::min(0.0, *std::min_element(data.begin(), data.end())));
-            max_list.push_back(std::max(0.0, *std::max_element(data.begin(), data.end())));
+        // decimation keeps the extrema, so scanning the reduced curve suffices
+        if (!data_v_[i].empty()) {
+            min = std::min(min, *std::min_element(data_v_[i].begin(), data_v_[i].end()));
+            max = std::max(max, *std::max_element(data_v_[i].begin(), data_v_[i].end()));
         }
     }
-    double min = 0;
-    double max = 0;
-    if (min_list.size() > 0) {
-        min = std::min(0.0, *std::min_element(min_list.begin(), min_list.end()));
-    }
-    if (max_list.size() > 0) {
-        max = std::max(0.0, *std::max_element(max_list.begin(), max_list.end()));
-    }
-    if (data_t_.size() == 0) {
+
+    if (n == 0) {
         x_map.setScaleInterval(-1, 1);
     } else {
-        x_map.setScaleInterval(data_t_.front(), data_t_.back());
+        x_map.setScaleInterval((data_t_raw_.front() - time_offset) * time_scale, (data_t_raw_.back() - time_offset) * time_scale);
     }
     y_map.setScaleInterval(min - 1, max + 1);
 }
 
 void VectorPlot::renderAndSend()
 {
-    QImage image(width_, height_, QImage::Format_RGB32);
+    // the decimated curves are small, copy them and draw without holding the lock
+    std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
+    std::vector<std::vector<double>> data_t = data_t_;
+    std::vector<std::vector<double>> data_v = data_v_;
+    QwtScaleMap x_scale = x_map;
+    QwtScaleMap y_scale = y_map;
+    const int width = width_;
+    const int height = height_;
+    updateLineColors();
+    std::vector<QColor> color_line = color_line_;
+    lock.unlock();
+
+    QImage image(width, height, QImage::Format_RGB32);
     QPainter painter;
     painter.begin(&image);
     painter.fillRect(image.rect(), color_bg_);
 
     QRect r(0, 0, image.width(), image.height());
 
-    x_map.setPaintInterval(r.left(), r.right());
-    y_map.setPaintInterval(r.bottom(), r.top());
+    x_scale.setPaintInterval(r.left(), r.right());
+    y_scale.setPaintInterval(r.bottom(), r.top());
 
-    updateLineColors();
-
-    std::vector<QwtPlotCurve> curve(data_v_.size());
-    for (std::size_t num_plot = 0; num_plot < data_v_.size(); ++num_plot) {
+    std::vector<QwtPlotCurve> curve(data_v.size());
+    for (std::size_t num_plot = 0; num_plot < data_v.size(); ++num_plot) {
         painter.setRenderHint(QPainter::Antialiasing, curve[num_plot].testRenderHint(QwtPlotItem::RenderAntialiased));
         painter.setRenderHint(QPainter::HighQualityAntialiasing, curve[num_plot].testRenderHint(QwtPlotItem::RenderAntialiased));
         curve[num_plot].setBaseline(0.0);
 
-        curve[num_plot].setPen(color_line_.at(num_plot), line_width_);
+        curve[num_plot].setPen(color_line.at(num_plot), line_width_);
 
         curve[num_plot].setStyle(QwtPlotCurve::Lines);
 
         curve[num_plot].setBrush(QBrush(color_fill_, Qt::SolidPattern));
 
-        curve[num_plot].setRawSamples(data_t_.data(), data_v_.at(num_plot).data(), data_t_.size());
+        curve[num_plot].setRawSamples(data_t.at(num_plot).data(), data_v.at(num_plot).data(), data_v.at(num_plot).size());
 
-        curve[num_plot].draw(&painter, x_map, y_map, r);
+        curve[num_plot].draw(&painter, x_scale, y_scale, r);
     }
 
     QwtLinearScaleEngine e;
-    QwtPlotScaleItem scale_time(QwtScaleDraw::TopScale, y_map.s1());
-    scale_time.setScaleDiv(e.divideScale(x_map.s1(), x_map.s2(), 10, 10));
+    QwtPlotScaleItem scale_time(QwtScaleDraw::TopScale, y_scale.s1());
+    scale_time.setScaleDiv(e.divideScale(x_scale.s1(), x_scale.s2(), 10, 10));
 
-    QwtPlotScaleItem scale_value(QwtScaleDraw::RightScale, x_map.s1());
-    scale_value.setScaleDiv(e.divideScale(y_map.s1(), y_map.s2(), 10, 10));
+    QwtPlotScaleItem scale_value(QwtScaleDraw::RightScale, x_scale.s1());
+    scale_value.setScaleDiv(e.divideScale(y_scale.s1(), y_scale.s2(), 10, 10));
 
-    scale_time.draw(&painter, x_map, y_map, r);
-    scale_value.draw(&painter, x_map, y_map, r);
+    scale_time.draw(&painter, x_scale, y_scale, r);
+    scale_value.draw(&painter, x_scale, y_scale, r);
 
     CvMatMessage::Ptr out_msg = std::make_shared<CvMatMessage>(enc::bgr, "plot", 0);
     out_msg->value = QtCvImageConverter::Converter::QImage2Mat(image);
@@ -242,10 +256,10 @@ double VectorPlot::getLineWidth() const
     return line_width_;
 }
 
-const double* VectorPlot::getTData() const
+const double* VectorPlot::getTData(std::size_t idx) const
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
-    return data_t_.data();
+    return data_t_.at(idx).data();
 }
 const double* VectorPlot::getVData(std::size_t idx) const
 {
@@ -257,16 +271,10 @@ std::size_t VectorPlot::getVDataCountNumCurves() const
     std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
     return data_v_.size();
 }
-std::size_t VectorPlot::getCount() const
+std::size_t VectorPlot::getCount(std::size_t idx) const
 {
     std::unique_lock<std::recursive_mutex> lock(mutex_buffer_);
-    std::vector<std::size_t> min_sz(1 + data_v_.size());
-    min_sz[0] = data_t_.size();
-    for (std::size_t i = 0; i < data_v_.size(); ++i) {
-        min_sz[i + 1] = data_v_[i].size();
-    }
-    std::size_t res = std::min(data_t_.size(), *std::min_element(min_sz.begin(), min_sz.end()));
-    return res;
+    return data_v_.at(idx).size();
 }
 
 Input* VectorPlot::createVariadicInput(TokenDataConstPtr type, const std::string& label, bool /*optional*/)
@@ -3,6 +3,7 @@
 
 /// PROJECT
 #include "plot.h"
+#include "plot_buffer.h"
 #include <csapex/model/variadic_io.h>
 #include <csapex/utility/assert.h>
 
@@ -30,10 +31,10 @@ public:
 
     //    QColor getLineColor(std::size_t idx) const;
 
-    const double* getTData() const;
+    const double* getTData(std::size_t idx) const;
     const double* getVData(std::size_t idx) const;
     std::size_t getVDataCountNumCurves() const;
-    std::size_t getCount() const;
+    std::size_t getCount(std::size_t idx) const;
 
 protected:
     void reset();
@@ -59,9 +60,12 @@ private:
 
     double start_t_;
     std::vector<double> data_t_raw_;
+    std::vector<PlotBuffer> buffer_v_;
 
-    std::vector<double> data_t_;
+    // decimated to the plot width
+    std::vector<std::vector<double>> data_t_;
     std::vector<std::vector<double>> data_v_;
+    std::vector<std::size_t> positions_;
 };
 
 }  // namespace csapex
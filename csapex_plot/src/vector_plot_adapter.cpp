@@ -44,17 +44,19 @@ void VectorPlotAdapter::display()
 
     // these getters are blocking. Collect data first then render.
     std::size_t num_curves = n->getVDataCountNumCurves();
-    std::size_t num_points = n->getCount();
     n->updateLineColors();
     std::vector<QwtPlotCurve*> curve(num_curves) /*= new QwtPlotCurve[n->getVDataCountNumCurves()];*/;
     std::vector<QColor> colors(num_curves);
     std::vector<QColor> line_colors(num_curves);
     std::vector<const double*> data(num_curves);
-    const double* tdata = n->getTData();
+    std::vector<const double*> tdata(num_curves);
+    std::vector<std::size_t> num_points(num_curves);
     for (std::size_t i = 0; i < num_curves; ++i) {
         colors[i] = n->getFillColor();
         line_colors[i] = n->getLineColor(i);
         data[i] = n->getVData(i);
+        tdata[i] = n->getTData(i);
+        num_points[i] = n->getCount(i);
     }
 
     for (std::size_t i = 0; i < num_curves; ++i) {
@@ -65,7 +67,7 @@ void VectorPlotAdapter::display()
 
         curve[i]->setBrush(QBrush(colors[i], Qt::SolidPattern));
 
-        curve[i]->setRawSamples(tdata, data[i], num_points);
+        curve[i]->setRawSamples(tdata[i], data[i], num_points[i]);
 
         curve[i]->attach(plot_widget_);
         plot_widget_->replot();
@@ -0,0 +1,71 @@
+#ifndef CLUSTER_LABELS_H
+#define CLUSTER_LABELS_H
+
+/// SYSTEM
+// clang-format off
+#include <csapex/utility/suppress_warnings_start.h>
+#include <pcl/PointIndices.h>
+#include <csapex/utility/suppress_warnings_end.h>
+// clang-format on
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The ClusterLabels class is a dense label array with one entry per point of a cloud.
+ *
+ * Cluster i of the vector it was built from has label i + 1, points in no cluster
+ * have label UNLABELED. If clusters overlap, the later cluster wins and overlapping()
+ * is true, consumers that need all points of every cluster have to read the indices
+ * then. The array has the layout of the cloud, so organized clouds can be read row by row.
+ */
+class ClusterLabels
+{
+public:
+    typedef std::shared_ptr<ClusterLabels> Ptr;
+    typedef std::shared_ptr<ClusterLabels const> ConstPtr;
+
+    static const uint32_t UNLABELED = 0;
+
+public:
+    ClusterLabels();
+
+    void build(std::size_t width, std::size_t height, const std::vector<pcl::PointIndices>& clusters);
+
+    std::size_t width() const;
+    std::size_t height() const;
+    std::size_t size() const;
+
+    /// number of clusters, the largest label
+    std::size_t clusterCount() const;
+    /// true if a point belongs to more than one cluster
+    bool overlapping() const;
+
+    inline uint32_t operator[](std::size_t i) const
+    {
+        return labels_[i];
+    }
+
+    inline const uint32_t* data() const
+    {
+        return labels_.data();
+    }
+
+    inline const uint32_t* row(std::size_t r) const
+    {
+        return labels_.data() + r * width_;
+    }
+
+private:
+    std::size_t width_;
+    std::size_t height_;
+    std::size_t cluster_count_;
+    bool overlapping_;
+    std::vector<uint32_t> labels_;
+};
+
+}  // namespace csapex
+
+#endif  // CLUSTER_LABELS_H
@@ -3,6 +3,8 @@
 
 #undef NDEBUG
 #include <assert.h>
+#include <algorithm>
+#include <array>
 #include <eigen3/Eigen/Core>
 #include <eigen3/Eigen/Eigen>
 #include <iostream>
@@ -13,6 +15,13 @@ namespace csapex
 {
 namespace math
 {
+/**
+ * Mean and covariance of a growing set of points. Single points are added with
+ * Welford's update, distributions are merged with the pairwise formula of Chan
+ * et al., so partial distributions of disjoint point sets can be accumulated
+ * independently, e.g. in parallel, and merged afterwards.
+ * Points stored as one coordinate array per dimension are added block-wise.
+ */
 template <std::size_t Dim, bool limit_covariance = false>
 class EIGEN_ALIGN16 Distribution
 {
@@ -32,11 +41,12 @@ public:
     static constexpr double sqrt_2_M_PI = std::sqrt(2 * M_PI);
 #endif
     static constexpr double lambda_ratio = 1e-2;
+    /// number of points of a coordinate block that are reduced before they are merged
+    static constexpr std::size_t block_size = 256;
 
     Distribution()
       : mean(PointType::Zero())
-      , correlated(MatrixType::Zero())
-      , n(1)
+      , scatter(MatrixType::Zero())
       , n_1(0)
       , covariance(MatrixType::Zero())
       , inverse_covariance(MatrixType::Zero())
@@ -44,6 +54,7 @@ public:
       , eigen_vectors(EigenVectorSetType::Zero())
       , determinant(0.0)
       , dirty(false)
+      , dirty_inverse(false)
       , dirty_eigen(false)
     {
     }
@@ -55,28 +66,63 @@ public:
     {
         mean = PointType::Zero();
         covariance = MatrixType::Zero();
-        correlated = MatrixType::Zero();
-        n = 1;
+        scatter = MatrixType::Zero();
         n_1 = 0;
         dirty = true;
+        dirty_inverse = true;
         dirty_eigen = true;
     }
 
     /// Modification
     inline void add(const PointType& _p)
     {
-        mean = (mean * n_1 + _p) / n;
-        for (std::size_t i = 0; i < Dim; ++i) {
-            for (std::size_t j = i; j < Dim; ++j) {
-                correlated(i, j) = (correlated(i, j) * n_1 + _p(i) * _p(j)) / (double)n;
-            }
-        }
-        ++n;
         ++n_1;
+        const PointType delta = _p - mean;
+        mean += delta / (double)n_1;
+        scatter += (delta * delta.transpose()) * ((n_1 - 1) / (double)n_1);
         dirty = true;
+        dirty_inverse = true;
         dirty_eigen = true;
     }
 
+    /**
+     * @brief add adds _count points given as one coordinate array per dimension.
+     * Each block of points is reduced to its mean and scatter with two passes
+     * over the block, which stays in cache, and then merged.
+     */
+    template <typename T>
+    inline void add(const std::array<const T*, Dim>& _coordinates, const std::size_t _count)
+    {
+        double deviation[Dim][block_size];
+        for (std::size_t begin = 0; begin < _count; begin += block_size) {
+            const std::size_t size = std::min(block_size, _count - begin);
+
+            PointType block_mean;
+            for (std::size_t d = 0; d < Dim; ++d) {
+                const T* values = _coordinates[d] + begin;
+                block_mean(d) = reduce(size, [values](std::size_t k) { return (double)values[k]; }) / (double)size;
+
+                double* dev = deviation[d];
+                for (std::size_t k = 0; k < size; ++k) {
+                    dev[k] = values[k] - block_mean(d);
+                }
+            }
+
+            MatrixType block_scatter;
+            for (std::size_t i = 0; i < Dim; ++i) {
+                for (std::size_t j = i; j < Dim; ++j) {
+                    const double* a = deviation[i];
+                    const double* b = deviation[j];
+                    const double sum = reduce(size, [a, b](std::size_t k) { return a[k] * b[k]; });
+                    block_scatter(i, j) = sum;
+                    block_scatter(j, i) = sum;
+                }
+            }
+
+            merge(size, block_mean, block_scatter);
+        }
+    }
+
     inline Distribution& operator+=(const PointType& _p)
     {
         add(_p);
@@ -85,15 +131,7 @@ public:
 
     inline Distribution& operator+=(const Distribution& other)
     {
-        std::size_t _n = n_1 + other.n_1;
-        PointType _mean = (mean * n_1 + other.mean * other.n_1) / (double)_n;
-        MatrixType _corr = (correlated * n_1 + other.correlated * other.n_1) / (double)_n;
-        n = _n + 1;
-        n_1 = _n;
-        mean = _mean;
-        correlated = _corr;
-        dirty = true;
-        dirty_eigen = true;
+        merge(other.n_1, other.mean, other.scatter);
         return *this;
     }
 
@@ -139,6 +177,8 @@ public:
         if (n_1 >= 2) {
             if (dirty)
                 update();
+            if (dirty_inverse)
+                updateInverse();
             return inverse_covariance;
         }
         return MatrixType::Zero();
@@ -149,6 +189,8 @@ public:
         if (n_1 >= 2) {
             if (dirty)
                 update();
+            if (dirty_inverse)
+                updateInverse();
             _inverse_covariance = inverse_covariance;
         } else {
             _inverse_covariance = MatrixType::Zero();
@@ -221,6 +263,8 @@ public:
         if (n_1 >= 2) {
             if (dirty)
                 update();
+            if (dirty_inverse)
+                updateInverse();
             PointType q = _p - mean;
             double exponent = -0.5 * double(q.transpose() * inverse_covariance * q);
             double denominator = 1.0 / (covariance.determinant() * sqrt_2_M_PI);
@@ -234,6 +278,8 @@ public:
         if (n_1 >= 2) {
             if (dirty)
                 update();
+            if (dirty_inverse)
+                updateInverse();
             _q = _p - mean;
             double exponent = -0.5 * double(_q.transpose() * inverse_covariance * _q);
             double denominator = 1.0 / (determinant * sqrt_2_M_PI);
@@ -247,6 +293,8 @@ public:
         if (n_1 >= 2) {
             if (dirty)
                 update();
+            if (dirty_inverse)
+                updateInverse();
 
             PointType q = _p - mean;
             double exponent = -0.5 * double(q.transpose() * inverse_covariance * q);
@@ -260,6 +308,8 @@ public:
         if (n_1 >= 2) {
             if (dirty)
                 update();
+            if (dirty_inverse)
+                updateInverse();
             _q = _p - mean;
             double exponent = -0.5 * double(_q.transpose() * inverse_covariance * _q);
             return exp(exponent);
@@ -271,9 +321,8 @@ public:
     EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 private:
     PointType mean;
-    MatrixType correlated;
-    std::size_t n;
-    std::size_t n_1;  /// actual amount of points in distribution
+    MatrixType scatter;  /// sum of the outer products of the deviations from the mean
+    std::size_t n_1;     /// actual amount of points in distribution
 
     mutable MatrixType covariance;
     mutable MatrixType inverse_covariance;
@@ -282,17 +331,51 @@ private:
     mutable double determinant;
 
     mutable bool dirty;
+    mutable bool dirty_inverse;
     mutable bool dirty_eigen;
 
-    inline void update() const
+    /// sum of f(0) ... f(_n - 1) in four independent lanes, so that the loop can be vectorized without reordering
+    template <typename F>
+    static inline double reduce(const std::size_t _n, const F& f)
     {
-        double scale = n_1 / (double)(n_1 - 1);
-        for (std::size_t i = 0; i < Dim; ++i) {
-            for (std::size_t j = i; j < Dim; ++j) {
-                covariance(i, j) = (correlated(i, j) - (mean(i) * mean(j))) * scale;
-                covariance(j, i) = covariance(i, j);
+        double lanes[4] = { 0.0, 0.0, 0.0, 0.0 };
+        std::size_t k = 0;
+        for (; k + 4 <= _n; k += 4) {
+            for (std::size_t l = 0; l < 4; ++l) {
+                lanes[l] += f(k + l);
             }
         }
+        double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+        for (; k < _n; ++k) {
+            sum += f(k);
+        }
+        return sum;
+    }
+
+    inline void merge(const std::size_t _n, const PointType& _mean, const MatrixType& _scatter)
+    {
+        if (_n == 0) {
+            return;
+        }
+        if (n_1 == 0) {
+            mean = _mean;
+            scatter = _scatter;
+        } else {
+            const double total = (double)(n_1 + _n);
+            const PointType delta = _mean - mean;
+            mean += delta * (_n / total);
+            scatter += _scatter + (delta * delta.transpose()) * (n_1 * (double)_n / total);
+        }
+        n_1 += _n;
+        dirty = true;
+        dirty_inverse = true;
+        dirty_eigen = true;
+    }
+
+    /// the covariance is always needed, the inverse and the determinant only for sampling
+    inline void update() const
+    {
+        covariance = scatter / (double)(n_1 - 1);
 
         if (limit_covariance) {
             if (dirty_eigen)
@@ -314,21 +397,29 @@ private:
             }
             covariance = eigen_vectors * Lambda * eigen_vectors.transpose();
             inverse_covariance = eigen_vectors * Lambda.inverse() * eigen_vectors.transpose();
+            determinant = covariance.determinant();
+            dirty_inverse = false;
         } else {
-            inverse_covariance = covariance.inverse();
+            dirty_inverse = true;
         }
 
-        determinant = covariance.determinant();
         dirty = false;
         dirty_eigen = true;
     }
 
+    inline void updateInverse() const
+    {
+        inverse_covariance = covariance.inverse();
+        determinant = covariance.determinant();
+        dirty_inverse = false;
+    }
+
     inline void updateEigen() const
     {
-        Eigen::EigenSolver<MatrixType> solver;
+        Eigen::SelfAdjointEigenSolver<MatrixType> solver;
         solver.compute(covariance);
-        eigen_vectors = solver.eigenvectors().real();
-        eigen_values = solver.eigenvalues().real();
+        eigen_vectors = solver.eigenvectors();
+        eigen_values = solver.eigenvalues();
         dirty_eigen = false;
     }
 };
@@ -0,0 +1,130 @@
+#ifndef MAHALANOBIS_HPP
+#define MAHALANOBIS_HPP
+
+#include <algorithm>
+#include <array>
+#include <eigen3/Eigen/Core>
+#include <eigen3/Eigen/Eigen>
+
+namespace csapex
+{
+namespace math
+{
+/**
+ * Squared Mahalanobis distances to a fixed mean and covariance. The covariance
+ * is factorized once as L L^T, the distance of x is |L^-1 (x - mean)|^2, which
+ * is solved by forward substitution. Points stored as one coordinate array per
+ * dimension are processed in blocks, each substitution step runs over the whole
+ * block at once.
+ */
+template <std::size_t Dim>
+class EIGEN_ALIGN16 Mahalanobis
+{
+public:
+    typedef Eigen::Matrix<double, Dim, 1> PointType;
+    typedef Eigen::Matrix<double, Dim, Dim> MatrixType;
+
+    static constexpr std::size_t block_size = 256;
+
+    Mahalanobis() : mean(PointType::Zero()), lower(MatrixType::Identity()), inverse_diagonal(PointType::Ones()), regularized(false)
+    {
+    }
+
+    /// a covariance that is not positive definite is regularized by adding a small multiple of its trace to the diagonal
+    Mahalanobis(const PointType& _mean, const MatrixType& _covariance) : mean(_mean), regularized(false)
+    {
+        Eigen::LLT<MatrixType> llt(_covariance);
+        if (llt.info() != Eigen::Success) {
+            const double epsilon = std::max(1e-12, 1e-9 * _covariance.trace());
+            llt.compute(_covariance + MatrixType::Identity() * epsilon);
+            regularized = true;
+        }
+        lower = llt.matrixL();
+        for (std::size_t i = 0; i < Dim; ++i) {
+            inverse_diagonal(i) = 1.0 / lower(i, i);
+        }
+    }
+
+    inline bool isRegularized() const
+    {
+        return regularized;
+    }
+
+    inline double squaredDistance(const PointType& _p) const
+    {
+        PointType y;
+        for (std::size_t i = 0; i < Dim; ++i) {
+            double v = _p(i) - mean(i);
+            for (std::size_t j = 0; j < i; ++j) {
+                v -= lower(i, j) * y(j);
+            }
+            y(i) = v * inverse_diagonal(i);
+        }
+        return y.squaredNorm();
+    }
+
+    /// writes the squared distances of _count points to _out
+    template <typename T>
+    inline void squaredDistances(const std::array<const T*, Dim>& _coordinates, const std::size_t _count, double* _out) const
+    {
+        double y[Dim][block_size];
+        for (std::size_t begin = 0; begin < _count; begin += block_size) {
+            const std::size_t size = std::min(block_size, _count - begin);
+            double* out = _out + begin;
+            std::fill(out, out + size, 0.0);
+
+            for (std::size_t i = 0; i < Dim; ++i) {
+                const T* values = _coordinates[i] + begin;
+                const double m = mean(i);
+                double* yi = y[i];
+                for (std::size_t k = 0; k < size; ++k) {
+                    yi[k] = values[k] - m;
+                }
+                for (std::size_t j = 0; j < i; ++j) {
+                    const double l = lower(i, j);
+                    const double* yj = y[j];
+                    for (std::size_t k = 0; k < size; ++k) {
+                        yi[k] -= l * yj[k];
+                    }
+                }
+                const double s = inverse_diagonal(i);
+                for (std::size_t k = 0; k < size; ++k) {
+                    yi[k] *= s;
+                    out[k] += yi[k] * yi[k];
+                }
+            }
+        }
+    }
+
+    /// sum of the squared distances of _count points
+    template <typename T>
+    inline double sumOfSquaredDistances(const std::array<const T*, Dim>& _coordinates, const std::size_t _count) const
+    {
+        double distances[block_size];
+        double sum = 0.0;
+        for (std::size_t begin = 0; begin < _count; begin += block_size) {
+            const std::size_t size = std::min(block_size, _count - begin);
+            std::array<const T*, Dim> block;
+            for (std::size_t d = 0; d < Dim; ++d) {
+                block[d] = _coordinates[d] + begin;
+            }
+            squaredDistances(block, size, distances);
+            for (std::size_t k = 0; k < size; ++k) {
+                sum += distances[k];
+            }
+        }
+        return sum;
+    }
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+private:
+    PointType mean;
+    MatrixType lower;
+    PointType inverse_diagonal;
+    bool regularized;
+};
+}  // namespace math
+}  // namespace csapex
+
+#endif  // MAHALANOBIS_HPP
@@ -0,0 +1,76 @@
+#ifndef CLUSTER_LABELS_MESSAGE_H
+#define CLUSTER_LABELS_MESSAGE_H
+
+/// PROJECT
+#include <csapex/msg/message.h>
+#include <csapex/msg/token_traits.h>
+#include <csapex_point_cloud/labels/cluster_labels.h>
+
+namespace YAML
+{
+template <typename T, typename S>
+struct as_if;
+}
+
+namespace csapex
+{
+namespace connection_types
+{
+/**
+ * @brief The ClusterLabelsMessage struct carries the cluster labels of one point cloud.
+ *
+ * The labels are not serialized.
+ */
+struct ClusterLabelsMessage : public Message
+{
+protected:
+    CLONABLE_IMPLEMENTATION(ClusterLabelsMessage);
+
+public:
+    friend class YAML::as_if<ClusterLabelsMessage, void>;
+
+    typedef std::shared_ptr<ClusterLabelsMessage> Ptr;
+    typedef std::shared_ptr<ClusterLabelsMessage const> ConstPtr;
+
+    ClusterLabelsMessage(const std::string& frame_id, Stamp stamp_micro_seconds);
+
+    virtual std::string descriptiveName() const override;
+
+    bool acceptsConnectionFrom(const TokenData* other_side) const override;
+
+    ClusterLabels::ConstPtr value;
+
+private:
+    ClusterLabelsMessage();
+};
+
+/// TRAITS
+template <>
+struct type<ClusterLabelsMessage>
+{
+    static std::string name()
+    {
+        return "ClusterLabels";
+    }
+};
+
+}  // namespace connection_types
+
+template <>
+inline std::shared_ptr<connection_types::ClusterLabelsMessage> makeEmpty<connection_types::ClusterLabelsMessage>()
+{
+    return std::shared_ptr<connection_types::ClusterLabelsMessage>(new connection_types::ClusterLabelsMessage("/", 0));
+}
+}  // namespace csapex
+
+/// YAML
+namespace YAML
+{
+template <>
+struct convert<csapex::connection_types::ClusterLabelsMessage>
+{
+    static Node encode(const csapex::connection_types::ClusterLabelsMessage& rhs);
+    static bool decode(const Node& node, csapex::connection_types::ClusterLabelsMessage& rhs);
+};
+}  // namespace YAML
+#endif  // CLUSTER_LABELS_MESSAGE_H
@@ -0,0 +1,76 @@
+#ifndef SPATIAL_INDEX_MESSAGE_H
+#define SPATIAL_INDEX_MESSAGE_H
+
+/// PROJECT
+#include <csapex/msg/message.h>
+#include <csapex/msg/token_traits.h>
+#include <csapex_point_cloud/search/spatial_index.h>
+
+namespace YAML
+{
+template <typename T, typename S>
+struct as_if;
+}
+
+namespace csapex
+{
+namespace connection_types
+{
+/**
+ * @brief The SpatialIndexMessage struct carries a search structure built for one point cloud.
+ *
+ * The index itself is not serialized.
+ */
+struct SpatialIndexMessage : public Message
+{
+protected:
+    CLONABLE_IMPLEMENTATION(SpatialIndexMessage);
+
+public:
+    friend class YAML::as_if<SpatialIndexMessage, void>;
+
+    typedef std::shared_ptr<SpatialIndexMessage> Ptr;
+    typedef std::shared_ptr<SpatialIndexMessage const> ConstPtr;
+
+    SpatialIndexMessage(const std::string& frame_id, Stamp stamp_micro_seconds);
+
+    virtual std::string descriptiveName() const override;
+
+    bool acceptsConnectionFrom(const TokenData* other_side) const override;
+
+    SpatialIndex::ConstPtr value;
+
+private:
+    SpatialIndexMessage();
+};
+
+/// TRAITS
+template <>
+struct type<SpatialIndexMessage>
+{
+    static std::string name()
+    {
+        return "SpatialIndex";
+    }
+};
+
+}  // namespace connection_types
+
+template <>
+inline std::shared_ptr<connection_types::SpatialIndexMessage> makeEmpty<connection_types::SpatialIndexMessage>()
+{
+    return std::shared_ptr<connection_types::SpatialIndexMessage>(new connection_types::SpatialIndexMessage("/", 0));
+}
+}  // namespace csapex
+
+/// YAML
+namespace YAML
+{
+template <>
+struct convert<csapex::connection_types::SpatialIndexMessage>
+{
+    static Node encode(const csapex::connection_types::SpatialIndexMessage& rhs);
+    static bool decode(const Node& node, csapex::connection_types::SpatialIndexMessage& rhs);
+};
+}  // namespace YAML
+#endif  // SPATIAL_INDEX_MESSAGE_H
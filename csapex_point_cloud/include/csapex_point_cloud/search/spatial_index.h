@@ -0,0 +1,157 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+/// SYSTEM
+// clang-format off
+#include <csapex/utility/suppress_warnings_start.h>
+#include <pcl/point_cloud.h>
+#include <csapex/utility/suppress_warnings_end.h>
+// clang-format on
+#include <Eigen/Core>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The SpatialIndex class is a search structure over the finite points of a cloud.
+ *
+ * It is built once per cloud and shared through a SpatialIndexMessage, so that
+ * normal estimation, outlier removal and clustering do not build their own trees.
+ * Two variants are available: a k-d tree that adapts to any point density, and a
+ * voxel hash that is cheaper to build and fast if the search radius is close to
+ * the voxel size. Results are indices into the original cloud, invalid points
+ * included, so organized clouds keep their layout.
+ *
+ * All queries are const and may run concurrently.
+ */
+class SpatialIndex
+{
+public:
+    typedef std::shared_ptr<SpatialIndex> Ptr;
+    typedef std::shared_ptr<SpatialIndex const> ConstPtr;
+
+    enum class Type
+    {
+        KD_TREE,
+        VOXEL_HASH
+    };
+
+public:
+    SpatialIndex(Type type, double voxel_size = 0.1);
+
+    /// the index keeps a reference to the cloud, so matches() can identify it
+    template <typename PointT, template <typename> class SharedPtr>
+    void build(const SharedPtr<const pcl::PointCloud<PointT>>& cloud_ptr)
+    {
+        const pcl::PointCloud<PointT>& cloud = *cloud_ptr;
+        cloud_ = std::shared_ptr<const void>(&cloud, [cloud_ptr](const void*) {});
+        cloud_size_ = cloud.points.size();
+
+        x_.clear();
+        y_.clear();
+        z_.clear();
+        ids_.clear();
+        for (std::size_t i = 0; i < cloud.points.size(); ++i) {
+            const PointT& pt = cloud.points[i];
+            if (std::isfinite(pt.x) && std::isfinite(pt.y) && std::isfinite(pt.z)) {
+                x_.push_back(pt.x);
+                y_.push_back(pt.y);
+                z_.push_back(pt.z);
+                ids_.push_back(static_cast<int>(i));
+            }
+        }
+        build();
+    }
+
+    /// true if the index was built for this cloud instance, copies with the same header do not match
+    template <typename PointT>
+    bool matches(const pcl::PointCloud<PointT>& cloud) const
+    {
+        return cloud_.get() == &cloud;
+    }
+
+    Type type() const;
+    double voxelSize() const;
+
+    /// number of points in the indexed cloud, including invalid ones
+    std::size_t cloudSize() const;
+    /// number of indexed points
+    std::size_t size() const;
+
+    /**
+     * @brief radiusSearch finds all points closer than radius to query, in no particular order.
+     * @param max_nn stop after this many results, 0 for no limit
+     * @param mask if set, only points i with mask[i] are reported
+     * @return the number of results
+     */
+    int radiusSearch(const Eigen::Vector3f& query, double radius, std::vector<int>& indices, std::vector<float>& sqr_distances, unsigned int max_nn = 0,
+                     const std::vector<bool>* mask = nullptr) const;
+
+    /**
+     * @brief nearestKSearch finds the k points closest to query, sorted by distance.
+     * @param mask if set, only points i with mask[i] are reported
+     * @return the number of results, less than k if there are not enough points
+     */
+    int nearestKSearch(const Eigen::Vector3f& query, int k, std::vector<int>& indices, std::vector<float>& sqr_distances, const std::vector<bool>* mask = nullptr) const;
+
+private:
+    struct Node
+    {
+        /// points [begin, end) for leaves
+        int begin;
+        int end;
+        /// children, -1 for leaves
+        int left;
+        int right;
+        int axis;
+        float split;
+    };
+
+    struct Candidates;
+
+    void build();
+    void buildKdTree();
+    int buildKdNode(std::vector<int>& order, int begin, int end, Eigen::Vector3f lo, Eigen::Vector3f hi);
+    void buildVoxelHash();
+    void reorder(const std::vector<int>& order);
+
+    void radiusKdTree(int node, const float* q, float radius_sqr, unsigned int max_nn, const std::vector<bool>* mask, std::vector<int>& indices,
+                      std::vector<float>& sqr_distances) const;
+    void nearestKdTree(int node, const float* q, const std::vector<bool>* mask, Candidates& candidates) const;
+
+    void visitRange(int begin, int end, const float* q, float radius_sqr, unsigned int max_nn, const std::vector<bool>* mask, std::vector<int>& indices,
+                    std::vector<float>& sqr_distances) const;
+    void nearestRange(int begin, int end, const float* q, const std::vector<bool>* mask, Candidates& candidates) const;
+    int64_t voxelKey(int x, int y, int z) const;
+    int voxelCoordinate(float v) const;
+
+private:
+    Type type_;
+    double voxel_size_;
+
+    /// the indexed cloud, kept alive so that its address cannot be reused by another cloud
+    std::shared_ptr<const void> cloud_;
+    std::size_t cloud_size_;
+
+    // indexed points in the order of the leaves or voxels, ids_ maps them to the cloud
+    std::vector<float> x_;
+    std::vector<float> y_;
+    std::vector<float> z_;
+    std::vector<int> ids_;
+
+    // k-d tree, the root is nodes_[0]
+    std::vector<Node> nodes_;
+
+    // voxel hash, the points of a voxel are [range.first, range.second)
+    std::unordered_map<int64_t, std::pair<int, int>> voxels_;
+    Eigen::Vector3i voxel_min_;
+    Eigen::Vector3i voxel_max_;
+};
+
+}  // namespace csapex
+
+#endif  // SPATIAL_INDEX_H
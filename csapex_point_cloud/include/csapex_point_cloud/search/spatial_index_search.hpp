@@ -0,0 +1,74 @@
+#ifndef SPATIAL_INDEX_SEARCH_HPP
+#define SPATIAL_INDEX_SEARCH_HPP
+
+/// PROJECT
+#include <csapex_point_cloud/search/spatial_index.h>
+
+/// SYSTEM
+// clang-format off
+#include <csapex/utility/suppress_warnings_start.h>
+#include <pcl/search/search.h>
+#include <csapex/utility/suppress_warnings_end.h>
+// clang-format on
+#include <stdexcept>
+
+namespace csapex
+{
+/**
+ * @brief The SpatialIndexSearch class lets PCL algorithms search a shared SpatialIndex.
+ *
+ * Setting the input cloud does not rebuild anything, it only checks that the
+ * index belongs to the cloud and restricts the results to the given indices.
+ */
+template <typename PointT>
+class SpatialIndexSearch : public pcl::search::Search<PointT>
+{
+public:
+    typedef boost::shared_ptr<SpatialIndexSearch<PointT>> Ptr;
+
+    typedef typename pcl::search::Search<PointT>::PointCloudConstPtr PointCloudConstPtr;
+    typedef typename pcl::search::Search<PointT>::IndicesConstPtr IndicesConstPtr;
+
+    using pcl::search::Search<PointT>::nearestKSearch;
+    using pcl::search::Search<PointT>::radiusSearch;
+
+public:
+    SpatialIndexSearch(const SpatialIndex::ConstPtr& index) : pcl::search::Search<PointT>("SpatialIndexSearch", false), index_(index)
+    {
+    }
+
+    void setInputCloud(const PointCloudConstPtr& cloud, const IndicesConstPtr& indices = IndicesConstPtr()) override
+    {
+        if (!index_->matches(*cloud)) {
+            throw std::runtime_error("the spatial index was built for a different cloud");
+        }
+        this->input_ = cloud;
+        this->indices_ = indices;
+
+        mask_.clear();
+        if (indices) {
+            mask_.resize(cloud->points.size(), false);
+            for (int i : *indices) {
+                mask_[i] = true;
+            }
+        }
+    }
+
+    int nearestKSearch(const PointT& point, int k, std::vector<int>& k_indices, std::vector<float>& k_sqr_distances) const override
+    {
+        return index_->nearestKSearch(point.getVector3fMap(), k, k_indices, k_sqr_distances, this->indices_ ? &mask_ : nullptr);
+    }
+
+    int radiusSearch(const PointT& point, double radius, std::vector<int>& k_indices, std::vector<float>& k_sqr_distances, unsigned int max_nn = 0) const override
+    {
+        return index_->radiusSearch(point.getVector3fMap(), radius, k_indices, k_sqr_distances, max_nn, this->indices_ ? &mask_ : nullptr);
+    }
+
+private:
+    SpatialIndex::ConstPtr index_;
+    std::vector<bool> mask_;
+};
+
+}  // namespace csapex
+
+#endif  // SPATIAL_INDEX_SEARCH_HPP
@@ -13,6 +13,8 @@
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_math/param/factory.h>
 #include <csapex_point_cloud/msg/indices_message.h>
+#include <csapex_point_cloud/msg/spatial_index_message.h>
+#include <csapex_point_cloud/search/spatial_index_search.hpp>
 
 /// SYSTEM
 // clang-format off
@@ -51,6 +53,7 @@ void ClusterPointCloudPCL::setupParameters(Parameterizable& parameters)
     std::map<std::string, int> methods = {
         { "PCL_EUCLIDEAN", (int)Method::PCL_EUCLIDEAN },
         { "PCL_POLAR", (int)Method::PCL_POLAR },
+        { "RANGE_IMAGE", (int)Method::RANGE_IMAGE },
     };
     parameters.addParameter(param::factory::declareParameterSet("method", methods, (int)Method::PCL_EUCLIDEAN), [this](param::Parameter* p) { method_ = static_cast<Method>(p->as<int>()); });
 
@@ -58,7 +61,19 @@ void ClusterPointCloudPCL::setupParameters(Parameterizable& parameters)
     parameters.addParameter(param::factory::declareRange("minimum cluster size", 0, 20000, 100, 1), cluster_min_size_);
     parameters.addParameter(param::factory::declareRange("maximum cluster size", 0, 100000, 25000, 1), cluster_max_size_);
 
-    parameters.addConditionalParameter(param::factory::declareAngle("opening_angle", 0.001), [this]() { return method_ == Method::PCL_POLAR; }, polar_opening_angle_);
+    parameters.addConditionalParameter(param::factory::declareAngle("opening_angle", 0.001), [this]() { return method_ == Method::PCL_POLAR || method_ == Method::RANGE_IMAGE; },
+                                       polar_opening_angle_);
+
+    auto range_image = [this]() { return method_ == Method::RANGE_IMAGE; };
+    parameters.addConditionalParameter(
+        param::factory::declareRange("range_image/rows", param::ParameterDescription("Rows (rings) above and below a point that are compared, the cloud has to be organized"), 0, 8, 1, 1),
+        range_image, range_image_rows_);
+    parameters.addConditionalParameter(
+        param::factory::declareRange("range_image/cols", param::ParameterDescription("Columns (azimuth steps) left and right of a point that are compared"), 0, 32, 2, 1), range_image,
+        range_image_cols_);
+    parameters.addConditionalParameter(
+        param::factory::declareBool("range_image/wrap_around", param::ParameterDescription("Connect the first and the last column, for scans covering 360 degrees"), true), range_image,
+        range_image_wrap_around_);
 }
 
 void ClusterPointCloudPCL::process()
@@ -72,6 +87,7 @@ void ClusterPointCloudPCL::setup(NodeModifier& node_modifier)
 {
     in_cloud_ = node_modifier.addInput<PointCloudMessage>("PointCloud");
     in_indices_ = node_modifier.addOptionalInput<PointIndicesMessage>("Indices");
+    in_index_ = node_modifier.addOptionalInput<SpatialIndexMessage>("search index");
 
     out_ = node_modifier.addOutput<GenericVectorMessage, pcl::PointIndices>("Clusters");
     out_debug_ = node_modifier.addOutput<std::string>("Debug Info");
@@ -123,6 +139,9 @@ void ClusterPointCloudPCL::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr
         case Method::PCL_POLAR:
             cluster_indices = pclPolar<PointT>(cloud, indices);
             break;
+        case Method::RANGE_IMAGE:
+            cluster_indices = rangeImage<PointT>(cloud, indices);
+            break;
         default:
             throw std::runtime_error("unknown method");
     }
@@ -134,10 +153,23 @@ void ClusterPointCloudPCL::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr
     msg::publish(out_debug_, text_msg);
 }
 
+template <class PointT>
+typename pcl::search::Search<PointT>::Ptr ClusterPointCloudPCL::searchMethod()
+{
+    if (msg::hasMessage(in_index_)) {
+        SpatialIndex::ConstPtr index = msg::getMessage<SpatialIndexMessage>(in_index_)->value;
+        if (!index) {
+            throw std::runtime_error("received an empty spatial index");
+        }
+        return typename pcl::search::Search<PointT>::Ptr(new SpatialIndexSearch<PointT>(index));
+    }
+    return typename pcl::search::Search<PointT>::Ptr(new pcl::search::KdTree<PointT>);
+}
+
 template <class PointT>
 std::shared_ptr<std::vector<pcl::PointIndices>> ClusterPointCloudPCL::pclEuclidean(typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::IndicesConstPtr indices)
 {
-    typename pcl::search::KdTree<PointT>::Ptr tree(new pcl::search::KdTree<PointT>);
+    typename pcl::search::Search<PointT>::Ptr tree = searchMethod<PointT>();
     tree->setInputCloud(cloud, indices);
 
     std::shared_ptr<std::vector<pcl::PointIndices>> cluster_indices(new std::vector<pcl::PointIndices>);
@@ -170,7 +202,7 @@ std::shared_ptr<std::vector<pcl::PointIndices>> ClusterPointCloudPCL::pclEuclide
 template <class PointT>
 std::shared_ptr<std::vector<pcl::PointIndices>> ClusterPointCloudPCL::pclPolar(typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::IndicesConstPtr indices)
 {
-    typename pcl::search::KdTree<PointT>::Ptr tree(new pcl::search::KdTree<PointT>);
+    typename pcl::search::Search<PointT>::Ptr tree = searchMethod<PointT>();
     tree->setInputCloud(cloud, indices);
     std::shared_ptr<std::vector<pcl::PointIndices>> cluster_indices(new std::vector<pcl::PointIndices>);
     {
@@ -187,3 +219,27 @@ std::shared_ptr<std::vector<pcl::PointIndices>> ClusterPointCloudPCL::pclPolar(t
     }
     return cluster_indices;
 }
+
+template <class PointT>
+std::shared_ptr<std::vector<pcl::PointIndices>> ClusterPointCloudPCL::rangeImage(typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::IndicesConstPtr indices)
+{
+    if (!cloud->isOrganized()) {
+        throw std::runtime_error("range image clustering requires an organized cloud");
+    }
+
+    std::shared_ptr<std::vector<pcl::PointIndices>> cluster_indices(new std::vector<pcl::PointIndices>);
+    {
+        TRACE("clustering");
+        PolarClustering<PointT> ec;
+        ec.setClusterTolerance(cluster_tolerance_);
+        ec.setOpeningAngle(polar_opening_angle_);
+        ec.setMinClusterSize(cluster_min_size_);
+        ec.setMaxClusterSize(cluster_max_size_);
+        ec.setRangeImageNeighbourhood(range_image_rows_, range_image_cols_);
+        ec.setWrapAround(range_image_wrap_around_);
+        ec.setIndices(indices);
+        ec.setInputCloud(cloud);
+        ec.extractOrganized(*cluster_indices);
+    }
+    return cluster_indices;
+}
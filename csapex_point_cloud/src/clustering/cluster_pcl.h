@@ -7,6 +7,7 @@
 /// SYSTEM
 #include <pcl/PointIndices.h>
 #include <pcl/pcl_base.h>
+#include <pcl/search/search.h>
 
 namespace csapex
 {
@@ -25,22 +26,31 @@ public:
     void inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud);
 
 private:
+    /// the shared search index if one is connected, a new k-d tree otherwise
+    template <class PointT>
+    typename pcl::search::Search<PointT>::Ptr searchMethod();
+
     template <class PointT>
     std::shared_ptr<std::vector<pcl::PointIndices>> pclEuclidean(typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::IndicesConstPtr indices);
 
     template <class PointT>
     std::shared_ptr<std::vector<pcl::PointIndices>> pclPolar(typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::IndicesConstPtr indices);
 
+    template <class PointT>
+    std::shared_ptr<std::vector<pcl::PointIndices>> rangeImage(typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::IndicesConstPtr indices);
+
 private:
     enum class Method
     {
         PCL_EUCLIDEAN,
-        PCL_POLAR
+        PCL_POLAR,
+        RANGE_IMAGE
     };
 
 private:
     Input* in_cloud_;
     Input* in_indices_;
+    Input* in_index_;
     Output* out_;
     Output* out_debug_;
 
@@ -51,6 +61,10 @@ private:
     int cluster_max_size_;
 
     double polar_opening_angle_;
+
+    int range_image_rows_;
+    int range_image_cols_;
+    bool range_image_wrap_around_;
 };
 
 }  // namespace clustering
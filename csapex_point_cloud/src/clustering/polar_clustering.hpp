@@ -8,6 +8,10 @@
 #include <pcl/search/pcl_search.h>
 #include <csapex/utility/suppress_warnings_end.h>
 // clang-format on
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /** \brief Decompose a region of space into clusters based on the Euclidean
@@ -244,6 +248,139 @@ inline bool comparePointClusters(const pcl::PointIndices& a, const pcl::PointInd
     return (a.indices.size() < b.indices.size());
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/** \brief Decompose an organized cloud into clusters on its range image, without
+ * a search tree. Every point is compared to the points at the fixed (row, column)
+ * offsets up to \a neighbour_rows and \a neighbour_cols away, two points are
+ * connected if their distance is below the polar tolerance of either of them.
+ * The distance tests of a row and one offset are evaluated in one loop over
+ * contiguous arrays, connected points are joined with union-find and labelled
+ * in a second pass. \param cloud the organized point cloud \param indices the
+ * points to cluster, all other points are ignored \param wrap_around connect the
+ * first and the last column, for clouds covering 360 degrees \ingroup segmentation
+ */
+template <typename PointT>
+void extractRangeImageClusters(const pcl::PointCloud<PointT>& cloud, const std::vector<int>& indices, float alpha, float tolerance, int neighbour_rows, int neighbour_cols, bool wrap_around,
+                               std::vector<pcl::PointIndices>& clusters, unsigned int min_pts_per_cluster = 1, unsigned int max_pts_per_cluster = (std::numeric_limits<int>::max)())
+{
+    const int width = static_cast<int>(cloud.width);
+    const int height = static_cast<int>(cloud.height);
+    const int n = width * height;
+    if (height <= 1 || static_cast<int>(cloud.points.size()) != n) {
+        PCL_ERROR("[pcl::extractRangeImageClusters] The input cloud is not organized!\n");
+        return;
+    }
+
+    neighbour_rows = std::max(0, std::min(neighbour_rows, height - 1));
+    neighbour_cols = std::max(0, std::min(neighbour_cols, (width - 1) / 2));
+
+    // structure of arrays, so that the distance tests of a row run over contiguous memory
+    std::vector<float> xs(n), ys(n), zs(n), tolerance_sqr(n);
+    std::vector<unsigned char> valid(n, 0);
+    for (int i : indices) {
+        const PointT& pt = cloud.points[i];
+        const float r = std::sqrt(pt.x * pt.x + pt.y * pt.y + pt.z * pt.z);
+        const float t = tolerance * std::pow(r, alpha);
+        xs[i] = pt.x;
+        ys[i] = pt.y;
+        zs[i] = pt.z;
+        tolerance_sqr[i] = t * t;
+        valid[i] = 1;
+    }
+
+    std::vector<int> parent(n);
+    for (int i = 0; i < n; ++i) {
+        parent[i] = i;
+    }
+    auto find = [&parent](int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+    auto unite = [&](int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) {
+            parent[std::max(a, b)] = std::min(a, b);
+        }
+    };
+
+    std::vector<unsigned char> connected(width);
+
+    // tests p[x] against q[x] for x in [begin, end) and joins the connected pairs
+    auto connect = [&](int p, int q, int begin, int end) {
+        const float* px = xs.data() + p;
+        const float* py = ys.data() + p;
+        const float* pz = zs.data() + p;
+        const float* pt = tolerance_sqr.data() + p;
+        const unsigned char* pv = valid.data() + p;
+        const float* qx = xs.data() + q;
+        const float* qy = ys.data() + q;
+        const float* qz = zs.data() + q;
+        const float* qt = tolerance_sqr.data() + q;
+        const unsigned char* qv = valid.data() + q;
+        unsigned char* c = connected.data();
+
+        for (int x = begin; x < end; ++x) {
+            const float dx = px[x] - qx[x];
+            const float dy = py[x] - qy[x];
+            const float dz = pz[x] - qz[x];
+            const float d = dx * dx + dy * dy + dz * dz;
+            c[x] = (pv[x] & qv[x]) & static_cast<unsigned char>(d < std::max(pt[x], qt[x]));
+        }
+        for (int x = begin; x < end; ++x) {
+            if (c[x]) {
+                unite(p + x, q + x);
+            }
+        }
+    };
+
+    // first pass: half of the neighbourhood, so that every pair is tested once
+    for (int dr = 0; dr <= neighbour_rows; ++dr) {
+        for (int dc = -neighbour_cols; dc <= neighbour_cols; ++dc) {
+            if (dr == 0 && dc <= 0) {
+                continue;
+            }
+            for (int row = 0; row + dr < height; ++row) {
+                const int p = row * width;
+                const int q = (row + dr) * width + dc;
+                // columns whose neighbour lies inside the image ...
+                connect(p, q, std::max(0, -dc), std::min(width, width - dc));
+                // ... and the ones wrapping around
+                if (wrap_around && dc > 0) {
+                    connect(p, q - width, width - dc, width);
+                } else if (wrap_around && dc < 0) {
+                    connect(p, q + width, 0, -dc);
+                }
+            }
+        }
+    }
+
+    // second pass: number the components in the order of their first point
+    std::vector<int> label(n, -1);
+    std::vector<pcl::PointIndices> components;
+    for (int i = 0; i < n; ++i) {
+        if (!valid[i]) {
+            continue;
+        }
+        const int root = find(i);
+        if (label[root] < 0) {
+            label[root] = static_cast<int>(components.size());
+            components.emplace_back();
+        }
+        components[label[root]].indices.push_back(i);
+    }
+
+    for (pcl::PointIndices& component : components) {
+        if (component.indices.size() >= min_pts_per_cluster && component.indices.size() <= max_pts_per_cluster) {
+            component.header = cloud.header;
+            clusters.push_back(std::move(component));
+        }
+    }
+}
+
 template <typename PointT>
 class PolarClustering : public pcl::PCLBase<PointT>
 {
@@ -262,7 +399,8 @@ public:
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     /** \brief Empty constructor. */
-    PolarClustering() : tree_(), cluster_tolerance_(0), opening_angle_(1.0), min_pts_per_cluster_(1), max_pts_per_cluster_(std::numeric_limits<int>::max())
+    PolarClustering()
+      : tree_(), cluster_tolerance_(0), opening_angle_(1.0), min_pts_per_cluster_(1), max_pts_per_cluster_(std::numeric_limits<int>::max()), neighbour_rows_(1), neighbour_cols_(1), wrap_around_(true)
     {
     }
 
@@ -308,6 +446,22 @@ public:
         return (opening_angle_);
     }
 
+    /** \brief Set the range image neighbourhood used by extractOrganized.
+     * \param[in] rows the rows (rings) above and below that are compared
+     * \param[in] cols the columns (azimuth steps) left and right that are compared
+     */
+    inline void setRangeImageNeighbourhood(int rows, int cols)
+    {
+        neighbour_rows_ = rows;
+        neighbour_cols_ = cols;
+    }
+
+    /** \brief Connect the first and the last column of the range image in extractOrganized. */
+    inline void setWrapAround(bool wrap_around)
+    {
+        wrap_around_ = wrap_around;
+    }
+
     /** \brief Set the minimum number of points that a cluster needs to contain in
      * order to be considered valid. \param[in] min_cluster_size the minimum
      * cluster size
@@ -372,6 +526,26 @@ public:
         deinitCompute();
     }
 
+    /** \brief Cluster extraction on the range image of an organized cloud given by
+     * <setInputCloud (), setIndices ()>, no search method is needed.
+     * \param[out] clusters the resultant point clusters
+     */
+    void extractOrganized(std::vector<pcl::PointIndices>& clusters)
+    {
+        clusters.clear();
+        if (!initCompute() || (input_ != 0 && input_->points.empty()) || (indices_ != 0 && indices_->empty())) {
+            return;
+        }
+
+        extractRangeImageClusters(*input_, *indices_, static_cast<float>(opening_angle_), static_cast<float>(cluster_tolerance_), neighbour_rows_, neighbour_cols_, wrap_around_, clusters,
+                                  min_pts_per_cluster_, max_pts_per_cluster_);
+
+        // Sort the clusters based on their size (largest one first)
+        std::sort(clusters.rbegin(), clusters.rend(), comparePointClusters);
+
+        deinitCompute();
+    }
+
 protected:
     // Members derived from the base class
     using BasePCLBase::deinitCompute;
@@ -396,6 +570,11 @@ protected:
      * order to be considered valid (default = MAXINT). */
     int max_pts_per_cluster_;
 
+    /** \brief The range image neighbourhood of extractOrganized. */
+    int neighbour_rows_;
+    int neighbour_cols_;
+    bool wrap_around_;
+
     /** \brief Class getName method. */
     virtual std::string getClassName() const
     {
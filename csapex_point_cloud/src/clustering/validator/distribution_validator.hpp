@@ -81,8 +81,9 @@ private:
         current_distribution_.getCovariance(cov3D);
 
         Eigen::Matrix2d cov2D = cov3D.block<2, 2>(0, 0);
-        Eigen::EigenSolver<Eigen::Matrix2d> solver(cov2D);
-        Eigen::Vector2d eigen_values = solver.eigenvalues().real();
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> solver;
+        solver.computeDirect(cov2D, Eigen::EigenvaluesOnly);
+        Eigen::Vector2d eigen_values = solver.eigenvalues();
 
         for (std::size_t i = 0; i < 2; ++i) {
             const auto& interval = std_dev_[i];
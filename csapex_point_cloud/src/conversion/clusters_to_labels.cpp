@@ -0,0 +1,64 @@
+/// PROJECT
+#include <csapex/model/node.h>
+#include <csapex/model/node_modifier.h>
+#include <csapex/msg/generic_vector_message.hpp>
+#include <csapex/msg/io.h>
+#include <csapex/utility/register_apex_plugin.h>
+#include <csapex_point_cloud/msg/cluster_labels_message.h>
+#include <csapex_point_cloud/msg/point_cloud_message.h>
+
+using namespace csapex::connection_types;
+
+namespace csapex
+{
+class ClustersToLabels : public Node
+{
+public:
+    ClustersToLabels()
+    {
+    }
+
+    void setup(csapex::NodeModifier& modifier) override
+    {
+        in_cloud_ = modifier.addInput<PointCloudMessage>("PointCloud");
+        in_indices_ = modifier.addInput<GenericVectorMessage, pcl::PointIndices>("Clusters");
+
+        out_labels_ = modifier.addOutput<ClusterLabelsMessage>("Cluster Labels");
+    }
+
+    void setupParameters(csapex::Parameterizable& params) override
+    {
+    }
+
+    void process() override
+    {
+        PointCloudMessage::ConstPtr cloud(msg::getMessage<PointCloudMessage>(in_cloud_));
+        clusters_ = msg::getMessage<GenericVectorMessage, pcl::PointIndices>(in_indices_);
+
+        boost::apply_visitor(PointCloudMessage::Dispatch<ClustersToLabels>(this, cloud), cloud->value);
+
+        clusters_.reset();
+    }
+
+    template <class PointT>
+    void inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud)
+    {
+        ClusterLabels::Ptr labels(new ClusterLabels);
+        labels->build(cloud->width, cloud->height, *clusters_);
+
+        ClusterLabelsMessage::Ptr out(new ClusterLabelsMessage(cloud->header.frame_id, cloud->header.stamp));
+        out->value = labels;
+        msg::publish(out_labels_, out);
+    }
+
+private:
+    Input* in_cloud_;
+    Input* in_indices_;
+    Output* out_labels_;
+
+    std::shared_ptr<std::vector<pcl::PointIndices> const> clusters_;
+};
+
+}  // namespace csapex
+
+CSAPEX_REGISTER_CLASS(csapex::ClustersToLabels, csapex::Node)
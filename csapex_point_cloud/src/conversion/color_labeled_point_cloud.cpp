@@ -8,11 +8,13 @@
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex/view/utility/color.hpp>
 #include <csapex_opencv/cv_mat_message.h>
+#include <csapex_point_cloud/msg/cluster_labels_message.h>
 #include <csapex_point_cloud/msg/point_cloud_message.h>
 
 /// SYSTEM
 #include <pcl/conversions.h>
 #include <pcl/point_types.h>
+#include <algorithm>
 
 CSAPEX_REGISTER_CLASS(csapex::ColorLabeledPointCloud, csapex::Node)
 
@@ -29,12 +31,18 @@ void ColorLabeledPointCloud::process()
 {
     PointCloudMessage::ConstPtr msg(msg::getMessage<PointCloudMessage>(input_));
 
+    cluster_labels_.reset();
+    if (msg::hasMessage(in_cluster_labels_)) {
+        cluster_labels_ = msg::getMessage<ClusterLabelsMessage>(in_cluster_labels_)->value;
+    }
+
     boost::apply_visitor(PointCloudMessage::Dispatch<ColorLabeledPointCloud>(this, msg), msg->value);
 }
 
 void ColorLabeledPointCloud::setup(NodeModifier& node_modifier)
 {
     input_ = node_modifier.addInput<PointCloudMessage>("Labeled PointCloud");
+    in_cluster_labels_ = node_modifier.addOptionalInput<ClusterLabelsMessage>("Cluster Labels");
     output_ = node_modifier.addOutput<PointCloudMessage>("Colored PointCloud");
 }
 
@@ -51,27 +59,79 @@ struct Color
     uchar b;
 };
 
+/// colors of the labels, small labels are looked up in a table
+class Palette
+{
+public:
+    static const uint32_t TABLE_LIMIT = 1 << 16;
+
+    Palette(uint32_t max_label, std::size_t points)
+    {
+        const std::size_t size = std::min<std::size_t>(std::min<std::size_t>(max_label, points), TABLE_LIMIT) + 1;
+        table_.reserve(size);
+        table_.push_back(Color());
+        for (std::size_t label = 1; label < size; ++label) {
+            table_.push_back(make(label));
+        }
+    }
+
+    inline const Color& get(uint32_t label)
+    {
+        if (label < table_.size()) {
+            return table_[label];
+        }
+        auto it = colors_.find(label);
+        if (it == colors_.end()) {
+            it = colors_.insert(std::make_pair(label, make(label))).first;
+        }
+        return it->second;
+    }
+
+private:
+    static Color make(uint32_t label)
+    {
+        double r = 0.0, g = 0.0, b = 0.0;
+        color::fromCount(label + 1, r, g, b);
+        return Color(r, g, b);
+    }
+
+private:
+    std::vector<Color> table_;
+    std::map<uint32_t, Color> colors_;
+};
+
 template <class PointT>
 struct Impl
 {
-    inline static void convert(const typename pcl::PointCloud<PointT>::ConstPtr& src, typename pcl::PointCloud<pcl::PointXYZRGB>::Ptr& dst)
+    template <typename LabelOf>
+    inline static void convert(const typename pcl::PointCloud<PointT>::ConstPtr& src, typename pcl::PointCloud<pcl::PointXYZRGB>::Ptr& dst, const LabelOf& label_of)
     {
-        std::map<unsigned int, Color> colors;
-        colors.insert(std::make_pair(FLOOD_DEFAULT_LABEL, Color()));
-        for (typename pcl::PointCloud<PointT>::const_iterator it = src->begin(); it != src->end(); ++it) {
-            if (colors.find(it->label) == colors.end()) {
-                double r = 0.0, g = 0.0, b = 0.0;
-                color::fromCount(it->label + 1, r, g, b);
-                colors.insert(std::make_pair(it->label, Color(r, g, b)));
-            }
-            Color c = colors.at(it->label);
+        const std::size_t n = src->points.size();
+        uint32_t max_label = FLOOD_DEFAULT_LABEL;
+        for (std::size_t i = 0; i < n; ++i) {
+            max_label = std::max<uint32_t>(max_label, label_of(i));
+        }
+        Palette palette(max_label, n);
+
+        dst->points.resize(n);
+        const PointT* src_points = src->points.data();
+        pcl::PointXYZRGB* dst_points = dst->points.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            const Color& c = palette.get(label_of(i));
+            const PointT& s = src_points[i];
             pcl::PointXYZRGB p(c.r, c.g, c.b);
-            p.x = it->x;
-            p.y = it->y;
-            p.z = it->z;
-            dst->push_back(p);
+            p.x = s.x;
+            p.y = s.y;
+            p.z = s.z;
+            dst_points[i] = p;
         }
     }
+
+    inline static void convert(const typename pcl::PointCloud<PointT>::ConstPtr& src, typename pcl::PointCloud<pcl::PointXYZRGB>::Ptr& dst)
+    {
+        const PointT* points = src->points.data();
+        convert(src, dst, [points](std::size_t i) { return points[i].label; });
+    }
 };
 
 template <class PointT>
@@ -108,7 +168,15 @@ void ColorLabeledPointCloud::inputCloud(typename pcl::PointCloud<PointT>::ConstP
     PointCloudMessage::Ptr out(new PointCloudMessage(cloud->header.frame_id, cloud->header.stamp));
     pcl::PointCloud<pcl::PointXYZRGB>::Ptr out_cloud(new pcl::PointCloud<pcl::PointXYZRGB>);
 
-    implementation::Conversion<PointT>::apply(cloud, out_cloud);
+    if (cluster_labels_) {
+        if (cluster_labels_->size() != cloud->points.size()) {
+            throw std::runtime_error("the cluster labels were computed for a different cloud");
+        }
+        const ClusterLabels& labels = *cluster_labels_;
+        implementation::Impl<PointT>::convert(cloud, out_cloud, [&labels](std::size_t i) { return labels[i]; });
+    } else {
+        implementation::Conversion<PointT>::apply(cloud, out_cloud);
+    }
 
     out_cloud->height = cloud->height;
     out_cloud->header = cloud->header;
@@ -8,14 +8,60 @@
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex/view/utility/color.hpp>
 #include <csapex_opencv/roi_message.h>
+#include <csapex_opencv/parallel.h>
+#include <csapex_point_cloud/msg/cluster_labels_message.h>
 #include <csapex_point_cloud/msg/indices_message.h>
 #include <csapex_point_cloud/msg/point_cloud_message.h>
 #include <csapex_ros/ros_message_conversion.h>
 #include <csapex_ros/yaml_io.hpp>
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <opencv2/core/core.hpp>
 using namespace csapex::connection_types;
 
 namespace csapex
 {
+namespace
+{
+/// image space bounding box of one cluster
+struct Bounds
+{
+    double min_x = std::numeric_limits<double>::infinity();
+    double max_x = -std::numeric_limits<double>::infinity();
+    double min_y = std::numeric_limits<double>::infinity();
+    double max_y = -std::numeric_limits<double>::infinity();
+    double max_dist = -std::numeric_limits<double>::infinity();
+
+    inline void add(double x, double y)
+    {
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+    }
+
+    /// false for clusters without points and for boxes that do not fit a cv::Rect
+    inline bool valid() const
+    {
+        const double limit = std::numeric_limits<int>::max() / 2;
+        return min_x <= max_x && min_y <= max_y && -limit <= min_x && max_x <= limit && -limit <= min_y && max_y <= limit;
+    }
+
+    inline void merge(const Bounds& other)
+    {
+        min_x = std::min(min_x, other.min_x);
+        max_x = std::max(max_x, other.max_x);
+        min_y = std::min(min_y, other.min_y);
+        max_y = std::max(max_y, other.max_y);
+        max_dist = std::max(max_dist, other.max_dist);
+    }
+};
+
+}  // namespace
+
 class PointIndicesToROIs : public Node
 {
 public:
@@ -29,6 +75,7 @@ public:
         in_indices_ = modifier.addInput<GenericVectorMessage, pcl::PointIndices>("PointIndices");
         in_classification_ = modifier.addOptionalInput<GenericVectorMessage, int>("Classification");
         in_labels_ = modifier.addOptionalInput<GenericVectorMessage, std::string>("Labels");
+        in_cluster_labels_ = modifier.addOptionalInput<ClusterLabelsMessage>("Cluster Labels");
 
         output_rois_ = modifier.addOutput<GenericVectorMessage, RoiMessage>("ROIs");
     }
@@ -52,6 +99,12 @@ public:
 
         clusters_ = msg::getMessage<GenericVectorMessage, pcl::PointIndices>(in_indices_);
 
+        cluster_labels_.reset();
+        if (msg::hasMessage(in_cluster_labels_)) {
+            cluster_labels_ = msg::getMessage<ClusterLabelsMessage>(in_cluster_labels_)->value;
+            apex_assert(cluster_labels_->clusterCount() == clusters_->size());
+        }
+
         if (msg::hasMessage(in_labels_)) {
             labels_ = msg::getMessage<GenericVectorMessage, std::string>(in_labels_);
             apex_assert(labels_->size() == clusters_->size());
@@ -80,138 +133,149 @@ public:
 
         dense_ = cloud.width > 1 && cloud.height > 1;
 
-        if (dense_) {
-            inputDenseCloud<PointT>(cloud_ptr);
+        ClusterLabels::ConstPtr cluster_labels = cluster_labels_;
+        if (!cluster_labels) {
+            ClusterLabels::Ptr labels(new ClusterLabels);
+            labels->build(cloud.width, cloud.height, *clusters_);
+            cluster_labels = labels;
+        } else if (cluster_labels->size() != cloud.points.size()) {
+            throw std::runtime_error("the cluster labels were computed for a different cloud");
+        }
+
+        /// organized clouds use their pixel coordinates unless projection is enabled,
+        /// only sparse clouds are colored by distance
+        std::vector<Bounds> bounds;
+        if (cluster_labels->overlapping()) {
+            computeBoundsPerCluster(cloud, !dense_ || use_projection_, bounds);
         } else {
-            inputSparseCloud<PointT>(cloud_ptr);
+            computeBounds(cloud, *cluster_labels, !dense_ || use_projection_, bounds);
         }
+        publishRois(bounds, !dense_);
+
+        cluster_labels_.reset();
+        labels_.reset();
+        classification_.reset();
     }
 
+    /// adds a point to the bounds, either projected or at its row and column
     template <class PointT>
-    void inputDenseCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud_ptr)
+    void addPoint(Bounds& b, const PointT& pt, std::size_t row, std::size_t col, const bool project) const
     {
-        const pcl::PointCloud<PointT>& cloud = *cloud_ptr;
-        std::shared_ptr<std::vector<RoiMessage>> out(new std::vector<RoiMessage>);
-
-        std::size_t w = cloud.width;
-        //        std::size_t h = cloud.height;
-
-        int cluster_id = 0;
-        std::vector<int>::const_iterator class_label;
-        std::vector<std::string>::const_iterator label;
-
-        if (classification_) {
-            class_label = classification_->begin();
-        }
+        if (project) {
+            /*  general:
+             *
+             *            / z
+             *           /
+             *          /
+             *         +-------
+             *         |      x
+             *         |
+             *         | y
+             *
+             *  for us:
+             *
+             *       z |  / x
+             *         | /
+             *         |/
+             *  -------+
+             *   y
+             *
+             */
+            const double xx = -pt.y;
+            const double yy = -pt.z;
+            const double zz = pt.x;
+
+            double x = c_x_ + fov_x_ * xx / zz;
+            double y = c_y_ + fov_y_ * yy / zz;
+            if (!std::isfinite(x) || !std::isfinite(y)) {
+                // invalid points and points in the camera plane
+                return;
+            }
+            if (dense_) {
+                /// organized clouds always used integer image coordinates
+                x = std::trunc(x);
+                y = std::trunc(y);
+            }
+            b.add(x, y);
 
-        if (labels_) {
-            label = labels_->begin();
+            if (pt.x > b.max_dist)
+                b.max_dist = pt.x;
+        } else {
+            b.add(col, row);
         }
+    }
 
-        for (auto cluster = clusters_->begin(); cluster != clusters_->end(); ++cluster, ++cluster_id) {
-            auto indices = cluster->indices;
-
-            std::vector<PointT const*> cluster_pts(indices.size());
-
-            {
-                double min_col = std::numeric_limits<double>::infinity();
-                double max_col = -std::numeric_limits<double>::infinity();
-                double min_row = std::numeric_limits<double>::infinity();
-                double max_row = -std::numeric_limits<double>::infinity();
-                double max_dist = -std::numeric_limits<double>::infinity();
-
-                for (auto index = indices.begin(); index != indices.end(); ++index) {
-                    int i = *index;
-                    int row = i / w;
-                    int col = i % w;
-                    if (use_projection_) {
-                        const PointT& pt = cloud.points[*index];
-
-                        /*  general:
-                         *
-                         *            / z
-                         *           /
-                         *          /
-                         *         +-------
-                         *         |      x
-                         *         |
-                         *         | y
-                         *
-                         *  for us:
-                         *
-                         *       z |  / x
-                         *         | /
-                         *         |/
-                         *  -------+
-                         *   y
-                         *
-                         */
-
-                        //                double xx = pt.x;
-                        //                double yy = pt.y;
-                        //                double zz = pt.z;
-                        double xx = -pt.y;
-                        double yy = -pt.z;
-                        double zz = pt.x;
-
-                        col = c_x_ + fov_x_ * xx / zz;
-                        row = c_y_ + fov_y_ * yy / zz;
-
-                        if (pt.x > max_dist)
-                            max_dist = pt.x;
-                    }
-                    if (row < min_row)
-                        min_row = row;
-                    if (row > max_row)
-                        max_row = row;
-                    if (col < min_col)
-                        min_col = col;
-                    if (col > max_col)
-                        max_col = col;
+    /**
+     * Reduces the points of every cluster to its bounding box in one pass over the
+     * cloud. Chunks of points are reduced in parallel into their own bounds, which
+     * are merged afterwards. If project is false, the image coordinates are the
+     * row and column of the organized cloud.
+     */
+    template <class PointT>
+    void computeBounds(const pcl::PointCloud<PointT>& cloud, const ClusterLabels& labels, const bool project, std::vector<Bounds>& bounds)
+    {
+        const std::size_t clusters = clusters_->size();
+        const std::size_t n = cloud.points.size();
+        const std::size_t w = std::max<std::size_t>(1, cloud.width);
+        std::vector<std::vector<Bounds>> partial(parallel::chunkCount(n));
+        parallel::forEachChunk(n, [&](std::size_t c, std::size_t begin, std::size_t end) {
+            std::vector<Bounds>& local = partial[c];
+            local.resize(clusters);
+
+            const uint32_t* label = labels.data();
+            const PointT* points = cloud.points.data();
+
+            std::size_t row = begin / w;
+            std::size_t col = begin % w;
+            for (std::size_t i = begin; i < end; ++i) {
+                const uint32_t l = label[i];
+                if (l != ClusterLabels::UNLABELED && l <= clusters) {
+                    addPoint(local[l - 1], points[i], row, col, project);
                 }
 
-                RoiMessage roi;
-
-                cv::Rect rect;
-                rect.x = min_col;
-                rect.y = min_row;
-                rect.width = max_col - min_col;
-                rect.height = max_row - min_row;
-
-                if (flip_rois_) {
-                    rect.y = h_ - rect.y - rect.height;
+                if (++col == w) {
+                    col = 0;
+                    ++row;
                 }
+            }
+        });
 
-                roi.value.setRect(rect);
-                roi.value.setColor(cv::Scalar::all(0));
-                if (classification_) {
-                    roi.value.setClassification(*class_label);
-                    roi.value.setColor(colors_[*class_label]);
-                    ++class_label;
-                } else {
-                    roi.value.setClassification(0);
-                }
-                if (labels_) {
-                    roi.value.setLabel(*label);
-                    ++label;
-                }
-                out->push_back(roi);
+        bounds.assign(clusters, Bounds());
+        for (const std::vector<Bounds>& local : partial) {
+            for (std::size_t i = 0; i < clusters; ++i) {
+                bounds[i].merge(local[i]);
             }
         }
-
-        msg::publish<GenericVectorMessage, RoiMessage>(output_rois_, out);
-
-        labels_.reset();
-        classification_.reset();
     }
 
+    /**
+     * Reduces every cluster on its own. This is needed if clusters overlap, because
+     * the labels keep only the last cluster of every point. Indices outside of the
+     * cloud are ignored.
+     */
     template <class PointT>
-    void inputSparseCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud_ptr)
+    void computeBoundsPerCluster(const pcl::PointCloud<PointT>& cloud, const bool project, std::vector<Bounds>& bounds)
+    {
+        const std::vector<pcl::PointIndices>& clusters = *clusters_;
+        const std::size_t n = cloud.points.size();
+        const std::size_t w = std::max<std::size_t>(1, cloud.width);
+
+        bounds.assign(clusters.size(), Bounds());
+        parallel::forRange(static_cast<int>(clusters.size()), [&](const cv::Range& range) {
+            for (int c = range.start; c < range.end; ++c) {
+                for (int i : clusters[c].indices) {
+                    if (i >= 0 && static_cast<std::size_t>(i) < n) {
+                        addPoint(bounds[c], cloud.points[i], i / w, i % w, project);
+                    }
+                }
+            }
+        });
+    }
+
+    void publishRois(const std::vector<Bounds>& bounds, const bool color_by_distance)
     {
-        const pcl::PointCloud<PointT>& cloud = *cloud_ptr;
         std::shared_ptr<std::vector<RoiMessage>> out(new std::vector<RoiMessage>);
 
-        int cluster_id = 0;
         std::vector<int>::const_iterator class_label;
         std::vector<std::string>::const_iterator label;
         if (classification_) {
@@ -221,74 +285,35 @@ public:
         if (labels_) {
             label = labels_->begin();
         }
-        for (auto cluster = clusters_->begin(); cluster != clusters_->end(); ++cluster, ++cluster_id) {
-            auto indices = cluster->indices;
-            double min_x = std::numeric_limits<double>::infinity();
-            double max_x = -std::numeric_limits<double>::infinity();
-            double min_y = std::numeric_limits<double>::infinity();
-            double max_y = -std::numeric_limits<double>::infinity();
-
-            double max_dist = -std::numeric_limits<double>::infinity();
-
-            for (auto index = indices.begin(); index != indices.end(); ++index) {
-                const PointT& pt = cloud.points[*index];
-
-                /*  general:
-                 *
-                 *            / z
-                 *           /
-                 *          /
-                 *         +-------
-                 *         |      x
-                 *         |
-                 *         | y
-                 *
-                 *  for us:
-                 *
-                 *       z |  / x
-                 *         | /
-                 *         |/
-                 *  -------+
-                 *   y
-                 *
-                 */
-
-                //                double xx = pt.x;
-                //                double yy = pt.y;
-                //                double zz = pt.z;
-                double xx = -pt.y;
-                double yy = -pt.z;
-                double zz = pt.x;
-
-                double x = c_x_ + fov_x_ * xx / zz;
-                double y = c_y_ + fov_y_ * yy / zz;
-
-                if (y < min_y)
-                    min_y = y;
-                if (y > max_y)
-                    max_y = y;
-                if (x < min_x)
-                    min_x = x;
-                if (x > max_x)
-                    max_x = x;
-
-                if (pt.x > max_dist)
-                    max_dist = pt.x;
+        for (const Bounds& b : bounds) {
+            if (!b.valid()) {
+                // no point of this cluster could be placed in the image
+                if (classification_) {
+                    ++class_label;
+                }
+                if (labels_) {
+                    ++label;
+                }
+                continue;
             }
 
             RoiMessage roi;
             cv::Rect rect;
-            rect.x = min_x;
-            rect.y = min_y;
-            rect.width = max_x - min_x;
-            rect.height = max_y - min_y;
+            rect.x = b.min_x;
+            rect.y = b.min_y;
+            rect.width = b.max_x - b.min_x;
+            rect.height = b.max_y - b.min_y;
 
             if (flip_rois_) {
                 rect.y = h_ - rect.y - rect.height;
             }
 
             roi.value.setRect(rect);
-            roi.value.setColor(cv::Scalar(0, 0, max_dist / 10.0 * 255));
+            if (color_by_distance) {
+                roi.value.setColor(cv::Scalar(0, 0, b.max_dist / 10.0 * 255));
+            } else {
+                roi.value.setColor(cv::Scalar::all(0));
+            }
             if (classification_) {
                 roi.value.setClassification(*class_label);
                 roi.value.setColor(colors_[*class_label]);
@@ -298,16 +323,12 @@ public:
             }
             if (labels_) {
                 roi.value.setLabel(*label);
-
                 ++label;
             }
             out->push_back(roi);
         }
 
         msg::publish<GenericVectorMessage, RoiMessage>(output_rois_, out);
-
-        labels_.reset();
-        classification_.reset();
     }
 
 private:
@@ -315,6 +336,7 @@ private:
     Input* in_indices_;
     Input* in_labels_;
     Input* in_classification_;
+    Input* in_cluster_labels_;
     Output* output_rois_;
 
     double fov_x_;
@@ -331,6 +353,7 @@ private:
     //    bool use_classification_;
 
     std::shared_ptr<std::vector<pcl::PointIndices> const> clusters_;
+    ClusterLabels::ConstPtr cluster_labels_;
     std::shared_ptr<std::vector<std::string> const> labels_;
     std::shared_ptr<std::vector<int> const> classification_;
     std::map<int, cv::Scalar> colors_;
@@ -6,6 +6,7 @@
 #include <csapex/msg/generic_vector_message.hpp>
 #include <csapex/msg/io.h>
 #include <csapex/param/parameter_factory.h>
+#include <csapex_point_cloud/msg/cluster_labels_message.h>
 #include <csapex_point_cloud/msg/indices_message.h>
 
 /// SYSTEM
@@ -29,7 +30,15 @@ void LabelClusteredPointCloud::process()
 {
     PointCloudMessage::ConstPtr cloud(msg::getMessage<PointCloudMessage>(input_));
 
-    cluster_indices = msg::getMessage<GenericVectorMessage, pcl::PointIndices>(in_indices_);
+    cluster_labels_.reset();
+    cluster_indices.reset();
+    if (msg::hasMessage(in_cluster_labels_)) {
+        cluster_labels_ = msg::getMessage<ClusterLabelsMessage>(in_cluster_labels_)->value;
+    } else if (msg::hasMessage(in_indices_)) {
+        cluster_indices = msg::getMessage<GenericVectorMessage, pcl::PointIndices>(in_indices_);
+    } else {
+        throw std::runtime_error("either indices or cluster labels are required");
+    }
 
     boost::apply_visitor(PointCloudMessage::Dispatch<LabelClusteredPointCloud>(this, cloud), cloud->value);
 }
@@ -37,7 +46,8 @@ void LabelClusteredPointCloud::process()
 void LabelClusteredPointCloud::setup(NodeModifier& node_modifier)
 {
     input_ = node_modifier.addInput<PointCloudMessage>("PointCloud");
-    in_indices_ = node_modifier.addInput<GenericVectorMessage, pcl::PointIndices>("Indices");
+    in_indices_ = node_modifier.addOptionalInput<GenericVectorMessage, pcl::PointIndices>("Indices");
+    in_cluster_labels_ = node_modifier.addOptionalInput<ClusterLabelsMessage>("Cluster Labels");
     output_ = node_modifier.addOutput<PointCloudMessage>("Labeled PointCloud");
 }
 
@@ -71,21 +81,20 @@ struct Copy<pcl::PointXYZRGBL, pcl::PointXYZRGB>
 template <class PointT, class PointS>
 struct Impl
 {
-    inline static void label(const typename pcl::PointCloud<PointT>::ConstPtr src, typename pcl::PointCloud<PointS>::Ptr dst, const LabelClusteredPointCloud::Indices& indices)
+    inline static void label(const typename pcl::PointCloud<PointT>::ConstPtr src, typename pcl::PointCloud<PointS>::Ptr dst, const ClusterLabels& labels)
     {
         std::size_t n = src->points.size();
-        dst->points.resize(n);
-        for (std::size_t i = 0; i < n; ++i) {
-            Copy<PointS, PointT>::apply(src->points[i], dst->points[i]);
-            dst->points[i].label = 0;
+        if (labels.size() != n) {
+            throw std::runtime_error("the cluster labels were computed for a different cloud");
         }
 
-        int region = 1;
-        for (LabelClusteredPointCloud::Indices::const_iterator it = indices.begin(); it != indices.end(); ++it) {
-            for (std::vector<int>::const_iterator i = it->indices.begin(); i != it->indices.end(); ++i) {
-                dst->points[*i].label = region;
-            }
-            ++region;
+        dst->points.resize(n);
+        const PointT* src_points = src->points.data();
+        PointS* dst_points = dst->points.data();
+        const uint32_t* label = labels.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            Copy<PointS, PointT>::apply(src_points[i], dst_points[i]);
+            dst_points[i].label = label[i];
         }
     }
 };
@@ -93,14 +102,14 @@ struct Impl
 template <class PointT>
 struct Label
 {
-    static void apply(const typename pcl::PointCloud<PointT>::ConstPtr src, PointCloudMessage::Ptr& dst_msg, const LabelClusteredPointCloud::Indices& indices)
+    static void apply(const typename pcl::PointCloud<PointT>::ConstPtr src, PointCloudMessage::Ptr& dst_msg, const ClusterLabels& labels)
     {
         pcl::PointCloud<pcl::PointXYZL>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZL>);
         cloud->header = src->header;
         cloud->width = src->width;
         cloud->height = src->height;
         cloud->is_dense = src->is_dense;
-        Impl<PointT, pcl::PointXYZL>::label(src, cloud, indices);
+        Impl<PointT, pcl::PointXYZL>::label(src, cloud, labels);
         dst_msg->value = cloud;
     }
 };
@@ -108,10 +117,10 @@ struct Label
 template <>
 struct Label<pcl::PointXYZRGB>
 {
-    static void apply(const typename pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr src, PointCloudMessage::Ptr& dst_msg, const LabelClusteredPointCloud::Indices& indices)
+    static void apply(const typename pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr src, PointCloudMessage::Ptr& dst_msg, const ClusterLabels& labels)
     {
         pcl::PointCloud<pcl::PointXYZRGBL>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZRGBL>);
-        Impl<pcl::PointXYZRGB, pcl::PointXYZRGBL>::label(src, cloud, indices);
+        Impl<pcl::PointXYZRGB, pcl::PointXYZRGBL>::label(src, cloud, labels);
         cloud->header = src->header;
         cloud->width = src->width;
         cloud->height = src->height;
@@ -123,7 +132,7 @@ struct Label<pcl::PointXYZRGB>
 template <>
 struct Label<pcl::PointXY>
 {
-    static void apply(const typename pcl::PointCloud<pcl::PointXY>::ConstPtr src, PointCloudMessage::Ptr& dst_msg, const LabelClusteredPointCloud::Indices& indices)
+    static void apply(const typename pcl::PointCloud<pcl::PointXY>::ConstPtr src, PointCloudMessage::Ptr& dst_msg, const ClusterLabels& labels)
     {
         throw std::runtime_error("Pointcloud must be of type XYZ!");
     }
@@ -135,6 +144,13 @@ void LabelClusteredPointCloud::inputCloud(typename pcl::PointCloud<PointT>::Cons
 {
     PointCloudMessage::Ptr out(new PointCloudMessage(cloud->header.frame_id, cloud->header.stamp));
 
-    implementation::Label<PointT>::apply(cloud, out, *cluster_indices);
+    ClusterLabels::ConstPtr labels = cluster_labels_;
+    if (!labels) {
+        ClusterLabels::Ptr built(new ClusterLabels);
+        built->build(cloud->width, cloud->height, *cluster_indices);
+        labels = built;
+    }
+
+    implementation::Label<PointT>::apply(cloud, out, *labels);
     msg::publish(output_, out);
 }
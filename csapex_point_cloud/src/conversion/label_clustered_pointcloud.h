@@ -3,6 +3,7 @@
 
 /// PROJECT
 #include <csapex/model/node.h>
+#include <csapex_point_cloud/labels/cluster_labels.h>
 #include <csapex_point_cloud/msg/point_cloud_message.h>
 
 /// SYSTEM
@@ -35,9 +36,11 @@ public:
 protected:
     Input* input_;
     Input* in_indices_;
+    Input* in_cluster_labels_;
     Output* output_;
 
     IndicesPtr cluster_indices;
+    ClusterLabels::ConstPtr cluster_labels_;
 };
 }  // namespace csapex
 #endif  // LABEL_POINTCLOUD_H
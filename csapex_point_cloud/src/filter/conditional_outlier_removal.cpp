@@ -7,16 +7,86 @@
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_core_plugins/timestamp_message.h>
+#include <csapex_opencv/parallel.h>
+#include <csapex_point_cloud/msg/indices_message.h>
 
 /// SYSTEM
-#include <pcl/filters/conditional_removal.h>
 #include <pcl/point_types.h>
+#include <opencv2/core/core.hpp>
+#include <cmath>
+#include <limits>
 
 CSAPEX_REGISTER_CLASS(csapex::ConditionalOutlierRemoval, csapex::Node)
 
 using namespace csapex;
 using namespace csapex::connection_types;
 
+namespace
+{
+/**
+ * Each enabled axis contributes the comparisons min < v and v < max. AND requires
+ * all of them to hold, OR any of them, just like a pcl::ConditionAnd / ConditionOr
+ * with these field comparisons. Disabled axes are neutral, so the test is evaluated
+ * without branches.
+ */
+struct Condition
+{
+    bool conjunction;
+    bool enabled[3];
+    double min[3];
+    double max[3];
+
+    template <typename PointT>
+    inline bool operator()(const PointT& p) const
+    {
+        const double v[3] = { p.x, p.y, p.z };
+        bool all = true;
+        bool any = false;
+        for (int i = 0; i < 3; ++i) {
+            const bool gt = v[i] > min[i];
+            const bool lt = v[i] < max[i];
+            all &= !enabled[i] | (gt & lt);
+            any |= enabled[i] & (gt | lt);
+        }
+        return conjunction ? all : any;
+    }
+};
+
+template <typename PointT>
+inline bool isFinite(const PointT& p)
+{
+    return std::isfinite(p.x) & std::isfinite(p.y) & std::isfinite(p.z);
+}
+
+/// marks the finite points that fulfill the condition, chunk by chunk
+template <typename PointT>
+std::size_t evaluate(const pcl::PointCloud<PointT>& cloud, const Condition& condition, std::vector<uchar>& mask, std::vector<std::size_t>& chunk_counts)
+{
+    const std::size_t size = cloud.points.size();
+    mask.resize(size);
+    chunk_counts.assign(parallel::chunkCount(size), 0);
+    parallel::forEachChunk(size, [&](std::size_t c, std::size_t begin, std::size_t end) {
+        std::size_t count = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            const PointT& p = cloud.points[i];
+            const bool keep = isFinite(p) & condition(p);
+            mask[i] = keep;
+            count += keep;
+        }
+        chunk_counts[c] = count;
+    });
+
+    std::size_t total = 0;
+    for (std::size_t& count : chunk_counts) {
+        const std::size_t offset = total;
+        total += count;
+        count = offset;
+    }
+    return total;
+}
+
+}  // namespace
+
 ConditionalOutlierRemoval::ConditionalOutlierRemoval() : type_(AND), conditions_(0), x_range_(-30.0, 30.0), y_range_(-30.0, 30.0), z_range_(-30.0, 30.0), keep_organized_(false)
 {
 }
@@ -42,6 +112,7 @@ void ConditionalOutlierRemoval::setup(NodeModifier& node_modifier)
 {
     input_ = node_modifier.addInput<PointCloudMessage>("PointCloud");
     output_ = node_modifier.addOutput<PointCloudMessage>("Filtered Pointcloud");
+    output_indices_ = node_modifier.addOutput<PointIndicesMessage>("indices");
     update();
 }
 
@@ -54,46 +125,98 @@ void ConditionalOutlierRemoval::process()
 template <class PointT>
 void ConditionalOutlierRemoval::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud)
 {
+    const bool publish_cloud = msg::isConnected(output_);
+    const bool publish_indices = msg::isConnected(output_indices_);
+
+    const std::size_t size = cloud->points.size();
     typename pcl::PointCloud<PointT>::Ptr cloud_filtered;
+    PointIndicesMessage::Ptr indices_msg(new PointIndicesMessage);
+    indices_msg->value->header = cloud->header;
+    std::vector<int>& indices = indices_msg->value->indices;
+
     if (conditions_ != 0) {
-        typename pcl::ConditionBase<PointT>::Ptr condition;
-        switch (type_) {
-            case AND:
-                condition.reset(new pcl::ConditionAnd<PointT>);
-                break;
-            case OR:
-                condition.reset(new pcl::ConditionOr<PointT>);
-                break;
-            default:
-                std::runtime_error("Unknown condition type!");
-                break;
-        }
+        if (type_ != AND && type_ != OR)
+            throw std::runtime_error("Unknown condition type!");
 
-        if ((conditions_ & 1 & 3 & 5) == 1) {
-            condition->addComparison(typename pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("x", pcl::ComparisonOps::GT, x_range_.x())));
-            condition->addComparison(typename pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("x", pcl::ComparisonOps::LT, x_range_.y())));
+        Condition condition;
+        condition.conjunction = type_ == AND;
+        condition.enabled[0] = (conditions_ & 1 & 3 & 5) == 1;
+        condition.enabled[1] = (conditions_ & 2 & 3 & 6) == 2;
+        condition.enabled[2] = (conditions_ & 4 & 5 & 6) == 4;
+        for (int i = 0; i < 3; ++i) {
+            const Eigen::Vector2d& range = i == 0 ? x_range_ : (i == 1 ? y_range_ : z_range_);
+            condition.min[i] = range.x();
+            condition.max[i] = range.y();
         }
-        if ((conditions_ & 2 & 3 & 6) == 2) {
-            condition->addComparison(typename pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("y", pcl::ComparisonOps::GT, y_range_.x())));
-            condition->addComparison(typename pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("y", pcl::ComparisonOps::LT, y_range_.y())));
+
+        std::vector<uchar> mask;
+        std::vector<std::size_t> offsets;
+        const std::size_t kept = evaluate(*cloud, condition, mask, offsets);
+
+        if (publish_cloud) {
+            if (keep_organized_) {
+                cloud_filtered.reset(new pcl::PointCloud<PointT>(*cloud));
+                const float nan = std::numeric_limits<float>::quiet_NaN();
+                parallel::forEachChunk(size, [&](std::size_t, std::size_t begin, std::size_t end) {
+                    for (std::size_t i = begin; i < end; ++i) {
+                        if (!mask[i]) {
+                            PointT& p = cloud_filtered->points[i];
+                            p.x = nan;
+                            p.y = nan;
+                            p.z = nan;
+                        }
+                    }
+                });
+                cloud_filtered->is_dense = cloud->is_dense && kept == size;
+            } else {
+                cloud_filtered.reset(new pcl::PointCloud<PointT>);
+                cloud_filtered->header = cloud->header;
+                cloud_filtered->points.resize(kept);
+                parallel::forEachChunk(size, [&](std::size_t c, std::size_t begin, std::size_t end) {
+                    std::size_t j = offsets[c];
+                    for (std::size_t i = begin; i < end; ++i) {
+                        if (mask[i]) {
+                            cloud_filtered->points[j++] = cloud->points[i];
+                        }
+                    }
+                });
+                cloud_filtered->width = kept;
+                cloud_filtered->height = 1;
+                cloud_filtered->is_dense = true;
+            }
         }
-        if ((conditions_ & 4 & 5 & 6) == 4) {
-            condition->addComparison(typename pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("z", pcl::ComparisonOps::GT, z_range_.x())));
-            condition->addComparison(typename pcl::FieldComparison<PointT>::ConstPtr(new pcl::FieldComparison<PointT>("z", pcl::ComparisonOps::LT, z_range_.y())));
+
+        if (publish_indices) {
+            indices.resize(kept);
+            parallel::forEachChunk(size, [&](std::size_t c, std::size_t begin, std::size_t end) {
+                std::size_t j = offsets[c];
+                for (std::size_t i = begin; i < end; ++i) {
+                    if (mask[i]) {
+                        indices[j++] = static_cast<int>(i);
+                    }
+                }
+            });
         }
-        cloud_filtered.reset(new pcl::PointCloud<PointT>);
-        pcl::ConditionalRemoval<PointT> cr;
-        cr.setCondition(condition);
-        cr.setInputCloud(cloud);
-        cr.setKeepOrganized(keep_organized_);
-        cr.filter(*cloud_filtered);
     } else {
-        cloud_filtered.reset(new pcl::PointCloud<PointT>(*cloud));
+        if (publish_cloud) {
+            cloud_filtered.reset(new pcl::PointCloud<PointT>(*cloud));
+        }
+        if (publish_indices) {
+            indices.resize(size);
+            for (std::size_t i = 0; i < size; ++i) {
+                indices[i] = static_cast<int>(i);
+            }
+        }
     }
 
-    PointCloudMessage::Ptr out(new PointCloudMessage(cloud->header.frame_id, cloud->header.stamp));
-    out->value = cloud_filtered;
-    msg::publish(output_, out);
+    if (publish_cloud) {
+        PointCloudMessage::Ptr out(new PointCloudMessage(cloud->header.frame_id, cloud->header.stamp));
+        out->value = cloud_filtered;
+        msg::publish(output_, out);
+    }
+    if (publish_indices) {
+        msg::publish(output_indices_, indices_msg);
+    }
 }
 
 void ConditionalOutlierRemoval::update()
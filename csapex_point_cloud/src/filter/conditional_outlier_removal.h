@@ -31,6 +31,7 @@ private:
 
     Input* input_;
     Output* output_;
+    Output* output_indices_;
 
     void update();
 
@@ -7,6 +7,7 @@
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_point_cloud/msg/indices_message.h>
+#include <csapex_point_cloud/msg/spatial_index_message.h>
 #include <csapex/msg/any_message.h>
 #include <csapex/msg/generic_vector_message.hpp>
 
@@ -17,6 +18,7 @@
 #include <pcl/point_types.h>
 #include <csapex/utility/suppress_warnings_end.h>
 // clang-format on
+#include <limits>
 
 CSAPEX_REGISTER_CLASS(csapex::RadiusOutlierRemoval, csapex::Node)
 
@@ -39,6 +41,7 @@ void RadiusOutlierRemoval::setup(NodeModifier& node_modifier)
 {
     input_cloud_ = node_modifier.addInput<PointCloudMessage>("PointCloud");
     indices_input_ = node_modifier.addOptionalMultiInput<PointIndicesMessage, GenericVectorMessage>("indices");
+    input_index_ = node_modifier.addOptionalInput<SpatialIndexMessage>("search index");
     output_cloud_ = node_modifier.addOutput<PointCloudMessage>("Pointcloud");
     output_indices_ = node_modifier.addOutput<AnyMessage>("indices");
 }
@@ -59,6 +62,15 @@ void RadiusOutlierRemoval::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr
     if (!indices_out && !cloud_out)
         return;
 
+    if (msg::hasMessage(input_index_)) {
+        SpatialIndex::ConstPtr index = msg::getMessage<SpatialIndexMessage>(input_index_)->value;
+        if (!index || !index->matches(*cloud)) {
+            throw std::runtime_error("the spatial index was built for a different cloud");
+        }
+        filterWithIndex<PointT>(cloud, *index, cloud_out, indices_out);
+        return;
+    }
+
     int min_neighbours_ = readParameter<int>("min neighbours");
     bool keep_organized_ = readParameter<bool>("keep organized");
     bool negative_ = readParameter<bool>("negate");
@@ -131,3 +143,112 @@ void RadiusOutlierRemoval::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr
         msg::publish(output_cloud_, out);
     }
 }
+
+template <class PointT>
+void RadiusOutlierRemoval::filterWithIndex(typename pcl::PointCloud<PointT>::ConstPtr cloud, const SpatialIndex& index, bool cloud_out, bool indices_out)
+{
+    const int min_neighbours = readParameter<int>("min neighbours");
+    const bool keep_organized = readParameter<bool>("keep organized");
+    const bool negative = readParameter<bool>("negate");
+    const double search_radius = readParameter<double>("search radius");
+
+    // the search stops as soon as the point itself and min_neighbours others are found
+    std::vector<int> neighbours;
+    std::vector<float> sqr_distances;
+    auto filter = [&](const std::vector<int>* subset, std::vector<int>& kept) {
+        const std::size_t n = subset ? subset->size() : cloud->points.size();
+        for (std::size_t k = 0; k < n; ++k) {
+            const int i = subset ? (*subset)[k] : static_cast<int>(k);
+            const PointT& pt = cloud->points[i];
+            if (!std::isfinite(pt.x) || !std::isfinite(pt.y) || !std::isfinite(pt.z)) {
+                continue;
+            }
+            const bool enough = index.radiusSearch(pt.getVector3fMap(), search_radius, neighbours, sqr_distances, min_neighbours + 1) > min_neighbours;
+            if (enough != negative) {
+                kept.push_back(i);
+            }
+        }
+    };
+
+    auto publishCloud = [&](const std::vector<int>* subset, const std::vector<int>& kept) {
+        typename pcl::PointCloud<PointT>::Ptr cloud_filtered(new pcl::PointCloud<PointT>);
+        if (keep_organized) {
+            // points of the subset that are not kept become NaN, all others are unchanged
+            *cloud_filtered = *cloud;
+            std::vector<bool> keep(cloud->points.size(), subset != nullptr);
+            if (subset) {
+                for (int i : *subset) {
+                    keep[i] = false;
+                }
+            }
+            for (int i : kept) {
+                keep[i] = true;
+            }
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            for (std::size_t i = 0; i < keep.size(); ++i) {
+                if (!keep[i]) {
+                    PointT& pt = cloud_filtered->points[i];
+                    pt.x = pt.y = pt.z = nan;
+                }
+            }
+            cloud_filtered->is_dense = false;
+        } else {
+            cloud_filtered->reserve(kept.size());
+            for (int i : kept) {
+                cloud_filtered->push_back(cloud->points[i]);
+            }
+        }
+        cloud_filtered->header = cloud->header;
+
+        PointCloudMessage::Ptr out(new PointCloudMessage(cloud->header.frame_id, cloud->header.stamp));
+        out->value = cloud_filtered;
+        msg::publish(output_cloud_, out);
+    };
+
+    if (!msg::hasMessage(indices_input_)) {
+        std::vector<int> kept;
+        filter(nullptr, kept);
+        if (cloud_out) {
+            publishCloud(nullptr, kept);
+        }
+        if (indices_out) {
+            PointIndicesMessage::Ptr indices_filtered(new PointIndicesMessage);
+            indices_filtered->value->header = cloud->header;
+            indices_filtered->value->indices = kept;
+            msg::publish(output_indices_, indices_filtered);
+        }
+
+    } else if (msg::isMessage<PointIndicesMessage>(indices_input_)) {
+        PointIndicesMessage::ConstPtr indices = msg::getMessage<PointIndicesMessage>(indices_input_);
+        PointIndicesMessage::Ptr indices_filtered(new PointIndicesMessage);
+        indices_filtered->value->header = cloud->header;
+        filter(&indices->value->indices, indices_filtered->value->indices);
+        if (cloud_out) {
+            publishCloud(&indices->value->indices, indices_filtered->value->indices);
+        }
+        if (indices_out) {
+            msg::publish(output_indices_, indices_filtered);
+        }
+
+    } else {
+        GenericVectorMessage::ConstPtr message = msg::getMessage<GenericVectorMessage>(indices_input_);
+        apex_assert(std::dynamic_pointer_cast<GenericPointerMessage<pcl::PointIndices> const>(message->nestedType()));
+        std::shared_ptr<std::vector<pcl::PointIndices>> out_ind(new std::vector<pcl::PointIndices>(message->nestedValueCount()));
+        std::vector<int> all_subsets;
+        std::vector<int> all_kept;
+        for (std::size_t i = 0; i < message->nestedValueCount(); ++i) {
+            auto val = std::dynamic_pointer_cast<GenericPointerMessage<pcl::PointIndices> const>(message->nestedValue(i));
+            pcl::PointIndices& kept = out_ind->at(i);
+            kept.header = val->value->header;
+            filter(&val->value->indices, kept.indices);
+            all_subsets.insert(all_subsets.end(), val->value->indices.begin(), val->value->indices.end());
+            all_kept.insert(all_kept.end(), kept.indices.begin(), kept.indices.end());
+        }
+        if (cloud_out) {
+            publishCloud(&all_subsets, all_kept);
+        }
+        if (indices_out) {
+            msg::publish<GenericVectorMessage, pcl::PointIndices>(output_indices_, out_ind);
+        }
+    }
+}
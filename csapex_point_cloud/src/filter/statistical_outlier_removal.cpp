@@ -7,6 +7,7 @@
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_point_cloud/msg/indices_message.h>
+#include <csapex_point_cloud/msg/spatial_index_message.h>
 
 /// SYSTEM
 // clang-format off
@@ -15,6 +16,8 @@
 #include <pcl/point_types.h>
 #include <csapex/utility/suppress_warnings_end.h>
 // clang-format on
+#include <cmath>
+#include <limits>
 
 CSAPEX_REGISTER_CLASS(csapex::StatisticalOutlierRemoval, csapex::Node)
 
@@ -37,6 +40,7 @@ void StatisticalOutlierRemoval::setup(NodeModifier& node_modifier)
 {
     input_cloud_ = node_modifier.addInput<PointCloudMessage>("PointCloud");
     input_indices_ = node_modifier.addOptionalInput<PointIndicesMessage>("indices");
+    input_index_ = node_modifier.addOptionalInput<SpatialIndexMessage>("search index");
     output_cloud_ = node_modifier.addOutput<PointCloudMessage>("Pointcloud");
     output_indices_ = node_modifier.addOutput<PointIndicesMessage>("indices");
 }
@@ -56,6 +60,15 @@ void StatisticalOutlierRemoval::inputCloud(typename pcl::PointCloud<PointT>::Con
     if (!indices_out && !cloud_out)
         return;
 
+    if (msg::hasMessage(input_index_)) {
+        SpatialIndex::ConstPtr index = msg::getMessage<SpatialIndexMessage>(input_index_)->value;
+        if (!index || !index->matches(*cloud)) {
+            throw std::runtime_error("the spatial index was built for a different cloud");
+        }
+        filterWithIndex<PointT>(cloud, *index, cloud_out, indices_out);
+        return;
+    }
+
     int mean_k = readParameter<int>("mean k");
     bool keep_organized = readParameter<bool>("keep organized");
     bool negative = readParameter<bool>("negate");
@@ -85,3 +98,96 @@ void StatisticalOutlierRemoval::inputCloud(typename pcl::PointCloud<PointT>::Con
         msg::publish(output_indices_, indices_filtered);
     }
 }
+
+template <class PointT>
+void StatisticalOutlierRemoval::filterWithIndex(typename pcl::PointCloud<PointT>::ConstPtr cloud, const SpatialIndex& index, bool cloud_out, bool indices_out)
+{
+    const int mean_k = readParameter<int>("mean k");
+    const bool keep_organized = readParameter<bool>("keep organized");
+    const bool negative = readParameter<bool>("negate");
+    const double std_dev_mul_thresh = readParameter<double>("std dev threshold");
+
+    std::vector<int> subset;
+    if (msg::hasMessage(input_indices_)) {
+        subset = msg::getMessage<PointIndicesMessage>(input_indices_)->value->indices;
+    } else {
+        subset.resize(cloud->points.size());
+        for (std::size_t i = 0; i < subset.size(); ++i) {
+            subset[i] = static_cast<int>(i);
+        }
+    }
+
+    // mean distance to the mean_k nearest neighbours, the first result is the point itself
+    std::vector<double> distances(subset.size(), -1.0);
+    std::vector<int> neighbours;
+    std::vector<float> sqr_distances;
+    double sum = 0.0;
+    double sq_sum = 0.0;
+    int valid = 0;
+    for (std::size_t k = 0; k < subset.size(); ++k) {
+        const PointT& pt = cloud->points[subset[k]];
+        if (!std::isfinite(pt.x) || !std::isfinite(pt.y) || !std::isfinite(pt.z)) {
+            continue;
+        }
+        const int found = index.nearestKSearch(pt.getVector3fMap(), mean_k + 1, neighbours, sqr_distances);
+        if (found < 2) {
+            continue;
+        }
+        double distance = 0.0;
+        for (int j = 1; j < found; ++j) {
+            distance += std::sqrt(sqr_distances[j]);
+        }
+        distance /= (found - 1);
+
+        distances[k] = distance;
+        sum += distance;
+        sq_sum += distance * distance;
+        ++valid;
+    }
+
+    const double mean = valid > 0 ? sum / valid : 0.0;
+    const double variance = valid > 1 ? (sq_sum - sum * sum / valid) / (valid - 1) : 0.0;
+    const double threshold = mean + std_dev_mul_thresh * std::sqrt(std::max(0.0, variance));
+
+    std::vector<int> kept;
+    std::vector<bool> removed(cloud->points.size(), false);
+    for (std::size_t k = 0; k < subset.size(); ++k) {
+        const bool inlier = distances[k] >= 0.0 && distances[k] <= threshold;
+        if (distances[k] >= 0.0 && inlier != negative) {
+            kept.push_back(subset[k]);
+        } else {
+            removed[subset[k]] = true;
+        }
+    }
+
+    if (cloud_out) {
+        typename pcl::PointCloud<PointT>::Ptr cloud_filtered(new pcl::PointCloud<PointT>);
+        if (keep_organized) {
+            *cloud_filtered = *cloud;
+            const float nan = std::numeric_limits<float>::quiet_NaN();
+            for (std::size_t i = 0; i < removed.size(); ++i) {
+                if (removed[i]) {
+                    PointT& pt = cloud_filtered->points[i];
+                    pt.x = pt.y = pt.z = nan;
+                }
+            }
+            cloud_filtered->is_dense = false;
+        } else {
+            cloud_filtered->reserve(kept.size());
+            for (int i : kept) {
+                cloud_filtered->push_back(cloud->points[i]);
+            }
+        }
+        cloud_filtered->header = cloud->header;
+
+        PointCloudMessage::Ptr out(new PointCloudMessage(cloud->header.frame_id, cloud->header.stamp));
+        out->value = cloud_filtered;
+        msg::publish(output_cloud_, out);
+    }
+    if (indices_out) {
+        PointIndicesMessage::Ptr indices_filtered(new PointIndicesMessage);
+        indices_filtered->value->header = cloud->header;
+        indices_filtered->value->indices = kept;
+        msg::publish(output_indices_, indices_filtered);
+    }
+}
@@ -4,6 +4,7 @@
 /// PROJECT
 #include <csapex/model/node.h>
 #include <csapex_point_cloud/msg/point_cloud_message.h>
+#include <csapex_point_cloud/search/spatial_index.h>
 
 namespace csapex
 {
@@ -19,9 +20,14 @@ public:
     template <class PointT>
     void inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud);
 
+protected:
+    template <class PointT>
+    void filterWithIndex(typename pcl::PointCloud<PointT>::ConstPtr cloud, const SpatialIndex& index, bool cloud_out, bool indices_out);
+
 protected:
     Input* input_cloud_;
     Input* input_indices_;
+    Input* input_index_;
     Output* output_cloud_;
     Output* output_indices_;
 };
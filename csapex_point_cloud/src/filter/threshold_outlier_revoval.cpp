@@ -8,9 +8,22 @@
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_core_plugins/timestamp_message.h>
 #include <csapex_opencv/cv_mat_message.h>
+#include <csapex_opencv/parallel.h>
+#include <csapex_point_cloud/msg/indices_message.h>
 
 /// SYSTEM
 #include <pcl/point_types.h>
+#include <opencv2/core/core.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 CSAPEX_REGISTER_CLASS(csapex::ThresholdOutlierRemoval, csapex::Node)
 
@@ -19,159 +32,311 @@ using namespace csapex::connection_types;
 
 namespace
 {
-template <typename Any>
-class PointTraits
-{
-    typedef char Small;
-    class Big
-    {
-        char dummy[2];
-    };
-
-    template <typename Class>
-    static Small testx(__typeof__(&Class::x));
-    template <typename Class>
-    static Big testx(...);
-
-    template <typename Class>
-    static Small testy(__typeof__(&Class::y));
-    template <typename Class>
-    static Big testy(...);
-
-    template <typename Class>
-    static Small testz(__typeof__(&Class::z));
-    template <typename Class>
-    static Big testz(...);
-
-public:
-    enum
-    {
-        HasX = sizeof(testx<Any>(0)) == sizeof(Small)
-    };
-    enum
-    {
-        HasY = sizeof(testy<Any>(0)) == sizeof(Small)
-    };
-    enum
-    {
-        HasZ = sizeof(testz<Any>(0)) == sizeof(Small)
-    };
-    enum
-    {
-        HasXY = HasX && HasY && !HasZ
-    };
-    enum
-    {
-        HasXYZ = HasX && HasY && HasZ
-    };
-};
+/// number of rows handled by one parallel task
+const int BAND_ROWS = 16;
 
-template <typename PointT>
-inline static void add(const PointT& p1, PointT& p2, typename std::enable_if<PointTraits<PointT>::HasXY, PointT>::type* dummy = 0)
-{
-    p2.x += p1.x;
-    p2.y += p1.y;
-}
+/// offsets of the 8 neighbours, in the order their values are summed up
+const int XS[] = { -1, -1, -1, 0, 1, 1, 1, 0 };
+const int YS[] = { -1, 0, 1, 1, 1, 0, -1, -1 };
 
-template <typename PointT>
-inline static void add(const PointT& p1, PointT& p2, typename std::enable_if<PointTraits<PointT>::HasXYZ, PointT>::type* dummy = 0)
+/// calls function(y0, y1) for bands of rows in parallel
+template <typename Function>
+void forEachBand(int rows, const Function& function)
 {
-    p2.x += p1.x;
-    p2.y += p1.y;
-    p2.z += p1.z;
+    const int bands = (rows + BAND_ROWS - 1) / BAND_ROWS;
+    parallel::forRange(bands, [&](const cv::Range& range) {
+        for (int b = range.start; b < range.end; ++b) {
+            const int y0 = b * BAND_ROWS;
+            function(y0, std::min(rows, y0 + BAND_ROWS));
+        }
+    });
 }
 
-template <typename PointT, typename T>
-inline static void divide(const T scalar, PointT& p1, typename std::enable_if<PointTraits<PointT>::HasXY, PointT>::type* dummy = 0)
+/// the x, y and z coordinates of the cloud rows [y0, y1) in separate planes
+struct CoordinatePlanes
 {
-    p1.x /= scalar;
-    p1.y /= scalar;
-}
+    template <typename PointT>
+    void load(const PointT* src_ptr, const int cols, const int y0, const int y1)
+    {
+        this->cols = cols;
+        this->y0 = y0;
+
+        const std::size_t size = static_cast<std::size_t>(y1 - y0) * cols;
+        x.resize(size);
+        y.resize(size);
+        z.resize(size);
+
+        const PointT* src = src_ptr + static_cast<std::size_t>(y0) * cols;
+        for (std::size_t i = 0; i < size; ++i) {
+            x[i] = src[i].x;
+            y[i] = src[i].y;
+            z[i] = src[i].z;
+        }
+    }
 
-template <typename PointT, typename T>
-inline static void divide(const T scalar, PointT& p1, typename std::enable_if<PointTraits<PointT>::HasXYZ, PointT>::type* dummy = 0)
-{
-    p1.x /= scalar;
-    p1.y /= scalar;
-    p1.z /= scalar;
-}
+    const float* row(const std::vector<float>& plane, const int y) const
+    {
+        return plane.data() + static_cast<std::size_t>(y - y0) * cols;
+    }
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    int cols;
+    int y0;
+};
 
-template <typename PointT, typename T>
-inline static T distance(const PointT& p1, const PointT& p2, typename std::enable_if<PointTraits<PointT>::HasXY, PointT>::type* dummy = 0)
+#ifdef __SSE2__
+/// zero extends 4 thresholds to 32 bit
+inline __m128i loadThresholds(const uchar* th)
 {
-    T diffx = p1.x - p2.x;
-    T diffy = p1.y - p2.y;
-    return std::sqrt(diffx * diffx + diffy * diffy);
+    int32_t packed;
+    std::memcpy(&packed, th, sizeof(packed));
+    const __m128i zero = _mm_setzero_si128();
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
 }
-
-template <typename PointT, typename T>
-inline static T distance(const PointT& p1, const PointT& p2, typename std::enable_if<PointTraits<PointT>::HasXYZ, PointT>::type* dummy = 0)
+#endif
+
+/**
+ * Interpolates the interior pixels [1, cols - 1) of the middle row of xs, ys, zs and th_rows into out_x, out_y, out_z.
+ * Every pixel is computed regardless of its own threshold, the caller selects the results by the threshold mask.
+ * Neighbours are masked without branches, NaN neighbours fail the distance comparison.
+ */
+void interpolateInteriorRow(const float* const xs[3], const float* const ys[3], const float* const zs[3], const uchar* const th_rows[3], const int cols, const uchar threshold,
+                            const float max_distance_sqr, float* out_x, float* out_y, float* out_z)
 {
-    T diffx = p1.x - p2.x;
-    T diffy = p1.y - p2.y;
-    T diffz = p1.z - p2.z;
-    return std::sqrt(diffx * diffx + diffy * diffy + diffz * diffz);
+    const int end = cols - 1;
+    int x = 1;
+#ifdef __SSE2__
+    const __m128 v_max_distance_sqr = _mm_set1_ps(max_distance_sqr);
+    const __m128i v_threshold = _mm_set1_epi32(threshold);
+    const __m128 v_one = _mm_set1_ps(1.f);
+    for (; x + 4 <= end; x += 4) {
+        const __m128 px = _mm_loadu_ps(xs[1] + x);
+        const __m128 py = _mm_loadu_ps(ys[1] + x);
+        const __m128 pz = _mm_loadu_ps(zs[1] + x);
+
+        __m128 sx = _mm_setzero_ps(), sy = _mm_setzero_ps(), sz = _mm_setzero_ps(), normalizer = _mm_setzero_ps();
+        for (int i = 0; i < 8; ++i) {
+            const int r = 1 + YS[i];
+            const int c = x + XS[i];
+            const __m128 nx = _mm_loadu_ps(xs[r] + c);
+            const __m128 ny = _mm_loadu_ps(ys[r] + c);
+            const __m128 nz = _mm_loadu_ps(zs[r] + c);
+            const __m128 dx = _mm_sub_ps(nx, px);
+            const __m128 dy = _mm_sub_ps(ny, py);
+            const __m128 dz = _mm_sub_ps(nz, pz);
+            const __m128 distance_sqr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            const __m128 above = _mm_castsi128_ps(_mm_cmpgt_epi32(loadThresholds(th_rows[r] + c), v_threshold));
+            const __m128 valid = _mm_andnot_ps(above, _mm_cmple_ps(distance_sqr, v_max_distance_sqr));
+            sx = _mm_add_ps(sx, _mm_and_ps(valid, nx));
+            sy = _mm_add_ps(sy, _mm_and_ps(valid, ny));
+            sz = _mm_add_ps(sz, _mm_and_ps(valid, nz));
+            normalizer = _mm_add_ps(normalizer, _mm_and_ps(valid, v_one));
+        }
+        _mm_storeu_ps(out_x + x, _mm_div_ps(sx, normalizer));
+        _mm_storeu_ps(out_y + x, _mm_div_ps(sy, normalizer));
+        _mm_storeu_ps(out_z + x, _mm_div_ps(sz, normalizer));
+    }
+#endif
+    for (; x < end; ++x) {
+        const float px = xs[1][x];
+        const float py = ys[1][x];
+        const float pz = zs[1][x];
+
+        float sx = 0.f, sy = 0.f, sz = 0.f, normalizer = 0.f;
+        for (int i = 0; i < 8; ++i) {
+            const int r = 1 + YS[i];
+            const int c = x + XS[i];
+            const float nx = xs[r][c];
+            const float ny = ys[r][c];
+            const float nz = zs[r][c];
+            const float dx = nx - px;
+            const float dy = ny - py;
+            const float dz = nz - pz;
+            const bool valid = (th_rows[r][c] <= threshold) & (dx * dx + dy * dy + dz * dz <= max_distance_sqr);
+            sx += valid ? nx : 0.f;
+            sy += valid ? ny : 0.f;
+            sz += valid ? nz : 0.f;
+            normalizer += valid ? 1.f : 0.f;
+        }
+        out_x[x] = sx / normalizer;
+        out_y[x] = sy / normalizer;
+        out_z[x] = sz / normalizer;
+    }
 }
 
 template <typename PointT>
 struct ThresholdNoiseFilter
 {
+    /// a neighbour n of p is used if it is below the threshold and close enough, NaN neighbours never are
+    inline static bool accept(const PointT& p, const PointT& n, const uchar threshold_n, const uchar threshold, const float max_distance_sqr)
+    {
+        const float dx = n.x - p.x;
+        const float dy = n.y - p.y;
+        const float dz = n.z - p.z;
+        return (threshold_n <= threshold) & (dx * dx + dy * dy + dz * dz <= max_distance_sqr);
+    }
+
+    inline static PointT point(const float x, const float y, const float z)
+    {
+        PointT p;
+        p.x = x;
+        p.y = y;
+        p.z = z;
+        return p;
+    }
+
+    inline static PointT interpolateBorder(const PointT* src_ptr, const cv::Mat& thresholds, const int x, const int y, const uchar threshold, const float max_distance_sqr)
+    {
+        const int cols = thresholds.cols;
+        const int rows = thresholds.rows;
+        const PointT& p = src_ptr[y * cols + x];
+        float sx = 0.f, sy = 0.f, sz = 0.f, normalizer = 0.f;
+        for (int i = 0; i < 8; ++i) {
+            const int posx = x + XS[i];
+            const int posy = y + YS[i];
+            if (posx > -1 && posx < cols && posy > -1 && posy < rows) {
+                const PointT& n = src_ptr[posy * cols + posx];
+                if (accept(p, n, thresholds.ptr<uchar>(posy)[posx], threshold, max_distance_sqr)) {
+                    sx += n.x;
+                    sy += n.y;
+                    sz += n.z;
+                    normalizer += 1.f;
+                }
+            }
+        }
+        return point(sx / normalizer, sy / normalizer, sz / normalizer);
+    }
+
+    /// replaces the points above the threshold by the mean of their close neighbours below it
     inline static void interpolate(const typename pcl::PointCloud<PointT>::ConstPtr& src, const cv::Mat& thresholds, const uchar threshold, const double max_distance,
                                    typename pcl::PointCloud<PointT>::Ptr& dst)
     {
-        static int xs[] = { -1, -1, -1, 0, 1, 1, 1, 0 };
-        static int ys[] = { -1, 0, 1, 1, 1, 0, -1, -1 };
-
         dst.reset(new pcl::PointCloud<PointT>(*src));
 
         const PointT* src_ptr = src->points.data();
         PointT* dst_ptr = dst->points.data();
-        const uchar* th_ptr = thresholds.ptr<uchar>();
-
-        int cols = src->width;
-        int rows = src->height;
-
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                int pos = y * cols + x;
-                if (th_ptr[pos] > threshold) {
-                    double normalizer = 0;
-                    PointT inter_value;
-                    for (int i = 0; i < 8; ++i) {
-                        int posx = x + xs[i];
-                        int posy = y + ys[i];
-                        if (posx > -1 && posx < cols && posy > -1 && posy < rows) {
-                            int npos = posy * cols + posx;
-                            if (th_ptr[npos] <= threshold && distance<PointT, double>(src_ptr[npos], src_ptr[pos]) <= max_distance) {
-                                add(src_ptr[npos], inter_value);
-                                normalizer += 1.0;
-                            }
+
+        const int cols = src->width;
+        const int rows = src->height;
+        const float max_distance_sqr = static_cast<float>(max_distance * max_distance);
+
+        forEachBand(rows, [&](int y0, int y1) {
+            // the band and its neighbouring rows as planes, so the interior loop reads contiguous floats
+            CoordinatePlanes planes;
+            planes.load(src_ptr, cols, std::max(0, y0 - 1), std::min(rows, y1 + 1));
+
+            std::vector<float> out_x(cols), out_y(cols), out_z(cols);
+
+            for (int y = y0; y < y1; ++y) {
+                const uchar* th_row = thresholds.ptr<uchar>(y);
+                PointT* dst_row = dst_ptr + y * cols;
+
+                if (y == 0 || y == rows - 1) {
+                    for (int x = 0; x < cols; ++x) {
+                        if (th_row[x] > threshold) {
+                            dst_row[x] = interpolateBorder(src_ptr, thresholds, x, y, threshold, max_distance_sqr);
                         }
                     }
-                    divide(normalizer, inter_value);
-                    dst_ptr[pos] = inter_value;
+                    continue;
+                }
+
+                const float* const xs[3] = { planes.row(planes.x, y - 1), planes.row(planes.x, y), planes.row(planes.x, y + 1) };
+                const float* const ys[3] = { planes.row(planes.y, y - 1), planes.row(planes.y, y), planes.row(planes.y, y + 1) };
+                const float* const zs[3] = { planes.row(planes.z, y - 1), planes.row(planes.z, y), planes.row(planes.z, y + 1) };
+                const uchar* const th_rows[3] = { thresholds.ptr<uchar>(y - 1), th_row, thresholds.ptr<uchar>(y + 1) };
+
+                if (th_row[0] > threshold) {
+                    dst_row[0] = interpolateBorder(src_ptr, thresholds, 0, y, threshold, max_distance_sqr);
+                }
+
+                interpolateInteriorRow(xs, ys, zs, th_rows, cols, threshold, max_distance_sqr, out_x.data(), out_y.data(), out_z.data());
+
+                // replaced points are reset like at the border, only x, y and z are interpolated
+                const int last = cols - 1;
+                for (int x = 1; x < last; ++x) {
+                    if (th_row[x] > threshold) {
+                        dst_row[x] = point(out_x[x], out_y[x], out_z[x]);
+                    }
+                }
+
+                if (last > 0 && th_row[last] > threshold) {
+                    dst_row[last] = interpolateBorder(src_ptr, thresholds, last, y, threshold, max_distance_sqr);
                 }
             }
-        }
+        });
     }
 
-    inline static void filter(const typename pcl::PointCloud<PointT>::ConstPtr& src, const cv::Mat& thresholds, const uchar threshold, typename pcl::PointCloud<PointT>::Ptr& dst)
+    /// resets the points above the threshold, either to PointT() or to NaN coordinates
+    inline static void filter(const typename pcl::PointCloud<PointT>::ConstPtr& src, const cv::Mat& thresholds, const uchar threshold, const bool removed_as_nan,
+                              typename pcl::PointCloud<PointT>::Ptr& dst)
     {
         dst.reset(new pcl::PointCloud<PointT>(*src));
 
         PointT* dst_ptr = dst->points.data();
-        const uchar* th_ptr = thresholds.ptr<uchar>();
 
-        int cols = src->width;
-        int rows = src->height;
+        const int cols = src->width;
+        const int rows = src->height;
+
+        PointT removed;
+        if (removed_as_nan) {
+            removed.x = removed.y = removed.z = std::numeric_limits<float>::quiet_NaN();
+        }
+
+        forEachBand(rows, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                const uchar* th_row = thresholds.ptr<uchar>(y);
+                PointT* dst_row = dst_ptr + y * cols;
+                for (int x = 0; x < cols; ++x) {
+                    if (th_row[x] > threshold) {
+                        if (removed_as_nan) {
+                            dst_row[x].x = removed.x;
+                            dst_row[x].y = removed.y;
+                            dst_row[x].z = removed.z;
+                        } else {
+                            dst_row[x] = removed;
+                        }
+                    }
+                }
+            }
+        });
+
+        if (removed_as_nan) {
+            dst->is_dense = false;
+        }
+    }
 
-        for (int y = 0; y < rows; ++y) {
-            for (int x = 0; x < cols; ++x) {
-                int pos = y * cols + x;
-                if (th_ptr[pos] > threshold) {
-                    dst_ptr[pos] = PointT();
+    /// collects the points at or below the threshold without touching the cloud
+    inline static void indices(const cv::Mat& thresholds, const uchar threshold, std::vector<int>& indices)
+    {
+        const int cols = thresholds.cols;
+        const int rows = thresholds.rows;
+        const int bands = (rows + BAND_ROWS - 1) / BAND_ROWS;
+
+        std::vector<std::vector<int>> band_indices(bands);
+        forEachBand(rows, [&](int y0, int y1) {
+            std::vector<int>& local = band_indices[y0 / BAND_ROWS];
+            local.resize((y1 - y0) * cols);
+            std::size_t count = 0;
+            for (int y = y0; y < y1; ++y) {
+                const uchar* th_row = thresholds.ptr<uchar>(y);
+                const int row_begin = y * cols;
+                for (int x = 0; x < cols; ++x) {
+                    local[count] = row_begin + x;
+                    count += th_row[x] <= threshold;
                 }
             }
+            local.resize(count);
+        });
+
+        std::size_t size = 0;
+        for (const std::vector<int>& local : band_indices) {
+            size += local.size();
+        }
+        indices.reserve(size);
+        for (const std::vector<int>& local : band_indices) {
+            indices.insert(indices.end(), local.begin(), local.end());
         }
     }
 };
@@ -186,6 +351,10 @@ void ThresholdOutlierRemoval::setupParameters(Parameterizable& parameters)
     parameters.addParameter(csapex::param::factory::declareRange("threshold", 0, 255, 255, 1));
     parameters.addParameter(csapex::param::factory::declareRange("max. distance", 0.0, 10.0, 0.25, 0.01));
     parameters.addParameter(csapex::param::factory::declareBool("interpolate", false));
+    parameters.addParameter(csapex::param::factory::declareBool("removed as NaN",
+                                                                csapex::param::ParameterDescription("Mark removed points with NaN coordinates instead of resetting them, "
+                                                                                                    "ignored if interpolating"),
+                                                                false));
 }
 
 void ThresholdOutlierRemoval::setup(NodeModifier& node_modifier)
@@ -193,6 +362,7 @@ void ThresholdOutlierRemoval::setup(NodeModifier& node_modifier)
     input_ = node_modifier.addInput<PointCloudMessage>("PointCloud");
     thresholds_ = node_modifier.addInput<CvMatMessage>("Thresholds");
     output_ = node_modifier.addOutput<PointCloudMessage>("Filtered Pointcloud");
+    output_indices_ = node_modifier.addOutput<PointIndicesMessage>("indices");
 }
 
 void ThresholdOutlierRemoval::process()
@@ -208,6 +378,7 @@ void ThresholdOutlierRemoval::inputCloud(typename pcl::PointCloud<PointT>::Const
     uchar threshold = readParameter<int>("threshold");
     double max_dist = readParameter<double>("max. distance");
     bool interpolate = readParameter<bool>("interpolate");
+    bool removed_as_nan = readParameter<bool>("removed as NaN");
 
     if (thresholds->value.rows != (int)cloud->height)
         throw std::runtime_error("Height of pointcloud and threshold matrix not matching!");
@@ -216,14 +387,23 @@ void ThresholdOutlierRemoval::inputCloud(typename pcl::PointCloud<PointT>::Const
     if (!thresholds->hasChannels(1, CV_8U))
         throw std::runtime_error("Threshold matrix type must be 'mono'!");
 
-    typename pcl::PointCloud<PointT>::Ptr cloud_filtered;
+    if (msg::isConnected(output_)) {
+        typename pcl::PointCloud<PointT>::Ptr cloud_filtered;
+
+        if (interpolate)
+            ThresholdNoiseFilter<PointT>::interpolate(cloud, thresholds->value, threshold, max_dist, cloud_filtered);
+        else
+            ThresholdNoiseFilter<PointT>::filter(cloud, thresholds->value, threshold, removed_as_nan, cloud_filtered);
 
-    if (interpolate)
-        ThresholdNoiseFilter<PointT>::interpolate(cloud, thresholds->value, threshold, max_dist, cloud_filtered);
-    else
-        ThresholdNoiseFilter<PointT>::filter(cloud, thresholds->value, threshold, cloud_filtered);
+        PointCloudMessage::Ptr out(new PointCloudMessage(cloud->header.frame_id, cloud->header.stamp));
+        out->value = cloud_filtered;
+        msg::publish(output_, out);
+    }
 
-    PointCloudMessage::Ptr out(new PointCloudMessage(cloud->header.frame_id, cloud->header.stamp));
-    out->value = cloud_filtered;
-    msg::publish(output_, out);
+    if (msg::isConnected(output_indices_)) {
+        PointIndicesMessage::Ptr out(new PointIndicesMessage);
+        out->value->header = cloud->header;
+        ThresholdNoiseFilter<PointT>::indices(thresholds->value, threshold, out->value->indices);
+        msg::publish(output_indices_, out);
+    }
 }
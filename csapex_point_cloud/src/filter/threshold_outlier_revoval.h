@@ -23,6 +23,7 @@ private:
     Input* input_;
     Input* thresholds_;
     Output* output_;
+    Output* output_indices_;
 };
 }  // namespace csapex
 #endif  // STATISTICAL_OUTLIER_REMOVAL_H
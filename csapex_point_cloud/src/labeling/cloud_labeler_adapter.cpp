@@ -228,7 +228,7 @@ std::pair<QVector3D, QVector3D> CloudLabelerAdapter::calculateRay(const QPointF&
     QVector3D v = QVector3D::crossProduct(h, view).normalized();
 
     double vLength = std::tan((fov_v_ * M_PI / 180.0) / 2) * near_;
-    double hLength = vLength * (w_view_ / h_view_);
+    double hLength = vLength * (w_view_ / static_cast<double>(h_view_));
 
     v *= vLength;
     h *= hLength;
@@ -236,11 +236,11 @@ std::pair<QVector3D, QVector3D> CloudLabelerAdapter::calculateRay(const QPointF&
     double x = cursor.x();
     double y = h_view_ - cursor.y();
 
-    x -= w_view_ / 2;
-    y -= h_view_ / 2;
+    x -= w_view_ / 2.0;
+    y -= h_view_ / 2.0;
 
-    x /= (w_view_ / 2);
-    y /= (h_view_ / 2);
+    x /= (w_view_ / 2.0);
+    y /= (h_view_ / 2.0);
 
     QVector3D pos = eye + view * near_ + (h * x + v * y);
     QVector3D dir = (pos - eye).normalized();
@@ -249,6 +249,18 @@ std::pair<QVector3D, QVector3D> CloudLabelerAdapter::calculateRay(const QPointF&
     return ray;
 }
 
+PickingIndex::Camera CloudLabelerAdapter::pickingCamera() const
+{
+    PickingIndex::Camera camera;
+    camera.eye = Eigen::Vector3f(eye.x(), eye.y(), eye.z());
+    camera.look_at = Eigen::Vector3f(look_at_pt.x(), look_at_pt.y(), look_at_pt.z());
+    camera.up = Eigen::Vector3f(up.x(), up.y(), up.z());
+    camera.fov_v = fov_v_;
+    camera.width = w_view_;
+    camera.height = h_view_;
+    return camera;
+}
+
 void CloudLabelerAdapter::paintGLImpl(bool request)
 {
     auto n = wrapped_.lock();
@@ -403,14 +415,18 @@ void CloudLabelerAdapter::labelPoint()
     int label = node->readParameter<int>("label");
     radius_ = node->readParameter<double>("radius");
 
-    for (pcl::PointXYZL& pt : labeled_->points) {
-        QVector3D v(pt.x, pt.y, pt.z);
-        if (v.distanceToPoint(selection_3d_cursor_) < radius_) {
-            pt.label = label;
-        }
+    picking_.sphere(Eigen::Vector3f(selection_3d_cursor_.x(), selection_3d_cursor_.y(), selection_3d_cursor_.z()), radius_, picked_);
+
+    bool changed = false;
+    for (int i : picked_) {
+        pcl::PointXYZL& pt = labeled_->points[i];
+        changed |= pt.label != static_cast<uint32_t>(label);
+        pt.label = label;
     }
 
-    drawPoints();
+    if (changed) {
+        drawPoints();
+    }
 
     repaintRequest();
 }
@@ -444,29 +460,12 @@ void CloudLabelerAdapter::labelArea()
     selection_c_ = calculateRay(bl);
     selection_d_ = calculateRay(br);
 
-    QVector3D n_ab = QVector3D::crossProduct(selection_a_.second, selection_b_.second);
-    QVector3D n_bd = QVector3D::crossProduct(selection_b_.second, selection_d_.second);
-    ;
-    QVector3D n_dc = QVector3D::crossProduct(selection_d_.second, selection_c_.second);
-    ;
-    QVector3D n_ca = QVector3D::crossProduct(selection_c_.second, selection_a_.second);
-    ;
-
-    QVector3D normals[]{ n_ab, n_bd, n_dc, n_ca };
-
-    for (pcl::PointXYZL& pt : labeled_->points) {
-        QVector3D v(pt.x, pt.y, pt.z);
-        bool inside = true;
-        for (const QVector3D& n : normals) {
-            double dot = QVector3D::dotProduct(n, v - eye);
-            if (dot < 0) {
-                inside = false;
-                break;
-            }
-        }
-        if (inside) {
-            pt.label = label;
-        }
+    // the frustum spanned by the rays is the rectangle in view coordinates
+    picking_.setCamera(pickingCamera());
+    picking_.rectangle(minx, miny, maxx, maxy, picked_);
+
+    for (int i : picked_) {
+        labeled_->points[i].label = label;
     }
 
     drawPoints();
@@ -595,16 +594,8 @@ void CloudLabelerAdapter::mouseMoveEventImpl(QGraphicsSceneMouseEvent* event)
 
     double closest_dist = std::numeric_limits<double>::infinity();
 
-    for (pcl::PointXYZL& pt : labeled_->points) {
-        QVector3D v(pt.x, pt.y, pt.z);
-        QVector3D ve = v - eye;
-        double dist = v.distanceToLine(eye, ray.second);
-        if (dist < 0.05) {
-            if (ve.length() < closest_dist) {
-                closest_dist = ve.length();
-            }
-        }
-    }
+    picking_.setCamera(pickingCamera());
+    picking_.closestOnRay(cursor_.x(), cursor_.y(), Eigen::Vector3f(ray.second.x(), ray.second.y(), ray.second.z()), 0.05, closest_dist);
 
     selection_3d_cursor_ = eye + ray.second * closest_dist;
 
@@ -782,6 +773,7 @@ void CloudLabelerAdapter::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr
 
         ++pt_label;
     }
+    picking_.setCloud(labeled_);
 
     makeCurrent();
 
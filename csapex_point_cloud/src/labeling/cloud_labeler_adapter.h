@@ -6,6 +6,7 @@
 
 /// COMPONENT
 #include "cloud_labeler.h"
+#include "picking_index.h"
 
 /// SYSTEM
 #include <QGLFramebufferObject>
@@ -49,6 +50,7 @@ protected:
     bool eventFilter(QObject*, QEvent*);
 
     std::pair<QVector3D, QVector3D> calculateRay(const QPointF& cursor);
+    PickingIndex::Camera pickingCamera() const;
 
     void drawPoints();
 
@@ -144,6 +146,9 @@ protected:
     std::pair<QVector3D, QVector3D> selection_d_;
 
     QVector3D selection_eye_;
+
+    PickingIndex picking_;
+    std::vector<int> picked_;
 };
 
 }  // namespace csapex
@@ -0,0 +1,255 @@
+/// HEADER
+#include "picking_index.h"
+
+/// SYSTEM
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace csapex;
+
+namespace
+{
+const int SCREEN_CELL = 16;
+
+/// bound for the pixel distance of a point near the ray, relative to tube / depth, valid for rays up to 45 degrees off the optical axis
+const double OBLIQUE_FACTOR = 2.0;
+
+int cellCoordinate(float v, double cell)
+{
+    return static_cast<int>(std::floor(v / cell));
+}
+
+int clampedCell(double v, int cells)
+{
+    return static_cast<int>(std::max(0.0, std::min(cells - 1.0, std::floor(v / SCREEN_CELL))));
+}
+
+}  // namespace
+
+bool PickingIndex::Camera::operator==(const Camera& other) const
+{
+    return eye == other.eye && look_at == other.look_at && up == other.up && fov_v == other.fov_v && width == other.width && height == other.height;
+}
+
+PickingIndex::PickingIndex() : voxel_size_(0.0), screen_valid_(false), focal_(1.0), cols_(0), rows_(0)
+{
+}
+
+void PickingIndex::setCloud(const pcl::PointCloud<pcl::PointXYZL>::ConstPtr& cloud)
+{
+    cloud_ = cloud;
+    voxel_size_ = 0.0;
+    voxels_.clear();
+    voxel_points_.clear();
+    screen_valid_ = false;
+}
+
+void PickingIndex::setCamera(const Camera& camera)
+{
+    if (!screen_valid_ || !(camera == camera_)) {
+        camera_ = camera;
+        screen_valid_ = false;
+    }
+}
+
+int64_t PickingIndex::voxelKey(int x, int y, int z) const
+{
+    // 21 bits per axis
+    const uint64_t mask = (uint64_t(1) << 21) - 1;
+    return static_cast<int64_t>(((static_cast<uint64_t>(x) & mask) << 42) | ((static_cast<uint64_t>(y) & mask) << 21) | (static_cast<uint64_t>(z) & mask));
+}
+
+void PickingIndex::buildVoxels(double cell)
+{
+    voxel_size_ = cell;
+    voxels_.clear();
+
+    const std::size_t n = cloud_->points.size();
+    std::vector<std::pair<int64_t, int>> keyed;
+    keyed.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        const pcl::PointXYZL& pt = cloud_->points[i];
+        if (std::isfinite(pt.x) && std::isfinite(pt.y) && std::isfinite(pt.z)) {
+            keyed.emplace_back(voxelKey(cellCoordinate(pt.x, cell), cellCoordinate(pt.y, cell), cellCoordinate(pt.z, cell)), static_cast<int>(i));
+        }
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    voxel_points_.resize(keyed.size());
+    for (std::size_t i = 0; i < keyed.size();) {
+        std::size_t j = i;
+        while (j < keyed.size() && keyed[j].first == keyed[i].first) {
+            voxel_points_[j] = keyed[j].second;
+            ++j;
+        }
+        voxels_[keyed[i].first] = std::make_pair(static_cast<int>(i), static_cast<int>(j));
+        i = j;
+    }
+}
+
+void PickingIndex::sphere(const Eigen::Vector3f& center, double radius, std::vector<int>& indices)
+{
+    indices.clear();
+    if (!cloud_ || radius <= 0.0) {
+        return;
+    }
+    if (voxel_size_ <= 0.0 || radius > 2.0 * voxel_size_ || radius < 0.5 * voxel_size_) {
+        buildVoxels(radius);
+    }
+
+    const float radius_sqr = static_cast<float>(radius * radius);
+    const int x0 = cellCoordinate(center.x() - radius, voxel_size_);
+    const int x1 = cellCoordinate(center.x() + radius, voxel_size_);
+    const int y0 = cellCoordinate(center.y() - radius, voxel_size_);
+    const int y1 = cellCoordinate(center.y() + radius, voxel_size_);
+    const int z0 = cellCoordinate(center.z() - radius, voxel_size_);
+    const int z1 = cellCoordinate(center.z() + radius, voxel_size_);
+
+    for (int x = x0; x <= x1; ++x) {
+        for (int y = y0; y <= y1; ++y) {
+            for (int z = z0; z <= z1; ++z) {
+                auto pos = voxels_.find(voxelKey(x, y, z));
+                if (pos == voxels_.end()) {
+                    continue;
+                }
+                for (int k = pos->second.first; k < pos->second.second; ++k) {
+                    const int i = voxel_points_[k];
+                    if ((cloud_->points[i].getVector3fMap() - center).squaredNorm() < radius_sqr) {
+                        indices.push_back(i);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void PickingIndex::buildScreen()
+{
+    screen_valid_ = true;
+
+    // same camera as CloudLabelerAdapter::calculateRay
+    forward_ = (camera_.look_at - camera_.eye).normalized();
+    right_ = forward_.cross(camera_.up).normalized();
+    upward_ = right_.cross(forward_).normalized();
+    focal_ = (camera_.height / 2.0) / std::tan((camera_.fov_v * M_PI / 180.0) / 2.0);
+
+    cols_ = std::max(1, static_cast<int>(std::ceil(camera_.width / SCREEN_CELL)));
+    rows_ = std::max(1, static_cast<int>(std::ceil(camera_.height / SCREEN_CELL)));
+
+    const std::size_t n = cloud_->points.size();
+    screen_x_.resize(n);
+    screen_y_.resize(n);
+    depth_.resize(n);
+
+    // counting sort of the points in front of the camera into the cells, the border cells extend to infinity
+    std::vector<int> cell_of(n, -1);
+    cell_offsets_.assign(cols_ * rows_ + 1, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        const Eigen::Vector3f d = cloud_->points[i].getVector3fMap() - camera_.eye;
+        const float z = d.dot(forward_);
+        depth_[i] = z;
+        if (!(z > 0.f)) {
+            continue;
+        }
+        const float x = static_cast<float>(camera_.width / 2.0 + focal_ * d.dot(right_) / z);
+        const float y = static_cast<float>(camera_.height / 2.0 - focal_ * d.dot(upward_) / z);
+        screen_x_[i] = x;
+        screen_y_[i] = y;
+        const int cell = clampedCell(y, rows_) * cols_ + clampedCell(x, cols_);
+        cell_of[i] = cell;
+        ++cell_offsets_[cell + 1];
+    }
+    for (int c = 0; c < cols_ * rows_; ++c) {
+        cell_offsets_[c + 1] += cell_offsets_[c];
+    }
+
+    cell_points_.resize(cell_offsets_.back());
+    std::vector<int> fill(cell_offsets_.begin(), cell_offsets_.end() - 1);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (cell_of[i] >= 0) {
+            cell_points_[fill[cell_of[i]]++] = static_cast<int>(i);
+        }
+    }
+
+    for (int c = 0; c < cols_ * rows_; ++c) {
+        std::sort(cell_points_.begin() + cell_offsets_[c], cell_points_.begin() + cell_offsets_[c + 1], [this](int a, int b) { return depth_[a] < depth_[b]; });
+    }
+}
+
+void PickingIndex::rectangle(double min_x, double min_y, double max_x, double max_y, std::vector<int>& indices)
+{
+    indices.clear();
+    if (!cloud_) {
+        return;
+    }
+    if (!screen_valid_) {
+        buildScreen();
+    }
+
+    const int c0 = clampedCell(min_x, cols_);
+    const int c1 = clampedCell(max_x, cols_);
+    const int r0 = clampedCell(min_y, rows_);
+    const int r1 = clampedCell(max_y, rows_);
+
+    for (int r = r0; r <= r1; ++r) {
+        for (int c = c0; c <= c1; ++c) {
+            const int cell = r * cols_ + c;
+            for (int k = cell_offsets_[cell]; k < cell_offsets_[cell + 1]; ++k) {
+                const int i = cell_points_[k];
+                if (screen_x_[i] >= min_x && screen_x_[i] <= max_x && screen_y_[i] >= min_y && screen_y_[i] <= max_y) {
+                    indices.push_back(i);
+                }
+            }
+        }
+    }
+}
+
+bool PickingIndex::closestOnRay(double cursor_x, double cursor_y, const Eigen::Vector3f& direction, double tube, double& distance)
+{
+    if (!cloud_) {
+        return false;
+    }
+    if (!screen_valid_) {
+        buildScreen();
+    }
+
+    const float tube_sqr = static_cast<float>(tube * tube);
+    double best = std::numeric_limits<double>::infinity();
+
+    for (int r = 0; r < rows_; ++r) {
+        for (int c = 0; c < cols_; ++c) {
+            // pixel distance between the cursor and the cell
+            const double left = c == 0 ? -std::numeric_limits<double>::infinity() : c * SCREEN_CELL;
+            const double right = c == cols_ - 1 ? std::numeric_limits<double>::infinity() : (c + 1) * SCREEN_CELL;
+            const double top = r == 0 ? -std::numeric_limits<double>::infinity() : r * SCREEN_CELL;
+            const double bottom = r == rows_ - 1 ? std::numeric_limits<double>::infinity() : (r + 1) * SCREEN_CELL;
+            const double dx = std::max(0.0, std::max(left - cursor_x, cursor_x - right));
+            const double dy = std::max(0.0, std::max(top - cursor_y, cursor_y - bottom));
+            const double pixels = std::sqrt(dx * dx + dy * dy);
+
+            const int cell = r * cols_ + c;
+            for (int k = cell_offsets_[cell]; k < cell_offsets_[cell + 1]; ++k) {
+                const int i = cell_points_[k];
+                const double z = depth_[i];
+                // the points are sorted by depth: farther ones can neither be closer nor project close enough
+                if (z >= best || pixels * z > OBLIQUE_FACTOR * focal_ * tube) {
+                    break;
+                }
+
+                const Eigen::Vector3f d = cloud_->points[i].getVector3fMap() - camera_.eye;
+                const float along = d.dot(direction);
+                if (d.squaredNorm() - along * along < tube_sqr) {
+                    best = std::min(best, static_cast<double>(d.norm()));
+                }
+            }
+        }
+    }
+
+    if (best == std::numeric_limits<double>::infinity()) {
+        return false;
+    }
+    distance = best;
+    return true;
+}
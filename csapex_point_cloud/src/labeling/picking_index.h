@@ -0,0 +1,99 @@
+#ifndef PICKING_INDEX_H
+#define PICKING_INDEX_H
+
+/// SYSTEM
+// clang-format off
+#include <csapex/utility/suppress_warnings_start.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+#include <csapex/utility/suppress_warnings_end.h>
+// clang-format on
+#include <Eigen/Core>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The PickingIndex class answers the selection queries of the CloudLabelerAdapter.
+ *
+ * Two structures are kept for the point positions of the labeled cloud:
+ * - a voxel hash with the brush radius as cell size for sphere queries, rebuilt
+ *   if the radius changes by more than a factor of two,
+ * - a grid over the projected points in view coordinates, rebuilt whenever the
+ *   camera changes. Each cell holds its points sorted by depth, points outside
+ *   of the view are kept in the border cells.
+ *
+ * The queries only visit the cells touched by the selection, so their cost
+ * depends on the number of selected points rather than the cloud size.
+ * Labels may change between queries, positions may not.
+ */
+class PickingIndex
+{
+public:
+    struct Camera
+    {
+        Eigen::Vector3f eye;
+        Eigen::Vector3f look_at;
+        Eigen::Vector3f up;
+        /// vertical field of view in degrees
+        double fov_v;
+        double width;
+        double height;
+
+        bool operator==(const Camera& other) const;
+    };
+
+public:
+    PickingIndex();
+
+    void setCloud(const pcl::PointCloud<pcl::PointXYZL>::ConstPtr& cloud);
+    void setCamera(const Camera& camera);
+
+    /// all points closer than radius to center
+    void sphere(const Eigen::Vector3f& center, double radius, std::vector<int>& indices);
+    /// all points in front of the camera that project into the rectangle, in view coordinates
+    void rectangle(double min_x, double min_y, double max_x, double max_y, std::vector<int>& indices);
+    /**
+     * @brief closestOnRay finds the point closest to the eye whose distance to the ray is below tube.
+     * @param cursor the ray through this position in view coordinates
+     * @param direction the normalized direction of that ray
+     * @param distance distance between the eye and the found point
+     * @return false if no point is close enough to the ray
+     */
+    bool closestOnRay(double cursor_x, double cursor_y, const Eigen::Vector3f& direction, double tube, double& distance);
+
+private:
+    void buildVoxels(double cell);
+    void buildScreen();
+    int64_t voxelKey(int x, int y, int z) const;
+
+private:
+    pcl::PointCloud<pcl::PointXYZL>::ConstPtr cloud_;
+
+    // voxel hash, the points of a voxel are voxel_points_[range.first ... range.second - 1]
+    double voxel_size_;
+    std::vector<int> voxel_points_;
+    std::unordered_map<int64_t, std::pair<int, int>> voxels_;
+
+    // screen grid
+    Camera camera_;
+    bool screen_valid_;
+    Eigen::Vector3f forward_;
+    Eigen::Vector3f right_;
+    Eigen::Vector3f upward_;
+    /// pixels per unit at depth one
+    double focal_;
+    int cols_;
+    int rows_;
+    std::vector<float> screen_x_;
+    std::vector<float> screen_y_;
+    std::vector<float> depth_;
+    std::vector<int> cell_offsets_;
+    std::vector<int> cell_points_;
+};
+
+}  // namespace csapex
+
+#endif  // PICKING_INDEX_H
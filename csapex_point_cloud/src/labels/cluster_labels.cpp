@@ -0,0 +1,64 @@
+/// HEADER
+#include <csapex_point_cloud/labels/cluster_labels.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <stdexcept>
+
+using namespace csapex;
+
+const uint32_t ClusterLabels::UNLABELED;
+
+ClusterLabels::ClusterLabels() : width_(0), height_(0), cluster_count_(0), overlapping_(false)
+{
+}
+
+void ClusterLabels::build(std::size_t width, std::size_t height, const std::vector<pcl::PointIndices>& clusters)
+{
+    width_ = width;
+    height_ = height;
+    cluster_count_ = clusters.size();
+    overlapping_ = false;
+
+    const std::size_t n = width * height;
+    labels_.assign(n, UNLABELED);
+
+    uint32_t label = 1;
+    for (const pcl::PointIndices& cluster : clusters) {
+        for (int i : cluster.indices) {
+            if (i < 0 || static_cast<std::size_t>(i) >= n) {
+                throw std::runtime_error("cluster index out of range of the cloud");
+            }
+            if (labels_[i] != UNLABELED && labels_[i] != label) {
+                overlapping_ = true;
+            }
+            labels_[i] = label;
+        }
+        ++label;
+    }
+}
+
+std::size_t ClusterLabels::width() const
+{
+    return width_;
+}
+
+std::size_t ClusterLabels::height() const
+{
+    return height_;
+}
+
+std::size_t ClusterLabels::size() const
+{
+    return labels_.size();
+}
+
+std::size_t ClusterLabels::clusterCount() const
+{
+    return cluster_count_;
+}
+
+bool ClusterLabels::overlapping() const
+{
+    return overlapping_;
+}
@@ -0,0 +1,45 @@
+/// HEADER
+#include <csapex_point_cloud/msg/cluster_labels_message.h>
+
+/// PROJECT
+#include <csapex/utility/register_msg.h>
+
+CSAPEX_REGISTER_MESSAGE(csapex::connection_types::ClusterLabelsMessage)
+
+using namespace csapex;
+using namespace connection_types;
+
+ClusterLabelsMessage::ClusterLabelsMessage(const std::string& frame_id, Message::Stamp stamp) : Message(type<ClusterLabelsMessage>::name(), frame_id, stamp)
+{
+}
+
+ClusterLabelsMessage::ClusterLabelsMessage() : Message(type<ClusterLabelsMessage>::name(), "/", 0)
+{
+}
+
+std::string ClusterLabelsMessage::descriptiveName() const
+{
+    return Message::descriptiveName();
+}
+
+bool ClusterLabelsMessage::acceptsConnectionFrom(const TokenData* other_side) const
+{
+    return dynamic_cast<const ClusterLabelsMessage*>(other_side);
+}
+
+/// YAML
+namespace YAML
+{
+Node convert<csapex::connection_types::ClusterLabelsMessage>::encode(const csapex::connection_types::ClusterLabelsMessage& rhs)
+{
+    return convert<csapex::connection_types::Message>::encode(rhs);
+}
+
+bool convert<csapex::connection_types::ClusterLabelsMessage>::decode(const Node& node, csapex::connection_types::ClusterLabelsMessage& rhs)
+{
+    if (!node.IsMap()) {
+        return false;
+    }
+    return convert<csapex::connection_types::Message>::decode(node, rhs);
+}
+}  // namespace YAML
@@ -0,0 +1,45 @@
+/// HEADER
+#include <csapex_point_cloud/msg/spatial_index_message.h>
+
+/// PROJECT
+#include <csapex/utility/register_msg.h>
+
+CSAPEX_REGISTER_MESSAGE(csapex::connection_types::SpatialIndexMessage)
+
+using namespace csapex;
+using namespace connection_types;
+
+SpatialIndexMessage::SpatialIndexMessage(const std::string& frame_id, Message::Stamp stamp) : Message(type<SpatialIndexMessage>::name(), frame_id, stamp)
+{
+}
+
+SpatialIndexMessage::SpatialIndexMessage() : Message(type<SpatialIndexMessage>::name(), "/", 0)
+{
+}
+
+std::string SpatialIndexMessage::descriptiveName() const
+{
+    return Message::descriptiveName();
+}
+
+bool SpatialIndexMessage::acceptsConnectionFrom(const TokenData* other_side) const
+{
+    return dynamic_cast<const SpatialIndexMessage*>(other_side);
+}
+
+/// YAML
+namespace YAML
+{
+Node convert<csapex::connection_types::SpatialIndexMessage>::encode(const csapex::connection_types::SpatialIndexMessage& rhs)
+{
+    return convert<csapex::connection_types::Message>::encode(rhs);
+}
+
+bool convert<csapex::connection_types::SpatialIndexMessage>::decode(const Node& node, csapex::connection_types::SpatialIndexMessage& rhs)
+{
+    if (!node.IsMap()) {
+        return false;
+    }
+    return convert<csapex::connection_types::Message>::decode(node, rhs);
+}
+}  // namespace YAML
@@ -0,0 +1,54 @@
+/// HEADER
+#include "build_spatial_index.h"
+
+/// PROJECT
+#include <csapex/model/node_modifier.h>
+#include <csapex/msg/io.h>
+#include <csapex/param/parameter_factory.h>
+#include <csapex/utility/register_apex_plugin.h>
+#include <csapex_point_cloud/msg/spatial_index_message.h>
+
+CSAPEX_REGISTER_CLASS(csapex::BuildSpatialIndex, csapex::Node)
+
+using namespace csapex;
+using namespace csapex::connection_types;
+
+BuildSpatialIndex::BuildSpatialIndex()
+{
+}
+
+void BuildSpatialIndex::setupParameters(Parameterizable& parameters)
+{
+    std::map<std::string, int> types{ { "k-d tree", (int)SpatialIndex::Type::KD_TREE }, { "voxel hash", (int)SpatialIndex::Type::VOXEL_HASH } };
+    parameters.addParameter(param::factory::declareParameterSet("type", types, (int)SpatialIndex::Type::KD_TREE), type_);
+    parameters.addConditionalParameter(param::factory::declareRange("voxel size",
+                                                                    param::ParameterDescription("Edge length of the voxels, "
+                                                                                                "should be close to the search radius of the consumers"),
+                                                                    0.005, 2.0, 0.1, 0.005),
+                                       [this]() { return type_ == (int)SpatialIndex::Type::VOXEL_HASH; }, voxel_size_);
+}
+
+void BuildSpatialIndex::setup(NodeModifier& node_modifier)
+{
+    input_cloud_ = node_modifier.addInput<PointCloudMessage>("PointCloud");
+
+    output_ = node_modifier.addOutput<SpatialIndexMessage>("search index");
+}
+
+void BuildSpatialIndex::process()
+{
+    PointCloudMessage::ConstPtr msg(msg::getMessage<PointCloudMessage>(input_cloud_));
+
+    boost::apply_visitor(PointCloudMessage::Dispatch<BuildSpatialIndex>(this, msg), msg->value);
+}
+
+template <class PointT>
+void BuildSpatialIndex::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud)
+{
+    SpatialIndex::Ptr index(new SpatialIndex(static_cast<SpatialIndex::Type>(type_), voxel_size_));
+    index->build(cloud);
+
+    SpatialIndexMessage::Ptr out(new SpatialIndexMessage(cloud->header.frame_id, cloud->header.stamp));
+    out->value = index;
+    msg::publish(output_, out);
+}
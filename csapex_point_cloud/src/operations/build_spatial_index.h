@@ -0,0 +1,32 @@
+#ifndef BUILD_SPATIAL_INDEX_H
+#define BUILD_SPATIAL_INDEX_H
+
+/// PROJECT
+#include <csapex/model/node.h>
+#include <csapex_point_cloud/msg/point_cloud_message.h>
+
+namespace csapex
+{
+class BuildSpatialIndex : public Node
+{
+public:
+    BuildSpatialIndex();
+
+    virtual void setup(csapex::NodeModifier& node_modifier) override;
+    virtual void setupParameters(Parameterizable& parameters) override;
+    virtual void process() override;
+
+    template <class PointT>
+    void inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud);
+
+private:
+    Input* input_cloud_;
+    Output* output_;
+
+    int type_;
+    double voxel_size_;
+};
+
+}  // namespace csapex
+
+#endif  // BUILD_SPATIAL_INDEX_H
@@ -6,7 +6,16 @@
 #include <csapex/model/node_modifier.h>
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex/msg/generic_value_message.hpp>
+#include <csapex_opencv/parallel.h>
 #include <csapex_point_cloud/msg/point_cloud_message.h>
+#include <csapex_point_cloud/math/distribution.hpp>
+#include <csapex_point_cloud/math/mahalanobis.hpp>
+
+/// SYSTEM
+#include <array>
+#include <cmath>
+#include <opencv2/core/core.hpp>
+#include <vector>
 using namespace csapex;
 using namespace csapex::connection_types;
 
@@ -65,13 +74,8 @@ public:
     {
         double dist = 0;
         if(first_ || has_cloud2_){
-            if(first_){
-                std::size_t dim = getDim<PointT>(cloud);
-                mean_ = Eigen::VectorXd::Zero(dim);
-                covariance_ = Eigen::MatrixXd::Zero(dim, dim);
-            }
             if(!hold_){
-                getMeanAndCov<PointT>(cloud, mean_,covariance_);
+                updateReference<PointT>(cloud);
             }
             hold_ = first_ && hold_first_;
             if(first_ && !has_cloud2_){
@@ -86,136 +90,67 @@ public:
         dist = getDistance<PointT>(cloud);
         dist /= cloud->points.size();
         if(!hold_){
-            getMeanAndCov<PointT>(cloud, mean_,covariance_);
+            updateReference<PointT>(cloud);
         }
         msg::publish(out_, dist);
 
     }
 
     template <class PointT>
-    double getDistance(typename pcl::PointCloud<PointT>::ConstPtr cloud) const
+    double getDistance(typename pcl::PointCloud<PointT>::ConstPtr cloud)
     {
-        std::size_t N = cloud->points.size();
-        Eigen::MatrixXd S = covariance_.inverse();
+        const std::size_t N = splitCoordinates<PointT>(cloud);
+        std::vector<double> sums(parallel::chunkCount(N), 0.0);
+        parallel::forEachChunk(N, [&](std::size_t c, std::size_t begin, std::size_t end) { sums[c] = reference_.sumOfSquaredDistances(coordinates(begin), end - begin); });
+
         double d2 = 0;
-        for (std::size_t i = 0; i < N; ++i) {
-            const PointT& pt = cloud->points[i];
-            Eigen::VectorXd p = getEigenVector<PointT>(pt);
-            Eigen::MatrixXd diff = p - mean_;
-            Eigen::Matrix<double, 1,1 > scalar =  (diff.transpose() * S * diff).eval();
-            d2 += scalar(0);
+        for (double sum : sums) {
+            d2 += sum;
         }
         return std::sqrt(d2);
     }
 
+    /// mean and covariance of the cloud, accumulated as partial distributions of chunks that are merged in order
     template <class PointT>
-    void getMeanAndCov(typename pcl::PointCloud<PointT>::ConstPtr cloud, Eigen::VectorXd& mean, Eigen::MatrixXd& cov) const
+    void updateReference(typename pcl::PointCloud<PointT>::ConstPtr cloud)
     {
-        std::size_t N = cloud->points.size();
-        mean = Eigen::VectorXd::Zero(3);
-        cov = Eigen::MatrixXd::Zero(3,3);
+        const std::size_t N = splitCoordinates<PointT>(cloud);
+        std::vector<math::Distribution<3>, Eigen::aligned_allocator<math::Distribution<3>>> partial(parallel::chunkCount(N));
+        parallel::forEachChunk(N, [&](std::size_t c, std::size_t begin, std::size_t end) { partial[c].add(coordinates(begin), end - begin); });
 
-        for (std::size_t i = 0; i < N; ++i) {
-            const PointT& pt = cloud->points[i];
-            Eigen::VectorXd p = getEigenVector<PointT>(pt);
-            mean += p;
+        math::Distribution<3> distribution;
+        for (const math::Distribution<3>& d : partial) {
+            distribution += d;
         }
-        mean /= N;
 
-        for (std::size_t i = 0; i < N; ++i) {
-            PointT pt = cloud->points[i];
-            Eigen::VectorXd p = getEigenVector<PointT>(pt);
-            Eigen::VectorXd diff = p - mean;
-            Eigen::MatrixXd cov_i = (diff * diff.transpose().eval()).eval();
-            cov += cov_i;
+        // the reference has always been the population covariance
+        math::Distribution<3>::MatrixType covariance = distribution.getCovariance();
+        if (N > 1) {
+            covariance *= (N - 1) / (double)N;
         }
-        cov /= N;
-    }
-
-
-    template <class PointT>
-    Eigen::VectorXd getEigenVector(const PointT& pt) const
-    {
-        Eigen::Matrix<double,3, 1> p;
-        p(0) = static_cast<double>(pt.x);
-        p(1) = static_cast<double>(pt.y);
-        p(2) = static_cast<double>(pt.z);
-        return p;
-    }
-
-    Eigen::VectorXd getEigenVector(const pcl::PointNormal& pt) const
-    {
-        Eigen::Matrix<double, 6, 1> p;
-        p(0) = static_cast<double>(pt.x);
-        p(1) = static_cast<double>(pt.y);
-        p(2) = static_cast<double>(pt.z);
-        p(3) = static_cast<double>(pt.normal_x);
-        p(4) = static_cast<double>(pt.normal_y);
-        p(5) = static_cast<double>(pt.normal_z);
-        return p;
-    }
-
-    Eigen::VectorXd getEigenVector(const pcl::PointXYZRGB& pt) const
-    {
-        Eigen::Matrix<double, 6, 1> p;
-        p(0) = static_cast<double>(pt.x);
-        p(1) = static_cast<double>(pt.y);
-        p(2) = static_cast<double>(pt.z);
-        p(3) = static_cast<double>(pt.r);
-        p(4) = static_cast<double>(pt.g);
-        p(5) = static_cast<double>(pt.b);
-        return p;
-    }
-
-    Eigen::VectorXd getEigenVector(const pcl::PointXYZRGBA& pt) const
-    {
-        Eigen::Matrix<double, 6, 1> p;
-        p(0) = static_cast<double>(pt.x);
-        p(1) = static_cast<double>(pt.y);
-        p(2) = static_cast<double>(pt.z);
-        p(3) = static_cast<double>(pt.r);
-        p(4) = static_cast<double>(pt.g);
-        p(5) = static_cast<double>(pt.b);
-        return p;
-    }
-
-
-    Eigen::VectorXd getEigenVector(const pcl::PointXYZHSV& pt) const
-    {
-        Eigen::Matrix<double, 6, 1> p;
-        p(0) = static_cast<double>(pt.x);
-        p(1) = static_cast<double>(pt.y);
-        p(2) = static_cast<double>(pt.z);
-        p(3) = static_cast<double>(pt.h);
-        p(4) = static_cast<double>(pt.s);
-        p(5) = static_cast<double>(pt.v);
-        return p;
+        reference_ = math::Mahalanobis<3>(distribution.getMean(), covariance);
     }
 
+    /// copies x, y and z into separate arrays
     template <class PointT>
-    std::size_t getDim(typename pcl::PointCloud<PointT>::ConstPtr) const
+    std::size_t splitCoordinates(typename pcl::PointCloud<PointT>::ConstPtr cloud)
     {
-        return 3;
-    }
-
-    std::size_t getDim(typename pcl::PointCloud<pcl::PointNormal>::ConstPtr ) const
-    {
-        return 6;
-    }
-
-    std::size_t getDim(typename pcl::PointCloud<pcl::PointXYZRGB>::ConstPtr) const
-    {
-        return 6;
-    }
-
-    std::size_t getDim(typename pcl::PointCloud<pcl::PointXYZRGBA>::ConstPtr) const
-    {
-        return 6;
+        const std::size_t N = cloud->points.size();
+        for (auto& c : coordinates_) {
+            c.resize(N);
+        }
+        for (std::size_t i = 0; i < N; ++i) {
+            const PointT& pt = cloud->points[i];
+            coordinates_[0][i] = pt.x;
+            coordinates_[1][i] = pt.y;
+            coordinates_[2][i] = pt.z;
+        }
+        return N;
     }
 
-    std::size_t getDim(typename pcl::PointCloud<pcl::PointXYZHSV>::ConstPtr) const
+    std::array<const float*, 3> coordinates(std::size_t begin) const
     {
-        return 6;
+        return { { coordinates_[0].data() + begin, coordinates_[1].data() + begin, coordinates_[2].data() + begin } };
     }
 
 private:
@@ -226,8 +161,8 @@ private:
     Input* in_cloud_;
     Input* in_cloud2_;
     Output* out_;
-    Eigen::VectorXd mean_;
-    Eigen::MatrixXd covariance_;
+    math::Mahalanobis<3> reference_;
+    std::array<std::vector<float>, 3> coordinates_;
 
 };
 
@@ -7,20 +7,82 @@
 #include <csapex/msg/io.h>
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
+#include <csapex_opencv/parallel.h>
 #include <csapex_point_cloud/msg/normals_message.h>
 #include <csapex_point_cloud/msg/point_cloud_message.h>
+#include <csapex_point_cloud/msg/spatial_index_message.h>
 
 /// SYSTEM
+#include <opencv2/core/core.hpp>
 #include <pcl/features/integral_image_normal.h>
 #include <pcl/features/normal_3d.h>
-#include <pcl/features/normal_3d_omp.h>
 #include <pcl/point_types.h>
-#include <pcl/search/impl/kdtree.hpp>
+#include <limits>
 
 using namespace csapex::connection_types;
 
 namespace csapex
 {
+namespace impl
+{
+/// number of points whose normals are computed by one task
+const int NORMALS_BLOCK_SIZE = 1024;
+
+/**
+ * Accumulates the covariance of a neighbourhood. The coordinates are gathered
+ * into contiguous arrays relative to the query point first, so that the sums
+ * run over plain float arrays and stay accurate far from the origin.
+ */
+struct CovarianceAccumulator
+{
+    template <class PointT>
+    bool compute(const pcl::PointCloud<PointT>& cloud, const PointT& query, const std::vector<int>& neighbours, Eigen::Matrix3f& covariance)
+    {
+        const std::size_t n = neighbours.size();
+        x.resize(n);
+        y.resize(n);
+        z.resize(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const PointT& pt = cloud.points[neighbours[i]];
+            x[i] = pt.x - query.x;
+            y[i] = pt.y - query.y;
+            z[i] = pt.z - query.z;
+        }
+
+        float sx = 0, sy = 0, sz = 0, sxx = 0, sxy = 0, sxz = 0, syy = 0, syz = 0, szz = 0;
+        const float* px = x.data();
+        const float* py = y.data();
+        const float* pz = z.data();
+        for (std::size_t i = 0; i < n; ++i) {
+            sx += px[i];
+            sy += py[i];
+            sz += pz[i];
+            sxx += px[i] * px[i];
+            sxy += px[i] * py[i];
+            sxz += px[i] * pz[i];
+            syy += py[i] * py[i];
+            syz += py[i] * pz[i];
+            szz += pz[i] * pz[i];
+        }
+
+        const float f = 1.0f / static_cast<float>(n);
+        const float mx = sx * f, my = sy * f, mz = sz * f;
+        covariance(0, 0) = sxx * f - mx * mx;
+        covariance(0, 1) = covariance(1, 0) = sxy * f - mx * my;
+        covariance(0, 2) = covariance(2, 0) = sxz * f - mx * mz;
+        covariance(1, 1) = syy * f - my * my;
+        covariance(1, 2) = covariance(2, 1) = syz * f - my * mz;
+        covariance(2, 2) = szz * f - mz * mz;
+        return covariance.allFinite();
+    }
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+};
+
+}  // namespace impl
+
 class EstimateNormals : public Node
 {
 public:
@@ -31,13 +93,14 @@ public:
     virtual void setup(csapex::NodeModifier& node_modifier) override
     {
         input_ = node_modifier.addInput<PointCloudMessage>("cloud");
+        input_index_ = node_modifier.addOptionalInput<SpatialIndexMessage>("search index");
         output_ = node_modifier.addOutput<NormalsMessage>("normals");
     }
 
     void setupParameters(Parameterizable& parameters)
     {
         parameters.addParameter(param::factory::declareBool("use_pca_based_estimation", false), use_pca_);
-        parameters.addConditionalParameter(param::factory::declareBool("use_open_mp", false), [this]() { return use_pca_; }, use_omp_);
+        parameters.addConditionalParameter(param::factory::declareBool("use_open_mp", param::ParameterDescription("Estimate the normals of blocks of points in parallel"), false), [this]() { return use_pca_; }, use_omp_);
         parameters.addConditionalParameter(param::factory::declareRange("search_radius", 0.01, 1.0, 0.03, 0.01), [this]() { return use_pca_; }, search_radius_);
 
         parameters.addConditionalParameter(param::factory::declareRange("max_depth_change_factor", 0.0, 0.5, 0.02, 0.001), [this]() { return !use_pca_; }, max_depth_change_factor_);
@@ -67,26 +130,19 @@ public:
         out_msg->value = msg;
 
         if (use_pca_) {
-            typename pcl::NormalEstimation<PointT, pcl::Normal>::Ptr ne;
-            if (use_omp_) {
-                ne.reset(new pcl::NormalEstimationOMP<PointT, pcl::Normal>);
+            SpatialIndex::ConstPtr index;
+            if (msg::hasMessage(input_index_)) {
+                index = msg::getMessage<SpatialIndexMessage>(input_index_)->value;
+                if (!index || !index->matches(*cloud)) {
+                    throw std::runtime_error("the spatial index was built for a different cloud");
+                }
             } else {
-                ne.reset(new pcl::NormalEstimation<PointT, pcl::Normal>);
+                SpatialIndex::Ptr tree(new SpatialIndex(SpatialIndex::Type::KD_TREE));
+                tree->build(cloud);
+                index = tree;
             }
 
-            ne->setInputCloud(cloud);
-
-            // Create an empty kdtree representation, and pass it to the normal
-            // estimation object. Its content will be filled inside the object, based
-            // on the given input dataset (as no other search surface is given).
-            typename pcl::search::KdTree<PointT>::Ptr tree(new pcl::search::KdTree<PointT>());
-            ne->setSearchMethod(tree);
-
-            // Use all neighbors in a sphere of radius 3cm
-            ne->setRadiusSearch(search_radius_);
-
-            // Compute the features
-            ne->compute(*msg);
+            computeNormals<PointT>(*cloud, *index, *msg);
 
         } else {
             if (!cloud->isOrganized())
@@ -105,8 +161,54 @@ public:
         msg::publish(output_, out_msg);
     }
 
+    /// PCA of the neighbourhood within the search radius, flipped towards the sensor origin
+    template <class PointT>
+    void computeNormals(const pcl::PointCloud<PointT>& cloud, const SpatialIndex& index, pcl::PointCloud<pcl::Normal>& normals)
+    {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        const int n = static_cast<int>(cloud.points.size());
+        const double radius = search_radius_;
+        const Eigen::Vector4f& viewpoint = cloud.sensor_origin_;
+
+        normals.header = cloud.header;
+        normals.width = cloud.width;
+        normals.height = cloud.height;
+        normals.is_dense = false;
+        normals.points.resize(n);
+
+        auto compute = [&](const cv::Range& blocks) {
+            impl::CovarianceAccumulator accumulator;
+            std::vector<int> neighbours;
+            std::vector<float> sqr_distances;
+            Eigen::Matrix3f covariance;
+
+            const int end = std::min(n, blocks.end * impl::NORMALS_BLOCK_SIZE);
+            for (int i = blocks.start * impl::NORMALS_BLOCK_SIZE; i < end; ++i) {
+                const PointT& pt = cloud.points[i];
+                pcl::Normal& normal = normals.points[i];
+
+                const bool finite = std::isfinite(pt.x) && std::isfinite(pt.y) && std::isfinite(pt.z);
+                if (!finite || index.radiusSearch(pt.getVector3fMap(), radius, neighbours, sqr_distances) < 3 || !accumulator.compute(cloud, pt, neighbours, covariance)) {
+                    normal.normal_x = normal.normal_y = normal.normal_z = normal.curvature = nan;
+                    continue;
+                }
+
+                pcl::solvePlaneParameters(covariance, normal.normal_x, normal.normal_y, normal.normal_z, normal.curvature);
+                pcl::flipNormalTowardsViewpoint(pt, viewpoint[0], viewpoint[1], viewpoint[2], normal.normal_x, normal.normal_y, normal.normal_z);
+            }
+        };
+
+        const int blocks = (n + impl::NORMALS_BLOCK_SIZE - 1) / impl::NORMALS_BLOCK_SIZE;
+        if (use_omp_) {
+            parallel::forRange(blocks, compute);
+        } else {
+            compute(cv::Range(0, blocks));
+        }
+    }
+
 private:
     Input* input_;
+    Input* input_index_;
     Output* output_;
 
     int method_;
@@ -0,0 +1,112 @@
+/// COMPONENT
+#include "pcd_reader.h"
+
+/// SYSTEM
+// clang-format off
+#include <csapex/utility/suppress_warnings_start.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/point_types.h>
+#include <csapex/utility/suppress_warnings_end.h>
+// clang-format on
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+
+/**
+ * Compares loading a .pcd file with PCL, as PCDPointCloudMessageProvider did, with
+ * streaming it in chunks through PCDReader. Both decode pcl::PointXYZ.
+ *
+ * usage: pcd_benchmark <file.pcd> <legacy|stream> [chunk size]
+ *
+ * The peak RSS covers the whole process, so run each mode in its own process.
+ */
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+double milliseconds(const Clock::time_point& start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+double peakRssMB()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+void report(const std::string& mode, double first, double total, std::size_t points)
+{
+    std::cout << "mode:             " << mode << "\n"
+              << "points:           " << points << "\n"
+              << "first cloud [ms]: " << first << "\n"
+              << "total [ms]:       " << total << "\n"
+              << "peak RSS [MB]:    " << peakRssMB() << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0] << " <file.pcd> <legacy|stream> [chunk size]" << std::endl;
+        return 1;
+    }
+
+    const std::string file = argv[1];
+    const std::string mode = argv[2];
+    const std::size_t chunk_size = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000000;
+    if (chunk_size == 0) {
+        std::cerr << "the chunk size has to be positive" << std::endl;
+        return 1;
+    }
+
+    const Clock::time_point start = Clock::now();
+
+    if (mode == "legacy") {
+        pcl::PCLPointCloud2 blob;
+        if (pcl::io::loadPCDFile(file, blob) != 0) {
+            return 1;
+        }
+        pcl::PointCloud<pcl::PointXYZ> cloud;
+        pcl::fromPCLPointCloud2(blob, cloud);
+
+        const double total = milliseconds(start);
+        report(mode, total, total, cloud.points.size());
+
+    } else if (mode == "stream") {
+        csapex::PCDReader reader;
+        try {
+            reader.open(file);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        if (reader.encoding() == csapex::PCDReader::Encoding::ASCII) {
+            std::cerr << "ascii files are not streamed" << std::endl;
+            return 1;
+        }
+
+        double first = -1.0;
+        pcl::PointCloud<pcl::PointXYZ> cloud;
+        for (std::size_t begin = 0; begin < reader.size(); begin += chunk_size) {
+            reader.read(begin, std::min(reader.size(), begin + chunk_size), cloud);
+            if (first < 0.0) {
+                first = milliseconds(start);
+            }
+        }
+
+        report(mode, first, milliseconds(start), reader.size());
+
+    } else {
+        std::cerr << "unknown mode " << mode << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -6,15 +6,64 @@
 #include <csapex/param/range_parameter.h>
 #include <csapex/utility/register_apex_plugin.h>
 
+#include <algorithm>
 #include <boost/mpl/for_each.hpp>
 #include <boost/mpl/vector.hpp>
+#include <cmath>
 #include <pcl/io/pcd_io.h>
+#include <unordered_map>
 
 CSAPEX_REGISTER_CLASS(csapex::PCDPointCloudMessageProvider, csapex::MessageProvider)
 
 using namespace csapex;
 using namespace connection_types;
 
+namespace
+{
+template <typename PointT>
+bool matchesFields(const std::vector<pcl::PCLPointField>& available_fields, bool full_match)
+{
+    std::vector<pcl::PCLPointField> fields;
+    pcl::for_each_type<typename pcl::traits::fieldList<PointT>::type>(pcl::detail::FieldAdder<PointT>(fields));
+
+    if (full_match) {
+        std::size_t available = 0;
+        for (const pcl::PCLPointField& field : available_fields) {
+            if (field.name != "_") {
+                ++available;
+            }
+        }
+        if (fields.size() != available) {
+            return false;
+        }
+    }
+
+    for (size_t d = 0; d < fields.size(); ++d) {
+        bool found = false;
+        for (size_t f = 0; f < available_fields.size() && !found; ++f) {
+            if (fields[d].name == available_fields[f].name) {
+                found = true;
+            }
+        }
+
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void reportUnknownType(const std::vector<pcl::PCLPointField>& fields)
+{
+    std::cerr << "cannot convert message, type is not known. Fields:";
+    for (const pcl::PCLPointField& field : fields) {
+        std::cerr << field.name << " ";
+    }
+    std::cerr << std::endl;
+}
+
+}  // namespace
+
 struct try_convert
 {
     try_convert(const pcl::PCLPointCloud2& pcl_blob, typename connection_types::PointCloudMessage::Ptr& out, bool full_match, bool& success)
@@ -26,34 +75,10 @@ struct try_convert
     template <typename PointT>
     void operator()(PointT& pt)
     {
-        if (success_) {
+        if (success_ || !matchesFields<PointT>(pcl_blob_.fields, full_match_)) {
             return;
         }
 
-        std::vector<pcl::PCLPointField> fields;
-        pcl::for_each_type<typename pcl::traits::fieldList<PointT>::type>(pcl::detail::FieldAdder<PointT>(fields));
-
-        const std::vector<::pcl::PCLPointField>& available_fields = pcl_blob_.fields;
-
-        if (full_match_) {
-            if (fields.size() != available_fields.size()) {
-                return;
-            }
-        }
-
-        for (size_t d = 0; d < fields.size(); ++d) {
-            bool found = false;
-            for (size_t f = 0; f < available_fields.size() && !found; ++f) {
-                if (fields[d].name == available_fields[f].name) {
-                    found = true;
-                }
-            }
-
-            if (!found) {
-                return;
-            }
-        }
-
         success_ = true;
         typename pcl::PointCloud<PointT>::Ptr cloud(new pcl::PointCloud<PointT>);
         pcl::fromPCLPointCloud2(pcl_blob_, *cloud);
@@ -69,14 +94,94 @@ struct try_convert
     bool& success_;
 };
 
+struct select_decoder
+{
+    select_decoder(const std::vector<pcl::PCLPointField>& fields, PCDPointCloudMessageProvider::Decoder& decoder, bool full_match)
+      : fields_(fields), decoder_(decoder), full_match_(full_match)
+    {
+    }
+
+    template <typename PointT>
+    void operator()(PointT& pt)
+    {
+        if (decoder_ || !matchesFields<PointT>(fields_, full_match_)) {
+            return;
+        }
+
+        decoder_ = [](const PCDReader& reader, const PCDPointCloudMessageProvider::Part& part, const std::string& frame_id) {
+            typename pcl::PointCloud<PointT>::Ptr cloud(new pcl::PointCloud<PointT>);
+            if (part.indices.empty()) {
+                reader.read(part.begin, part.end, *cloud);
+            } else {
+                reader.read(part.indices, *cloud);
+            }
+            cloud->header.frame_id = frame_id;
+
+            PointCloudMessage::Ptr msg(new PointCloudMessage(frame_id, 0));
+            msg->value = cloud;
+            return msg;
+        };
+    }
+
+    const std::vector<pcl::PCLPointField>& fields_;
+    PCDPointCloudMessageProvider::Decoder& decoder_;
+
+    bool full_match_;
+};
+
 std::map<std::string, PCDPointCloudMessageProvider::ProviderConstructor> PCDPointCloudMessageProvider::plugins;
 
-PCDPointCloudMessageProvider::PCDPointCloudMessageProvider() : sent_(false)
+PCDPointCloudMessageProvider::PCDPointCloudMessageProvider()
+  : sent_(false), next_part_(0), planned_mode_(Mode::WHOLE), planned_chunk_size_(0), planned_tile_size_(0.0)
 {
     setType(makeEmpty<PointCloudMessage>());
+
+    std::map<std::string, int> modes = {
+        { "whole cloud", (int)Mode::WHOLE },
+        { "chunks", (int)Mode::CHUNKS },
+        { "tiles", (int)Mode::TILES },
+    };
+    state.addParameter(csapex::param::factory::declareParameterSet("pcd/mode", modes, (int)Mode::WHOLE));
+    state.addParameter(csapex::param::factory::declareRange("pcd/chunk size", 1000, 10000000, 1000000, 1000));
+    state.addParameter(csapex::param::factory::declareRange("pcd/tile size", 1.0, 1000.0, 50.0, 1.0));
 }
 
 void PCDPointCloudMessageProvider::load(const std::string& file)
+{
+    sent_ = false;
+    point_cloud_.reset();
+    decoder_ = nullptr;
+    parts_.clear();
+    next_part_ = 0;
+    frame_id_ = "cloud_frame";
+
+    try {
+        reader_.open(file);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+    }
+
+    if (!reader_.isOpen() || reader_.encoding() == PCDReader::Encoding::ASCII) {
+        reader_.close();
+        loadComplete(file);
+        return;
+    }
+
+    select_decoder full_match_selector(reader_.fields(), decoder_, true);
+    boost::mpl::for_each<connection_types::PointCloudPointTypes>(full_match_selector);
+
+    if (!decoder_) {
+        select_decoder partial_selector(reader_.fields(), decoder_, false);
+        boost::mpl::for_each<connection_types::PointCloudPointTypes>(partial_selector);
+    }
+
+    if (!decoder_) {
+        reportUnknownType(reader_.fields());
+        reader_.close();
+    }
+}
+
+void PCDPointCloudMessageProvider::loadComplete(const std::string& file)
 {
     pcl::PCLPointCloud2 pcl_blob;
     pcl::io::loadPCDFile(file, pcl_blob);
@@ -96,11 +201,7 @@ void PCDPointCloudMessageProvider::load(const std::string& file)
     }
 
     if (!success) {
-        std::cerr << "cannot convert message, type is not known. Fields:";
-        for (const auto& field : pcl_blob.fields) {
-            std::cerr << field.name << " ";
-        }
-        std::cerr << std::endl;
+        reportUnknownType(pcl_blob.fields);
         point_cloud_.reset();
     }
 }
@@ -110,14 +211,114 @@ std::vector<std::string> PCDPointCloudMessageProvider::getExtensions() const
     return { ".pcd" };
 }
 
+void PCDPointCloudMessageProvider::plan()
+{
+    const Mode mode = static_cast<Mode>(state.readParameter<int>("pcd/mode"));
+    const int chunk_size = state.readParameter<int>("pcd/chunk size");
+    const double tile_size = state.readParameter<double>("pcd/tile size");
+
+    if (!parts_.empty() && mode == planned_mode_ && (mode != Mode::CHUNKS || chunk_size == planned_chunk_size_) && (mode != Mode::TILES || tile_size == planned_tile_size_)) {
+        return;
+    }
+
+    planned_mode_ = mode;
+    planned_chunk_size_ = chunk_size;
+    planned_tile_size_ = tile_size;
+    parts_.clear();
+    next_part_ = 0;
+    point_cloud_.reset();
+
+    const std::size_t n = reader_.size();
+
+    if (mode == Mode::CHUNKS && chunk_size > 0) {
+        for (std::size_t begin = 0; begin < n; begin += chunk_size) {
+            parts_.push_back(Part{ begin, std::min(n, begin + chunk_size), {} });
+        }
+
+    } else if (mode == Mode::TILES && reader_.hasField("x") && reader_.hasField("y")) {
+        // assign every point to its tile, tiles are sent row by row
+        std::vector<int> tile_of(n, -1);
+        std::unordered_map<uint64_t, int> tile_ids;
+        std::vector<std::pair<std::pair<int, int>, int>> tiles;
+        {
+            std::vector<float> x, y;
+            reader_.readField("x", x);
+            reader_.readField("y", y);
+            for (std::size_t i = 0; i < n; ++i) {
+                if (!std::isfinite(x[i]) || !std::isfinite(y[i])) {
+                    continue;
+                }
+                const int tx = static_cast<int>(std::floor(x[i] / tile_size));
+                const int ty = static_cast<int>(std::floor(y[i] / tile_size));
+                const uint64_t key = (static_cast<uint64_t>(static_cast<uint32_t>(ty)) << 32) | static_cast<uint32_t>(tx);
+                auto pos = tile_ids.find(key);
+                if (pos == tile_ids.end()) {
+                    pos = tile_ids.emplace(key, static_cast<int>(tiles.size())).first;
+                    tiles.emplace_back(std::make_pair(ty, tx), pos->second);
+                }
+                tile_of[i] = pos->second;
+            }
+        }
+        std::sort(tiles.begin(), tiles.end());
+
+        std::vector<int> order(tiles.size());
+        for (std::size_t t = 0; t < tiles.size(); ++t) {
+            order[tiles[t].second] = static_cast<int>(t);
+        }
+        std::vector<std::size_t> counts(tiles.size(), 0);
+        for (int t : tile_of) {
+            if (t >= 0) {
+                ++counts[order[t]];
+            }
+        }
+
+        parts_.resize(tiles.size(), Part{ 0, 0, {} });
+        for (std::size_t t = 0; t < tiles.size(); ++t) {
+            parts_[t].indices.reserve(counts[t]);
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            if (tile_of[i] >= 0) {
+                parts_[order[tile_of[i]]].indices.push_back(static_cast<int>(i));
+            }
+        }
+    }
+
+    if (parts_.empty()) {
+        parts_.push_back(Part{ 0, n, {} });
+    }
+}
+
 bool PCDPointCloudMessageProvider::hasNext()
 {
+    if (decoder_) {
+        plan();
+        return next_part_ < parts_.size() || state.readParameter<bool>("playback/resend");
+    }
     return point_cloud_ && (!sent_ || state.readParameter<bool>("playback/resend"));
 }
 
 connection_types::Message::Ptr PCDPointCloudMessageProvider::next(std::size_t slot)
 {
     sent_ = true;
+    if (!decoder_) {
+        return point_cloud_;
+    }
+
+    plan();
+    if (next_part_ >= parts_.size()) {
+        // resending starts the sequence over
+        next_part_ = 0;
+    }
+
+    const Part& part = parts_[next_part_++];
+    if (parts_.size() > 1) {
+        return decoder_(reader_, part, frame_id_);
+    }
+
+    // a single part is kept, so that resending does not decode it again
+    if (!point_cloud_) {
+        point_cloud_ = decoder_(reader_, part, frame_id_);
+    }
     return point_cloud_;
 }
 
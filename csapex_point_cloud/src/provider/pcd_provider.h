@@ -6,16 +6,45 @@
 #include <csapex/serialization/serializable.h>
 #include <csapex_point_cloud/msg/point_cloud_message.h>
 
+/// COMPONENT
+#include "pcd_reader.h"
+
 /// SYSTEM
 #include <functional>
 
 namespace csapex
 {
+/**
+ * @brief The PCDPointCloudMessageProvider class plays back a .pcd file.
+ *
+ * Binary and binary compressed files are read with a PCDReader, so only the
+ * fields of the selected point type are decoded and nothing is converted before
+ * the first message is requested. The cloud can be sent as a whole, in chunks
+ * of consecutive points, or in square xy tiles, each part being one message.
+ * ASCII files are loaded completely with PCL.
+ */
 class CSAPEX_EXPORT_PLUGIN PCDPointCloudMessageProvider : public MessageProvider
 {
 public:
     using Ptr = std::shared_ptr<PCDPointCloudMessageProvider>;
 
+    enum class Mode
+    {
+        WHOLE,
+        CHUNKS,
+        TILES
+    };
+
+    /// points [begin, end) or, if not empty, the given indices
+    struct Part
+    {
+        std::size_t begin;
+        std::size_t end;
+        std::vector<int> indices;
+    };
+
+    using Decoder = std::function<connection_types::PointCloudMessage::Ptr(const PCDReader&, const Part&, const std::string&)>;
+
 protected:
     using ProviderConstructor = std::function<PCDPointCloudMessageProvider*(const std::string&)>;
 
@@ -33,10 +62,24 @@ public:
     GenericStatePtr getState() const;
     void setParameterState(GenericStatePtr memento);
 
+private:
+    void loadComplete(const std::string& file);
+    void plan();
+
 private:
     connection_types::PointCloudMessage::Ptr point_cloud_;
     bool sent_;
 
+    PCDReader reader_;
+    Decoder decoder_;
+    std::string frame_id_;
+
+    std::vector<Part> parts_;
+    std::size_t next_part_;
+    Mode planned_mode_;
+    int planned_chunk_size_;
+    double planned_tile_size_;
+
     static std::map<std::string, ProviderConstructor> plugins;
 };
 }  // namespace csapex
@@ -0,0 +1,475 @@
+/// HEADER
+#include "pcd_reader.h"
+
+/// SYSTEM
+// clang-format off
+#include <csapex/utility/suppress_warnings_start.h>
+#include <pcl/io/lzf.h>
+#include <csapex/utility/suppress_warnings_end.h>
+// clang-format on
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace csapex;
+
+namespace
+{
+uint8_t datatype(char type, int size)
+{
+    switch (type) {
+        case 'I':
+            return size == 1 ? pcl::PCLPointField::INT8 : size == 2 ? pcl::PCLPointField::INT16 : size == 4 ? pcl::PCLPointField::INT32 : 0;
+        case 'U':
+            return size == 1 ? pcl::PCLPointField::UINT8 : size == 2 ? pcl::PCLPointField::UINT16 : size == 4 ? pcl::PCLPointField::UINT32 : 0;
+        case 'F':
+            return size == 4 ? pcl::PCLPointField::FLOAT32 : size == 8 ? pcl::PCLPointField::FLOAT64 : 0;
+        default:
+            return 0;
+    }
+}
+
+uint32_t datasize(uint8_t type)
+{
+    switch (type) {
+        case pcl::PCLPointField::INT8:
+        case pcl::PCLPointField::UINT8:
+            return 1;
+        case pcl::PCLPointField::INT16:
+        case pcl::PCLPointField::UINT16:
+            return 2;
+        case pcl::PCLPointField::INT32:
+        case pcl::PCLPointField::UINT32:
+        case pcl::PCLPointField::FLOAT32:
+            return 4;
+        case pcl::PCLPointField::FLOAT64:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+template <typename T>
+T load(const uint8_t* data)
+{
+    T v;
+    std::memcpy(&v, data, sizeof(T));
+    return v;
+}
+
+double loadAs(uint8_t type, const uint8_t* data)
+{
+    switch (type) {
+        case pcl::PCLPointField::INT8:
+            return load<int8_t>(data);
+        case pcl::PCLPointField::UINT8:
+            return load<uint8_t>(data);
+        case pcl::PCLPointField::INT16:
+            return load<int16_t>(data);
+        case pcl::PCLPointField::UINT16:
+            return load<uint16_t>(data);
+        case pcl::PCLPointField::INT32:
+            return load<int32_t>(data);
+        case pcl::PCLPointField::UINT32:
+            return load<uint32_t>(data);
+        case pcl::PCLPointField::FLOAT32:
+            return load<float>(data);
+        case pcl::PCLPointField::FLOAT64:
+            return load<double>(data);
+        default:
+            return 0.0;
+    }
+}
+
+template <typename T>
+void store(double v, uint8_t* data)
+{
+    const T t = static_cast<T>(v);
+    std::memcpy(data, &t, sizeof(T));
+}
+
+void storeAs(uint8_t type, double v, uint8_t* data)
+{
+    switch (type) {
+        case pcl::PCLPointField::INT8:
+            store<int8_t>(v, data);
+            break;
+        case pcl::PCLPointField::UINT8:
+            store<uint8_t>(v, data);
+            break;
+        case pcl::PCLPointField::INT16:
+            store<int16_t>(v, data);
+            break;
+        case pcl::PCLPointField::UINT16:
+            store<uint16_t>(v, data);
+            break;
+        case pcl::PCLPointField::INT32:
+            store<int32_t>(v, data);
+            break;
+        case pcl::PCLPointField::UINT32:
+            store<uint32_t>(v, data);
+            break;
+        case pcl::PCLPointField::FLOAT32:
+            store<float>(v, data);
+            break;
+        case pcl::PCLPointField::FLOAT64:
+            store<double>(v, data);
+            break;
+        default:
+            break;
+    }
+}
+
+bool isColor(const std::string& name)
+{
+    return name == "rgb" || name == "rgba";
+}
+
+}  // namespace
+
+PCDReader::PCDReader()
+  : encoding_(Encoding::ASCII)
+  , point_step_(0)
+  , width_(0)
+  , height_(0)
+  , origin_(Eigen::Vector4f::Zero())
+  , orientation_(Eigen::Quaternionf::Identity())
+  , fd_(-1)
+  , map_(nullptr)
+  , map_size_(0)
+  , data_offset_(0)
+  , open_(false)
+{
+}
+
+PCDReader::~PCDReader()
+{
+    close();
+}
+
+void PCDReader::close()
+{
+    if (map_) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    map_size_ = 0;
+    data_offset_ = 0;
+    open_ = false;
+    fields_.clear();
+    std::vector<uint8_t>().swap(buffer_);
+}
+
+bool PCDReader::isOpen() const
+{
+    return open_;
+}
+
+PCDReader::Encoding PCDReader::encoding() const
+{
+    return encoding_;
+}
+
+const std::vector<pcl::PCLPointField>& PCDReader::fields() const
+{
+    return fields_;
+}
+
+bool PCDReader::hasField(const std::string& name) const
+{
+    for (const pcl::PCLPointField& field : fields_) {
+        if (field.name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t PCDReader::size() const
+{
+    return static_cast<std::size_t>(width_) * height_;
+}
+
+uint32_t PCDReader::width() const
+{
+    return width_;
+}
+
+uint32_t PCDReader::height() const
+{
+    return height_;
+}
+
+const Eigen::Vector4f& PCDReader::origin() const
+{
+    return origin_;
+}
+
+const Eigen::Quaternionf& PCDReader::orientation() const
+{
+    return orientation_;
+}
+
+void PCDReader::open(const std::string& file)
+{
+    close();
+
+    fd_ = ::open(file.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error(std::string("cannot open ") + file);
+    }
+
+    struct stat info;
+    if (fstat(fd_, &info) != 0 || info.st_size == 0) {
+        close();
+        throw std::runtime_error(std::string("cannot read ") + file);
+    }
+
+    map_size_ = static_cast<std::size_t>(info.st_size);
+    map_ = mmap(nullptr, map_size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        close();
+        throw std::runtime_error(std::string("cannot map ") + file);
+    }
+
+    const char* data = static_cast<const char*>(map_);
+    try {
+        parseHeader(data, data + map_size_);
+
+        if (encoding_ == Encoding::BINARY) {
+            if (data_offset_ + size() * point_step_ > map_size_) {
+                throw std::runtime_error("the file is shorter than its header claims");
+            }
+            madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+        } else if (encoding_ == Encoding::BINARY_COMPRESSED) {
+            decompress();
+        }
+
+    } catch (const std::exception& e) {
+        close();
+        throw std::runtime_error(file + ": " + e.what());
+    }
+
+    open_ = true;
+}
+
+void PCDReader::parseHeader(const char* begin, const char* end)
+{
+    std::vector<int> sizes;
+    std::vector<char> types;
+    std::vector<int> counts;
+    std::vector<std::string> names;
+    width_ = 0;
+    height_ = 1;
+    origin_ = Eigen::Vector4f::Zero();
+    orientation_ = Eigen::Quaternionf::Identity();
+
+    const char* line = begin;
+    while (line < end) {
+        const char* eol = static_cast<const char*>(std::memchr(line, '\n', end - line));
+        if (!eol) {
+            throw std::runtime_error("the header is incomplete");
+        }
+
+        std::istringstream in(std::string(line, eol));
+        line = eol + 1;
+
+        std::string key;
+        in >> key;
+        if (key.empty() || key[0] == '#') {
+            continue;
+        }
+
+        if (key == "FIELDS" || key == "COLUMNS") {
+            std::string name;
+            while (in >> name) {
+                names.push_back(name);
+            }
+        } else if (key == "SIZE") {
+            int s;
+            while (in >> s) {
+                sizes.push_back(s);
+            }
+        } else if (key == "TYPE") {
+            char t;
+            while (in >> t) {
+                types.push_back(t);
+            }
+        } else if (key == "COUNT") {
+            int c;
+            while (in >> c) {
+                counts.push_back(c);
+            }
+        } else if (key == "WIDTH") {
+            in >> width_;
+        } else if (key == "HEIGHT") {
+            in >> height_;
+        } else if (key == "VIEWPOINT") {
+            float tx, ty, tz, qw, qx, qy, qz;
+            if (in >> tx >> ty >> tz >> qw >> qx >> qy >> qz) {
+                origin_ = Eigen::Vector4f(tx, ty, tz, 0.f);
+                orientation_ = Eigen::Quaternionf(qw, qx, qy, qz);
+            }
+        } else if (key == "DATA") {
+            std::string encoding;
+            in >> encoding;
+            if (encoding == "binary") {
+                encoding_ = Encoding::BINARY;
+            } else if (encoding == "binary_compressed") {
+                encoding_ = Encoding::BINARY_COMPRESSED;
+            } else {
+                encoding_ = Encoding::ASCII;
+            }
+            data_offset_ = line - begin;
+            break;
+        }
+    }
+
+    if (data_offset_ == 0) {
+        throw std::runtime_error("no DATA entry in the header");
+    }
+    if (counts.empty()) {
+        counts.assign(names.size(), 1);
+    }
+    if (names.empty() || sizes.size() != names.size() || types.size() != names.size() || counts.size() != names.size()) {
+        throw std::runtime_error("inconsistent FIELDS, SIZE, TYPE and COUNT entries");
+    }
+
+    point_step_ = 0;
+    for (std::size_t f = 0; f < names.size(); ++f) {
+        pcl::PCLPointField field;
+        field.name = names[f];
+        field.offset = point_step_;
+        field.datatype = datatype(types[f], sizes[f]);
+        field.count = counts[f];
+        if (field.datatype == 0) {
+            throw std::runtime_error(std::string("unsupported type of field ") + field.name);
+        }
+        point_step_ += sizes[f] * counts[f];
+        fields_.push_back(field);
+    }
+}
+
+void PCDReader::decompress()
+{
+    const uint8_t* data = static_cast<const uint8_t*>(map_) + data_offset_;
+    if (data_offset_ + 8 > map_size_) {
+        throw std::runtime_error("the compressed data is missing");
+    }
+    const uint32_t compressed = load<uint32_t>(data);
+    const uint32_t uncompressed = load<uint32_t>(data + 4);
+    if (data_offset_ + 8 + compressed > map_size_) {
+        throw std::runtime_error("the compressed data is truncated");
+    }
+
+    std::size_t expected = 0;
+    for (const pcl::PCLPointField& field : fields_) {
+        if (field.name != "_") {
+            expected += size() * datasize(field.datatype) * field.count;
+        }
+    }
+    if (expected != uncompressed) {
+        throw std::runtime_error("the compressed data does not match the fields");
+    }
+
+    buffer_.resize(uncompressed);
+    if (uncompressed > 0 && pcl::lzfDecompress(data + 8, compressed, buffer_.data(), uncompressed) != uncompressed) {
+        throw std::runtime_error("cannot decompress the data");
+    }
+
+    // the mapping is not needed anymore
+    munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+}
+
+std::vector<PCDReader::Copy> PCDReader::makePlan(const std::vector<pcl::PCLPointField>& target) const
+{
+    std::vector<Copy> plan;
+
+    // binary compressed data stores the fields one after another, padding is dropped
+    std::size_t block = 0;
+    for (const pcl::PCLPointField& field : fields_) {
+        const uint32_t bytes = datasize(field.datatype) * field.count;
+        const uint8_t* base = nullptr;
+        std::size_t stride = 0;
+        if (encoding_ == Encoding::BINARY) {
+            base = static_cast<const uint8_t*>(map_) + data_offset_ + field.offset;
+            stride = point_step_;
+        } else if (field.name != "_") {
+            base = buffer_.data() + block;
+            stride = bytes;
+            block += size() * bytes;
+        }
+
+        if (field.name == "_" || !base) {
+            continue;
+        }
+
+        for (const pcl::PCLPointField& t : target) {
+            if (t.name != field.name) {
+                continue;
+            }
+            Copy copy;
+            copy.base = base;
+            copy.stride = stride;
+            copy.source_type = field.datatype;
+            copy.target_type = t.datatype;
+            copy.target_offset = t.offset;
+            copy.count = std::min(field.count, t.count);
+            // packed colors are bit patterns, never convert them numerically
+            const bool raw = t.datatype == field.datatype || (isColor(t.name) && datasize(t.datatype) == datasize(field.datatype));
+            copy.bytes = raw ? copy.count * datasize(t.datatype) : 0;
+            plan.push_back(copy);
+        }
+    }
+
+    return plan;
+}
+
+void PCDReader::decode(const std::vector<Copy>& plan, std::size_t index, uint8_t* point)
+{
+    for (const Copy& copy : plan) {
+        const uint8_t* source = copy.base + index * copy.stride;
+        uint8_t* target = point + copy.target_offset;
+        if (copy.bytes > 0) {
+            std::memcpy(target, source, copy.bytes);
+        } else {
+            const uint32_t source_size = datasize(copy.source_type);
+            const uint32_t target_size = datasize(copy.target_type);
+            for (uint32_t c = 0; c < copy.count; ++c) {
+                storeAs(copy.target_type, loadAs(copy.source_type, source + c * source_size), target + c * target_size);
+            }
+        }
+    }
+}
+
+void PCDReader::readField(const std::string& name, std::vector<float>& values) const
+{
+    pcl::PCLPointField target;
+    target.name = name;
+    target.offset = 0;
+    target.datatype = pcl::PCLPointField::FLOAT32;
+    target.count = 1;
+
+    const std::vector<Copy> plan = makePlan({ target });
+    if (plan.empty()) {
+        throw std::runtime_error(std::string("no field ") + name);
+    }
+
+    const std::size_t n = size();
+    values.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        decode(plan, i, reinterpret_cast<uint8_t*>(&values[i]));
+    }
+}
@@ -0,0 +1,146 @@
+#ifndef PCD_READER_H
+#define PCD_READER_H
+
+/// SYSTEM
+// clang-format off
+#include <csapex/utility/suppress_warnings_start.h>
+#include <pcl/PCLPointField.h>
+#include <pcl/point_cloud.h>
+#include <pcl/point_traits.h>
+#include <pcl/for_each_type.h>
+#include <pcl/conversions.h>
+#include <csapex/utility/suppress_warnings_end.h>
+// clang-format on
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The PCDReader class decodes points of binary PCD files on demand.
+ *
+ * Binary files are memory mapped, points are only touched when they are read.
+ * Binary compressed files are decompressed once into a buffer that holds each
+ * field for all points contiguously. Only the fields of the requested point
+ * type are decoded, fields that are missing in the file keep their default.
+ * ASCII files are recognized but not supported, use pcl::io::loadPCDFile.
+ */
+class PCDReader
+{
+public:
+    enum class Encoding
+    {
+        ASCII,
+        BINARY,
+        BINARY_COMPRESSED
+    };
+
+public:
+    PCDReader();
+    ~PCDReader();
+
+    PCDReader(const PCDReader&) = delete;
+    PCDReader& operator=(const PCDReader&) = delete;
+
+    /// parses the header and maps the data, throws std::runtime_error
+    void open(const std::string& file);
+    void close();
+
+    bool isOpen() const;
+    Encoding encoding() const;
+
+    /// fields in file order, including padding fields named "_"
+    const std::vector<pcl::PCLPointField>& fields() const;
+    bool hasField(const std::string& name) const;
+
+    std::size_t size() const;
+    uint32_t width() const;
+    uint32_t height() const;
+    const Eigen::Vector4f& origin() const;
+    const Eigen::Quaternionf& orientation() const;
+
+    /// points [begin, end), the cloud keeps the organization of the file if all points are read
+    template <typename PointT>
+    void read(std::size_t begin, std::size_t end, pcl::PointCloud<PointT>& cloud) const
+    {
+        const std::vector<Copy> plan = makePlan(targetFields<PointT>());
+        cloud.points.resize(end - begin);
+        for (std::size_t i = begin; i < end; ++i) {
+            decode(plan, i, reinterpret_cast<uint8_t*>(&cloud.points[i - begin]));
+        }
+        finish(cloud, begin == 0 && end == size());
+    }
+
+    template <typename PointT>
+    void read(const std::vector<int>& indices, pcl::PointCloud<PointT>& cloud) const
+    {
+        const std::vector<Copy> plan = makePlan(targetFields<PointT>());
+        cloud.points.resize(indices.size());
+        for (std::size_t k = 0; k < indices.size(); ++k) {
+            decode(plan, indices[k], reinterpret_cast<uint8_t*>(&cloud.points[k]));
+        }
+        finish(cloud, false);
+    }
+
+    /// the first element of a field for all points, converted to float
+    void readField(const std::string& name, std::vector<float>& values) const;
+
+private:
+    struct Copy
+    {
+        const uint8_t* base;
+        std::size_t stride;
+        uint8_t source_type;
+        uint8_t target_type;
+        uint32_t target_offset;
+        uint32_t count;
+        /// number of bytes if source and target type are equal, 0 otherwise
+        uint32_t bytes;
+    };
+
+    template <typename PointT>
+    static std::vector<pcl::PCLPointField> targetFields()
+    {
+        std::vector<pcl::PCLPointField> fields;
+        pcl::for_each_type<typename pcl::traits::fieldList<PointT>::type>(pcl::detail::FieldAdder<PointT>(fields));
+        return fields;
+    }
+
+    template <typename PointT>
+    void finish(pcl::PointCloud<PointT>& cloud, bool complete) const
+    {
+        cloud.width = complete ? width_ : static_cast<uint32_t>(cloud.points.size());
+        cloud.height = complete ? height_ : 1;
+        cloud.is_dense = false;
+        cloud.sensor_origin_ = origin_;
+        cloud.sensor_orientation_ = orientation_;
+    }
+
+    void parseHeader(const char* begin, const char* end);
+    void decompress();
+    std::vector<Copy> makePlan(const std::vector<pcl::PCLPointField>& target) const;
+    static void decode(const std::vector<Copy>& plan, std::size_t index, uint8_t* point);
+
+private:
+    Encoding encoding_;
+    std::vector<pcl::PCLPointField> fields_;
+    uint32_t point_step_;
+    uint32_t width_;
+    uint32_t height_;
+    Eigen::Vector4f origin_;
+    Eigen::Quaternionf orientation_;
+
+    int fd_;
+    void* map_;
+    std::size_t map_size_;
+    std::size_t data_offset_;
+    bool open_;
+
+    /// decompressed data of binary compressed files, one block per non-padding field
+    std::vector<uint8_t> buffer_;
+};
+
+}  // namespace csapex
+
+#endif  // PCD_READER_H
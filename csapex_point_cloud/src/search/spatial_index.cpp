@@ -0,0 +1,362 @@
+/// HEADER
+#include <csapex_point_cloud/search/spatial_index.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+using namespace csapex;
+
+namespace
+{
+const int LEAF_SIZE = 16;
+}
+
+/// the k best points found so far, sorted by distance
+struct SpatialIndex::Candidates
+{
+    Candidates(int k) : k(k)
+    {
+        indices.reserve(k + 1);
+        sqr_distances.reserve(k + 1);
+    }
+
+    float worst() const
+    {
+        return static_cast<int>(indices.size()) < k ? std::numeric_limits<float>::infinity() : sqr_distances.back();
+    }
+
+    void insert(int index, float sqr_distance)
+    {
+        if (sqr_distance >= worst()) {
+            return;
+        }
+        auto pos = std::upper_bound(sqr_distances.begin(), sqr_distances.end(), sqr_distance);
+        const std::ptrdiff_t at = pos - sqr_distances.begin();
+        sqr_distances.insert(pos, sqr_distance);
+        indices.insert(indices.begin() + at, index);
+        if (static_cast<int>(indices.size()) > k) {
+            sqr_distances.pop_back();
+            indices.pop_back();
+        }
+    }
+
+    int k;
+    std::vector<int> indices;
+    std::vector<float> sqr_distances;
+};
+
+SpatialIndex::SpatialIndex(Type type, double voxel_size) : type_(type), voxel_size_(voxel_size), cloud_size_(0)
+{
+    if (type_ == Type::VOXEL_HASH && !(voxel_size_ > 0.0)) {
+        throw std::runtime_error("the voxel size of a spatial index has to be positive");
+    }
+}
+
+SpatialIndex::Type SpatialIndex::type() const
+{
+    return type_;
+}
+
+double SpatialIndex::voxelSize() const
+{
+    return voxel_size_;
+}
+
+std::size_t SpatialIndex::cloudSize() const
+{
+    return cloud_size_;
+}
+
+std::size_t SpatialIndex::size() const
+{
+    return ids_.size();
+}
+
+void SpatialIndex::build()
+{
+    nodes_.clear();
+    voxels_.clear();
+    switch (type_) {
+        case Type::KD_TREE:
+            buildKdTree();
+            break;
+        case Type::VOXEL_HASH:
+            buildVoxelHash();
+            break;
+    }
+}
+
+void SpatialIndex::reorder(const std::vector<int>& order)
+{
+    std::vector<float> x(order.size()), y(order.size()), z(order.size());
+    std::vector<int> ids(order.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        x[i] = x_[order[i]];
+        y[i] = y_[order[i]];
+        z[i] = z_[order[i]];
+        ids[i] = ids_[order[i]];
+    }
+    x_.swap(x);
+    y_.swap(y);
+    z_.swap(z);
+    ids_.swap(ids);
+}
+
+void SpatialIndex::buildKdTree()
+{
+    const int n = static_cast<int>(ids_.size());
+    std::vector<int> order(n);
+    for (int i = 0; i < n; ++i) {
+        order[i] = i;
+    }
+    Eigen::Vector3f lo = Eigen::Vector3f::Constant(std::numeric_limits<float>::infinity());
+    Eigen::Vector3f hi = -lo;
+    for (int i = 0; i < n; ++i) {
+        const Eigen::Vector3f p(x_[i], y_[i], z_[i]);
+        lo = lo.cwiseMin(p);
+        hi = hi.cwiseMax(p);
+    }
+
+    nodes_.reserve(2 * (n / LEAF_SIZE + 1));
+    buildKdNode(order, 0, n, lo, hi);
+    reorder(order);
+}
+
+int SpatialIndex::buildKdNode(std::vector<int>& order, int begin, int end, Eigen::Vector3f lo, Eigen::Vector3f hi)
+{
+    const int id = static_cast<int>(nodes_.size());
+    nodes_.push_back(Node{ begin, end, -1, -1, 0, 0.f });
+    if (end - begin <= LEAF_SIZE) {
+        return id;
+    }
+
+    // split the longest side of the cell at the median
+    int axis;
+    (hi - lo).maxCoeff(&axis);
+
+    const float* values = axis == 0 ? x_.data() : axis == 1 ? y_.data() : z_.data();
+    const int mid = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end, [values](int a, int b) { return values[a] < values[b]; });
+
+    const float split = values[order[mid]];
+    Eigen::Vector3f left_hi = hi;
+    left_hi[axis] = split;
+    Eigen::Vector3f right_lo = lo;
+    right_lo[axis] = split;
+    const int left = buildKdNode(order, begin, mid, lo, left_hi);
+    const int right = buildKdNode(order, mid, end, right_lo, hi);
+
+    Node& node = nodes_[id];
+    node.left = left;
+    node.right = right;
+    node.axis = axis;
+    node.split = split;
+    return id;
+}
+
+int SpatialIndex::voxelCoordinate(float v) const
+{
+    return static_cast<int>(std::floor(v / voxel_size_));
+}
+
+int64_t SpatialIndex::voxelKey(int x, int y, int z) const
+{
+    // 21 bits per axis
+    const uint64_t mask = (uint64_t(1) << 21) - 1;
+    return static_cast<int64_t>(((static_cast<uint64_t>(x) & mask) << 42) | ((static_cast<uint64_t>(y) & mask) << 21) | (static_cast<uint64_t>(z) & mask));
+}
+
+void SpatialIndex::buildVoxelHash()
+{
+    const int n = static_cast<int>(ids_.size());
+    voxel_min_.setConstant(std::numeric_limits<int>::max());
+    voxel_max_.setConstant(std::numeric_limits<int>::min());
+
+    std::vector<std::pair<int64_t, int>> keyed(n);
+    for (int i = 0; i < n; ++i) {
+        const Eigen::Vector3i cell(voxelCoordinate(x_[i]), voxelCoordinate(y_[i]), voxelCoordinate(z_[i]));
+        voxel_min_ = voxel_min_.cwiseMin(cell);
+        voxel_max_ = voxel_max_.cwiseMax(cell);
+        keyed[i] = std::make_pair(voxelKey(cell.x(), cell.y(), cell.z()), i);
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    std::vector<int> order(n);
+    for (int i = 0; i < n;) {
+        int j = i;
+        while (j < n && keyed[j].first == keyed[i].first) {
+            order[j] = keyed[j].second;
+            ++j;
+        }
+        voxels_[keyed[i].first] = std::make_pair(i, j);
+        i = j;
+    }
+    reorder(order);
+}
+
+void SpatialIndex::visitRange(int begin, int end, const float* q, float radius_sqr, unsigned int max_nn, const std::vector<bool>* mask, std::vector<int>& indices,
+                              std::vector<float>& sqr_distances) const
+{
+    for (int i = begin; i < end; ++i) {
+        const float dx = x_[i] - q[0];
+        const float dy = y_[i] - q[1];
+        const float dz = z_[i] - q[2];
+        const float d = dx * dx + dy * dy + dz * dz;
+        if (d <= radius_sqr && (!mask || (*mask)[ids_[i]])) {
+            if (max_nn > 0 && indices.size() >= max_nn) {
+                return;
+            }
+            indices.push_back(ids_[i]);
+            sqr_distances.push_back(d);
+        }
+    }
+}
+
+void SpatialIndex::nearestRange(int begin, int end, const float* q, const std::vector<bool>* mask, Candidates& candidates) const
+{
+    for (int i = begin; i < end; ++i) {
+        const float dx = x_[i] - q[0];
+        const float dy = y_[i] - q[1];
+        const float dz = z_[i] - q[2];
+        if (!mask || (*mask)[ids_[i]]) {
+            candidates.insert(ids_[i], dx * dx + dy * dy + dz * dz);
+        }
+    }
+}
+
+void SpatialIndex::radiusKdTree(int node, const float* q, float radius_sqr, unsigned int max_nn, const std::vector<bool>* mask, std::vector<int>& indices,
+                                std::vector<float>& sqr_distances) const
+{
+    if (max_nn > 0 && indices.size() >= max_nn) {
+        return;
+    }
+    const Node& n = nodes_[node];
+    if (n.left < 0) {
+        visitRange(n.begin, n.end, q, radius_sqr, max_nn, mask, indices, sqr_distances);
+        return;
+    }
+
+    const float diff = q[n.axis] - n.split;
+    const int near = diff < 0.f ? n.left : n.right;
+    const int far = diff < 0.f ? n.right : n.left;
+    radiusKdTree(near, q, radius_sqr, max_nn, mask, indices, sqr_distances);
+    if (diff * diff <= radius_sqr) {
+        radiusKdTree(far, q, radius_sqr, max_nn, mask, indices, sqr_distances);
+    }
+}
+
+void SpatialIndex::nearestKdTree(int node, const float* q, const std::vector<bool>* mask, Candidates& candidates) const
+{
+    const Node& n = nodes_[node];
+    if (n.left < 0) {
+        nearestRange(n.begin, n.end, q, mask, candidates);
+        return;
+    }
+
+    const float diff = q[n.axis] - n.split;
+    const int near = diff < 0.f ? n.left : n.right;
+    const int far = diff < 0.f ? n.right : n.left;
+    nearestKdTree(near, q, mask, candidates);
+    if (diff * diff < candidates.worst()) {
+        nearestKdTree(far, q, mask, candidates);
+    }
+}
+
+int SpatialIndex::radiusSearch(const Eigen::Vector3f& query, double radius, std::vector<int>& indices, std::vector<float>& sqr_distances, unsigned int max_nn,
+                               const std::vector<bool>* mask) const
+{
+    indices.clear();
+    sqr_distances.clear();
+    if (ids_.empty() || radius < 0.0) {
+        return 0;
+    }
+
+    const float q[3] = { query.x(), query.y(), query.z() };
+    const float radius_sqr = static_cast<float>(radius * radius);
+
+    if (type_ == Type::KD_TREE) {
+        radiusKdTree(0, q, radius_sqr, max_nn, mask, indices, sqr_distances);
+
+    } else {
+        const Eigen::Vector3i lo = Eigen::Vector3i(voxelCoordinate(q[0] - radius), voxelCoordinate(q[1] - radius), voxelCoordinate(q[2] - radius)).cwiseMax(voxel_min_);
+        const Eigen::Vector3i hi = Eigen::Vector3i(voxelCoordinate(q[0] + radius), voxelCoordinate(q[1] + radius), voxelCoordinate(q[2] + radius)).cwiseMin(voxel_max_);
+        if ((hi - lo).minCoeff() < 0) {
+            return 0;
+        }
+
+        const double cells = double(hi.x() - lo.x() + 1) * (hi.y() - lo.y() + 1) * (hi.z() - lo.z() + 1);
+        if (cells > voxels_.size()) {
+            // the radius is large compared to the voxels, scanning all points is cheaper
+            visitRange(0, static_cast<int>(ids_.size()), q, radius_sqr, max_nn, mask, indices, sqr_distances);
+            return static_cast<int>(indices.size());
+        }
+
+        for (int x = lo.x(); x <= hi.x(); ++x) {
+            for (int y = lo.y(); y <= hi.y(); ++y) {
+                for (int z = lo.z(); z <= hi.z(); ++z) {
+                    auto pos = voxels_.find(voxelKey(x, y, z));
+                    if (pos != voxels_.end()) {
+                        visitRange(pos->second.first, pos->second.second, q, radius_sqr, max_nn, mask, indices, sqr_distances);
+                    }
+                }
+            }
+        }
+    }
+
+    return static_cast<int>(indices.size());
+}
+
+int SpatialIndex::nearestKSearch(const Eigen::Vector3f& query, int k, std::vector<int>& indices, std::vector<float>& sqr_distances, const std::vector<bool>* mask) const
+{
+    indices.clear();
+    sqr_distances.clear();
+    if (ids_.empty() || k <= 0) {
+        return 0;
+    }
+
+    const float q[3] = { query.x(), query.y(), query.z() };
+    Candidates candidates(k);
+
+    if (type_ == Type::KD_TREE) {
+        nearestKdTree(0, q, mask, candidates);
+
+    } else {
+        // visit shells of voxels around the query until no unvisited voxel can contain a closer point
+        const Eigen::Vector3i center(voxelCoordinate(q[0]), voxelCoordinate(q[1]), voxelCoordinate(q[2]));
+        const int last = std::max((voxel_max_ - center).maxCoeff(), (center - voxel_min_).maxCoeff());
+        for (int r = 0; r <= last; ++r) {
+            const double cells = std::pow(2.0 * r + 1.0, 3);
+            if (cells > voxels_.size()) {
+                // the shells reach far beyond the occupied voxels, scanning all points is cheaper
+                candidates = Candidates(k);
+                nearestRange(0, static_cast<int>(ids_.size()), q, mask, candidates);
+                break;
+            }
+
+            for (int x = center.x() - r; x <= center.x() + r; ++x) {
+                for (int y = center.y() - r; y <= center.y() + r; ++y) {
+                    const bool inner = std::abs(x - center.x()) < r && std::abs(y - center.y()) < r;
+                    const int step = inner ? 2 * r : 1;
+                    for (int z = center.z() - r; z <= center.z() + r; z += std::max(1, step)) {
+                        auto pos = voxels_.find(voxelKey(x, y, z));
+                        if (pos != voxels_.end()) {
+                            nearestRange(pos->second.first, pos->second.second, q, mask, candidates);
+                        }
+                    }
+                }
+            }
+
+            const double reach = r * voxel_size_;
+            if (candidates.worst() <= reach * reach) {
+                break;
+            }
+        }
+    }
+
+    indices.swap(candidates.indices);
+    sqr_distances.swap(candidates.sqr_distances);
+    return static_cast<int>(indices.size());
+}
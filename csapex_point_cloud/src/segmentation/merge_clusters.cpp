@@ -15,6 +15,9 @@
 #include <csapex_ros/yaml_io.hpp>
 
 /// SYSTEM
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
 // clang-format off
 #include <csapex/utility/suppress_warnings_start.h>
 #include <tf/tf.h>
@@ -32,66 +35,83 @@ template <class PointT>
 struct Impl;
 }
 
-template <typename PointT>
-double distance(const PointT& a)
+namespace merge_clusters
 {
-    auto dx = a.x;
-    auto dy = a.y;
-    auto dz = a.z;
-    return std::sqrt(dx * dx + dy * dy + dz * dz);
-}
-template <typename PointT>
-double distanceXYZ(const PointT& a, const PointT& b)
-{
-    auto dx = a.x - b.x;
-    auto dy = a.y - b.y;
-    auto dz = a.z - b.z;
-    return std::sqrt(dx * dx + dy * dy + dz * dz);
-}
-template <typename PointT>
-double distanceXY(const PointT& a, const PointT& b)
+/// running sums of a cluster, merged in constant time
+struct Statistics
 {
-    auto dx = a.x - b.x;
-    auto dy = a.y - b.y;
-    return std::sqrt(dx * dx + dy * dy);
-}
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+    std::size_t n = 0;
 
-template <typename PointT>
-double distanceZ(const PointT& a, const PointT& b)
-{
-    auto dz = a.z - b.z;
-    return std::abs(dz);
-}
+    void add(const Statistics& other)
+    {
+        x += other.x;
+        y += other.y;
+        z += other.z;
+        n += other.n;
+    }
 
-void merge(pcl::PointIndices& a, pcl::PointIndices& b)
-{
-    a.indices.insert(a.indices.end(), b.indices.begin(), b.indices.end());
-    b.indices.clear();
-}
+    double distanceTo(const Statistics& other) const
+    {
+        const double dx = x / n - other.x / other.n;
+        const double dy = y / n - other.y / other.n;
+        const double dz = z / n - other.z / other.n;
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+};
 
-template <typename PointT>
-PointT calculateMean(const pcl::PointCloud<PointT>& cloud, const pcl::PointIndices& cluster)
+class UnionFind
 {
-    PointT m;
-    m.x = 0;
-    m.y = 0;
-    m.z = 0;
-
-    std::size_t n = cluster.indices.size();
-    for (std::size_t k = 0; k < n; ++k) {
-        const PointT& p = cloud.at(cluster.indices[k]);
-        m.x += p.x;
-        m.y += p.y;
-        m.z += p.z;
+public:
+    UnionFind(std::size_t n) : parent_(n)
+    {
+        for (std::size_t i = 0; i < n; ++i) {
+            parent_[i] = static_cast<int>(i);
+        }
+    }
+
+    int find(int i)
+    {
+        while (parent_[i] != i) {
+            parent_[i] = parent_[parent_[i]];
+            i = parent_[i];
+        }
+        return i;
     }
 
-    m.x /= n;
-    m.y /= n;
-    m.z /= n;
+    /// the smaller root survives, so every set is represented by its first cluster
+    int unite(int a, int b)
+    {
+        a = find(a);
+        b = find(b);
+        if (b < a) {
+            std::swap(a, b);
+        }
+        parent_[b] = a;
+        return a;
+    }
+
+private:
+    std::vector<int> parent_;
+};
 
-    return m;
+/// points of all clusters, sorted by their xy grid cell
+struct GridPoint
+{
+    int64_t cell;
+    int cluster;
+    float x, y, z;
+};
+
+inline int64_t cellKey(int64_t cx, int64_t cy)
+{
+    return static_cast<int64_t>((static_cast<uint64_t>(cx) << 32) ^ (static_cast<uint64_t>(cy) & 0xFFFFFFFF));
 }
 
+}  // namespace merge_clusters
+
 class MergeClusters : public Node
 {
 public:
@@ -137,47 +157,61 @@ public:
         auto out_indices_msg = std::make_shared<std::vector<pcl::PointIndices>>();
         std::vector<pcl::PointIndices>& merged_indices = *out_indices_msg;
 
-        merged_indices = indices;
+        const int clusters = static_cast<int>(indices.size());
+
+        // statistics and xy merge distance of every input cluster
+        std::vector<merge_clusters::Statistics> statistics(clusters);
+        std::vector<double> max_distance_xy(clusters, 0.0);
+        double cell_size = 0.0;
+        for (int c = 0; c < clusters; ++c) {
+            merge_clusters::Statistics& s = statistics[c];
+            for (int i : indices[c].indices) {
+                const PointT& pt = cloud.at(i);
+                if (std::isfinite(pt.x) && std::isfinite(pt.y) && std::isfinite(pt.z)) {
+                    s.x += pt.x;
+                    s.y += pt.y;
+                    s.z += pt.z;
+                    ++s.n;
+                }
+            }
+            if (s.n == 0) {
+                continue;
+            }
+
+            const double d = std::sqrt(s.x * s.x + s.y * s.y + s.z * s.z) / s.n + cluster_distance_xy_distance_offset_;
+            const double factor = cluster_distance_xy_distance_factor_ == 0 ? 1.0 : cluster_distance_xy_distance_factor_ * d;
+            max_distance_xy[c] = cluster_distance_xy_ * factor;
+            cell_size = std::max(cell_size, max_distance_xy[c]);
+        }
 
-        std::map<std::vector<pcl::PointIndices>::iterator, PointT> mean;
-        for (auto it = merged_indices.begin(); it != merged_indices.end(); ++it) {
-            pcl::PointIndices& c1 = *it;
-            mean[it] = calculateMean(cloud, c1);
+        // clusters touching each other: a point pair within the xy and z distances
+        std::vector<std::pair<int, int>> contacts;
+        if (cell_size > 0.0) {
+            findContacts(cloud, indices, max_distance_xy, cell_size, contacts);
+        }
+        std::sort(contacts.begin(), contacts.end());
+
+        // touching clusters are merged if the means of the merged sets are close enough
+        merge_clusters::UnionFind sets(clusters);
+        for (const std::pair<int, int>& contact : contacts) {
+            const int a = sets.find(contact.first);
+            const int b = sets.find(contact.second);
+            if (a != b && statistics[a].distanceTo(statistics[b]) < cluster_max_mean_xyz_) {
+                const int root = sets.unite(a, b);
+                statistics[root].add(statistics[root == a ? b : a]);
+            }
         }
 
-        // cluster euclidean
-        for (auto it = merged_indices.begin(); it != merged_indices.end(); ++it) {
-            pcl::PointIndices& c1 = *it;
-            const PointT& mean1 = mean[it];
-            if (!c1.indices.empty()) {
-                for (auto it2 = it + 1; it2 != merged_indices.end(); ++it2) {
-                    pcl::PointIndices& c2 = *it2;
-                    if (!c2.indices.empty()) {
-                        const PointT& mean2 = mean[it2];
-                        double d = distance(mean2) + cluster_distance_xy_distance_offset_;
-                        double factor = cluster_distance_xy_distance_factor_ == 0 ? 1.0 : cluster_distance_xy_distance_factor_ * d;
-
-                        if (distanceXYZ(mean1, mean2) < cluster_max_mean_xyz_) {
-                            for (std::size_t k = 0, n = c1.indices.size(); k < n; ++k) {
-                                const PointT& p1 = cloud.at(c1.indices[k]);
-
-                                bool merged = false;
-                                for (std::size_t l = 0, n = c2.indices.size(); l < n; ++l) {
-                                    const PointT& p2 = cloud.at(c2.indices[l]);
-                                    if (distanceXY(p1, p2) < cluster_distance_xy_ * factor && distanceZ(p1, p2) < cluster_distance_z_) {
-                                        merge(c1, c2);
-                                        mean[it] = calculateMean(cloud, c1);
-                                        merged = true;
-                                        break;
-                                    }
-                                }
-                                if (merged)
-                                    break;
-                            }
-                        }
-                    }
-                }
+        std::vector<int> output_index(clusters, -1);
+        for (int c = 0; c < clusters; ++c) {
+            const int root = sets.find(c);
+            if (output_index[root] < 0) {
+                output_index[root] = static_cast<int>(merged_indices.size());
+                merged_indices.emplace_back();
+                merged_indices.back().header = indices[root].header;
             }
+            std::vector<int>& target = merged_indices[output_index[root]].indices;
+            target.insert(target.end(), indices[c].indices.begin(), indices[c].indices.end());
         }
 
         for (auto it = merged_indices.begin(); it != merged_indices.end();) {
@@ -205,6 +239,118 @@ public:
         msg::publish<GenericVectorMessage, pcl::PointIndices>(out_, out_indices_msg);
     }
 
+private:
+    /**
+     * Buckets all points into an xy grid with the largest merge distance as cell size,
+     * so touching points are in the same or in neighbouring cells. Only one contact per
+     * cluster pair is needed, so a pair is skipped as soon as it is known to touch.
+     */
+    template <class PointT>
+    void findContacts(const pcl::PointCloud<PointT>& cloud, const std::vector<pcl::PointIndices>& indices, const std::vector<double>& max_distance_xy, double cell_size,
+                      std::vector<std::pair<int, int>>& contacts)
+    {
+        using merge_clusters::GridPoint;
+
+        std::vector<GridPoint> points;
+        for (int c = 0, n = static_cast<int>(indices.size()); c < n; ++c) {
+            if (max_distance_xy[c] <= 0.0) {
+                continue;
+            }
+            for (int i : indices[c].indices) {
+                const PointT& pt = cloud.at(i);
+                if (std::isfinite(pt.x) && std::isfinite(pt.y) && std::isfinite(pt.z)) {
+                    GridPoint gp;
+                    gp.cell = merge_clusters::cellKey(static_cast<int64_t>(std::floor(pt.x / cell_size)), static_cast<int64_t>(std::floor(pt.y / cell_size)));
+                    gp.cluster = c;
+                    gp.x = pt.x;
+                    gp.y = pt.y;
+                    gp.z = pt.z;
+                    points.push_back(gp);
+                }
+            }
+        }
+        std::sort(points.begin(), points.end(), [](const GridPoint& a, const GridPoint& b) { return a.cell != b.cell ? a.cell < b.cell : a.cluster < b.cluster; });
+
+        // every occupied cell is a run of points, each run is sorted by cluster
+        std::unordered_map<int64_t, std::pair<std::size_t, std::size_t>> cells;
+        for (std::size_t begin = 0; begin < points.size();) {
+            std::size_t end = begin + 1;
+            while (end < points.size() && points[end].cell == points[begin].cell) {
+                ++end;
+            }
+            cells[points[begin].cell] = std::make_pair(begin, end);
+            begin = end;
+        }
+
+        std::unordered_set<int64_t> touching;
+        auto pair_key = [](int a, int b) { return (static_cast<int64_t>(std::min(a, b)) << 32) | std::max(a, b); };
+
+        auto touch = [&](std::size_t a_begin, std::size_t a_end, std::size_t b_begin, std::size_t b_end) {
+            const int a = points[a_begin].cluster;
+            const int b = points[b_begin].cluster;
+            if (a == b || touching.count(pair_key(a, b)) > 0) {
+                return;
+            }
+            const double max_xy = std::max(max_distance_xy[a], max_distance_xy[b]);
+            const double max_xy_sqr = max_xy * max_xy;
+            for (std::size_t i = a_begin; i < a_end; ++i) {
+                const GridPoint& p = points[i];
+                for (std::size_t j = b_begin; j < b_end; ++j) {
+                    const GridPoint& q = points[j];
+                    const double dx = p.x - q.x;
+                    const double dy = p.y - q.y;
+                    if (dx * dx + dy * dy < max_xy_sqr && std::abs(p.z - q.z) < cluster_distance_z_) {
+                        touching.insert(pair_key(a, b));
+                        contacts.emplace_back(std::min(a, b), std::max(a, b));
+                        return;
+                    }
+                }
+            }
+        };
+
+        // the cluster runs [begin, end) of a cell
+        auto runs = [&points](std::size_t begin, std::size_t end, std::vector<std::pair<std::size_t, std::size_t>>& out) {
+            out.clear();
+            while (begin < end) {
+                std::size_t run_end = begin + 1;
+                while (run_end < end && points[run_end].cluster == points[begin].cluster) {
+                    ++run_end;
+                }
+                out.emplace_back(begin, run_end);
+                begin = run_end;
+            }
+        };
+
+        // the cell itself and half of its neighbours, so every pair of cells is visited once
+        const int64_t offsets[5][2] = { { 0, 0 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+        std::vector<std::pair<std::size_t, std::size_t>> own_runs;
+        std::vector<std::pair<std::size_t, std::size_t>> other_runs;
+        for (const auto& cell : cells) {
+            const int64_t cx = static_cast<int64_t>(std::floor(points[cell.second.first].x / cell_size));
+            const int64_t cy = static_cast<int64_t>(std::floor(points[cell.second.first].y / cell_size));
+            runs(cell.second.first, cell.second.second, own_runs);
+
+            for (std::size_t a = 0; a < own_runs.size(); ++a) {
+                for (std::size_t b = a + 1; b < own_runs.size(); ++b) {
+                    touch(own_runs[a].first, own_runs[a].second, own_runs[b].first, own_runs[b].second);
+                }
+            }
+
+            for (int o = 1; o < 5; ++o) {
+                auto neighbour = cells.find(merge_clusters::cellKey(cx + offsets[o][0], cy + offsets[o][1]));
+                if (neighbour == cells.end()) {
+                    continue;
+                }
+                runs(neighbour->second.first, neighbour->second.second, other_runs);
+                for (const auto& own : own_runs) {
+                    for (const auto& other : other_runs) {
+                        touch(own.first, own.second, other.first, other.second);
+                    }
+                }
+            }
+        }
+    }
+
 private:
     Input* in_;
     Input* in_indices_;
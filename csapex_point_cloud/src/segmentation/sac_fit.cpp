@@ -19,6 +19,7 @@
 #include <tf/tf.h>
 #include <csapex/utility/suppress_warnings_end.h>
 // clang-format on
+#include <algorithm>
 
 CSAPEX_REGISTER_CLASS(csapex::SacFit, csapex::Node)
 
@@ -47,6 +48,10 @@ void SacFit::setupParameters(Parameterizable& parameters)
 
     parameters.addParameter(param::factory::declareBool("optimize coefficients", true), optimize_coefficients_);
 
+    parameters.addParameter(param::factory::declareBool("find multiple models", false), fit_multiple_models_);
+    parameters.addConditionalParameter(param::factory::declareRange("maximum model count", -1, 100, 5, 1), [this]() { return fit_multiple_models_; }, maximum_model_count_);
+    parameters.addConditionalParameter(param::factory::declareRange("minimum residual cloud size", 0, 20000, 100, 1), [this]() { return fit_multiple_models_; }, minimum_residual_cloud_size_);
+
     std::map<std::string, int> model_types = { { "CIRCLE2D", pcl::SACMODEL_CIRCLE2D },
                                                { "CIRCLE3D", pcl::SACMODEL_CIRCLE3D },
                                                { "CONE", (int)pcl::SACMODEL_CONE },
@@ -132,38 +137,16 @@ void SacFit::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud)
     if (msg::hasMessage(in_indices_)) {
         std::shared_ptr<std::vector<pcl::PointIndices> const> in_indices = msg::getMessage<GenericVectorMessage, pcl::PointIndices>(in_indices_);
         for (const pcl::PointIndices& indices : *in_indices) {
-            pcl::ModelCoefficients::Ptr model_coefficients(new pcl::ModelCoefficients);
-            pcl::PointIndices::Ptr indices_ptr(new pcl::PointIndices(indices));
-            segmenter->setIndices(indices_ptr);
-
-            pcl::PointIndices inliers;
-            segmenter->segment(inliers, *model_coefficients);
-            if ((int)inliers.indices.size() > min_inliers_) {
-                out_indices->emplace_back(inliers);
-
-                ModelMessage model;
-                model.coefficients = model_coefficients;
-                model.probability = segmenter->getProbability();
-                model.frame_id = cloud->header.frame_id;
-                model.model_type = (pcl::SacModel)model_type_;
-                out_models->emplace_back(model);
-            }
+            pcl::IndicesPtr residual(new std::vector<int>(indices.indices));
+            segmentModels<PointT>(*segmenter, cloud, residual, *out_indices, *out_models);
         }
     } else {
-        /// modify for more than one model
-        pcl::ModelCoefficients::Ptr model_coefficients(new pcl::ModelCoefficients);
-        pcl::PointIndices inliers;
-        segmenter->segment(inliers, *model_coefficients);
-        if ((int)inliers.indices.size() > min_inliers_) {
-            out_indices->emplace_back(inliers);
-
-            ModelMessage model;
-            model.coefficients = model_coefficients;
-            model.probability = segmenter->getProbability();
-            model.frame_id = cloud->header.frame_id;
-            model.model_type = (pcl::SacModel)model_type_;
-            out_models->emplace_back(model);
+        pcl::IndicesPtr residual(new std::vector<int>);
+        residual->reserve(cloud->points.size());
+        for (std::size_t i = 0; i < cloud->points.size(); ++i) {
+            residual->push_back(static_cast<int>(i));
         }
+        segmentModels<PointT>(*segmenter, cloud, residual, *out_indices, *out_models);
     }
 
     msg::publish<GenericVectorMessage, pcl::PointIndices>(out_indices_, out_indices);
@@ -172,6 +155,46 @@ void SacFit::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud)
     delete segmenter;
 }
 
+template <class PointT>
+void SacFit::segmentModels(pcl::SACSegmentation<PointT>& segmenter, typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::IndicesPtr residual, std::vector<pcl::PointIndices>& out_indices,
+                           std::vector<ModelMessage>& out_models)
+{
+    /// all rounds share the residual buffer, the inliers of each model are compacted out of it in place
+    std::vector<bool> removed;
+    int model_count = 0;
+    while (!residual->empty()) {
+        if (fit_multiple_models_ && (int)residual->size() < minimum_residual_cloud_size_)
+            break;
+
+        pcl::ModelCoefficients::Ptr model_coefficients(new pcl::ModelCoefficients);
+        pcl::PointIndices inliers;
+        segmenter.setIndices(residual);
+        segmenter.segment(inliers, *model_coefficients);
+        if ((int)inliers.indices.size() <= min_inliers_)
+            break;
+
+        inliers.header = cloud->header;
+        out_indices.emplace_back(inliers);
+
+        ModelMessage model;
+        model.coefficients = model_coefficients;
+        model.probability = segmenter.getProbability();
+        model.frame_id = cloud->header.frame_id;
+        model.model_type = (pcl::SacModel)model_type_;
+        out_models.emplace_back(model);
+
+        ++model_count;
+        if (!fit_multiple_models_ || (maximum_model_count_ != -1 && model_count >= maximum_model_count_))
+            break;
+
+        removed.resize(cloud->points.size(), false);
+        for (int i : inliers.indices) {
+            removed[i] = true;
+        }
+        residual->erase(std::remove_if(residual->begin(), residual->end(), [&removed](int i) { return removed[i]; }), residual->end());
+    }
+}
+
 template <class PointT>
 void SacFit::estimateNormals(typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::PointCloud<pcl::Normal>::Ptr normals)
 {
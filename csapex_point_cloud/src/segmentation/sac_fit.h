@@ -16,6 +16,7 @@
 #include <pcl/features/normal_3d.h>
 #include <pcl/filters/extract_indices.h>
 #include <pcl/sample_consensus/sac_model_normal_parallel_plane.h>
+#include <pcl/segmentation/sac_segmentation.h>
 #if __clang__
 #pragma clang diagnostic pop
 #endif  //__clang__
@@ -58,6 +59,14 @@ private:
     bool from_normals_;
     bool optimize_coefficients_;
 
+    bool fit_multiple_models_;
+    int maximum_model_count_;
+    int minimum_residual_cloud_size_;
+
+    template <class PointT>
+    void segmentModels(pcl::SACSegmentation<PointT>& segmenter, typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::IndicesPtr residual, std::vector<pcl::PointIndices>& out_indices,
+                       std::vector<ModelMessage>& out_models);
+
     template <class PointT>
     void estimateNormals(typename pcl::PointCloud<PointT>::ConstPtr cloud, pcl::PointCloud<pcl::Normal>::Ptr normals);
 
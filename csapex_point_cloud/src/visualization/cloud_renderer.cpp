@@ -7,12 +7,15 @@
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
 
+/// SYSTEM
+#include <pcl/point_types.h>
+
 CSAPEX_REGISTER_CLASS(csapex::CloudRenderer, csapex::Node)
 
 using namespace csapex;
 using namespace csapex::connection_types;
 
-CloudRenderer::CloudRenderer()
+CloudRenderer::CloudRenderer() : software_(false)
 {
 }
 
@@ -61,6 +64,10 @@ void CloudRenderer::setupParameters(Parameterizable& parameters)
     parameters.addParameter(csapex::param::factory::declareBool("~grid/xz", false), refresh);
 
     parameters.addParameter(csapex::param::factory::declareRange("point/size", 1., 30., 5., 0.1), refresh);
+
+    parameters.addParameter(csapex::param::factory::declareBool("render/software",
+                                                                csapex::param::ParameterDescription("Render the output image on the CPU instead of the OpenGL view, works without a GUI"), false),
+                            software_);
 }
 
 void CloudRenderer::setup(NodeModifier& node_modifier)
@@ -86,7 +93,13 @@ void CloudRenderer::beginProcess(csapex::NodeModifier& node_modifier, Parameteri
 
     display_request();
 
-    if (!msg::isConnected(output_)) {
+    if (software_) {
+        if (msg::isConnected(output_)) {
+            boost::apply_visitor(PointCloudMessage::Dispatch<CloudRenderer>(this, msg), msg->value);
+        }
+        done();
+
+    } else if (!msg::isConnected(output_)) {
         done();
     }
 }
@@ -111,6 +124,11 @@ bool CloudRenderer::isOutputConnected() const
     return msg::isConnected(output_);
 }
 
+bool CloudRenderer::isSoftwareRendering() const
+{
+    return software_;
+}
+
 void CloudRenderer::refresh()
 {
     refresh_request();
@@ -125,3 +143,196 @@ void CloudRenderer::publishImage(const cv::Mat& img)
 
     done();
 }
+
+namespace
+{
+enum Component
+{
+    X,
+    Y,
+    Z,
+    I,
+    AUTO
+};
+
+template <class PointT>
+double intensity(const PointT&)
+{
+    return 0.0;
+}
+
+double intensity(const pcl::PointXYZI& pt)
+{
+    return pt.intensity;
+}
+
+template <class PointT>
+bool pointColor(const PointT&, cv::Vec3b&)
+{
+    return false;
+}
+
+bool pointColor(const pcl::PointXYZRGB& pt, cv::Vec3b& color)
+{
+    color = cv::Vec3b(pt.b, pt.g, pt.r);
+    return true;
+}
+
+template <class PointT>
+double access(const PointT& pt, Component component)
+{
+    switch (component) {
+        case X:
+            return pt.x;
+        case Y:
+            return pt.y;
+        case Z:
+            return pt.z;
+        case I:
+            return intensity(pt);
+        default:
+            return 0.0;
+    }
+}
+
+cv::Vec3b readColor(Parameterizable& parameters, const std::string& name)
+{
+    const std::vector<int>& c = parameters.readParameter<std::vector<int>>(name);
+    return cv::Vec3b(c[2], c[1], c[0]);
+}
+
+// adapted from RVIZ, same as in the adapter
+cv::Vec3b rainbowColor(float value)
+{
+    value = std::max(std::min(value, 1.0f), 0.0f);
+
+    float h = value * 5.0f + 1.0f;
+    int i = std::floor(h);
+    float f = h - i;
+    if (!(i & 1))
+        f = 1 - f;  // if i is even
+    float n = 1 - f;
+
+    cv::Vec3f rgb;
+    if (i <= 1)
+        rgb = cv::Vec3f(n, 0, 1);
+    else if (i == 2)
+        rgb = cv::Vec3f(0, n, 1);
+    else if (i == 3)
+        rgb = cv::Vec3f(0, 1, n);
+    else if (i == 4)
+        rgb = cv::Vec3f(n, 1, 0);
+    else
+        rgb = cv::Vec3f(1, n, 0);
+
+    return cv::Vec3b(cv::saturate_cast<uchar>(rgb[2] * 255), cv::saturate_cast<uchar>(rgb[1] * 255), cv::saturate_cast<uchar>(rgb[0] * 255));
+}
+
+}  // namespace
+
+template <class PointT>
+void CloudRenderer::inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud)
+{
+    const std::string field = readParameter<std::string>("color/field");
+    Component component = AUTO;
+    if (field == "x") {
+        component = X;
+    } else if (field == "y") {
+        component = Y;
+    } else if (field == "z") {
+        component = Z;
+    } else if (field == "intensity" || field == "i") {
+        component = I;
+    }
+
+    std::vector<cv::Point3f> points;
+    std::vector<cv::Vec3b> colors;
+    points.reserve(cloud->points.size());
+    colors.reserve(cloud->points.size());
+
+    cv::Vec3b color;
+    const bool rgb = component == AUTO && !cloud->points.empty() && pointColor(cloud->points.front(), color);
+    if (rgb) {
+        for (const PointT& pt : cloud->points) {
+            pointColor(pt, color);
+            points.emplace_back(pt.x, pt.y, pt.z);
+            colors.push_back(color);
+        }
+
+    } else {
+        double min = std::numeric_limits<double>::max();
+        double max = std::numeric_limits<double>::lowest();
+        for (const PointT& pt : cloud->points) {
+            const double v = access(pt, component);
+            min = std::min(min, v);
+            max = std::max(max, v);
+        }
+        const double span = max > min ? max - min : 1.0;
+
+        const bool rainbow = readParameter<bool>("color/rainbow");
+        const cv::Vec3f start = readColor(*this, "color/gradient/start");
+        const cv::Vec3f end = readColor(*this, "color/gradient/end");
+
+        for (const PointT& pt : cloud->points) {
+            const double f = (access(pt, component) - min) / span;
+            if (rainbow) {
+                color = rainbowColor(f);
+            } else {
+                const cv::Vec3f c = f * start + (1.0 - f) * end;
+                color = cv::Vec3b(cv::saturate_cast<uchar>(c[0]), cv::saturate_cast<uchar>(c[1]), cv::saturate_cast<uchar>(c[2]));
+            }
+            points.emplace_back(pt.x, pt.y, pt.z);
+            colors.push_back(color);
+        }
+    }
+
+    const bool sync = readParameter<bool>("~size/out/sync");
+
+    SoftwareRenderer::Camera camera;
+    camera.width = readParameter<int>(sync ? "~size/width" : "~size/out/width");
+    camera.height = readParameter<int>(sync ? "~size/height" : "~size/out/height");
+    camera.r = readParameter<double>("~view/r");
+    camera.theta = readParameter<double>("~view/theta");
+    camera.phi = readParameter<double>("~view/phi");
+    camera.offset = cv::Point3d(readParameter<double>("~view/dx"), readParameter<double>("~view/dy"), readParameter<double>("~view/dz"));
+
+    renderer_.begin(camera, readColor(*this, "color/background"));
+    renderer_.drawPoints(points, colors, readParameter<double>("point/size"));
+    renderAugmentation();
+
+    CvMatMessage::Ptr msg(new CvMatMessage(enc::bgr, cloud->header.frame_id, cloud->header.stamp));
+    renderer_.image().copyTo(msg->value);
+    result_ = msg;
+}
+
+void CloudRenderer::renderAugmentation()
+{
+    const cv::Vec3b grid = readColor(*this, "color/grid");
+    const int size = readParameter<int>("~grid/size");
+    const double resolution = readParameter<double>("~grid/resolution");
+    const double dim = resolution * size / 2.0;
+    const double width = 1.5;
+
+    for (int i = 0; i <= size; ++i) {
+        const double v = -dim + i * resolution;
+        if (readParameter<bool>("~grid/xy")) {
+            renderer_.drawLine(cv::Point3d(v, -dim, 0), cv::Point3d(v, dim, 0), grid, width);
+            renderer_.drawLine(cv::Point3d(-dim, v, 0), cv::Point3d(dim, v, 0), grid, width);
+        }
+        if (readParameter<bool>("~grid/yz")) {
+            renderer_.drawLine(cv::Point3d(0, v, -dim), cv::Point3d(0, v, dim), grid, width);
+            renderer_.drawLine(cv::Point3d(0, -dim, v), cv::Point3d(0, dim, v), grid, width);
+        }
+        if (readParameter<bool>("~grid/xz")) {
+            renderer_.drawLine(cv::Point3d(v, 0, -dim), cv::Point3d(v, 0, dim), grid, width);
+            renderer_.drawLine(cv::Point3d(-dim, 0, v), cv::Point3d(dim, 0, v), grid, width);
+        }
+    }
+
+    if (readParameter<bool>("show axes")) {
+        const double d = 0.5;
+        renderer_.drawLine(cv::Point3d(0, 0, 0), cv::Point3d(d, 0, 0), cv::Vec3b(0, 0, 255), 3.0);
+        renderer_.drawLine(cv::Point3d(0, 0, 0), cv::Point3d(0, d, 0), cv::Vec3b(0, 255, 0), 3.0);
+        renderer_.drawLine(cv::Point3d(0, 0, 0), cv::Point3d(0, 0, d), cv::Vec3b(255, 0, 0), 3.0);
+    }
+}
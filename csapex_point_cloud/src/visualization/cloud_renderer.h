@@ -6,6 +6,9 @@
 #include <csapex_opencv/cv_mat_message.h>
 #include <csapex_point_cloud/msg/point_cloud_message.h>
 
+/// COMPONENT
+#include "software_renderer.h"
+
 namespace csapex
 {
 class CloudRenderer : public InteractiveNode
@@ -23,9 +26,14 @@ public:
 
     connection_types::PointCloudMessage::ConstPtr getMessage() const;
     bool isOutputConnected() const;
+    bool isSoftwareRendering() const;
+
+    template <class PointT>
+    void inputCloud(typename pcl::PointCloud<PointT>::ConstPtr cloud);
 
 private:
     void refresh();
+    void renderAugmentation();
 
 private:
     Input* input_;
@@ -40,6 +48,9 @@ private:
     connection_types::PointCloudMessage::ConstPtr message_;
 
     connection_types::CvMatMessage::Ptr result_;
+
+    bool software_;
+    SoftwareRenderer renderer_;
 };
 
 }  // namespace csapex
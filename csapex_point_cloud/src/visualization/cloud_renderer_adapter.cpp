@@ -287,7 +287,7 @@ void CloudRendererAdapter::paintGLImpl(bool request)
     view_->blockSignals(false);
     //    view_->scene()->update();
 
-    if (n->isOutputConnected() && request) {
+    if (n->isOutputConnected() && !n->isSoftwareRendering() && request) {
         cv::Mat mat = QtCvImageConverter::Converter::QImage2Mat(img);
         n->publishImage(mat);
     }
@@ -0,0 +1,205 @@
+/// HEADER
+#include "software_renderer.h"
+
+/// PROJECT
+#include <csapex_opencv/parallel.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <limits>
+
+using namespace csapex;
+
+namespace
+{
+const int TILE_SIZE = 64;
+const int BLOCK_SIZE = 16384;
+
+cv::Point3d normalized(const cv::Point3d& v)
+{
+    const double n = cv::norm(v);
+    return n > 0.0 ? v * (1.0 / n) : v;
+}
+
+}  // namespace
+
+SoftwareRenderer::SoftwareRenderer() : focal_x_(1.0), focal_y_(1.0), tiles_x_(0), tiles_y_(0)
+{
+}
+
+void SoftwareRenderer::begin(const Camera& camera, const cv::Vec3b& background)
+{
+    camera_ = camera;
+    camera_.width = std::max(1, camera_.width);
+    camera_.height = std::max(1, camera_.height);
+
+    // same as QMatrix4x4::lookAt with eye + offset, center = offset and up = z
+    const cv::Point3d direction(std::sin(camera_.theta) * std::cos(camera_.phi), std::sin(camera_.theta) * std::sin(camera_.phi), std::cos(camera_.theta));
+    eye_ = camera_.offset - camera_.r * direction;
+    forward_ = normalized(camera_.offset - eye_);
+    side_ = normalized(forward_.cross(cv::Point3d(0, 0, 1)));
+    if (cv::norm(side_) == 0.0) {
+        side_ = cv::Point3d(0, -1, 0);
+    }
+    up_ = side_.cross(forward_);
+
+    focal_y_ = 1.0 / std::tan(camera_.fov_y / 2.0);
+    focal_x_ = focal_y_ * camera_.height / camera_.width;
+
+    image_.create(camera_.height, camera_.width, CV_8UC3);
+    image_.setTo(cv::Scalar(background[0], background[1], background[2]));
+    depth_.create(camera_.height, camera_.width, CV_32FC1);
+    depth_.setTo(cv::Scalar(std::numeric_limits<float>::infinity()));
+
+    tiles_x_ = (camera_.width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y_ = (camera_.height + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+const cv::Mat& SoftwareRenderer::image() const
+{
+    return image_;
+}
+
+bool SoftwareRenderer::toCamera(const cv::Point3d& p, cv::Point3d& camera) const
+{
+    const cv::Point3d d = p - eye_;
+    camera = cv::Point3d(side_.dot(d), up_.dot(d), forward_.dot(d));
+    return camera.z > camera_.near_plane && camera.z < camera_.far_plane;
+}
+
+bool SoftwareRenderer::project(const cv::Point3d& camera, cv::Point2d& pixel) const
+{
+    const double x = focal_x_ * camera.x / camera.z;
+    const double y = focal_y_ * camera.y / camera.z;
+    pixel.x = (x + 1.0) * 0.5 * camera_.width;
+    pixel.y = (1.0 - y) * 0.5 * camera_.height;
+    return std::isfinite(pixel.x) && std::isfinite(pixel.y);
+}
+
+bool SoftwareRenderer::footprint(const cv::Point2d& pixel, double depth, int size, Splat& splat) const
+{
+    // all pixels whose center lies inside the square, like glPointSize without smoothing
+    const double lo_x = std::floor(pixel.x - size * 0.5 + 0.5);
+    const double lo_y = std::floor(pixel.y - size * 0.5 + 0.5);
+    if (lo_x >= camera_.width || lo_y >= camera_.height || lo_x + size <= 0 || lo_y + size <= 0) {
+        return false;
+    }
+
+    splat.x0 = std::max(0, static_cast<int>(lo_x));
+    splat.y0 = std::max(0, static_cast<int>(lo_y));
+    splat.x1 = std::min(camera_.width, static_cast<int>(lo_x) + size);
+    splat.y1 = std::min(camera_.height, static_cast<int>(lo_y) + size);
+    splat.depth = static_cast<float>(depth);
+    return true;
+}
+
+void SoftwareRenderer::drawSplat(const Splat& splat, const cv::Vec3b& color)
+{
+    for (int y = splat.y0; y < splat.y1; ++y) {
+        float* depth = depth_.ptr<float>(y);
+        cv::Vec3b* pixel = image_.ptr<cv::Vec3b>(y);
+        for (int x = splat.x0; x < splat.x1; ++x) {
+            if (splat.depth < depth[x]) {
+                depth[x] = splat.depth;
+                pixel[x] = color;
+            }
+        }
+    }
+}
+
+void SoftwareRenderer::drawPoints(const std::vector<cv::Point3f>& points, const std::vector<cv::Vec3b>& colors, double point_size)
+{
+    CV_Assert(points.size() == colors.size());
+
+    const int n = static_cast<int>(points.size());
+    const int blocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    const int tiles = tiles_x_ * tiles_y_;
+    const int size = std::max(1, static_cast<int>(std::round(point_size)));
+
+    splats_.resize(n);
+    bins_.resize(blocks);
+
+    // project each block and sort its splats into the tiles
+    parallel::forRange(blocks, [&](const cv::Range& range) {
+        for (int b = range.start; b < range.end; ++b) {
+            std::vector<std::vector<int>>& bins = bins_[b];
+            bins.resize(tiles);
+            for (std::vector<int>& bin : bins) {
+                bin.clear();
+            }
+
+            const int end = std::min(n, (b + 1) * BLOCK_SIZE);
+            for (int i = b * BLOCK_SIZE; i < end; ++i) {
+                const cv::Point3f& pt = points[i];
+                cv::Point3d camera;
+                cv::Point2d pixel;
+                Splat& splat = splats_[i];
+                if (!toCamera(cv::Point3d(pt.x, pt.y, pt.z), camera) || !project(camera, pixel) || !footprint(pixel, camera.z, size, splat)) {
+                    continue;
+                }
+
+                const int tx1 = (splat.x1 - 1) / TILE_SIZE;
+                const int ty1 = (splat.y1 - 1) / TILE_SIZE;
+                for (int ty = splat.y0 / TILE_SIZE; ty <= ty1; ++ty) {
+                    for (int tx = splat.x0 / TILE_SIZE; tx <= tx1; ++tx) {
+                        bins[ty * tiles_x_ + tx].push_back(i);
+                    }
+                }
+            }
+        }
+    });
+
+    // merge the blocks per tile, in point order
+    parallel::forRange(tiles, [&](const cv::Range& range) {
+        for (int t = range.start; t < range.end; ++t) {
+            const int tx0 = (t % tiles_x_) * TILE_SIZE;
+            const int ty0 = (t / tiles_x_) * TILE_SIZE;
+            for (int b = 0; b < blocks; ++b) {
+                for (int i : bins_[b][t]) {
+                    Splat clipped = splats_[i];
+                    clipped.x0 = std::max(clipped.x0, tx0);
+                    clipped.y0 = std::max(clipped.y0, ty0);
+                    clipped.x1 = std::min(clipped.x1, tx0 + TILE_SIZE);
+                    clipped.y1 = std::min(clipped.y1, ty0 + TILE_SIZE);
+                    drawSplat(clipped, colors[i]);
+                }
+            }
+        }
+    });
+}
+
+void SoftwareRenderer::drawLine(const cv::Point3d& a, const cv::Point3d& b, const cv::Vec3b& color, double width)
+{
+    cv::Point3d ca, cb;
+    toCamera(a, ca);
+    toCamera(b, cb);
+
+    // clip against the near plane
+    const double near_plane = camera_.near_plane * 2.0;
+    if (ca.z < near_plane && cb.z < near_plane) {
+        return;
+    }
+    if (ca.z < near_plane) {
+        ca += (cb - ca) * ((near_plane - ca.z) / (cb.z - ca.z));
+    } else if (cb.z < near_plane) {
+        cb += (ca - cb) * ((near_plane - cb.z) / (ca.z - cb.z));
+    }
+
+    cv::Point2d pa, pb;
+    if (!project(ca, pa) || !project(cb, pb)) {
+        return;
+    }
+
+    // sample the segment in 3d, so that the depth stays perspective correct
+    const double length = std::max(std::abs(pb.x - pa.x), std::abs(pb.y - pa.y));
+    const int steps = static_cast<int>(std::min(std::ceil(length), 16.0 * (camera_.width + camera_.height))) + 1;
+    const int size = std::max(1, static_cast<int>(std::round(width)));
+    for (int s = 0; s <= steps; ++s) {
+        const cv::Point3d c = ca + (cb - ca) * (static_cast<double>(s) / steps);
+        cv::Point2d pixel;
+        Splat splat;
+        if (c.z < camera_.far_plane && project(c, pixel) && footprint(pixel, c.z, size, splat)) {
+            drawSplat(splat, color);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#ifndef SOFTWARE_RENDERER_H
+#define SOFTWARE_RENDERER_H
+
+/// SYSTEM
+#include <cmath>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The SoftwareRenderer class renders colored points and lines into a BGR image on the CPU.
+ *
+ * The camera matches the OpenGL view of the CloudRendererAdapter: it orbits the
+ * offset at distance r with the angles theta and phi, z pointing up, with a
+ * perspective projection of 45 degrees vertical field of view.
+ *
+ * Points are drawn as squares of point_size pixels with a depth test. They are
+ * projected in parallel blocks, each block sorting its splats into the image
+ * tiles they cover. The tiles are then rasterized in parallel, visiting the
+ * blocks in order, so every pixel is written by one thread only and the result
+ * equals a sequential z-buffer.
+ */
+class SoftwareRenderer
+{
+public:
+    struct Camera
+    {
+        Camera() : width(400), height(400), r(10.0), theta(M_PI / 2), phi(0.0), offset(0.0, 0.0, 0.0), fov_y(M_PI / 4), near_plane(0.0001), far_plane(300.0)
+        {
+        }
+
+        int width;
+        int height;
+
+        double r;
+        double theta;
+        double phi;
+        cv::Point3d offset;
+
+        double fov_y;
+        double near_plane;
+        double far_plane;
+    };
+
+public:
+    SoftwareRenderer();
+
+    /// clears color and depth, buffers are kept if the size did not change
+    void begin(const Camera& camera, const cv::Vec3b& background);
+
+    /// @param colors one BGR color per point
+    void drawPoints(const std::vector<cv::Point3f>& points, const std::vector<cv::Vec3b>& colors, double point_size);
+    void drawLine(const cv::Point3d& a, const cv::Point3d& b, const cv::Vec3b& color, double width);
+
+    /// CV_8UC3, BGR
+    const cv::Mat& image() const;
+
+private:
+    struct Splat
+    {
+        int x0, y0, x1, y1;
+        float depth;
+    };
+
+    bool toCamera(const cv::Point3d& p, cv::Point3d& camera) const;
+    bool project(const cv::Point3d& camera, cv::Point2d& pixel) const;
+    bool footprint(const cv::Point2d& pixel, double depth, int size, Splat& splat) const;
+    void drawSplat(const Splat& splat, const cv::Vec3b& color);
+
+private:
+    Camera camera_;
+
+    cv::Point3d eye_;
+    cv::Point3d side_;
+    cv::Point3d up_;
+    cv::Point3d forward_;
+    double focal_x_;
+    double focal_y_;
+
+    cv::Mat image_;
+    cv::Mat depth_;
+
+    int tiles_x_;
+    int tiles_y_;
+    std::vector<Splat> splats_;
+    /// per block and tile, the points whose splat overlaps the tile
+    std::vector<std::vector<std::vector<int>>> bins_;
+};
+
+}  // namespace csapex
+
+#endif  // SOFTWARE_RENDERER_H
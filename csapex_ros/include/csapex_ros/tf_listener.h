@@ -5,6 +5,7 @@
 #include <csapex/utility/assert.h>
 #include <csapex/utility/singleton.hpp>
 #include <csapex_ros/ros_handler.h>
+#include <csapex_ros/transform_lookup.h>
 
 /// SYSTEM
 // clang-format off
@@ -27,12 +28,16 @@ public:
 
     static LockedTFListener getLocked();
 
+    /// event-driven lookups, does not require the listener lock
+    static std::shared_ptr<TransformLookup> getLookup();
+
     static void start();
     static void stop();
 
     void reset()
     {
         tfl->clear();
+        lookup_->clear();
         std::cout << "reset tf listener" << std::endl;
         tfl.reset(new tf::TransformListener);
     }
@@ -44,6 +49,8 @@ private:
     TFListener();
 
     void cb(const tf::tfMessage::ConstPtr& msg);
+    void updateReferenceFrame(const tf::tfMessage::ConstPtr& msg);
+    void staticCb(const tf::tfMessage::ConstPtr& msg);
     bool tryFrameAsReference(const tf::tfMessage::ConstPtr& msg, const std::string& frame);
 
     int retries;
@@ -51,6 +58,9 @@ private:
     bool init;
     ros::Time last_;
     ros::Subscriber tf_sub;
+    ros::Subscriber tf_static_sub;
+
+    std::shared_ptr<TransformLookup> lookup_;
 
     std::mutex m;
 };
@@ -0,0 +1,120 @@
+#ifndef TRANSFORM_LOOKUP_H
+#define TRANSFORM_LOOKUP_H
+
+/// SYSTEM
+// clang-format off
+#include <csapex/utility/suppress_warnings_start.h>
+#include <ros/time.h>
+#include <tf/transform_datatypes.h>
+#include <tf2_msgs/TFMessage.h>
+#include <csapex/utility/suppress_warnings_end.h>
+// clang-format on
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The TransformLookup class answers source -> target queries from
+ *        per-edge transform buffers.
+ *
+ * The chain of edges connecting two frames is resolved once and cached until
+ * the structure of the tree changes. A lookup interpolates every edge of the
+ * chain directly, without walking the tree again.
+ * Waiting lookups sleep on a condition variable and are woken whenever new
+ * transforms are added, there is no polling.
+ *
+ * Transforms are fed with addTransform, either by TFListener or directly, which
+ * allows using the lookup without a running ROS master.
+ */
+class TransformLookup
+{
+public:
+    enum class Result
+    {
+        /// the transform could be computed
+        OK,
+        /// the transform may become available when more data arrives
+        PENDING,
+        /// the transform cannot be computed, waiting does not help
+        FAILED
+    };
+
+public:
+    TransformLookup(const ros::Duration& cache_time = ros::Duration(10.0));
+
+    void addTransform(const tf::StampedTransform& transform, bool is_static = false);
+    void addTransforms(const tf2_msgs::TFMessage& msg, bool is_static = false);
+
+    void clear();
+
+    /**
+     * @brief lookupTransform computes the transform from source to target frame
+     * @param time stamp of the transform, ros::Time(0) for the latest common time
+     * @return OK, if the transform has been written to transform
+     */
+    Result lookupTransform(const std::string& target, const std::string& source, const ros::Time& time, tf::StampedTransform& transform) const;
+
+    /**
+     * @brief waitForTransform blocks until the transform can be computed or the timeout has passed
+     * @return true, if the transform has been written to transform
+     */
+    bool waitForTransform(const std::string& target, const std::string& source, const ros::Time& time, const ros::WallDuration& timeout, tf::StampedTransform& transform) const;
+
+    bool canTransform(const std::string& target, const std::string& source, const ros::Time& time) const;
+
+    std::vector<std::string> getFrameStrings() const;
+
+private:
+    struct Edge
+    {
+        std::string child;
+        std::string parent;
+        bool is_static;
+
+        /// transforms parent <- child, sorted by time
+        std::deque<tf::StampedTransform> buffer;
+    };
+
+    struct Chain
+    {
+        std::size_t generation;
+        bool valid;
+
+        /// edges from the source frame up to the common ancestor
+        std::vector<const Edge*> source_up;
+        /// edges from the target frame up to the common ancestor
+        std::vector<const Edge*> target_up;
+    };
+
+    void addTransformLocked(const tf::StampedTransform& transform, bool is_static);
+    Result lookupLocked(const std::string& target, const std::string& source, const ros::Time& time, tf::StampedTransform& transform) const;
+
+    const Chain& getChain(const std::string& target, const std::string& source) const;
+
+    static Result interpolate(const Edge& edge, const ros::Time& time, tf::Transform& transform);
+    static std::string strip(const std::string& frame);
+
+private:
+    ros::Duration cache_time_;
+
+    mutable std::mutex mutex_;
+    mutable std::condition_variable transforms_added_;
+
+    /// child frame -> edge to the parent frame
+    std::unordered_map<std::string, std::unique_ptr<Edge>> edges_;
+
+    /// incremented whenever an edge is added or re-parented, cached chains of older generations are resolved again
+    std::size_t generation_;
+    mutable std::map<std::pair<std::string, std::string>, Chain> chains_;
+};
+
+}  // namespace csapex
+
+#endif  // TRANSFORM_LOOKUP_H
@@ -6,11 +6,16 @@
 
 using namespace csapex;
 
-TFListener::TFListener()
+TFListener::TFListener() : lookup_(std::make_shared<TransformLookup>())
 {
     init = false;
 }
 
+std::shared_ptr<TransformLookup> TFListener::getLookup()
+{
+    return instance().lookup_;
+}
+
 LockedTFListener TFListener::getLocked()
 {
     TFListener* l = &instance();
@@ -27,6 +32,7 @@ void TFListener::start()
 
     i->tfl.reset(new tf::TransformListener);
     i->tf_sub = ROSHandler::instance().nh()->subscribe<tf::tfMessage>("/tf", 0, std::bind(&TFListener::cb, i, std::placeholders::_1));
+    i->tf_static_sub = ROSHandler::instance().nh()->subscribe<tf::tfMessage>("/tf_static", 0, std::bind(&TFListener::staticCb, i, std::placeholders::_1));
     i->retries = 10;
 }
 
@@ -41,7 +47,18 @@ bool TFListener::ok()
     return init && tfl;
 }
 
+void TFListener::staticCb(const tf::tfMessage::ConstPtr& msg)
+{
+    lookup_->addTransforms(*msg, true);
+}
+
 void TFListener::cb(const tf::tfMessage::ConstPtr& msg)
+{
+    updateReferenceFrame(msg);
+    lookup_->addTransforms(*msg);
+}
+
+void TFListener::updateReferenceFrame(const tf::tfMessage::ConstPtr& msg)
 {
     ros::Time now;
     if (init) {
@@ -107,4 +124,6 @@ void TFListener::addTransforms(const tf2_msgs::TFMessage& msg)
         trafo.stamp_ = trafo_msg.header.stamp;
         tfl->setTransform(trafo, "TFListener");
     }
+
+    lookup_->addTransforms(msg);
 }
@@ -0,0 +1,293 @@
+/// HEADER
+#include <csapex_ros/transform_lookup.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <chrono>
+
+using namespace csapex;
+
+namespace
+{
+bool stampLess(const tf::StampedTransform& a, const tf::StampedTransform& b)
+{
+    return a.stamp_ < b.stamp_;
+}
+}  // namespace
+
+TransformLookup::TransformLookup(const ros::Duration& cache_time) : cache_time_(cache_time), generation_(1)
+{
+}
+
+std::string TransformLookup::strip(const std::string& frame)
+{
+    if (!frame.empty() && frame[0] == '/') {
+        return frame.substr(1);
+    }
+    return frame;
+}
+
+void TransformLookup::addTransform(const tf::StampedTransform& transform, bool is_static)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        addTransformLocked(transform, is_static);
+    }
+
+    transforms_added_.notify_all();
+}
+
+void TransformLookup::addTransforms(const tf2_msgs::TFMessage& msg, bool is_static)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (const geometry_msgs::TransformStamped& trafo_msg : msg.transforms) {
+            tf::StampedTransform trafo;
+            tf::transformStampedMsgToTF(trafo_msg, trafo);
+            addTransformLocked(trafo, is_static);
+        }
+    }
+
+    // wake the waiters once per message
+    transforms_added_.notify_all();
+}
+
+void TransformLookup::addTransformLocked(const tf::StampedTransform& transform, bool is_static)
+{
+    std::string child = strip(transform.child_frame_id_);
+    std::string parent = strip(transform.frame_id_);
+    if (child.empty() || parent.empty() || child == parent) {
+        return;
+    }
+
+    std::unique_ptr<Edge>& edge = edges_[child];
+    if (!edge) {
+        edge.reset(new Edge);
+        edge->child = child;
+        edge->parent = parent;
+        edge->is_static = is_static;
+        ++generation_;
+
+    } else if (edge->parent != parent || edge->is_static != is_static) {
+        edge->parent = parent;
+        edge->is_static = is_static;
+        edge->buffer.clear();
+        ++generation_;
+    }
+
+    std::deque<tf::StampedTransform>& buffer = edge->buffer;
+    if (is_static) {
+        buffer.assign(1, transform);
+
+    } else if (buffer.empty() || buffer.back().stamp_ < transform.stamp_) {
+        buffer.push_back(transform);
+
+    } else {
+        auto pos = std::lower_bound(buffer.begin(), buffer.end(), transform, &stampLess);
+        if (pos != buffer.end() && pos->stamp_ == transform.stamp_) {
+            *pos = transform;
+        } else {
+            buffer.insert(pos, transform);
+        }
+    }
+
+    while (buffer.size() > 1 && buffer.back().stamp_ - buffer.front().stamp_ > cache_time_) {
+        buffer.pop_front();
+    }
+}
+
+void TransformLookup::clear()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    edges_.clear();
+    chains_.clear();
+}
+
+std::vector<std::string> TransformLookup::getFrameStrings() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    std::vector<std::string> frames;
+    for (const auto& pair : edges_) {
+        const Edge& edge = *pair.second;
+        frames.push_back(edge.child);
+        if (edges_.find(edge.parent) == edges_.end()) {
+            frames.push_back(edge.parent);
+        }
+    }
+
+    std::sort(frames.begin(), frames.end());
+    frames.erase(std::unique(frames.begin(), frames.end()), frames.end());
+    return frames;
+}
+
+TransformLookup::Result TransformLookup::lookupTransform(const std::string& target, const std::string& source, const ros::Time& time, tf::StampedTransform& transform) const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    return lookupLocked(strip(target), strip(source), time, transform);
+}
+
+bool TransformLookup::canTransform(const std::string& target, const std::string& source, const ros::Time& time) const
+{
+    tf::StampedTransform transform;
+    return lookupTransform(target, source, time, transform) == Result::OK;
+}
+
+bool TransformLookup::waitForTransform(const std::string& target, const std::string& source, const ros::Time& time, const ros::WallDuration& timeout,
+                                       tf::StampedTransform& transform) const
+{
+    const std::string target_frame = strip(target);
+    const std::string source_frame = strip(source);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeout.toNSec());
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        Result result = lookupLocked(target_frame, source_frame, time, transform);
+        if (result != Result::PENDING) {
+            return result == Result::OK;
+        }
+
+        if (transforms_added_.wait_until(lock, deadline) == std::cv_status::timeout) {
+            return lookupLocked(target_frame, source_frame, time, transform) == Result::OK;
+        }
+    }
+}
+
+const TransformLookup::Chain& TransformLookup::getChain(const std::string& target, const std::string& source) const
+{
+    Chain& chain = chains_[std::make_pair(target, source)];
+    if (chain.generation == generation_) {
+        // unconnected frames are cached as well, they are resolved again once the tree changes
+        return chain;
+    }
+
+    chain.generation = generation_;
+    chain.valid = false;
+    chain.source_up.clear();
+    chain.target_up.clear();
+
+    // collect all ancestors of the source frame, the edge count bounds the depth in case of cycles
+    std::vector<std::string> source_frames(1, source);
+    for (std::size_t depth = 0; depth < edges_.size(); ++depth) {
+        auto pos = edges_.find(source_frames.back());
+        if (pos == edges_.end()) {
+            break;
+        }
+        chain.source_up.push_back(pos->second.get());
+        source_frames.push_back(pos->second->parent);
+    }
+
+    // climb from the target frame until a common ancestor is found
+    std::string frame = target;
+    for (std::size_t depth = 0; depth <= edges_.size(); ++depth) {
+        auto common = std::find(source_frames.begin(), source_frames.end(), frame);
+        if (common != source_frames.end()) {
+            chain.source_up.resize(common - source_frames.begin());
+            chain.valid = true;
+            break;
+        }
+
+        auto pos = edges_.find(frame);
+        if (pos == edges_.end()) {
+            break;
+        }
+        chain.target_up.push_back(pos->second.get());
+        frame = pos->second->parent;
+    }
+
+    if (!chain.valid) {
+        chain.source_up.clear();
+        chain.target_up.clear();
+    }
+
+    return chain;
+}
+
+TransformLookup::Result TransformLookup::lookupLocked(const std::string& target, const std::string& source, const ros::Time& time, tf::StampedTransform& transform) const
+{
+    const Chain& chain = getChain(target, source);
+    if (!chain.valid) {
+        // the frames might get connected later
+        return Result::PENDING;
+    }
+
+    ros::Time stamp = time;
+    if (stamp.isZero()) {
+        // latest common time of all non-static edges
+        bool first = true;
+        for (const std::vector<const Edge*>* edges : { &chain.source_up, &chain.target_up }) {
+            for (const Edge* edge : *edges) {
+                if (edge->is_static) {
+                    continue;
+                }
+                if (edge->buffer.empty()) {
+                    return Result::PENDING;
+                }
+                const ros::Time& newest = edge->buffer.back().stamp_;
+                if (first || newest < stamp) {
+                    stamp = newest;
+                    first = false;
+                }
+            }
+        }
+    }
+
+    tf::Transform source_to_common = tf::Transform::getIdentity();
+    for (const Edge* edge : chain.source_up) {
+        tf::Transform t;
+        Result result = interpolate(*edge, stamp, t);
+        if (result != Result::OK) {
+            return result;
+        }
+        source_to_common = t * source_to_common;
+    }
+
+    tf::Transform target_to_common = tf::Transform::getIdentity();
+    for (const Edge* edge : chain.target_up) {
+        tf::Transform t;
+        Result result = interpolate(*edge, stamp, t);
+        if (result != Result::OK) {
+            return result;
+        }
+        target_to_common = t * target_to_common;
+    }
+
+    transform = tf::StampedTransform(target_to_common.inverse() * source_to_common, stamp, target, source);
+    return Result::OK;
+}
+
+TransformLookup::Result TransformLookup::interpolate(const Edge& edge, const ros::Time& time, tf::Transform& transform)
+{
+    const std::deque<tf::StampedTransform>& buffer = edge.buffer;
+    if (buffer.empty()) {
+        return Result::PENDING;
+    }
+
+    if (edge.is_static) {
+        transform = buffer.front();
+        return Result::OK;
+    }
+
+    if (time > buffer.back().stamp_) {
+        return Result::PENDING;
+    }
+    if (time < buffer.front().stamp_) {
+        return Result::FAILED;
+    }
+
+    tf::StampedTransform key;
+    key.stamp_ = time;
+    auto upper = std::lower_bound(buffer.begin(), buffer.end(), key, &stampLess);
+    if (upper->stamp_ == time) {
+        transform = *upper;
+        return Result::OK;
+    }
+
+    auto lower = upper - 1;
+    const double ratio = (time - lower->stamp_).toSec() / (upper->stamp_ - lower->stamp_).toSec();
+
+    transform.setOrigin(lower->getOrigin().lerp(upper->getOrigin(), ratio));
+    transform.setRotation(lower->getRotation().slerp(upper->getRotation(), ratio));
+    return Result::OK;
+}
@@ -0,0 +1,142 @@
+#include <csapex_ros/transform_lookup.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace csapex;
+
+namespace
+{
+tf::StampedTransform makeTransform(const std::string& parent, const std::string& child, double stamp, double x, double y, double z)
+{
+    tf::Transform transform(tf::Quaternion::getIdentity(), tf::Vector3(x, y, z));
+    return tf::StampedTransform(transform, ros::Time(stamp), parent, child);
+}
+
+void expectOrigin(const tf::StampedTransform& transform, double x, double y, double z)
+{
+    EXPECT_NEAR(x, transform.getOrigin().x(), 1e-9);
+    EXPECT_NEAR(y, transform.getOrigin().y(), 1e-9);
+    EXPECT_NEAR(z, transform.getOrigin().z(), 1e-9);
+}
+
+/// map -> odom is dynamic and moves along x, odom -> base is static
+class TransformLookupTest : public ::testing::Test
+{
+protected:
+    TransformLookupTest()
+    {
+        lookup.addTransform(makeTransform("map", "odom", 1.0, 0.0, 0.0, 0.0));
+        lookup.addTransform(makeTransform("map", "odom", 2.0, 2.0, 0.0, 0.0));
+        lookup.addTransform(makeTransform("odom", "base", 0.0, 0.0, 1.0, 0.0), true);
+    }
+
+    TransformLookup lookup;
+};
+}  // namespace
+
+TEST_F(TransformLookupTest, InterpolatesAlongTheChain)
+{
+    tf::StampedTransform transform;
+    ASSERT_EQ(TransformLookup::Result::OK, lookup.lookupTransform("map", "base", ros::Time(1.5), transform));
+
+    expectOrigin(transform, 1.0, 1.0, 0.0);
+    EXPECT_EQ("map", transform.frame_id_);
+    EXPECT_EQ("base", transform.child_frame_id_);
+    EXPECT_EQ(ros::Time(1.5), transform.stamp_);
+}
+
+TEST_F(TransformLookupTest, InverseDirection)
+{
+    tf::StampedTransform transform;
+    ASSERT_EQ(TransformLookup::Result::OK, lookup.lookupTransform("base", "map", ros::Time(1.5), transform));
+
+    expectOrigin(transform, -1.0, -1.0, 0.0);
+}
+
+TEST_F(TransformLookupTest, TimeZeroUsesTheLatestCommonTime)
+{
+    tf::StampedTransform transform;
+    ASSERT_EQ(TransformLookup::Result::OK, lookup.lookupTransform("map", "base", ros::Time(0), transform));
+
+    EXPECT_EQ(ros::Time(2.0), transform.stamp_);
+    expectOrigin(transform, 2.0, 1.0, 0.0);
+}
+
+TEST_F(TransformLookupTest, LeadingSlashesAreIgnored)
+{
+    tf::StampedTransform transform;
+    EXPECT_EQ(TransformLookup::Result::OK, lookup.lookupTransform("/map", "/base", ros::Time(2.0), transform));
+}
+
+TEST_F(TransformLookupTest, OldStampsFailAndNewStampsArePending)
+{
+    tf::StampedTransform transform;
+    EXPECT_EQ(TransformLookup::Result::FAILED, lookup.lookupTransform("map", "base", ros::Time(0.5), transform));
+    EXPECT_EQ(TransformLookup::Result::PENDING, lookup.lookupTransform("map", "base", ros::Time(2.5), transform));
+    EXPECT_EQ(TransformLookup::Result::PENDING, lookup.lookupTransform("map", "unknown", ros::Time(1.5), transform));
+    EXPECT_FALSE(lookup.canTransform("map", "base", ros::Time(2.5)));
+    EXPECT_TRUE(lookup.canTransform("map", "base", ros::Time(2.0)));
+}
+
+TEST_F(TransformLookupTest, SiblingsAreConnectedViaTheCommonAncestor)
+{
+    lookup.addTransform(makeTransform("odom", "camera", 0.0, 0.0, 0.0, 3.0), true);
+
+    tf::StampedTransform transform;
+    ASSERT_EQ(TransformLookup::Result::OK, lookup.lookupTransform("camera", "base", ros::Time(1.0), transform));
+
+    expectOrigin(transform, 0.0, 1.0, -3.0);
+}
+
+TEST_F(TransformLookupTest, ReparentingInvalidatesTheCachedChain)
+{
+    tf::StampedTransform transform;
+    ASSERT_EQ(TransformLookup::Result::OK, lookup.lookupTransform("map", "base", ros::Time(1.0), transform));
+    expectOrigin(transform, 0.0, 1.0, 0.0);
+
+    lookup.addTransform(makeTransform("map", "base", 0.0, 5.0, 0.0, 0.0), true);
+
+    ASSERT_EQ(TransformLookup::Result::OK, lookup.lookupTransform("map", "base", ros::Time(1.0), transform));
+    expectOrigin(transform, 5.0, 0.0, 0.0);
+}
+
+TEST_F(TransformLookupTest, FrameStrings)
+{
+    std::vector<std::string> frames = lookup.getFrameStrings();
+    EXPECT_EQ((std::vector<std::string>{ "base", "map", "odom" }), frames);
+}
+
+TEST_F(TransformLookupTest, WaitingIsWokenByNewTransforms)
+{
+    std::thread feeder([this]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        lookup.addTransform(makeTransform("map", "odom", 3.0, 4.0, 0.0, 0.0));
+    });
+
+    tf::StampedTransform transform;
+    auto start = std::chrono::steady_clock::now();
+    bool found = lookup.waitForTransform("map", "base", ros::Time(2.5), ros::WallDuration(10.0), transform);
+    auto waited = std::chrono::steady_clock::now() - start;
+    feeder.join();
+
+    ASSERT_TRUE(found);
+    expectOrigin(transform, 3.0, 1.0, 0.0);
+    EXPECT_LT(waited, std::chrono::seconds(5));
+}
+
+TEST_F(TransformLookupTest, WaitingTimesOut)
+{
+    tf::StampedTransform transform;
+    EXPECT_FALSE(lookup.waitForTransform("map", "base", ros::Time(2.5), ros::WallDuration(0.05), transform));
+}
+
+TEST_F(TransformLookupTest, WaitingReturnsImmediatelyForOldStamps)
+{
+    tf::StampedTransform transform;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(lookup.waitForTransform("map", "base", ros::Time(0.5), ros::WallDuration(10.0), transform));
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
@@ -0,0 +1,180 @@
+#ifndef MULTI_MODEL_HPP
+#define MULTI_MODEL_HPP
+
+/// PROJECT
+#include "ransac.hpp"
+
+/// SYSTEM
+#include <algorithm>
+
+namespace csapex_sample_consensus
+{
+struct MultiModelParameters : public RansacParameters
+{
+    int maximum_model_count = 5;                 /// -1 means no limit
+    std::size_t minimum_residual_size = 100;     /// stop if less points are left
+    std::size_t minimum_model_size = 1000;       /// smaller models are reported as rejected
+    std::size_t maximum_cached_hypotheses = 16;  /// hypotheses kept for the following rounds
+
+    MultiModelParameters() = default;
+
+    void assign(const RansacParameters& params)
+    {
+        Parameters::assign(params);
+        outlier_probability = params.outlier_probability;
+        use_outlier_probability = params.use_outlier_probability;
+        maximum_sampling_retries = params.maximum_sampling_retries;
+    }
+};
+
+/**
+ * Extracts several models one after another. All rounds work on the same index
+ * buffer, the inliers of an accepted model are swap-removed from it in place.
+ * The best hypotheses seen during a round are cached. Once a model is removed,
+ * their inlier counts are corrected by the removed points, and the best one that
+ * still supports enough points starts the search of the next round.
+ */
+template <typename PointT>
+class MultiModelRansac : public Ransac<PointT>
+{
+public:
+    using Ptr = std::shared_ptr<MultiModelRansac>;
+    using Base = Ransac<PointT>;
+    using Model = typename Base::Model;
+
+    struct Result
+    {
+        typename Model::Ptr model;
+        std::vector<int> inliers;
+    };
+
+    MultiModelRansac(const std::vector<int>& indices, const MultiModelParameters& parameters, std::default_random_engine& rng)
+      : Base(indices, parameters, rng), multi_parameters_(parameters)
+    {
+    }
+
+    /**
+     * @brief extract finds models of the type of prototype until the residual is too small or enough models were found.
+     * @param models accepted models with their sorted inliers
+     * @param rejected sorted inliers of models that were too small
+     * @return the number of rounds
+     */
+    std::size_t extract(const typename Model::Ptr& prototype, std::vector<Result>& models, std::vector<std::vector<int>>& rejected)
+    {
+        std::vector<int>& buffer = SampleConsensus<PointT>::indices_;
+        const std::size_t minimum_size = std::max(multi_parameters_.minimum_residual_size, prototype->getModelDimension());
+        const float distance = multi_parameters_.model_search_distance;
+
+        cache_.clear();
+
+        std::size_t rounds = 0;
+        while (buffer.size() >= minimum_size) {
+            if (multi_parameters_.maximum_model_count >= 0 && rounds >= static_cast<std::size_t>(multi_parameters_.maximum_model_count))
+                break;
+
+            Base::updateSampling();
+
+            Hypothesis initial;
+            if (!cache_.empty()) {
+                auto best = std::max_element(cache_.begin(), cache_.end(), [](const Hypothesis& a, const Hypothesis& b) { return a.count < b.count; });
+                initial = *best;
+                cache_.erase(best);
+            }
+
+            typename Model::Ptr model = prototype->clone();
+            const double scale = validationScale();
+            if (!Base::computeModel(model, initial.model, static_cast<std::size_t>(initial.count * scale), initial.mean_distance))
+                break;
+
+            /// move the inliers to the back of the buffer and cut them off
+            std::size_t size = buffer.size();
+            for (std::size_t i = 0; i < size;) {
+                if (model->getDistanceToModel(buffer[i]) <= distance) {
+                    --size;
+                    std::swap(buffer[i], buffer[size]);
+                } else {
+                    ++i;
+                }
+            }
+            std::vector<int> inliers(buffer.begin() + size, buffer.end());
+            buffer.resize(size);
+            ++rounds;
+
+            if (inliers.empty())
+                break;
+
+            updateCache(model, inliers);
+
+            std::sort(inliers.begin(), inliers.end());
+            if (inliers.size() > multi_parameters_.minimum_model_size) {
+                models.emplace_back(Result{ model, std::move(inliers) });
+            } else {
+                rejected.emplace_back(std::move(inliers));
+            }
+        }
+        cache_.clear();
+        return rounds;
+    }
+
+    /// the points that are not explained by any model, in no particular order
+    inline const std::vector<int>& getResidual() const
+    {
+        return SampleConsensus<PointT>::indices_;
+    }
+
+protected:
+    struct Hypothesis
+    {
+        typename Model::Ptr model;
+        double count = 0.0;  /// estimated inliers in the whole buffer
+        double mean_distance = std::numeric_limits<double>::max();
+    };
+
+    MultiModelParameters multi_parameters_;
+    std::vector<Hypothesis> cache_;
+
+    virtual void evaluatedHypothesis(const typename Model::Ptr& model, const typename Model::InlierStatistic& statistic) override
+    {
+        if (multi_parameters_.maximum_cached_hypotheses == 0)
+            return;
+
+        const double count = statistic.count / validationScale();
+        if (count < multi_parameters_.minimum_model_size)
+            return;
+
+        if (cache_.size() < multi_parameters_.maximum_cached_hypotheses) {
+            cache_.emplace_back(Hypothesis{ model->clone(), count, statistic.mean_distance });
+            return;
+        }
+        auto worst = std::min_element(cache_.begin(), cache_.end(), [](const Hypothesis& a, const Hypothesis& b) { return a.count < b.count; });
+        if (worst->count < count) {
+            *worst = Hypothesis{ model->clone(), count, statistic.mean_distance };
+        }
+    }
+
+    /// hypotheses that mostly described the removed points fall below the minimum model size and are dropped
+    inline void updateCache(const typename Model::Ptr& accepted, const std::vector<int>& removed)
+    {
+        const float distance = multi_parameters_.model_search_distance;
+        for (Hypothesis& hypothesis : cache_) {
+            if (hypothesis.model == accepted) {
+                hypothesis.count = 0.0;
+                continue;
+            }
+            hypothesis.count -= static_cast<double>(hypothesis.model->countInliers(removed, distance));
+        }
+        cache_.erase(std::remove_if(cache_.begin(), cache_.end(),
+                                    [this](const Hypothesis& hypothesis) { return hypothesis.count < static_cast<double>(multi_parameters_.minimum_model_size); }),
+                     cache_.end());
+    }
+
+    /// ratio between the inlier counts seen during validation and the counts in the whole buffer
+    inline double validationScale() const
+    {
+        const double ratio = multi_parameters_.model_validation_ratio;
+        return (ratio == 0.0 || ratio == 1.0) ? 1.0 : ratio;
+    }
+};
+}  // namespace csapex_sample_consensus
+
+#endif  // MULTI_MODEL_HPP
@@ -6,6 +6,7 @@
 #include "sac.hpp"
 
 /// SYSTEM
+#include <limits>
 #include <random>
 #include <set>
 
@@ -36,11 +37,19 @@ public:
     virtual void setIndices(const std::vector<int>& indices) override
     {
         Base::setIndices(indices);
-        distribution_ = std::uniform_int_distribution<std::size_t>(0, Base::indices_.size() - 1);
-        one_over_indices_ = 1.0 / static_cast<double>(Base::indices_.size());
+        updateSampling();
     }
 
     virtual bool computeModel(typename Model::Ptr& model) override
+    {
+        return computeModel(model, typename Model::Ptr(), 0, std::numeric_limits<double>::max());
+    }
+
+    /**
+     * @brief computeModel starts the search from a known hypothesis, which is only replaced by better ones.
+     * @param initial_inliers inlier count of the initial hypothesis, on the same scale as the validation
+     */
+    bool computeModel(typename Model::Ptr& model, const typename Model::Ptr& initial, const std::size_t initial_inliers, const double initial_mean_distance)
     {
         const std::size_t model_dimension = model->getModelDimension();
         const std::size_t indices_size = Base::indices_.size();
@@ -54,7 +63,7 @@ public:
         delegate<bool()> termination = [&internal_params, this]() {
             bool terminate_max_skipped = internal_params.skipped >= internal_params.maximum_skipped;
             bool terminate_max_iteration = (int)internal_params.iteration >= parameters_.maximum_iterations;
-            bool terminate_outlier_probability = parameters_.use_outlier_probability && internal_params.iteration >= internal_params.k_outlier;
+            bool terminate_outlier_probability = parameters_.use_outlier_probability && internal_params.best_model && internal_params.iteration >= internal_params.k_outlier;
             bool terminate_mean_model_distance = parameters_.use_mean_model_distance && internal_params.mean_model_distance < parameters_.mean_model_distance;
             return terminate_max_skipped || terminate_max_iteration || terminate_outlier_probability || terminate_mean_model_distance;
         };
@@ -69,6 +78,13 @@ public:
             }
         };
 
+        if (initial) {
+            internal_params.best_model = initial;
+            internal_params.maximum_inliers = initial_inliers;
+            internal_params.mean_model_distance = initial_mean_distance;
+            update_internal_paramters();
+        }
+
         /// ITERATE AND FIND A MODEL
         while (!termination()) {
             if (!selectSamples(model, internal_params.model_dimension, internal_params.model_samples)) {
@@ -88,6 +104,7 @@ public:
                 drawSamples(validation_samples, indices);
                 model->getInlierStatistic(indices, parameters_.model_search_distance, stat);
             }
+            evaluatedHypothesis(model, stat);
 
             if (stat.count > internal_params.maximum_inliers) {
                 internal_params.maximum_inliers = stat.count;
@@ -131,6 +148,17 @@ protected:
     std::uniform_int_distribution<std::size_t> distribution_;
     double one_over_indices_;
 
+    /// called for every hypothesis that was scored, the model is reused afterwards and has to be cloned to be kept
+    virtual void evaluatedHypothesis(const typename Model::Ptr& /*model*/, const typename Model::InlierStatistic& /*statistic*/)
+    {
+    }
+
+    inline void updateSampling()
+    {
+        distribution_ = std::uniform_int_distribution<std::size_t>(0, Base::indices_.size() - 1);
+        one_over_indices_ = 1.0 / static_cast<double>(Base::indices_.size());
+    }
+
     inline bool selectSamples(const typename Model::Ptr& model, const std::size_t samples, std::vector<int>& indices)
     {
         std::set<int> selection;
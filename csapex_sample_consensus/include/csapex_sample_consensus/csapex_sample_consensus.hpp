@@ -12,6 +12,7 @@
 
 //// algorithm base type
 #include "algorithms/antsac.hpp"
+#include "algorithms/multi_model.hpp"
 #include "algorithms/ransac.hpp"
 #include "algorithms/sac.hpp"
 
@@ -22,6 +22,8 @@ public:
         parameters.addParameter(param::factory::declareValue("random seed", -1), std::bind(&Ransac::setupRandomGenerator, this));
 
         parameters.addParameter(param::factory::declareRange("maximum sampling retries", 1, 1000, 100, 1), ransac_parameters_.maximum_sampling_retries);
+
+        parameters.addConditionalParameter(param::factory::declareRange("cached hypotheses", 0, 64, 16, 1), [this]() { return fit_multiple_models_; }, cached_hypotheses_);
     }
 
     virtual void process() override
@@ -54,36 +56,40 @@ public:
 
         /// prepare algorithm
         ransac_parameters_.assign(sac_parameters_);
-        typename csapex_sample_consensus::Ransac<PointT>::Ptr sac(new csapex_sample_consensus::Ransac<PointT>(prior_inlier, ransac_parameters_, rng_));
 
         pcl::PointIndices outliers;
         pcl::PointIndices inliers;
         inliers.header = cloud->header;
         outliers.header = cloud->header;
         if (fit_multiple_models_) {
-            outliers.indices = sac->getIndices();
-            int model_searches = 0;
-            while ((int)outliers.indices.size() >= minimum_residual_cloud_size_) {
-                auto working_model = model->clone();
-                sac->computeModel(working_model);
-                if (working_model) {
-                    inliers.indices.clear();
-                    outliers.indices.clear();
-                    working_model->getInliersAndOutliers(ransac_parameters_.model_search_distance, inliers.indices, outliers.indices);
-
-                    if ((int)inliers.indices.size() > minimum_model_cloud_size_)
-                        out_inliers->emplace_back(inliers);
-                    else
-                        out_outliers->emplace_back(inliers);
-
-                    sac->setIndices(outliers.indices);
-                }
-                ++model_searches;
-                if (maximum_model_count_ != -1 && model_searches >= maximum_model_count_)
-                    break;
+            csapex_sample_consensus::MultiModelParameters multi_parameters;
+            multi_parameters.assign(ransac_parameters_);
+            multi_parameters.maximum_model_count = maximum_model_count_;
+            multi_parameters.minimum_residual_size = minimum_residual_cloud_size_;
+            multi_parameters.minimum_model_size = minimum_model_cloud_size_;
+            multi_parameters.maximum_cached_hypotheses = cached_hypotheses_;
+            csapex_sample_consensus::MultiModelRansac<PointT> sac(prior_inlier, multi_parameters, rng_);
+
+            std::vector<typename csapex_sample_consensus::MultiModelRansac<PointT>::Result> models;
+            std::vector<std::vector<int>> rejected;
+            sac.extract(model, models, rejected);
+
+            for (auto& result : models) {
+                inliers.indices = std::move(result.inliers);
+                out_inliers->emplace_back(inliers);
+            }
+            for (auto& rejected_indices : rejected) {
+                inliers.indices = std::move(rejected_indices);
+                out_outliers->emplace_back(inliers);
             }
+
+            outliers.indices = sac.getResidual();
+            std::sort(outliers.indices.begin(), outliers.indices.end());
+            outliers.indices.insert(outliers.indices.end(), prior_outlier.begin(), prior_outlier.end());
             out_outliers->emplace_back(outliers);
         } else {
+            typename csapex_sample_consensus::Ransac<PointT>::Ptr sac(new csapex_sample_consensus::Ransac<PointT>(prior_inlier, ransac_parameters_, rng_));
+
             sac->computeModel(model);
             if (model) {
                 model->getInliersAndOutliers(prior_inlier, ransac_parameters_.model_search_distance, inliers.indices, outliers.indices);
@@ -105,6 +111,7 @@ public:
 
 protected:
     csapex_sample_consensus::RansacParameters ransac_parameters_;
+    int cached_hypotheses_;
 
     std::default_random_engine rng_;  /// keep the random engine alive for better number generation
 
@@ -23,7 +23,7 @@ CSAPEX_REGISTER_CLASS(csapex::DynamicTransform, csapex::Node)
 
 using namespace csapex;
 
-DynamicTransform::DynamicTransform() : init_(false), initial_retries_(10), frozen_(false)
+DynamicTransform::DynamicTransform() : init_(false), initial_retries_(10), exact_time_(false), timeout_(0.1), frozen_(false)
 {
 }
 
@@ -40,6 +40,8 @@ void DynamicTransform::setupParameters(Parameterizable& parameters)
     target_p = std::dynamic_pointer_cast<param::SetParameter>(getParameter("target"));
 
     parameters.addParameter(csapex::param::factory::declareBool("exact_time", false), exact_time_);
+    parameters.addParameter(csapex::param::factory::declareRange("timeout", csapex::param::ParameterDescription("Maximum time [s] to wait for the requested stamp"), 0.0, 1.0, 0.1, 0.01),
+                            timeout_);
 
     auto is_frozen = csapex::param::factory::declareBool("freeze_transformation", false);
     parameters.addParameter(is_frozen, [this](param::Parameter* p) { freeze(p->as<bool>()); });
@@ -110,25 +112,6 @@ void DynamicTransform::processROS()
     }
 }
 
-namespace
-{
-bool waitForTransform(tf::TransformListener& tfl, const std::string& target, const std::string& source, const ros::Time& time, const ros::WallDuration& duration,
-                      const ros::WallDuration& poll_duration)
-{
-    ros::WallTime start = ros::WallTime::now();
-    ros::WallTime end = start + duration;
-    while (ros::WallTime::now() < end) {
-        if (tfl.canTransform(target, source, time)) {
-            return true;
-        }
-
-        poll_duration.sleep();
-    }
-
-    return false;
-}
-}  // namespace
-
 void DynamicTransform::publishTransform(const ros::Time& time)
 {
     if (!init_ || source_p->noParameters() == 0 || target_p->noParameters() == 0) {
@@ -161,32 +144,22 @@ void DynamicTransform::publishTransform(const ros::Time& time)
             throw std::runtime_error("to is not a string");
         }
 
-        try {
-            LockedTFListener l = TFListener::getLocked();
-            apex_assert(l.l);
-            auto listener = l.l->tfl;
-            apex_assert(listener);
-            tf::TransformListener& tfl = *listener;
-
-            if (waitForTransform(tfl, target, source, time, ros::WallDuration(0.1), ros::WallDuration(0.01))) {
-                tfl.lookupTransform(target, source, time, t);
-
-            } else if (exact_time_) {
-                node_modifier_->setWarning(std::string("cannot exactly transform between ") + target + " and " + source);
-                return;
-
-            } else {
-                if (tfl.canTransform(target, source, ros::Time(0))) {
-                    node_modifier_->setWarning("cannot transform, using latest transform");
-                    tfl.lookupTransform(target, source, ros::Time(0), t);
-                } else {
-                    node_modifier_->setWarning(std::string("cannot transform between ") + target + " and " + source + " at all...");
-                    return;
-                }
-            }
+        // the lookup service wakes us as soon as the requested stamp is available
+        std::shared_ptr<TransformLookup> lookup = TFListener::getLookup();
+        apex_assert(lookup);
+
+        if (lookup->waitForTransform(target, source, time, ros::WallDuration(timeout_), t)) {
             node_modifier_->setNoError();
-        } catch (const tf2::TransformException& e) {
-            node_modifier_->setWarning(e.what());
+
+        } else if (exact_time_) {
+            node_modifier_->setWarning(std::string("cannot exactly transform between ") + target + " and " + source);
+            return;
+
+        } else if (lookup->lookupTransform(target, source, ros::Time(0), t) == TransformLookup::Result::OK) {
+            node_modifier_->setWarning("cannot transform, using latest transform");
+
+        } else {
+            node_modifier_->setWarning(std::string("cannot transform between ") + target + " and " + source + " at all...");
             return;
         }
 
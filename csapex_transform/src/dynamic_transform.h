@@ -51,6 +51,7 @@ private:
     param::SetParameter::Ptr target_p;
 
     bool exact_time_;
+    double timeout_;
 
     bool frozen_;
 
@@ -0,0 +1,170 @@
+/// HEADER
+#include "async_video_writer.h"
+
+/// SYSTEM
+#include <opencv2/imgproc/imgproc.hpp>
+
+using namespace csapex;
+
+AsyncVideoWriter::AsyncVideoWriter() : codec_(0), fps_(0.0), capacity_(1), policy_(Policy::DROP_NEWEST), running_(false), failed_(false), encoded_(0), dropped_(0)
+{
+}
+
+AsyncVideoWriter::~AsyncVideoWriter()
+{
+    stop();
+}
+
+void AsyncVideoWriter::start(const std::string& path, int codec, double fps, cv::Size frame_size, std::size_t capacity, Policy policy)
+{
+    stop();
+
+    path_ = path;
+    codec_ = codec;
+    fps_ = fps;
+    frame_size_ = frame_size;
+    capacity_ = std::max<std::size_t>(1, capacity);
+    policy_ = policy;
+
+    failed_ = false;
+    encoded_ = 0;
+    dropped_ = 0;
+
+    running_ = true;
+    worker_ = std::thread(&AsyncVideoWriter::run, this);
+}
+
+void AsyncVideoWriter::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        running_ = false;
+    }
+    frame_available_.notify_all();
+    space_available_.notify_all();
+
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+bool AsyncVideoWriter::push(const cv::Mat& frame)
+{
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    if (!running_) {
+        ++dropped_;
+        return false;
+    }
+
+    bool dropped = false;
+    if (queue_.size() >= capacity_) {
+        switch (policy_) {
+            case Policy::DROP_NEWEST:
+                ++dropped_;
+                return false;
+            case Policy::DROP_OLDEST:
+                queue_.pop_front();
+                ++dropped_;
+                dropped = true;
+                break;
+            case Policy::BLOCK:
+                space_available_.wait(lock, [this]() { return queue_.size() < capacity_ || !running_; });
+                if (!running_) {
+                    ++dropped_;
+                    return false;
+                }
+                break;
+        }
+    }
+
+    queue_.push_back(frame);
+    lock.unlock();
+
+    frame_available_.notify_one();
+    return !dropped;
+}
+
+bool AsyncVideoWriter::isRunning() const
+{
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    return running_;
+}
+
+bool AsyncVideoWriter::hasFailed() const
+{
+    return failed_;
+}
+
+std::size_t AsyncVideoWriter::getEncodedFrames() const
+{
+    return encoded_;
+}
+
+std::size_t AsyncVideoWriter::getDroppedFrames() const
+{
+    return dropped_;
+}
+
+std::size_t AsyncVideoWriter::getQueuedFrames() const
+{
+    std::unique_lock<std::mutex> lock(queue_mutex_);
+    return queue_.size();
+}
+
+void AsyncVideoWriter::run()
+{
+    cv::VideoWriter writer;
+    cv::Size size = frame_size_;
+
+    while (true) {
+        cv::Mat frame;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            frame_available_.wait(lock, [this]() { return !queue_.empty() || !running_; });
+            if (queue_.empty()) {
+                // stopped and drained
+                break;
+            }
+            frame = queue_.front();
+            queue_.pop_front();
+        }
+        space_available_.notify_one();
+
+        if (failed_) {
+            ++dropped_;
+            continue;
+        }
+
+        if (!writer.isOpened()) {
+            if (size.width == 0) {
+                size.width = frame.cols;
+            }
+            if (size.height == 0) {
+                size.height = frame.rows;
+            }
+            writer.open(path_, codec_, fps_, size, true);
+            if (!writer.isOpened()) {
+                failed_ = true;
+                ++dropped_;
+                continue;
+            }
+        }
+
+        writer << prepare(frame, size);
+        ++encoded_;
+    }
+
+    writer.release();
+}
+
+cv::Mat AsyncVideoWriter::prepare(const cv::Mat& frame, const cv::Size& size) const
+{
+    cv::Mat image = frame;
+    if (image.type() == CV_8UC1) {
+        cv::cvtColor(image, image, CV_GRAY2BGR);
+    }
+    if (image.size() != size) {
+        cv::resize(image, image, size);
+    }
+    return image;
+}
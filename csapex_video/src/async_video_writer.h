@@ -0,0 +1,86 @@
+#ifndef ASYNC_VIDEO_WRITER_H
+#define ASYNC_VIDEO_WRITER_H
+
+/// SYSTEM
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <opencv2/core/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+#include <string>
+#include <thread>
+
+namespace csapex
+{
+/**
+ * @brief The AsyncVideoWriter class encodes frames on a dedicated thread.
+ *
+ * Frames are handed over as shallow cv::Mat headers through a bounded queue,
+ * resizing, colour conversion and encoding all happen on the encoder thread.
+ */
+class AsyncVideoWriter
+{
+public:
+    enum class Policy
+    {
+        DROP_NEWEST = 0,
+        DROP_OLDEST = 1,
+        BLOCK = 2
+    };
+
+public:
+    AsyncVideoWriter();
+    ~AsyncVideoWriter();
+
+    /**
+     * @brief start spawns the encoder thread, the file is opened with the first frame
+     * @param frame_size output size, a zero dimension is taken from the first frame
+     */
+    void start(const std::string& path, int codec, double fps, cv::Size frame_size, std::size_t capacity, Policy policy);
+
+    /**
+     * @brief stop encodes all queued frames, releases the writer and joins the thread
+     */
+    void stop();
+
+    /**
+     * @brief push enqueues a frame, the frame must not be modified afterwards
+     * @return false, iff a frame had to be dropped
+     */
+    bool push(const cv::Mat& frame);
+
+    bool isRunning() const;
+    bool hasFailed() const;
+
+    std::size_t getEncodedFrames() const;
+    std::size_t getDroppedFrames() const;
+    std::size_t getQueuedFrames() const;
+
+private:
+    void run();
+    cv::Mat prepare(const cv::Mat& frame, const cv::Size& size) const;
+
+private:
+    std::string path_;
+    int codec_;
+    double fps_;
+    cv::Size frame_size_;
+    std::size_t capacity_;
+    Policy policy_;
+
+    std::thread worker_;
+    mutable std::mutex queue_mutex_;
+    std::condition_variable frame_available_;
+    std::condition_variable space_available_;
+    std::deque<cv::Mat> queue_;
+    bool running_;
+
+    std::atomic<bool> failed_;
+    std::atomic<std::size_t> encoded_;
+    std::atomic<std::size_t> dropped_;
+};
+
+}  // namespace csapex
+
+#endif  // ASYNC_VIDEO_WRITER_H
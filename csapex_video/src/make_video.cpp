@@ -15,10 +15,15 @@ CSAPEX_REGISTER_CLASS(csapex::MakeVideo, csapex::Node)
 using namespace csapex;
 using namespace csapex::connection_types;
 
-MakeVideo::MakeVideo()
+MakeVideo::MakeVideo() : buffer_(true), asynchronous_(false), queue_size_(64), full_queue_policy_(0)
 {
 }
 
+MakeVideo::~MakeVideo()
+{
+    async_writer_.stop();
+}
+
 void MakeVideo::setup(NodeModifier& node_modifier)
 {
     input_ = node_modifier.addInput<CvMatMessage>("Input image");
@@ -50,6 +55,25 @@ void MakeVideo::setupParameters(Parameterizable& parameters)
     parameters.addParameter(param::factory::declareRange("height", 0, 1080, 0, 1), frame_size_.height);
     parameters.addParameter(param::factory::declareBool("buffer", true), buffer_);
 
+    auto online = [this]() { return !buffer_; };
+    auto async = [this]() { return !buffer_ && asynchronous_; };
+    parameters.addConditionalParameter(param::factory::declareBool("asynchronous",
+                                                                   param::ParameterDescription("Encode on a dedicated thread. Frames are passed through a bounded queue, "
+                                                                                               "resizing and colour conversion are done on the encoder thread as well."),
+                                                                   false),
+                                       online, asynchronous_);
+    parameters.addConditionalParameter(param::factory::declareRange("queue/size", 1, 1024, 64, 1), async, queue_size_);
+    std::map<std::string, int> policies = { { "drop newest", (int)AsyncVideoWriter::Policy::DROP_NEWEST },
+                                            { "drop oldest", (int)AsyncVideoWriter::Policy::DROP_OLDEST },
+                                            { "block", (int)AsyncVideoWriter::Policy::BLOCK } };
+    parameters.addConditionalParameter(param::factory::declareParameterSet("queue/when full",
+                                                                           param::ParameterDescription("What to do when the encoder cannot keep up.<br />"
+                                                                                                       "block applies backpressure to the graph."),
+                                                                           policies, (int)AsyncVideoWriter::Policy::DROP_NEWEST),
+                                       async, full_queue_policy_);
+    parameters.addConditionalParameter(param::factory::declareOutputText("queue/encoded frames"), async);
+    parameters.addConditionalParameter(param::factory::declareOutputText("queue/dropped frames"), async);
+
     parameters.addParameter(param::factory::declareTrigger("clear"), std::bind(&MakeVideo::clear, this));
 
     parameters.addParameter(param::factory::declareTrigger("write"), std::bind(&MakeVideo::writeBuffer, this));
@@ -60,11 +84,33 @@ void MakeVideo::process()
     CvMatMessage::ConstPtr msg = msg::getMessage<CvMatMessage>(input_);
     if (buffer_) {
         msg_buffer_.push_back(msg);
+    } else if (asynchronous_) {
+        writeAsynchronous(msg);
     } else {
         writeOnline(msg);
     }
 }
 
+void MakeVideo::writeAsynchronous(const CvMatMessage::ConstPtr& msg)
+{
+    if (msg->value.type() != CV_8UC1 && msg->value.type() != CV_8UC3) {
+        throw std::runtime_error("Need 8UC1 or 8UC3!");
+    }
+
+    if (!async_writer_.isRunning()) {
+        async_writer_.start(path_ + file_extensions_[codec_type_], codec_type_, frame_rate_, frame_size_, queue_size_, static_cast<AsyncVideoWriter::Policy>(full_queue_policy_));
+    }
+    if (async_writer_.hasFailed()) {
+        throw std::runtime_error("Cannot open video file " + path_ + file_extensions_[codec_type_]);
+    }
+
+    // messages are immutable, so the encoder thread can share the image data
+    async_writer_.push(msg->value);
+
+    setParameter("queue/encoded frames", std::to_string(async_writer_.getEncodedFrames()));
+    setParameter("queue/dropped frames", std::to_string(async_writer_.getDroppedFrames()));
+}
+
 void MakeVideo::writeOnline(const CvMatMessage::ConstPtr& msg)
 {
     if (frame_size_.width == 0 || frame_size_.height == 0) {
@@ -119,6 +165,7 @@ void MakeVideo::writeBuffer()
 
 void MakeVideo::clear()
 {
+    async_writer_.stop();
     if (vw_.isOpened())
         vw_.release();
     msg_buffer_.clear();
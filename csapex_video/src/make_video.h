@@ -1,5 +1,8 @@
 #pragma once
 
+/// COMPONENT
+#include "async_video_writer.h"
+
 /// PROJECT
 #include <csapex/model/node.h>
 #include <csapex_opencv/cv_mat_message.h>
@@ -10,6 +13,7 @@ class CSAPEX_EXPORT_PLUGIN MakeVideo : public csapex::Node
 {
 public:
     MakeVideo();
+    ~MakeVideo();
 
     void setup(NodeModifier& node_modifier) override;
     void setupParameters(Parameterizable& parameters) override;
@@ -24,11 +28,16 @@ private:
     double frame_rate_;
     cv::Size frame_size_;
     bool buffer_;
+    bool asynchronous_;
+    int queue_size_;
+    int full_queue_policy_;
     cv::VideoWriter vw_;
+    AsyncVideoWriter async_writer_;
 
     std::vector<connection_types::CvMatMessage::ConstPtr> msg_buffer_;
 
     void writeOnline(const connection_types::CvMatMessage::ConstPtr& msg);
+    void writeAsynchronous(const connection_types::CvMatMessage::ConstPtr& msg);
     void writeBuffer();
     void clear();
 };
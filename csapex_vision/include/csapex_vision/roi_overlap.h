@@ -0,0 +1,173 @@
+#ifndef ROI_OVERLAP_H
+#define ROI_OVERLAP_H
+
+/// SYSTEM
+#include <functional>
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+namespace csapex
+{
+namespace roi
+{
+/// intersection over union, 0 for disjoint rectangles
+double overlapIoU(const cv::Rect& a, const cv::Rect& b);
+/// intersection over the larger area, 0 for disjoint rectangles
+double overlapMax(const cv::Rect& a, const cv::Rect& b);
+
+enum class OverlapMeasure
+{
+    IOU,
+    MAX
+};
+
+double overlap(const cv::Rect& a, const cv::Rect& b, OverlapMeasure measure);
+
+/// true, if the rectangles share at least one pixel
+inline bool intersects(const cv::Rect& a, const cv::Rect& b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+/**
+ * @brief The RectIndex class is a static R-tree over a set of rectangles,
+ *        bulk loaded with sort-tile-recursive packing.
+ *
+ * Queries report the indices of all rectangles sharing at least one pixel
+ * with the query rectangle, in no particular order.
+ */
+class RectIndex
+{
+public:
+    RectIndex(std::size_t node_capacity = 16);
+    RectIndex(const std::vector<cv::Rect>& rects, std::size_t node_capacity = 16);
+
+    void build(const std::vector<cv::Rect>& rects);
+
+    std::size_t size() const
+    {
+        return rects_.size();
+    }
+
+    const cv::Rect& rect(std::size_t index) const
+    {
+        return rects_[index];
+    }
+
+    template <typename Callback>
+    void query(const cv::Rect& rect, Callback callback) const
+    {
+        if (!nodes_.empty()) {
+            visit(nodes_.size() - 1, rect, callback);
+        }
+    }
+
+    void query(const cv::Rect& rect, std::vector<std::size_t>& result) const;
+
+private:
+    struct Node
+    {
+        cv::Rect bounds;
+        std::size_t first;
+        std::size_t count;
+        bool leaf;
+    };
+
+    template <typename Callback>
+    void visit(std::size_t node_index, const cv::Rect& rect, Callback& callback) const
+    {
+        const Node& node = nodes_[node_index];
+        if (!intersects(node.bounds, rect)) {
+            return;
+        }
+
+        for (std::size_t i = node.first, end = node.first + node.count; i < end; ++i) {
+            if (!node.leaf) {
+                visit(i, rect, callback);
+            } else if (intersects(rects_[items_[i]], rect)) {
+                callback(items_[i]);
+            }
+        }
+    }
+
+private:
+    std::size_t node_capacity_;
+
+    std::vector<cv::Rect> rects_;
+    /// leaf entries, permuted into tile order
+    std::vector<std::size_t> items_;
+    /// all nodes, level by level from the leaves upward, the root is the last node
+    std::vector<Node> nodes_;
+};
+
+enum class SuppressionMethod
+{
+    /// discard every box overlapping a better one by more than the threshold
+    GREEDY,
+    /// scale the score by (1 - overlap) when the overlap exceeds the threshold
+    SOFT_LINEAR,
+    /// scale the score by exp(-overlap^2 / sigma)
+    SOFT_GAUSSIAN
+};
+
+struct SuppressionParameters
+{
+    SuppressionParameters() : method(SuppressionMethod::GREEDY), measure(OverlapMeasure::IOU), overlap_threshold(0.5), sigma(0.5), score_threshold(0.0)
+    {
+    }
+
+    SuppressionMethod method;
+    OverlapMeasure measure;
+    double overlap_threshold;
+    double sigma;
+    /// soft suppression drops boxes whose score decayed below this value
+    double score_threshold;
+};
+
+/**
+ * @brief nonMaximumSuppression selects boxes in order of decreasing score
+ * @param scores the scores of the boxes, rescored in place by soft suppression
+ * @return the indices of the kept boxes, ordered by decreasing (final) score
+ */
+std::vector<std::size_t> nonMaximumSuppression(const std::vector<cv::Rect>& rects, std::vector<double>& scores, const SuppressionParameters& parameters);
+
+/**
+ * @brief mergeOverlapping replaces every group of (transitively) overlapping rectangles
+ *        by its bounding box, until no two results overlap anymore
+ */
+std::vector<cv::Rect> mergeOverlapping(const std::vector<cv::Rect>& rects);
+
+/**
+ * @brief The GreedyMatcher class assigns each query rectangle the best unassigned
+ *        candidate, every candidate is assigned at most once.
+ *        Ties are resolved in favor of the lower candidate index.
+ *        The overlap function has to be 0 for rectangles that do not intersect.
+ */
+class GreedyMatcher
+{
+public:
+    typedef std::function<double(const cv::Rect&, const cv::Rect&)> OverlapFunction;
+
+    GreedyMatcher(const std::vector<cv::Rect>& candidates, OverlapMeasure measure);
+    GreedyMatcher(const std::vector<cv::Rect>& candidates, const OverlapFunction& overlap_fn);
+
+    /**
+     * @brief match finds the unassigned candidate with the maximum overlap
+     * @param min_overlap non-negative threshold the overlap has to exceed
+     * @return the candidate index, or -1 if no candidate overlaps by more than min_overlap
+     */
+    int match(const cv::Rect& query, double min_overlap, double* overlap = nullptr) const;
+
+    void assign(std::size_t candidate);
+    bool isAssigned(std::size_t candidate) const;
+
+private:
+    RectIndex index_;
+    OverlapFunction overlap_fn_;
+    std::vector<char> assigned_;
+};
+
+}  // namespace roi
+}  // namespace csapex
+
+#endif  // ROI_OVERLAP_H
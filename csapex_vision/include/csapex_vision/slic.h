@@ -0,0 +1,102 @@
+#ifndef SLIC_H
+#define SLIC_H
+
+/// SYSTEM
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The Slic class segments a BGR image into superpixels with preemptive SLIC.
+ *
+ * Every pixel is assigned to the closest center within one grid step S in Lab
+ * color and image space, weighted by the compactness. Centers are bucketed into
+ * a grid with cell size S, so each pixel only looks at the centers of the 3x3
+ * neighbouring cells, which lets assignment and center update run on row stripes
+ * in parallel. Centers that moved less than the preemption threshold are frozen,
+ * pixels without an active center in their neighbourhood are skipped.
+ *
+ * All buffers are kept between calls. With warm starting, the centers of the
+ * previous call are used as seeds if the image size and parameters are unchanged.
+ */
+class Slic
+{
+public:
+    struct Parameters
+    {
+        Parameters() : superpixels(50), compactness(0.0), iterations(10), preemption(true), preemption_threshold(0.5), warm_start(false), warm_start_iterations(3)
+        {
+        }
+
+        int superpixels;
+        double compactness;
+        int iterations;
+        bool preemption;
+        /// centers moving less than this (in pixels and Lab units) are considered converged
+        double preemption_threshold;
+        bool warm_start;
+        /// replaces iterations when the previous centers are reused
+        int warm_start_iterations;
+    };
+
+    struct Center
+    {
+        float l, a, b;
+        float x, y;
+    };
+
+public:
+    Slic();
+
+    /// @param labels CV_32SC1, superpixels are numbered consecutively from 0 and connected
+    /// @return the number of superpixels
+    int segment(const cv::Mat& bgr, const Parameters& parameters, cv::Mat& labels);
+
+    /// the centers after the last iteration, before connectivity was enforced
+    const std::vector<Center>& centers() const;
+    /// iterations that were run by the last call
+    int iterationsUsed() const;
+
+    /// forgets the previous centers
+    void reset();
+
+private:
+    void seedGrid();
+    void bucketCenters();
+    void assign(int y0, int y1);
+    void accumulate(int y0, int y1, std::vector<double>& sums) const;
+    bool updateCenters();
+    int enforceConnectivity(cv::Mat& labels);
+
+private:
+    cv::Mat lab_;
+    cv::Mat assignment_;
+
+    float step_;
+    float spatial_weight_;
+    float threshold_sqr_;
+    bool preemption_;
+
+    std::vector<Center> centers_;
+    std::vector<bool> active_;
+    std::vector<std::vector<double>> stripe_sums_;
+
+    /// centers per grid cell, cell c holds cell_centers_[cell_offsets_[c] ... cell_offsets_[c + 1] - 1]
+    int grid_cols_;
+    int grid_rows_;
+    std::vector<int> cell_offsets_;
+    std::vector<int> cell_centers_;
+    std::vector<bool> cell_active_;
+
+    std::vector<int> queue_;
+
+    cv::Size previous_size_;
+    int previous_superpixels_;
+    double previous_compactness_;
+    int iterations_used_;
+};
+
+}  // namespace csapex
+
+#endif  // SLIC_H
@@ -0,0 +1,90 @@
+/// PROJECT
+#include <csapex/model/node.h>
+#include <csapex/model/node_modifier.h>
+#include <csapex/msg/generic_vector_message.hpp>
+#include <csapex/msg/io.h>
+#include <csapex/utility/assert.h>
+#include <csapex/utility/register_apex_plugin.h>
+#include <csapex_opencv/roi_message.h>
+#include <csapex_opencv/roi_set_message.h>
+
+/// SYSTEM
+#include <algorithm>
+
+namespace csapex
+{
+using namespace connection_types;
+
+class RoisToRoiSet : public csapex::Node
+{
+public:
+    RoisToRoiSet()
+    {
+    }
+
+    virtual void setup(csapex::NodeModifier& node_modifier) override
+    {
+        in_rois_ = node_modifier.addInput<GenericVectorMessage, RoiMessage>("ROIs");
+        in_scores_ = node_modifier.addOptionalInput<GenericVectorMessage, double>("scores");
+        out_set_ = node_modifier.addOutput<RoiSetMessage>("ROI set");
+    }
+
+    virtual void process() override
+    {
+        std::shared_ptr<std::vector<RoiMessage> const> in_rois = msg::getMessage<GenericVectorMessage, RoiMessage>(in_rois_);
+
+        RoiSetMessage::Ptr out_set(new RoiSetMessage);
+        out_set->assign(*in_rois);
+
+        if (msg::hasMessage(in_scores_)) {
+            std::shared_ptr<std::vector<double> const> in_scores = msg::getMessage<GenericVectorMessage, double>(in_scores_);
+            apex_assert(in_scores->size() == in_rois->size());
+            std::copy(in_scores->begin(), in_scores->end(), out_set->value.scores().begin());
+        }
+
+        msg::publish(out_set_, out_set);
+    }
+
+private:
+    Input* in_rois_;
+    Input* in_scores_;
+    Output* out_set_;
+};
+
+class RoiSetToRois : public csapex::Node
+{
+public:
+    RoiSetToRois()
+    {
+    }
+
+    virtual void setup(csapex::NodeModifier& node_modifier) override
+    {
+        in_set_ = node_modifier.addInput<RoiSetMessage>("ROI set");
+        out_rois_ = node_modifier.addOutput<GenericVectorMessage, RoiMessage>("ROIs");
+        out_scores_ = node_modifier.addOutput<GenericVectorMessage, double>("scores");
+    }
+
+    virtual void process() override
+    {
+        RoiSetMessage::ConstPtr in_set = msg::getMessage<RoiSetMessage>(in_set_);
+
+        msg::publish<GenericVectorMessage, RoiMessage>(out_rois_, in_set->toRoiMessages());
+
+        if (msg::isConnected(out_scores_)) {
+            const std::vector<float>& scores = in_set->value.scores();
+            std::shared_ptr<std::vector<double>> out_scores(new std::vector<double>(scores.begin(), scores.end()));
+            msg::publish<GenericVectorMessage, double>(out_scores_, out_scores);
+        }
+    }
+
+private:
+    Input* in_set_;
+    Output* out_rois_;
+    Output* out_scores_;
+};
+
+}  // namespace csapex
+
+CSAPEX_REGISTER_CLASS(csapex::RoisToRoiSet, csapex::Node)
+CSAPEX_REGISTER_CLASS(csapex::RoiSetToRois, csapex::Node)
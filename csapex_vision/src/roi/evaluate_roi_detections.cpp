@@ -6,6 +6,7 @@
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_evaluation/confusion_matrix_message.h>
 #include <csapex_opencv/roi_message.h>
+#include <csapex_vision/roi_overlap.h>
 
 #include <fstream>
 
@@ -69,6 +70,16 @@ inline double overlap_iou(const cv::Rect& prediction, const cv::Rect& groundtrut
     return (prediction & groundtruth).area() / (double)(prediction | groundtruth).area();
 }
 
+inline std::vector<cv::Rect> rects(const RoiMessagesConstPtr& rois)
+{
+    std::vector<cv::Rect> result;
+    result.reserve(rois->size());
+    for (const RoiMessage& roi : *rois) {
+        result.push_back(roi.value.rect());
+    }
+    return result;
+}
+
 inline void evaluateIgnoringPartlyVisible(const RoiMessagesConstPtr& groundtruth, const RoiMessagesConstPtr& predition, const double min_overlap, ConfusionMatrix& confury,
                                           std::array<std::size_t, 2>& human_parts, std::function<double(const cv::Rect&, const cv::Rect&)> overlap_fn, DebugRois& debug)
 {
@@ -76,31 +87,19 @@ inline void evaluateIgnoringPartlyVisible(const RoiMessagesConstPtr& groundtruth
     const std::size_t size_groundtruth = groundtruth->size();
     const std::size_t size_prediction = predition->size();
 
-    std::vector<char> predictions_mask(size_prediction, 1);
+    /// predictions are spatially indexed, only overlapping ones are considered
+    roi::GreedyMatcher predictions_mask(rects(predition), overlap_fn);
 
     /// groundtruth data can simply be kept, we only need to check for HUMAN_PART
     for (std::size_t i = 0; i < size_groundtruth; ++i) {
         const RoiMessage& roi_gt = groundtruth->at(i);
         if (roi_gt.value.classification() == EvaluateROIDetections::HUMAN_PART) {
             /// find the prediction with maximum overlap and remove it
-            std::size_t max_idx;
-            double max_overlap = std::numeric_limits<double>::lowest();
-            for (std::size_t j = 0; j < size_prediction; ++j) {
-                /// no refill
-                if (predictions_mask[j] == 0)
-                    continue;
-
-                const RoiMessage& roi_pred = predition->at(j);
-                const double overlap = overlap_fn(roi_pred.value.rect(), roi_gt.value.rect());
-                if (overlap > max_overlap) {
-                    max_idx = j;
-                    max_overlap = overlap;
-                }
-            }
             /// two possibilities here: either overlap or not
             /// if so, a prediction roi has been assigned no matter what prediction
-            if (max_overlap > min_overlap) {
-                predictions_mask[max_idx] = 0;
+            const int max_idx = predictions_mask.match(roi_gt.value.rect(), min_overlap);
+            if (max_idx >= 0) {
+                predictions_mask.assign(max_idx);
 
                 const RoiMessage& roi_pred = predition->at(max_idx);
                 if (roi_pred.value.classification() == EvaluateROIDetections::HUMAN) {
@@ -121,23 +120,10 @@ inline void evaluateIgnoringPartlyVisible(const RoiMessagesConstPtr& groundtruth
         }
 
         /// find the predcition with maximum overlap
-        std::size_t max_idx;
-        double max_overlap = std::numeric_limits<double>::lowest();
-        for (std::size_t j = 0; j < size_prediction; ++j) {
-            /// no refill
-            if (predictions_mask[j] == 0)
-                continue;
-
-            const RoiMessage& roi_pred = predition->at(j);
-            const double overlap = overlap_fn(roi_pred.value.rect(), roi_gt.value.rect());
-            if (overlap > max_overlap) {
-                max_idx = j;
-                max_overlap = overlap;
-            }
-        }
+        const int max_idx = predictions_mask.match(roi_gt.value.rect(), min_overlap);
 
         /// two possibilities here: either overlap or not
-        if (max_overlap > min_overlap) {
+        if (max_idx >= 0) {
             const RoiMessage& roi_pred = predition->at(max_idx);
             confury.reportClassification(roi_gt.value.classification(), roi_pred.value.classification());
             if (roi_gt.value.classification() == EvaluateROIDetections::BACKGROUND) {
@@ -152,7 +138,7 @@ inline void evaluateIgnoringPartlyVisible(const RoiMessagesConstPtr& groundtruth
                     debug.tp->push_back(roi_pred);
             }
             /// roi has been assigned, so we have to erase it from the mask
-            predictions_mask[max_idx] = 0;
+            predictions_mask.assign(max_idx);
         } else {
             /// roi was not found at all
             confury.reportClassification(roi_gt.value.classification(), EvaluateROIDetections::BACKGROUND);
@@ -166,7 +152,7 @@ inline void evaluateIgnoringPartlyVisible(const RoiMessagesConstPtr& groundtruth
     /// now its time to evaluate the leftovers
     for (std::size_t i = 0; i < size_prediction; ++i) {
         /// still no refill
-        if (predictions_mask[i] == 0)
+        if (predictions_mask.isAssigned(i))
             continue;
         /// if a roi hasn't been assigned yet, we have to check wether it is
         /// human or not
@@ -186,25 +172,12 @@ inline void evaluteIntegratingPartlyVisible(const RoiMessagesConstPtr& groundtru
     const std::size_t size_groundtruth = groundtruth->size();
     const std::size_t size_prediction = prediction->size();
 
-    std::vector<char> predictions_mask(size_prediction, 1);
+    roi::GreedyMatcher predictions_mask(rects(prediction), overlap_fn);
     for (std::size_t i = 0; i < size_groundtruth; ++i) {
         /// a maximum overlap prediction
         const RoiMessage& roi_gt = groundtruth->at(i);
-        std::size_t max_idx;
-        double max_overlap = std::numeric_limits<double>::lowest();
-        for (std::size_t j = 0; j < size_prediction; ++j) {
-            /// no refill
-            if (predictions_mask[j] == 0)
-                continue;
-
-            const RoiMessage& roi_pred = prediction->at(j);
-            const double overlap = overlap_fn(roi_pred.value.rect(), roi_gt.value.rect());
-            if (overlap > max_overlap) {
-                max_idx = j;
-                max_overlap = overlap;
-            }
-        }
-        if (max_overlap > min_overlap) {
+        const int max_idx = predictions_mask.match(roi_gt.value.rect(), min_overlap);
+        if (max_idx >= 0) {
             const RoiMessage& roi_pred = prediction->at(max_idx);
             if (roi_gt.value.classification() == EvaluateROIDetections::HUMAN) {
                 /// we found a match, now the detection has to match
@@ -223,7 +196,7 @@ inline void evaluteIntegratingPartlyVisible(const RoiMessagesConstPtr& groundtru
                     debug.tp->push_back(roi_pred);
                 }
             }
-            predictions_mask[max_idx] = 0;
+            predictions_mask.assign(max_idx);
         } else {
             /// we did not find a match, if it should be detected, this is bad
             if (roi_gt.value.classification() == EvaluateROIDetections::HUMAN) {
@@ -236,7 +209,7 @@ inline void evaluteIntegratingPartlyVisible(const RoiMessagesConstPtr& groundtru
     /// now its time to eat the leftovers
     for (std::size_t i = 0; i < size_prediction; ++i) {
         /// still no refill
-        if (predictions_mask[i] == 0)
+        if (predictions_mask.isAssigned(i))
             continue;
         /// if a roi hasn't been assigned yet, we have to check wether it is
         /// human or not
@@ -7,6 +7,7 @@
 
 #include <csapex/msg/generic_vector_message.hpp>
 #include <csapex_opencv/roi_message.h>
+#include <csapex_opencv/roi_set_message.h>
 
 CSAPEX_REGISTER_CLASS(csapex::FilterROIs, csapex::Node)
 
@@ -26,35 +27,56 @@ void FilterROIs::setupParameters(Parameterizable& parameters)
 
 void FilterROIs::setup(NodeModifier& node_modifier)
 {
-    in_rois_ = node_modifier.addInput<GenericVectorMessage, RoiMessage>("ROIs");
+    in_rois_ = node_modifier.addOptionalInput<GenericVectorMessage, RoiMessage>("ROIs");
+    in_roi_set_ = node_modifier.addOptionalInput<RoiSetMessage>("ROI set");
     out_rois_passed_ = node_modifier.addOutput<GenericVectorMessage, RoiMessage>("ROIs (passed)");
     out_rois_rejected_ = node_modifier.addOutput<GenericVectorMessage, RoiMessage>("ROIs (rejected)");
+    out_roi_set_passed_ = node_modifier.addOutput<RoiSetMessage>("ROI set (passed)");
+    out_roi_set_rejected_ = node_modifier.addOutput<RoiSetMessage>("ROI set (rejected)");
 }
 
 void FilterROIs::process()
 {
-    std::shared_ptr<std::vector<RoiMessage> const> rois_in = msg::getMessage<GenericVectorMessage, RoiMessage>(in_rois_);
-    std::shared_ptr<std::vector<RoiMessage>> rois_out_passed(new std::vector<RoiMessage>());
-    std::shared_ptr<std::vector<RoiMessage>> rois_out_rejected(new std::vector<RoiMessage>());
-
-    for (const RoiMessage& roi : *rois_in) {
-        if (check(roi.value))
-            rois_out_passed->emplace_back(roi);
-        else
-            rois_out_rejected->emplace_back(roi);
+    if (msg::hasMessage(in_rois_)) {
+        std::shared_ptr<std::vector<RoiMessage> const> rois_in = msg::getMessage<GenericVectorMessage, RoiMessage>(in_rois_);
+        std::shared_ptr<std::vector<RoiMessage>> rois_out_passed(new std::vector<RoiMessage>());
+        std::shared_ptr<std::vector<RoiMessage>> rois_out_rejected(new std::vector<RoiMessage>());
+
+        for (const RoiMessage& roi : *rois_in) {
+            if (check(roi.value.rect()))
+                rois_out_passed->emplace_back(roi);
+            else
+                rois_out_rejected->emplace_back(roi);
+        }
+
+        msg::publish<GenericVectorMessage, RoiMessage>(out_rois_passed_, rois_out_passed);
+        msg::publish<GenericVectorMessage, RoiMessage>(out_rois_rejected_, rois_out_rejected);
     }
 
-    msg::publish<GenericVectorMessage, RoiMessage>(out_rois_passed_, rois_out_passed);
-    msg::publish<GenericVectorMessage, RoiMessage>(out_rois_rejected_, rois_out_rejected);
+    if (msg::hasMessage(in_roi_set_)) {
+        RoiSetMessage::ConstPtr set_in = msg::getMessage<RoiSetMessage>(in_roi_set_);
+        RoiSetMessage::Ptr set_passed(new RoiSetMessage(set_in->frame_id, set_in->stamp_micro_seconds));
+        RoiSetMessage::Ptr set_rejected(new RoiSetMessage(set_in->frame_id, set_in->stamp_micro_seconds));
+
+        const std::vector<cv::Rect>& rects = set_in->value.rects();
+        std::vector<char> mask(rects.size());
+        for (std::size_t i = 0, n = rects.size(); i < n; ++i) {
+            mask[i] = check(rects[i]);
+        }
+        set_in->value.partition(mask, set_passed->value, set_rejected->value);
+
+        msg::publish(out_roi_set_passed_, set_passed);
+        msg::publish(out_roi_set_rejected_, set_rejected);
+    }
 }
 
-bool FilterROIs::check(const Roi& roi) const
+bool FilterROIs::check(const cv::Rect& rect) const
 {
     bool passed = true;
 
-    passed = passed && check_range(roi.w(), width_);
-    passed = passed && check_range(roi.h(), height_);
-    passed = passed && check_range(static_cast<double>(roi.w()) / roi.h(), aspect_);
+    passed = passed && check_range(rect.width, width_);
+    passed = passed && check_range(rect.height, height_);
+    passed = passed && check_range(static_cast<double>(rect.width) / rect.height, aspect_);
 
     return passed;
 }
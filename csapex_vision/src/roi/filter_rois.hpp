@@ -16,7 +16,7 @@ public:
     virtual void process() override;
 
 private:
-    bool check(const Roi& roi) const;
+    bool check(const cv::Rect& rect) const;
     template <typename T>
     static bool check_range(const T& value, const std::pair<T, T>& range)
     {
@@ -29,8 +29,11 @@ private:
 
 private:
     Input* in_rois_;
+    Input* in_roi_set_;
     Output* out_rois_passed_;
     Output* out_rois_rejected_;
+    Output* out_roi_set_passed_;
+    Output* out_roi_set_rejected_;
 
     std::pair<int, int> width_;
     std::pair<int, int> height_;
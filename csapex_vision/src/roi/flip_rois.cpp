@@ -7,6 +7,7 @@
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_opencv/cv_mat_message.h>
 #include <csapex_opencv/roi_message.h>
+#include <csapex_opencv/roi_set_message.h>
 
 /// SYSTEM
 #include <functional>
@@ -26,8 +27,10 @@ public:
     virtual void setup(csapex::NodeModifier& node_modifier) override
     {
         in_img_ = node_modifier.addInput<CvMatMessage>("Image");
-        in_rois_ = node_modifier.addInput<GenericVectorMessage, RoiMessage>("ROIs");
+        in_rois_ = node_modifier.addOptionalInput<GenericVectorMessage, RoiMessage>("ROIs");
+        in_roi_set_ = node_modifier.addOptionalInput<RoiSetMessage>("ROI set");
         out_rois_ = node_modifier.addOutput<GenericVectorMessage, RoiMessage>("Flipped ROIs");
+        out_roi_set_ = node_modifier.addOutput<RoiSetMessage>("Flipped ROI set");
     }
 
     virtual void setupParameters(Parameterizable& parameters) override
@@ -40,11 +43,6 @@ public:
     {
         CvMatMessage::ConstPtr in_img = msg::getMessage<CvMatMessage>(in_img_);
 
-        std::shared_ptr<std::vector<RoiMessage> const> in_rois = msg::getMessage<GenericVectorMessage, RoiMessage>(in_rois_);
-
-        std::shared_ptr<std::vector<RoiMessage>> out_rois(new std::vector<RoiMessage>);
-        out_rois->assign(in_rois->begin(), in_rois->end());
-
         const cv::Mat& img = in_img->value;
         std::function<void(cv::Rect & roi)> modifier;
         switch (mode_) {
@@ -83,18 +81,38 @@ public:
                 break;
         }
 
-        for (RoiMessage& roi : *out_rois) {
-            cv::Rect r = roi.value.rect();
-            modifier(r);
-            roi.value.setRect(r);
+        if (msg::hasMessage(in_rois_)) {
+            std::shared_ptr<std::vector<RoiMessage> const> in_rois = msg::getMessage<GenericVectorMessage, RoiMessage>(in_rois_);
+
+            std::shared_ptr<std::vector<RoiMessage>> out_rois(new std::vector<RoiMessage>);
+            out_rois->assign(in_rois->begin(), in_rois->end());
+
+            for (RoiMessage& roi : *out_rois) {
+                cv::Rect r = roi.value.rect();
+                modifier(r);
+                roi.value.setRect(r);
+            }
+            msg::publish<GenericVectorMessage, RoiMessage>(out_rois_, out_rois);
+        }
+
+        if (msg::hasMessage(in_roi_set_)) {
+            RoiSetMessage::ConstPtr in_set = msg::getMessage<RoiSetMessage>(in_roi_set_);
+            RoiSetMessage::Ptr out_set(new RoiSetMessage(in_set->frame_id, in_set->stamp_micro_seconds));
+            out_set->value = in_set->value;
+
+            for (cv::Rect& r : out_set->value.rects()) {
+                modifier(r);
+            }
+            msg::publish(out_roi_set_, out_set);
         }
-        msg::publish<GenericVectorMessage, RoiMessage>(out_rois_, out_rois);
     }
 
 private:
     Input* in_img_;
     Input* in_rois_;
+    Input* in_roi_set_;
     Output* out_rois_;
+    Output* out_roi_set_;
 
     int mode_;
 };
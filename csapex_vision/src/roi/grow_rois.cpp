@@ -5,6 +5,7 @@
 #include <csapex/msg/generic_vector_message.hpp>
 #include <csapex_opencv/cv_mat_message.h>
 #include <csapex_opencv/roi_message.h>
+#include <csapex_opencv/roi_set_message.h>
 
 /// PROJECT
 #include <csapex/model/node_modifier.h>
@@ -32,19 +33,36 @@ void GrowROIs::setupParameters(Parameterizable& parameters)
 
 void GrowROIs::process()
 {
-    std::shared_ptr<std::vector<RoiMessage> const> rois_in = msg::getMessage<GenericVectorMessage, RoiMessage>(input_);
-    std::shared_ptr<std::vector<RoiMessage>> rois_out(new std::vector<RoiMessage>);
-    rois_out->assign(rois_in->begin(), rois_in->end());
+    if (msg::hasMessage(input_)) {
+        std::shared_ptr<std::vector<RoiMessage> const> rois_in = msg::getMessage<GenericVectorMessage, RoiMessage>(input_);
+        std::shared_ptr<std::vector<RoiMessage>> rois_out(new std::vector<RoiMessage>);
+        rois_out->assign(rois_in->begin(), rois_in->end());
 
-    for (RoiMessage& roi : *rois_out) {
-        roi.value.grow(x_, y_);
+        for (RoiMessage& roi : *rois_out) {
+            roi.value.grow(x_, y_);
+        }
+
+        msg::publish<GenericVectorMessage, RoiMessage>(output_, rois_out);
     }
 
-    msg::publish<GenericVectorMessage, RoiMessage>(output_, rois_out);
+    if (msg::hasMessage(input_set_)) {
+        RoiSetMessage::ConstPtr set_in = msg::getMessage<RoiSetMessage>(input_set_);
+        RoiSetMessage::Ptr set_out(new RoiSetMessage(set_in->frame_id, set_in->stamp_micro_seconds));
+        set_out->value = set_in->value;
+
+        RoiSet& rois = set_out->value;
+        for (std::size_t i = 0, n = rois.size(); i < n; ++i) {
+            rois[i].grow(x_, y_);
+        }
+
+        msg::publish(output_set_, set_out);
+    }
 }
 
 void GrowROIs::setup(NodeModifier& node_modifier)
 {
-    input_ = node_modifier.addInput<GenericVectorMessage, RoiMessage>("ROI");
+    input_ = node_modifier.addOptionalInput<GenericVectorMessage, RoiMessage>("ROI");
+    input_set_ = node_modifier.addOptionalInput<RoiSetMessage>("ROI set");
     output_ = node_modifier.addOutput<GenericVectorMessage, RoiMessage>("grown ROI");
+    output_set_ = node_modifier.addOutput<RoiSetMessage>("grown ROI set");
 }
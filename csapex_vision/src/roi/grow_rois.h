@@ -17,7 +17,9 @@ public:
 
 private:
     Input* input_;
+    Input* input_set_;
     Output* output_;
+    Output* output_set_;
     int x_, y_;
 };
 
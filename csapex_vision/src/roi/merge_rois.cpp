@@ -9,7 +9,7 @@
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_opencv/cv_mat_message.h>
 #include <csapex_opencv/roi_message.h>
-#include <cslibs_vision/utils/rectangle_cluster.h>
+#include <csapex_vision/roi_overlap.h>
 
 /// SYSTEM
 
@@ -32,15 +32,19 @@ void MergeROIs::process()
 {
     std::shared_ptr<std::vector<RoiMessage> const> rois = msg::getMessage<GenericVectorMessage, RoiMessage>(input_);
 
-    RectangleCluster cluster;
+    std::vector<cv::Rect> rects;
+    rects.reserve(rois->size());
     for (const RoiMessage& roi : *rois) {
-        cluster.integrate(roi.value.rect());
+        rects.push_back(roi.value.rect());
     }
 
+    std::vector<cv::Rect> merged = roi::mergeOverlapping(rects);
+
     std::shared_ptr<std::vector<RoiMessage>> out(new std::vector<RoiMessage>);
-    for (std::vector<cv::Rect>::iterator it = cluster.begin(); it != cluster.end(); ++it) {
+    out->reserve(merged.size());
+    for (const cv::Rect& rect : merged) {
         RoiMessage msg;
-        msg.value = Roi(*it);
+        msg.value = Roi(rect);
         out->push_back(msg);
     }
 
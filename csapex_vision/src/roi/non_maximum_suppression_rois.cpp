@@ -0,0 +1,86 @@
+/// HEADER
+#include "non_maximum_suppression_rois.h"
+
+/// PROJECT
+#include <csapex/model/node_modifier.h>
+#include <csapex/msg/generic_vector_message.hpp>
+#include <csapex/msg/io.h>
+#include <csapex/param/parameter_factory.h>
+#include <csapex/utility/assert.h>
+#include <csapex/utility/register_apex_plugin.h>
+#include <csapex_opencv/roi_message.h>
+
+CSAPEX_REGISTER_CLASS(csapex::NonMaximumSuppressionROIs, csapex::Node)
+
+using namespace csapex;
+using namespace connection_types;
+
+NonMaximumSuppressionROIs::NonMaximumSuppressionROIs()
+{
+}
+
+void NonMaximumSuppressionROIs::setup(NodeModifier& node_modifier)
+{
+    in_rois_ = node_modifier.addInput<GenericVectorMessage, RoiMessage>("ROIs");
+    in_scores_ = node_modifier.addOptionalInput<GenericVectorMessage, double>("scores");
+
+    out_rois_ = node_modifier.addOutput<GenericVectorMessage, RoiMessage>("suppressed ROIs");
+    out_scores_ = node_modifier.addOutput<GenericVectorMessage, double>("suppressed scores");
+}
+
+void NonMaximumSuppressionROIs::setupParameters(Parameterizable& parameters)
+{
+    std::map<std::string, int> methods = { { "greedy", (int)roi::SuppressionMethod::GREEDY },
+                                           { "soft (linear)", (int)roi::SuppressionMethod::SOFT_LINEAR },
+                                           { "soft (gaussian)", (int)roi::SuppressionMethod::SOFT_GAUSSIAN } };
+    parameters.addParameter(param::factory::declareParameterSet("method",
+                                                                param::ParameterDescription("greedy: drop every ROI overlapping a better one.<br />"
+                                                                                            "soft: decay the score of overlapping ROIs instead."),
+                                                                methods, (int)roi::SuppressionMethod::GREEDY),
+                            reinterpret_cast<int&>(parameters_.method));
+
+    std::map<std::string, int> measures = { { "IOU", (int)roi::OverlapMeasure::IOU }, { "MAX", (int)roi::OverlapMeasure::MAX } };
+    parameters.addParameter(param::factory::declareParameterSet("overlap_mode", measures, (int)roi::OverlapMeasure::IOU), reinterpret_cast<int&>(parameters_.measure));
+
+    parameters.addConditionalParameter(param::factory::declareRange("overlap", 0.0, 1.0, 0.5, 0.01),
+                                       [this]() { return parameters_.method != roi::SuppressionMethod::SOFT_GAUSSIAN; }, parameters_.overlap_threshold);
+    parameters.addConditionalParameter(param::factory::declareRange("sigma", 0.01, 2.0, 0.5, 0.01), [this]() { return parameters_.method == roi::SuppressionMethod::SOFT_GAUSSIAN; },
+                                       parameters_.sigma);
+    parameters.addParameter(param::factory::declareRange("min score", param::ParameterDescription("ROIs with a (decayed) score below are dropped"), 0.0, 1.0, 0.0, 0.001),
+                            parameters_.score_threshold);
+}
+
+void NonMaximumSuppressionROIs::process()
+{
+    std::shared_ptr<std::vector<RoiMessage> const> rois = msg::getMessage<GenericVectorMessage, RoiMessage>(in_rois_);
+
+    std::vector<double> scores;
+    if (msg::hasMessage(in_scores_)) {
+        std::shared_ptr<std::vector<double> const> scores_in = msg::getMessage<GenericVectorMessage, double>(in_scores_);
+        apex_assert(scores_in->size() == rois->size());
+        scores.assign(scores_in->begin(), scores_in->end());
+    } else {
+        // without scores, earlier ROIs are preferred
+        scores.assign(rois->size(), 1.0);
+    }
+
+    std::vector<cv::Rect> rects;
+    rects.reserve(rois->size());
+    for (const RoiMessage& roi : *rois) {
+        rects.push_back(roi.value.rect());
+    }
+
+    std::vector<std::size_t> kept = roi::nonMaximumSuppression(rects, scores, parameters_);
+
+    std::shared_ptr<std::vector<RoiMessage>> rois_out(new std::vector<RoiMessage>);
+    std::shared_ptr<std::vector<double>> scores_out(new std::vector<double>);
+    rois_out->reserve(kept.size());
+    scores_out->reserve(kept.size());
+    for (std::size_t i : kept) {
+        rois_out->push_back(rois->at(i));
+        scores_out->push_back(scores[i]);
+    }
+
+    msg::publish<GenericVectorMessage, RoiMessage>(out_rois_, rois_out);
+    msg::publish<GenericVectorMessage, double>(out_scores_, scores_out);
+}
@@ -0,0 +1,32 @@
+#ifndef NON_MAXIMUM_SUPPRESSION_ROIS_H
+#define NON_MAXIMUM_SUPPRESSION_ROIS_H
+
+/// COMPONENT
+#include <csapex_vision/roi_overlap.h>
+
+/// PROJECT
+#include <csapex/model/node.h>
+
+namespace csapex
+{
+class NonMaximumSuppressionROIs : public csapex::Node
+{
+public:
+    NonMaximumSuppressionROIs();
+
+    virtual void setup(csapex::NodeModifier& node_modifier) override;
+    virtual void setupParameters(Parameterizable& parameters) override;
+    virtual void process() override;
+
+private:
+    Input* in_rois_;
+    Input* in_scores_;
+    Output* out_rois_;
+    Output* out_scores_;
+
+    roi::SuppressionParameters parameters_;
+};
+
+}  // namespace csapex
+
+#endif  // NON_MAXIMUM_SUPPRESSION_ROIS_H
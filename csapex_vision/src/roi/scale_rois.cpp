@@ -7,6 +7,7 @@
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_opencv/cv_mat_message.h>
 #include <csapex_opencv/roi_message.h>
+#include <csapex_opencv/roi_set_message.h>
 
 /// SYSTEM
 #include <functional>
@@ -31,9 +32,11 @@ public:
 
     virtual void setup(csapex::NodeModifier& node_modifier) override
     {
-        in_rois_ = node_modifier.addInput<GenericVectorMessage, RoiMessage>("ROIs");
+        in_rois_ = node_modifier.addOptionalInput<GenericVectorMessage, RoiMessage>("ROIs");
+        in_roi_set_ = node_modifier.addOptionalInput<RoiSetMessage>("ROI set");
         in_img_ = node_modifier.addOptionalInput<CvMatMessage>("Cap to Image");
         out_rois_ = node_modifier.addOutput<GenericVectorMessage, RoiMessage>("Scaled ROIs");
+        out_roi_set_ = node_modifier.addOutput<RoiSetMessage>("Scaled ROI set");
     }
 
     virtual void setupParameters(Parameterizable& parameters) override
@@ -48,31 +51,44 @@ public:
 
     virtual void process() override
     {
-        std::shared_ptr<std::vector<RoiMessage> const> in_rois = msg::getMessage<GenericVectorMessage, RoiMessage>(in_rois_);
+        cv::Rect image_bounds;
+        bool cap = msg::hasMessage(in_img_);
+        if (cap) {
+            CvMatMessage::ConstPtr in_img = msg::getMessage<CvMatMessage>(in_img_);
+            image_bounds = cv::Rect(0, 0, in_img->value.cols, in_img->value.rows);
+        }
 
-        std::shared_ptr<std::vector<RoiMessage>> out_rois(new std::vector<RoiMessage>);
-        out_rois->assign(in_rois->begin(), in_rois->end());
+        if (msg::hasMessage(in_rois_)) {
+            std::shared_ptr<std::vector<RoiMessage> const> in_rois = msg::getMessage<GenericVectorMessage, RoiMessage>(in_rois_);
 
-        if (msg::hasMessage(in_img_)) {
-            CvMatMessage::ConstPtr in_img = msg::getMessage<CvMatMessage>(in_img_);
+            std::shared_ptr<std::vector<RoiMessage>> out_rois(new std::vector<RoiMessage>);
+            out_rois->assign(in_rois->begin(), in_rois->end());
 
-            const cv::Rect image_bounds(0, 0, in_img->value.cols, in_img->value.rows);
             for (RoiMessage& r : *out_rois) {
                 cv::Rect rect = r.value.rect();
                 scale(rect);
 
-                r.value.setRect(rect & image_bounds);
+                r.value.setRect(cap ? rect & image_bounds : rect);
             }
-        } else {
-            for (RoiMessage& r : *out_rois) {
-                cv::Rect rect = r.value.rect();
-                scale(rect);
 
-                r.value.setRect(rect);
-            }
+            msg::publish<GenericVectorMessage, RoiMessage>(out_rois_, out_rois);
         }
 
-        msg::publish<GenericVectorMessage, RoiMessage>(out_rois_, out_rois);
+        if (msg::hasMessage(in_roi_set_)) {
+            RoiSetMessage::ConstPtr in_set = msg::getMessage<RoiSetMessage>(in_roi_set_);
+            RoiSetMessage::Ptr out_set(new RoiSetMessage(in_set->frame_id, in_set->stamp_micro_seconds));
+            out_set->value = in_set->value;
+
+            // only the rectangle column is touched
+            for (cv::Rect& rect : out_set->value.rects()) {
+                scale(rect);
+                if (cap) {
+                    rect &= image_bounds;
+                }
+            }
+
+            msg::publish(out_roi_set_, out_set);
+        }
     }
 
 private:
@@ -101,7 +117,9 @@ private:
 private:
     Input* in_img_;
     Input* in_rois_;
+    Input* in_roi_set_;
     Output* out_rois_;
+    Output* out_roi_set_;
 
     int mode_;
 
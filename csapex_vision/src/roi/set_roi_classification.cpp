@@ -6,6 +6,10 @@
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_opencv/roi_message.h>
+#include <csapex_opencv/roi_set_message.h>
+
+/// SYSTEM
+#include <algorithm>
 
 namespace csapex
 {
@@ -20,8 +24,10 @@ public:
 
     virtual void setup(csapex::NodeModifier& node_modifier) override
     {
-        input_rois_ = node_modifier.addInput<GenericVectorMessage, RoiMessage>("ROIs");
+        input_rois_ = node_modifier.addOptionalInput<GenericVectorMessage, RoiMessage>("ROIs");
+        input_roi_set_ = node_modifier.addOptionalInput<RoiSetMessage>("ROI set");
         output_rois_ = node_modifier.addOutput<GenericVectorMessage, RoiMessage>("ROIs");
+        output_roi_set_ = node_modifier.addOutput<RoiSetMessage>("ROI set");
     }
     virtual void setupParameters(Parameterizable& parameters) override
     {
@@ -29,20 +35,35 @@ public:
     }
     virtual void process() override
     {
-        std::shared_ptr<std::vector<RoiMessage> const> input_rois = msg::getMessage<GenericVectorMessage, RoiMessage>(input_rois_);
-        std::shared_ptr<std::vector<RoiMessage>> output_rois(new std::vector<RoiMessage>);
+        if (msg::hasMessage(input_rois_)) {
+            std::shared_ptr<std::vector<RoiMessage> const> input_rois = msg::getMessage<GenericVectorMessage, RoiMessage>(input_rois_);
+            std::shared_ptr<std::vector<RoiMessage>> output_rois(new std::vector<RoiMessage>);
+
+            for (const RoiMessage& fm : *input_rois) {
+                output_rois->emplace_back(fm);
+                output_rois->back().value.setClassification(set_);
+            }
 
-        for (const RoiMessage& fm : *input_rois) {
-            output_rois->emplace_back(fm);
-            output_rois->back().value.setClassification(set_);
+            msg::publish<GenericVectorMessage, RoiMessage>(output_rois_, output_rois);
         }
 
-        msg::publish<GenericVectorMessage, RoiMessage>(output_rois_, output_rois);
+        if (msg::hasMessage(input_roi_set_)) {
+            RoiSetMessage::ConstPtr input_set = msg::getMessage<RoiSetMessage>(input_roi_set_);
+            RoiSetMessage::Ptr output_set(new RoiSetMessage(input_set->frame_id, input_set->stamp_micro_seconds));
+            output_set->value = input_set->value;
+
+            std::vector<int>& classifications = output_set->value.classifications();
+            std::fill(classifications.begin(), classifications.end(), set_);
+
+            msg::publish(output_roi_set_, output_set);
+        }
     }
 
 private:
     Input* input_rois_;
+    Input* input_roi_set_;
     Output* output_rois_;
+    Output* output_roi_set_;
 
     int set_;
 };
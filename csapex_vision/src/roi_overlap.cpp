@@ -0,0 +1,328 @@
+/// HEADER
+#include <csapex_vision/roi_overlap.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+#include <stdexcept>
+
+using namespace csapex;
+using namespace csapex::roi;
+
+double roi::overlapIoU(const cv::Rect& a, const cv::Rect& b)
+{
+    if (!intersects(a, b)) {
+        return 0.0;
+    }
+    const double intersection = (a & b).area();
+    return intersection / (a.area() + b.area() - intersection);
+}
+
+double roi::overlapMax(const cv::Rect& a, const cv::Rect& b)
+{
+    if (!intersects(a, b)) {
+        return 0.0;
+    }
+    return (a & b).area() / (double)std::max(a.area(), b.area());
+}
+
+double roi::overlap(const cv::Rect& a, const cv::Rect& b, OverlapMeasure measure)
+{
+    switch (measure) {
+        case OverlapMeasure::MAX:
+            return overlapMax(a, b);
+        case OverlapMeasure::IOU:
+        default:
+            return overlapIoU(a, b);
+    }
+}
+
+namespace
+{
+cv::Rect boundingBox(const cv::Rect& a, const cv::Rect& b)
+{
+    const int x0 = std::min(a.x, b.x);
+    const int y0 = std::min(a.y, b.y);
+    const int x1 = std::max(a.x + a.width, b.x + b.width);
+    const int y1 = std::max(a.y + a.height, b.y + b.height);
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+std::size_t findRoot(std::vector<std::size_t>& parent, std::size_t i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+}  // namespace
+
+RectIndex::RectIndex(std::size_t node_capacity) : node_capacity_(std::max<std::size_t>(2, node_capacity))
+{
+}
+
+RectIndex::RectIndex(const std::vector<cv::Rect>& rects, std::size_t node_capacity) : node_capacity_(std::max<std::size_t>(2, node_capacity))
+{
+    build(rects);
+}
+
+void RectIndex::build(const std::vector<cv::Rect>& rects)
+{
+    rects_ = rects;
+    items_.resize(rects_.size());
+    std::iota(items_.begin(), items_.end(), 0);
+    nodes_.clear();
+
+    if (rects_.empty()) {
+        return;
+    }
+
+    // sort-tile-recursive: vertical slices by center x, sorted by center y within each slice
+    auto center_x = [this](std::size_t i) { return 2 * rects_[i].x + rects_[i].width; };
+    auto center_y = [this](std::size_t i) { return 2 * rects_[i].y + rects_[i].height; };
+
+    const std::size_t n = items_.size();
+    const std::size_t leaves = (n + node_capacity_ - 1) / node_capacity_;
+    const std::size_t slices = std::max<std::size_t>(1, (std::size_t)std::ceil(std::sqrt((double)leaves)));
+    const std::size_t slice_size = slices * node_capacity_;
+
+    std::sort(items_.begin(), items_.end(), [&](std::size_t a, std::size_t b) { return center_x(a) < center_x(b); });
+    for (std::size_t begin = 0; begin < n; begin += slice_size) {
+        const std::size_t end = std::min(n, begin + slice_size);
+        std::sort(items_.begin() + begin, items_.begin() + end, [&](std::size_t a, std::size_t b) { return center_y(a) < center_y(b); });
+    }
+
+    nodes_.reserve(2 * leaves);
+
+    for (std::size_t begin = 0; begin < n; begin += node_capacity_) {
+        Node node;
+        node.first = begin;
+        node.count = std::min(node_capacity_, n - begin);
+        node.leaf = true;
+        node.bounds = rects_[items_[begin]];
+        for (std::size_t i = begin + 1; i < begin + node.count; ++i) {
+            node.bounds = boundingBox(node.bounds, rects_[items_[i]]);
+        }
+        nodes_.push_back(node);
+    }
+
+    // the tile order keeps consecutive nodes close to each other, so upper levels simply group them
+    std::size_t level_begin = 0;
+    std::size_t level_end = nodes_.size();
+    while (level_end - level_begin > 1) {
+        for (std::size_t begin = level_begin; begin < level_end; begin += node_capacity_) {
+            Node node;
+            node.first = begin;
+            node.count = std::min(node_capacity_, level_end - begin);
+            node.leaf = false;
+            node.bounds = nodes_[begin].bounds;
+            for (std::size_t i = begin + 1; i < begin + node.count; ++i) {
+                node.bounds = boundingBox(node.bounds, nodes_[i].bounds);
+            }
+            nodes_.push_back(node);
+        }
+        level_begin = level_end;
+        level_end = nodes_.size();
+    }
+}
+
+void RectIndex::query(const cv::Rect& rect, std::vector<std::size_t>& result) const
+{
+    result.clear();
+    query(rect, [&result](std::size_t i) { result.push_back(i); });
+}
+
+std::vector<std::size_t> roi::nonMaximumSuppression(const std::vector<cv::Rect>& rects, std::vector<double>& scores, const SuppressionParameters& parameters)
+{
+    if (scores.size() != rects.size()) {
+        throw std::runtime_error("number of scores does not match the number of boxes");
+    }
+
+    const std::size_t n = rects.size();
+    std::vector<std::size_t> kept;
+
+    RectIndex index(rects);
+
+    // done: kept or suppressed
+    std::vector<char> done(n, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!(scores[i] >= parameters.score_threshold)) {
+            done[i] = 1;
+        }
+    }
+
+    if (parameters.method == SuppressionMethod::GREEDY) {
+        // only candidates are sorted, NaN scores fail the threshold test above and would break the ordering
+        std::vector<std::size_t> order;
+        order.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (!done[i]) {
+                order.push_back(i);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [&scores](std::size_t a, std::size_t b) { return scores[a] > scores[b]; });
+
+        for (std::size_t i : order) {
+            if (done[i]) {
+                continue;
+            }
+            done[i] = 1;
+            kept.push_back(i);
+
+            // every box that is not done yet has a lower rank
+            index.query(rects[i], [&](std::size_t j) {
+                if (!done[j] && overlap(rects[i], rects[j], parameters.measure) > parameters.overlap_threshold) {
+                    done[j] = 1;
+                }
+            });
+        }
+        return kept;
+    }
+
+    // soft suppression: scores only decrease, so a lazy max-heap suffices
+    typedef std::pair<double, std::size_t> Entry;
+    auto worse = [](const Entry& a, const Entry& b) { return a.first < b.first || (a.first == b.first && a.second > b.second); };
+    std::priority_queue<Entry, std::vector<Entry>, decltype(worse)> queue(worse);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (!done[i]) {
+            queue.push(Entry(scores[i], i));
+        }
+    }
+
+    while (!queue.empty()) {
+        const Entry top = queue.top();
+        queue.pop();
+
+        const std::size_t i = top.second;
+        if (done[i] || top.first != scores[i]) {
+            // stale entry
+            continue;
+        }
+        done[i] = 1;
+        kept.push_back(i);
+
+        index.query(rects[i], [&](std::size_t j) {
+            if (done[j]) {
+                return;
+            }
+            const double o = overlap(rects[i], rects[j], parameters.measure);
+            double weight = 1.0;
+            if (parameters.method == SuppressionMethod::SOFT_LINEAR) {
+                if (o > parameters.overlap_threshold) {
+                    weight = 1.0 - o;
+                }
+            } else {
+                weight = std::exp(-(o * o) / parameters.sigma);
+            }
+            if (weight == 1.0) {
+                return;
+            }
+
+            scores[j] *= weight;
+            if (scores[j] < parameters.score_threshold) {
+                done[j] = 1;
+            } else {
+                queue.push(Entry(scores[j], j));
+            }
+        });
+    }
+
+    return kept;
+}
+
+std::vector<cv::Rect> roi::mergeOverlapping(const std::vector<cv::Rect>& rects)
+{
+    std::vector<cv::Rect> current;
+    current.reserve(rects.size());
+    for (const cv::Rect& r : rects) {
+        if (r.area() > 0) {
+            current.push_back(r);
+        }
+    }
+
+    // a merged bounding box can overlap rectangles that none of its members touched, so repeat until stable
+    RectIndex index;
+    std::vector<std::size_t> parent;
+    while (true) {
+        const std::size_t n = current.size();
+        index.build(current);
+
+        parent.resize(n);
+        std::iota(parent.begin(), parent.end(), 0);
+
+        bool merged = false;
+        for (std::size_t i = 0; i < n; ++i) {
+            index.query(current[i], [&](std::size_t j) {
+                if (j <= i) {
+                    return;
+                }
+                std::size_t a = findRoot(parent, i);
+                std::size_t b = findRoot(parent, j);
+                if (a != b) {
+                    parent[std::max(a, b)] = std::min(a, b);
+                    merged = true;
+                }
+            });
+        }
+
+        if (!merged) {
+            return current;
+        }
+
+        std::vector<cv::Rect> next;
+        std::vector<std::size_t> slot(n, n);
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::size_t root = findRoot(parent, i);
+            if (slot[root] == n) {
+                slot[root] = next.size();
+                next.push_back(current[i]);
+            } else {
+                next[slot[root]] = boundingBox(next[slot[root]], current[i]);
+            }
+        }
+        current.swap(next);
+    }
+}
+
+GreedyMatcher::GreedyMatcher(const std::vector<cv::Rect>& candidates, OverlapMeasure measure)
+  : index_(candidates), overlap_fn_([measure](const cv::Rect& a, const cv::Rect& b) { return overlap(a, b, measure); }), assigned_(candidates.size(), 0)
+{
+}
+
+GreedyMatcher::GreedyMatcher(const std::vector<cv::Rect>& candidates, const OverlapFunction& overlap_fn) : index_(candidates), overlap_fn_(overlap_fn), assigned_(candidates.size(), 0)
+{
+}
+
+int GreedyMatcher::match(const cv::Rect& query, double min_overlap, double* overlap) const
+{
+    int best = -1;
+    double best_overlap = min_overlap;
+    index_.query(query, [&](std::size_t j) {
+        if (assigned_[j]) {
+            return;
+        }
+        const double o = overlap_fn_(index_.rect(j), query);
+        if (o > best_overlap || (best >= 0 && o == best_overlap && (int)j < best)) {
+            best = j;
+            best_overlap = o;
+        }
+    });
+
+    if (overlap && best >= 0) {
+        *overlap = best_overlap;
+    }
+    return best;
+}
+
+void GreedyMatcher::assign(std::size_t candidate)
+{
+    assigned_[candidate] = 1;
+}
+
+bool GreedyMatcher::isAssigned(std::size_t candidate) const
+{
+    return assigned_[candidate] != 0;
+}
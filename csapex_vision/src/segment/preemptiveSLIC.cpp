@@ -7,7 +7,6 @@
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_opencv/cv_mat_message.h>
-#include <cslibs_vision/utils/preemptiveSLIC.h>
 
 CSAPEX_REGISTER_CLASS(csapex::PreemptiveSLIC, csapex::Node)
 
@@ -27,12 +26,16 @@ void PreemptiveSLIC::process()
     if (in->value.type() != CV_8UC3)
         throw std::runtime_error("Need a 3 channel bgr image!");
 
-    int n = readParameter<int>("super pixels");
-    double c = readParameter<double>("compactness");
+    Slic::Parameters parameters;
+    parameters.superpixels = readParameter<int>("super pixels");
+    parameters.compactness = readParameter<double>("compactness");
+    parameters.iterations = readParameter<int>("iterations");
+    parameters.preemption = readParameter<bool>("preemption");
+    parameters.preemption_threshold = readParameter<double>("preemption threshold");
+    parameters.warm_start = readParameter<bool>("warm start");
+    parameters.warm_start_iterations = readParameter<int>("warm start iterations");
 
-    cslibs_vision::PreemptiveSLIC ps;
-    cv::Mat seeds;
-    ps.preemptiveSLIC(in->value, n, c, out->value, seeds);
+    slic_.segment(in->value, parameters, out->value);
 
     msg::publish(output_, out);
 }
@@ -47,4 +50,14 @@ void PreemptiveSLIC::setupParameters(Parameterizable& parameters)
 {
     addParameter(csapex::param::factory::declareRange("super pixels", 10, 2000, 50, 1));
     addParameter(csapex::param::factory::declareRange("compactness", 0.0, 200.0, 0.0, 0.1));
+    addParameter(csapex::param::factory::declareRange("iterations", 1, 50, 10, 1));
+
+    csapex::param::Parameter::Ptr preemption = csapex::param::factory::declareBool("preemption", csapex::param::ParameterDescription("Stop updating superpixels that have converged."), true);
+    addParameter(preemption);
+    addConditionalParameter(csapex::param::factory::declareRange("preemption threshold", 0.0, 10.0, 0.5, 0.05), [preemption]() { return preemption->as<bool>(); });
+
+    csapex::param::Parameter::Ptr warm_start =
+        csapex::param::factory::declareBool("warm start", csapex::param::ParameterDescription("Seed with the centers of the previous frame, for video."), false);
+    addParameter(warm_start);
+    addConditionalParameter(csapex::param::factory::declareRange("warm start iterations", 1, 50, 3, 1), [warm_start]() { return warm_start->as<bool>(); });
 }
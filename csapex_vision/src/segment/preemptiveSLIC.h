@@ -3,6 +3,7 @@
 
 /// COMPONENT
 #include <csapex/model/node.h>
+#include <csapex_vision/slic.h>
 
 namespace csapex
 {
@@ -18,6 +19,8 @@ public:
 private:
     csapex::Output* output_;
     csapex::Input* input_;
+
+    Slic slic_;
 };
 }  // namespace csapex
 
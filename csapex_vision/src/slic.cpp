@@ -0,0 +1,413 @@
+/// HEADER
+#include <csapex_vision/slic.h>
+
+/// PROJECT
+#include <csapex_opencv/parallel.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <stdexcept>
+
+using namespace csapex;
+
+namespace
+{
+/// sums per center: l, a, b, x, y, count
+const int SUMS = 6;
+const int STRIPE_MIN_ROWS = 8;
+
+template <typename Function>
+void parallelStripes(int rows, int stripes, const Function& function)
+{
+    parallel::forRange(stripes, [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; ++s) {
+            function(s, s * rows / stripes, (s + 1) * rows / stripes);
+        }
+    });
+}
+
+}  // namespace
+
+Slic::Slic()
+  : step_(1.f)
+  , spatial_weight_(0.f)
+  , threshold_sqr_(0.f)
+  , preemption_(true)
+  , grid_cols_(0)
+  , grid_rows_(0)
+  , previous_superpixels_(0)
+  , previous_compactness_(0.0)
+  , iterations_used_(0)
+{
+}
+
+void Slic::reset()
+{
+    centers_.clear();
+}
+
+const std::vector<Slic::Center>& Slic::centers() const
+{
+    return centers_;
+}
+
+int Slic::iterationsUsed() const
+{
+    return iterations_used_;
+}
+
+int Slic::segment(const cv::Mat& bgr, const Parameters& parameters, cv::Mat& labels)
+{
+    if (bgr.type() != CV_8UC3) {
+        throw std::runtime_error("Need a 3 channel bgr image!");
+    }
+    if (bgr.empty()) {
+        labels = cv::Mat();
+        return 0;
+    }
+
+    cv::cvtColor(bgr, lab_, CV_BGR2Lab);
+
+    const int superpixels = std::max(1, std::min(parameters.superpixels, bgr.rows * bgr.cols));
+    step_ = static_cast<float>(std::sqrt(bgr.rows * bgr.cols / static_cast<double>(superpixels)));
+    spatial_weight_ = static_cast<float>(parameters.compactness / step_);
+    threshold_sqr_ = static_cast<float>(parameters.preemption_threshold * parameters.preemption_threshold);
+    preemption_ = parameters.preemption;
+
+    const bool warm = parameters.warm_start && !centers_.empty() && bgr.size() == previous_size_ && superpixels == previous_superpixels_ && parameters.compactness == previous_compactness_;
+
+    if (warm) {
+        // keep the positions, but the colors have to be taken from the new image
+        for (Center& center : centers_) {
+            const int x = std::min(std::max(cvRound(center.x), 0), bgr.cols - 1);
+            const int y = std::min(std::max(cvRound(center.y), 0), bgr.rows - 1);
+            const cv::Vec3b& color = lab_.at<cv::Vec3b>(y, x);
+            center.l = color[0];
+            center.a = color[1];
+            center.b = color[2];
+        }
+    } else {
+        assignment_.create(bgr.size(), CV_32SC1);
+        assignment_.setTo(cv::Scalar::all(-1));
+        seedGrid();
+    }
+
+    previous_size_ = bgr.size();
+    previous_superpixels_ = superpixels;
+    previous_compactness_ = parameters.compactness;
+
+    const int stripes = std::max(1, std::min(2 * cv::getNumThreads(), bgr.rows / STRIPE_MIN_ROWS));
+    stripe_sums_.resize(stripes);
+
+    active_.assign(centers_.size(), true);
+
+    const int iterations = std::max(1, warm ? parameters.warm_start_iterations : parameters.iterations);
+    iterations_used_ = 0;
+    for (int i = 0; i < iterations; ++i) {
+        ++iterations_used_;
+
+        bucketCenters();
+        parallelStripes(bgr.rows, stripes, [this](int, int y0, int y1) { assign(y0, y1); });
+        parallelStripes(bgr.rows, stripes, [this](int s, int y0, int y1) { accumulate(y0, y1, stripe_sums_[s]); });
+
+        if (!updateCenters()) {
+            break;
+        }
+    }
+
+    return enforceConnectivity(labels);
+}
+
+void Slic::seedGrid()
+{
+    centers_.clear();
+
+    const int cols = lab_.cols;
+    const int rows = lab_.rows;
+    const int grid_x = std::max(1, static_cast<int>(std::round(cols / step_)));
+    const int grid_y = std::max(1, static_cast<int>(std::round(rows / step_)));
+    const float dx = cols / static_cast<float>(grid_x);
+    const float dy = rows / static_cast<float>(grid_y);
+
+    cv::Mat gray;
+    cv::extractChannel(lab_, gray, 0);
+
+    for (int gy = 0; gy < grid_y; ++gy) {
+        for (int gx = 0; gx < grid_x; ++gx) {
+            int x = std::min(static_cast<int>((gx + 0.5f) * dx), cols - 1);
+            int y = std::min(static_cast<int>((gy + 0.5f) * dy), rows - 1);
+
+            // move the seed off edges, to the lowest gradient in its 3x3 neighbourhood
+            int best_x = x;
+            int best_y = y;
+            int best_gradient = std::numeric_limits<int>::max();
+            for (int ny = std::max(1, y - 1); ny <= std::min(rows - 2, y + 1); ++ny) {
+                for (int nx = std::max(1, x - 1); nx <= std::min(cols - 2, x + 1); ++nx) {
+                    const int gh = gray.at<uchar>(ny, nx + 1) - gray.at<uchar>(ny, nx - 1);
+                    const int gv = gray.at<uchar>(ny + 1, nx) - gray.at<uchar>(ny - 1, nx);
+                    const int gradient = gh * gh + gv * gv;
+                    if (gradient < best_gradient) {
+                        best_gradient = gradient;
+                        best_x = nx;
+                        best_y = ny;
+                    }
+                }
+            }
+
+            const cv::Vec3b& color = lab_.at<cv::Vec3b>(best_y, best_x);
+            Center center;
+            center.l = color[0];
+            center.a = color[1];
+            center.b = color[2];
+            center.x = static_cast<float>(best_x);
+            center.y = static_cast<float>(best_y);
+            centers_.push_back(center);
+        }
+    }
+}
+
+void Slic::bucketCenters()
+{
+    grid_cols_ = std::max(1, static_cast<int>(std::ceil(lab_.cols / step_)));
+    grid_rows_ = std::max(1, static_cast<int>(std::ceil(lab_.rows / step_)));
+    const int cells = grid_cols_ * grid_rows_;
+
+    auto cell_of = [this](const Center& center) {
+        const int gx = std::min(std::max(static_cast<int>(center.x / step_), 0), grid_cols_ - 1);
+        const int gy = std::min(std::max(static_cast<int>(center.y / step_), 0), grid_rows_ - 1);
+        return gy * grid_cols_ + gx;
+    };
+
+    // counting sort of the centers into their cells
+    cell_offsets_.assign(cells + 1, 0);
+    for (const Center& center : centers_) {
+        ++cell_offsets_[cell_of(center) + 1];
+    }
+    for (int c = 0; c < cells; ++c) {
+        cell_offsets_[c + 1] += cell_offsets_[c];
+    }
+    cell_centers_.resize(centers_.size());
+    std::vector<int> fill(cell_offsets_.begin(), cell_offsets_.end() - 1);
+
+    std::vector<bool> has_active(cells, false);
+    for (std::size_t k = 0; k < centers_.size(); ++k) {
+        const int cell = cell_of(centers_[k]);
+        cell_centers_[fill[cell]++] = static_cast<int>(k);
+        if (active_[k]) {
+            has_active[cell] = true;
+        }
+    }
+
+    // a cell has to be revisited if any center it can see is still moving
+    cell_active_.assign(cells, false);
+    for (int gy = 0; gy < grid_rows_; ++gy) {
+        for (int gx = 0; gx < grid_cols_; ++gx) {
+            bool active = false;
+            for (int ny = std::max(0, gy - 1); ny <= std::min(grid_rows_ - 1, gy + 1) && !active; ++ny) {
+                for (int nx = std::max(0, gx - 1); nx <= std::min(grid_cols_ - 1, gx + 1); ++nx) {
+                    if (has_active[ny * grid_cols_ + nx]) {
+                        active = true;
+                        break;
+                    }
+                }
+            }
+            cell_active_[gy * grid_cols_ + gx] = active;
+        }
+    }
+}
+
+void Slic::assign(int y0, int y1)
+{
+    const float inv_step = 1.f / step_;
+    const float weight_sqr = spatial_weight_ * spatial_weight_;
+
+    std::vector<int> candidates;
+    candidates.reserve(32);
+
+    for (int y = y0; y < y1; ++y) {
+        const cv::Vec3b* lab = lab_.ptr<cv::Vec3b>(y);
+        int* assignment = assignment_.ptr<int>(y);
+        const int gy = std::min(static_cast<int>(y * inv_step), grid_rows_ - 1);
+
+        int x = 0;
+        while (x < lab_.cols) {
+            // all pixels of a cell in this row share the candidates
+            const int gx = std::min(static_cast<int>(x * inv_step), grid_cols_ - 1);
+            int x_end = x + 1;
+            while (x_end < lab_.cols && std::min(static_cast<int>(x_end * inv_step), grid_cols_ - 1) == gx) {
+                ++x_end;
+            }
+
+            if (!cell_active_[gy * grid_cols_ + gx]) {
+                x = x_end;
+                continue;
+            }
+
+            candidates.clear();
+            for (int ny = std::max(0, gy - 1); ny <= std::min(grid_rows_ - 1, gy + 1); ++ny) {
+                for (int nx = std::max(0, gx - 1); nx <= std::min(grid_cols_ - 1, gx + 1); ++nx) {
+                    const int cell = ny * grid_cols_ + nx;
+                    for (int i = cell_offsets_[cell]; i < cell_offsets_[cell + 1]; ++i) {
+                        const int k = cell_centers_[i];
+                        if (std::abs(centers_[k].y - y) < step_) {
+                            candidates.push_back(k);
+                        }
+                    }
+                }
+            }
+
+            for (; x < x_end; ++x) {
+                const float l = lab[x][0];
+                const float a = lab[x][1];
+                const float b = lab[x][2];
+
+                float best = std::numeric_limits<float>::max();
+                int best_k = assignment[x];
+                for (int k : candidates) {
+                    const Center& center = centers_[k];
+                    const float dx = center.x - x;
+                    if (std::abs(dx) >= step_) {
+                        continue;
+                    }
+                    const float dy = center.y - y;
+                    const float dl = center.l - l;
+                    const float da = center.a - a;
+                    const float db = center.b - b;
+                    const float distance = dl * dl + da * da + db * db + weight_sqr * (dx * dx + dy * dy);
+                    if (distance < best) {
+                        best = distance;
+                        best_k = k;
+                    }
+                }
+                assignment[x] = best_k;
+            }
+        }
+    }
+}
+
+void Slic::accumulate(int y0, int y1, std::vector<double>& sums) const
+{
+    sums.assign(centers_.size() * SUMS, 0.0);
+    for (int y = y0; y < y1; ++y) {
+        const cv::Vec3b* lab = lab_.ptr<cv::Vec3b>(y);
+        const int* assignment = assignment_.ptr<int>(y);
+        for (int x = 0; x < lab_.cols; ++x) {
+            const int k = assignment[x];
+            if (k < 0) {
+                continue;
+            }
+            double* sum = &sums[k * SUMS];
+            sum[0] += lab[x][0];
+            sum[1] += lab[x][1];
+            sum[2] += lab[x][2];
+            sum[3] += x;
+            sum[4] += y;
+            sum[5] += 1.0;
+        }
+    }
+}
+
+bool Slic::updateCenters()
+{
+    std::vector<double>& total = stripe_sums_.front();
+    for (std::size_t s = 1; s < stripe_sums_.size(); ++s) {
+        const std::vector<double>& partial = stripe_sums_[s];
+        for (std::size_t i = 0; i < total.size(); ++i) {
+            total[i] += partial[i];
+        }
+    }
+
+    bool any_active = false;
+    for (std::size_t k = 0; k < centers_.size(); ++k) {
+        const double* sum = &total[k * SUMS];
+        if (sum[5] == 0.0) {
+            active_[k] = false;
+            continue;
+        }
+
+        Center updated;
+        updated.l = static_cast<float>(sum[0] / sum[5]);
+        updated.a = static_cast<float>(sum[1] / sum[5]);
+        updated.b = static_cast<float>(sum[2] / sum[5]);
+        updated.x = static_cast<float>(sum[3] / sum[5]);
+        updated.y = static_cast<float>(sum[4] / sum[5]);
+
+        Center& center = centers_[k];
+        const float dl = updated.l - center.l;
+        const float da = updated.a - center.a;
+        const float db = updated.b - center.b;
+        const float dx = updated.x - center.x;
+        const float dy = updated.y - center.y;
+        const float shift = dl * dl + da * da + db * db + dx * dx + dy * dy;
+
+        center = updated;
+        active_[k] = !preemption_ || shift > threshold_sqr_;
+        any_active = any_active || active_[k];
+    }
+    return any_active;
+}
+
+int Slic::enforceConnectivity(cv::Mat& labels)
+{
+    const int cols = assignment_.cols;
+    const int rows = assignment_.rows;
+    const int min_size = std::max(1, static_cast<int>(step_ * step_ / 4));
+
+    labels.create(assignment_.size(), CV_32SC1);
+    labels.setTo(cv::Scalar::all(-1));
+    queue_.resize(static_cast<std::size_t>(rows) * cols);
+
+    const int dx[4] = { -1, 0, 1, 0 };
+    const int dy[4] = { 0, -1, 0, 1 };
+
+    int next_label = 0;
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            if (labels.at<int>(y, x) >= 0) {
+                continue;
+            }
+
+            // a segment that is too small is merged into an already labeled neighbour
+            int adjacent = -1;
+            for (int n = 0; n < 4; ++n) {
+                const int nx = x + dx[n];
+                const int ny = y + dy[n];
+                if (nx >= 0 && nx < cols && ny >= 0 && ny < rows && labels.at<int>(ny, nx) >= 0) {
+                    adjacent = labels.at<int>(ny, nx);
+                }
+            }
+
+            const int source = assignment_.at<int>(y, x);
+            int head = 0;
+            int tail = 0;
+            queue_[tail++] = y * cols + x;
+            labels.at<int>(y, x) = next_label;
+            while (head < tail) {
+                const int index = queue_[head++];
+                const int px = index % cols;
+                const int py = index / cols;
+                for (int n = 0; n < 4; ++n) {
+                    const int nx = px + dx[n];
+                    const int ny = py + dy[n];
+                    if (nx >= 0 && nx < cols && ny >= 0 && ny < rows && labels.at<int>(ny, nx) < 0 && assignment_.at<int>(ny, nx) == source) {
+                        labels.at<int>(ny, nx) = next_label;
+                        queue_[tail++] = ny * cols + nx;
+                    }
+                }
+            }
+
+            if (tail < min_size && adjacent >= 0) {
+                for (int i = 0; i < tail; ++i) {
+                    labels.at<int>(queue_[i] / cols, queue_[i] % cols) = adjacent;
+                }
+            } else {
+                ++next_label;
+            }
+        }
+    }
+
+    return next_label;
+}
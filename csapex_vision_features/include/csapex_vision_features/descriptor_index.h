@@ -0,0 +1,168 @@
+#ifndef DESCRIPTOR_INDEX_H
+#define DESCRIPTOR_INDEX_H
+
+/// SYSTEM
+#include <cstdint>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The DescriptorIndex class answers k-nearest-neighbour queries against a fixed train set.
+ *
+ * The index remembers a fingerprint of the descriptors it was built for,
+ * so callers can call build() every frame and only pay for indexing when the
+ * train set actually changed.
+ * Queries are const and processed in parallel.
+ */
+class DescriptorIndex
+{
+public:
+    typedef std::shared_ptr<DescriptorIndex> Ptr;
+
+public:
+    virtual ~DescriptorIndex();
+
+    /// builds the index, unless it already indexes exactly these descriptors
+    /// @return true, if the index was (re)built
+    bool build(const cv::Mat& train);
+
+    /// @return the k nearest train descriptors for every query row, ordered by distance
+    virtual void knnMatch(const cv::Mat& query, std::vector<std::vector<cv::DMatch>>& matches, int k) const = 0;
+
+    bool empty() const;
+
+    static uint64_t fingerprint(const cv::Mat& descriptors);
+
+protected:
+    virtual void rebuild(const cv::Mat& train) = 0;
+
+protected:
+    cv::Mat train_;
+
+private:
+    uint64_t fingerprint_ = 0;
+};
+
+/**
+ * @brief The BruteForceIndex class compares every query with every train descriptor
+ */
+class BruteForceIndex : public DescriptorIndex
+{
+public:
+    BruteForceIndex(int norm);
+
+    void knnMatch(const cv::Mat& query, std::vector<std::vector<cv::DMatch>>& matches, int k) const override;
+
+protected:
+    void rebuild(const cv::Mat& train) override;
+
+private:
+    int norm_;
+};
+
+/**
+ * @brief The LshIndex class is a multi-table locality sensitive hash for binary descriptors.
+ *
+ * Every table hashes a random subset of the descriptor bits, buckets are stored
+ * as one sorted array per table and only non-empty buckets take up memory,
+ * so the size is independent of the key bits. With multi-probing, the buckets whose key differs
+ * in one bit are visited as well. Candidates are ranked by their exact Hamming
+ * distance, queries with fewer than k candidates fall back to a linear scan.
+ */
+class LshIndex : public DescriptorIndex
+{
+public:
+    LshIndex(int tables = 8, int key_bits = 12, bool multi_probe = true);
+
+    void knnMatch(const cv::Mat& query, std::vector<std::vector<cv::DMatch>>& matches, int k) const override;
+
+protected:
+    void rebuild(const cv::Mat& train) override;
+
+private:
+    struct Table
+    {
+        /// byte offset and mask of every key bit
+        std::vector<int> bytes;
+        std::vector<uint8_t> masks;
+
+        /// the sorted keys of the non-empty buckets, bucket b has the key keys[b]
+        std::vector<uint32_t> keys;
+        /// bucket b holds items[offsets[b]] ... items[offsets[b + 1] - 1]
+        std::vector<int> offsets;
+        std::vector<int> items;
+    };
+
+    uint32_t key(const Table& table, const uint8_t* descriptor) const;
+
+private:
+    int tables_count_;
+    int requested_key_bits_;
+    /// limited by the descriptor size
+    int key_bits_;
+    bool multi_probe_;
+
+    std::vector<Table> tables_;
+};
+
+/**
+ * @brief The KdForestIndex class is a set of randomized k-d trees for float descriptors.
+ *
+ * Each tree splits on one of the dimensions of highest variance, chosen at
+ * random. All trees are searched together best-bin-first, until max_checks
+ * descriptors have been compared.
+ */
+class KdForestIndex : public DescriptorIndex
+{
+public:
+    KdForestIndex(int trees = 4, int max_checks = 128);
+
+    void knnMatch(const cv::Mat& query, std::vector<std::vector<cv::DMatch>>& matches, int k) const override;
+
+protected:
+    void rebuild(const cv::Mat& train) override;
+
+private:
+    struct Node
+    {
+        /// split dimension, -1 for leaves
+        int dim;
+        float value;
+        /// children for inner nodes, the range in the tree's permutation for leaves
+        int first;
+        int second;
+    };
+
+    struct Tree
+    {
+        std::vector<Node> nodes;
+        std::vector<int> permutation;
+    };
+
+    int buildTree(Tree& tree, int begin, int end, cv::RNG& rng);
+
+private:
+    int trees_count_;
+    int max_checks_;
+
+    std::vector<Tree> trees_;
+};
+
+/**
+ * @brief ratioTest clears every entry whose best distance exceeds ratio times the second best
+ *        and every entry with less than two neighbours
+ */
+void ratioTest(std::vector<std::vector<cv::DMatch>>& matches, float ratio);
+
+/**
+ * @brief symmetryTest keeps the best matches 1 -> 2 that are also the best match 2 -> 1,
+ *        in the order of matches1. Cleared entries are ignored.
+ */
+void symmetryTest(const std::vector<std::vector<cv::DMatch>>& matches1, const std::vector<std::vector<cv::DMatch>>& matches2, std::vector<cv::DMatch>& symmetric);
+
+}  // namespace csapex
+
+#endif  // DESCRIPTOR_INDEX_H
@@ -0,0 +1,81 @@
+#ifndef TILED_EXTRACTOR_H
+#define TILED_EXTRACTOR_H
+
+/// PROJECT
+#include <cslibs_vision/utils/extractor.h>
+
+/// SYSTEM
+#include <functional>
+#include <map>
+#include <mutex>
+#include <opencv2/opencv.hpp>
+#include <thread>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The TiledExtractor class runs an Extractor on overlapping image tiles in parallel.
+ *
+ * Every worker thread lazily creates its own Extractor with the factory and
+ * keeps it until the factory changes, so detectors are not reinitialized for
+ * every frame and no detector instance is shared between threads.
+ *
+ * Keypoints are detected on every tile including its overlap, but a tile only
+ * keeps the keypoints inside its own cell, so every keypoint has exactly one
+ * owner. Keypoints of neighbouring cells closer than the suppression radius
+ * are deduplicated afterwards, keeping the stronger response.
+ */
+class TiledExtractor
+{
+public:
+    typedef std::function<Extractor::Ptr()> Factory;
+
+    struct Options
+    {
+        Options() : tiles_x(4), tiles_y(4), overlap(16), max_per_tile(0), suppression_radius(2.0)
+        {
+        }
+
+        int tiles_x;
+        int tiles_y;
+        /// pixels added to every side of a tile before detection
+        int overlap;
+        /// keypoints kept per tile, ordered by response, 0 keeps all
+        int max_per_tile;
+        /// keypoints of different tiles closer than this are considered duplicates
+        double suppression_radius;
+    };
+
+public:
+    TiledExtractor();
+
+    /// drops all cached extractors, they are recreated on demand with the new factory
+    void setFactory(Factory factory);
+    bool hasFactory() const;
+
+    void setOptions(const Options& options);
+    const Options& getOptions() const;
+
+    void extractKeypoints(const cv::Mat& image, const cv::Mat& mask, std::vector<cv::KeyPoint>& keypoints);
+
+    /// keypoints are processed in tiles_x * tiles_y contiguous batches, so the order of the input is preserved
+    void extractDescriptors(const cv::Mat& image, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors);
+
+    /// the extractor of the calling thread
+    Extractor::Ptr local();
+
+    /// partitions the image into tiles_x * tiles_y cells, row by row
+    static std::vector<cv::Rect> cells(const cv::Size& size, int tiles_x, int tiles_y);
+
+private:
+    Factory factory_;
+    Options options_;
+
+    std::mutex cache_mutex_;
+    std::map<std::thread::id, Extractor::Ptr> cache_;
+};
+
+}  // namespace csapex
+
+#endif  // TILED_EXTRACTOR_H
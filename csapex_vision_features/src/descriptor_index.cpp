@@ -0,0 +1,516 @@
+/// HEADER
+#include <csapex_vision_features/descriptor_index.h>
+
+/// PROJECT
+#include <csapex_opencv/parallel.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <utility>
+
+using namespace csapex;
+
+namespace
+{
+template <typename Function>
+void parallelFor(int n, const Function& function)
+{
+    // a few hundred queries per chunk amortize the per-chunk allocations
+    parallel::forRange(n, function, std::max(1.0, n / 256.0));
+}
+
+/// the k best candidates seen so far, sorted by distance
+class Neighbours
+{
+public:
+    Neighbours(int k) : k_(k)
+    {
+        items_.reserve(k + 1);
+    }
+
+    void clear()
+    {
+        items_.clear();
+    }
+
+    bool full() const
+    {
+        return static_cast<int>(items_.size()) >= k_;
+    }
+
+    float worst() const
+    {
+        return full() ? items_.back().first : std::numeric_limits<float>::max();
+    }
+
+    void insert(int index, float distance)
+    {
+        if (full() && distance >= items_.back().first) {
+            return;
+        }
+        auto pos = std::upper_bound(items_.begin(), items_.end(), std::make_pair(distance, index));
+        items_.insert(pos, std::make_pair(distance, index));
+        if (static_cast<int>(items_.size()) > k_) {
+            items_.pop_back();
+        }
+    }
+
+    void write(int query, std::vector<cv::DMatch>& matches, bool squared) const
+    {
+        matches.clear();
+        for (const std::pair<float, int>& item : items_) {
+            matches.push_back(cv::DMatch(query, item.second, squared ? std::sqrt(item.first) : item.first));
+        }
+    }
+
+private:
+    int k_;
+    std::vector<std::pair<float, int>> items_;
+};
+
+inline int hammingDistance(const uint8_t* a, const uint8_t* b, int bytes)
+{
+    int distance = 0;
+    int i = 0;
+    for (; i + 8 <= bytes; i += 8) {
+        uint64_t x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        distance += __builtin_popcountll(x ^ y);
+    }
+    for (; i < bytes; ++i) {
+        distance += __builtin_popcount(a[i] ^ b[i]);
+    }
+    return distance;
+}
+
+inline float squaredDistance(const float* a, const float* b, int dims)
+{
+    float distance = 0.0f;
+    for (int i = 0; i < dims; ++i) {
+        const float d = a[i] - b[i];
+        distance += d * d;
+    }
+    return distance;
+}
+
+}  // namespace
+
+/// DESCRIPTOR INDEX
+
+DescriptorIndex::~DescriptorIndex()
+{
+}
+
+uint64_t DescriptorIndex::fingerprint(const cv::Mat& descriptors)
+{
+    // FNV-1a over shape and contents, eight bytes at a time
+    const uint64_t prime = 1099511628211ull;
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&](uint64_t v) { hash = (hash ^ v) * prime; };
+
+    mix(descriptors.rows);
+    mix(descriptors.cols);
+    mix(descriptors.type());
+
+    const std::size_t row_bytes = descriptors.cols * descriptors.elemSize();
+    for (int row = 0; row < descriptors.rows; ++row) {
+        const uint8_t* data = descriptors.ptr<uint8_t>(row);
+        std::size_t i = 0;
+        for (; i + 8 <= row_bytes; i += 8) {
+            uint64_t v;
+            std::memcpy(&v, data + i, 8);
+            mix(v);
+        }
+        for (; i < row_bytes; ++i) {
+            mix(data[i]);
+        }
+    }
+    return hash;
+}
+
+bool DescriptorIndex::build(const cv::Mat& train)
+{
+    const uint64_t fp = fingerprint(train);
+    if (!train_.empty() && fp == fingerprint_ && train.size() == train_.size() && train.type() == train_.type()) {
+        return false;
+    }
+
+    // keep a private copy, the index must not depend on the lifetime of the message
+    train_ = train.clone();
+    fingerprint_ = fp;
+    rebuild(train_);
+    return true;
+}
+
+bool DescriptorIndex::empty() const
+{
+    return train_.empty();
+}
+
+/// BRUTE FORCE
+
+BruteForceIndex::BruteForceIndex(int norm) : norm_(norm)
+{
+}
+
+void BruteForceIndex::rebuild(const cv::Mat& /*train*/)
+{
+}
+
+void BruteForceIndex::knnMatch(const cv::Mat& query, std::vector<std::vector<cv::DMatch>>& matches, int k) const
+{
+    cv::BFMatcher matcher(norm_);
+    matcher.knnMatch(query, train_, matches, k);
+}
+
+/// LSH
+
+LshIndex::LshIndex(int tables, int key_bits, bool multi_probe) : tables_count_(std::max(1, tables)), requested_key_bits_(std::max(1, std::min(key_bits, 24))), key_bits_(requested_key_bits_), multi_probe_(multi_probe)
+{
+}
+
+uint32_t LshIndex::key(const Table& table, const uint8_t* descriptor) const
+{
+    uint32_t key = 0;
+    for (int b = 0; b < key_bits_; ++b) {
+        if (descriptor[table.bytes[b]] & table.masks[b]) {
+            key |= 1u << b;
+        }
+    }
+    return key;
+}
+
+void LshIndex::rebuild(const cv::Mat& train)
+{
+    const int bytes = train.cols * train.elemSize();
+    const int bits = bytes * 8;
+    const int key_bits = std::min(requested_key_bits_, bits);
+    key_bits_ = key_bits;
+
+    std::vector<int> bit_indices(bits);
+    std::iota(bit_indices.begin(), bit_indices.end(), 0);
+
+    // deterministic tables, so the same train set always yields the same matches
+    cv::RNG rng(0x5eed);
+
+    tables_.clear();
+    tables_.resize(tables_count_);
+    for (Table& table : tables_) {
+        for (int i = 0; i < key_bits; ++i) {
+            std::swap(bit_indices[i], bit_indices[i + rng.uniform(0, bits - i)]);
+            table.bytes.push_back(bit_indices[i] / 8);
+            table.masks.push_back(static_cast<uint8_t>(1u << (bit_indices[i] % 8)));
+        }
+
+        // sort the train descriptors by key, then store one offset per distinct key
+        std::vector<std::pair<uint32_t, int>> keyed(train.rows);
+        for (int row = 0; row < train.rows; ++row) {
+            keyed[row] = std::make_pair(key(table, train.ptr<uint8_t>(row)), row);
+        }
+        std::sort(keyed.begin(), keyed.end());
+
+        table.items.resize(train.rows);
+        for (int i = 0; i < train.rows; ++i) {
+            if (i == 0 || keyed[i].first != keyed[i - 1].first) {
+                table.keys.push_back(keyed[i].first);
+                table.offsets.push_back(i);
+            }
+            table.items[i] = keyed[i].second;
+        }
+        table.offsets.push_back(train.rows);
+    }
+}
+
+void LshIndex::knnMatch(const cv::Mat& query, std::vector<std::vector<cv::DMatch>>& matches, int k) const
+{
+    matches.clear();
+    matches.resize(query.rows);
+    if (train_.empty() || query.empty()) {
+        return;
+    }
+    CV_Assert(query.cols * query.elemSize() == train_.cols * train_.elemSize());
+
+    const int bytes = train_.cols * train_.elemSize();
+
+    parallelFor(query.rows, [&](const cv::Range& range) {
+        Neighbours neighbours(k);
+
+        // visited[i] == stamp marks train descriptor i as compared for the current query
+        std::vector<uint32_t> visited(train_.rows, 0);
+        uint32_t stamp = 0;
+
+        for (int q = range.start; q < range.end; ++q) {
+            const uint8_t* descriptor = query.ptr<uint8_t>(q);
+            neighbours.clear();
+            ++stamp;
+
+            int candidates = 0;
+            auto visitBucket = [&](const Table& table, uint32_t key) {
+                const auto pos = std::lower_bound(table.keys.begin(), table.keys.end(), key);
+                if (pos == table.keys.end() || *pos != key) {
+                    return;
+                }
+                const std::size_t bucket = pos - table.keys.begin();
+                for (int i = table.offsets[bucket], end = table.offsets[bucket + 1]; i < end; ++i) {
+                    const int item = table.items[i];
+                    if (visited[item] != stamp) {
+                        visited[item] = stamp;
+                        ++candidates;
+                        neighbours.insert(item, hammingDistance(descriptor, train_.ptr<uint8_t>(item), bytes));
+                    }
+                }
+            };
+
+            for (const Table& table : tables_) {
+                const uint32_t bucket = key(table, descriptor);
+                visitBucket(table, bucket);
+                if (multi_probe_) {
+                    for (int b = 0; b < key_bits_; ++b) {
+                        visitBucket(table, bucket ^ (1u << b));
+                    }
+                }
+            }
+
+            if (candidates < k && candidates < train_.rows) {
+                // too few candidates for a meaningful ratio test
+                for (int item = 0; item < train_.rows; ++item) {
+                    if (visited[item] != stamp) {
+                        neighbours.insert(item, hammingDistance(descriptor, train_.ptr<uint8_t>(item), bytes));
+                    }
+                }
+            }
+
+            neighbours.write(q, matches[q], false);
+        }
+    });
+}
+
+/// K-D FOREST
+
+KdForestIndex::KdForestIndex(int trees, int max_checks) : trees_count_(std::max(1, trees)), max_checks_(std::max(1, max_checks))
+{
+}
+
+void KdForestIndex::rebuild(const cv::Mat& train)
+{
+    CV_Assert(train.type() == CV_32F || train.empty());
+
+    cv::RNG rng(0x5eed);
+
+    trees_.clear();
+    trees_.resize(trees_count_);
+    for (Tree& tree : trees_) {
+        tree.permutation.resize(train.rows);
+        std::iota(tree.permutation.begin(), tree.permutation.end(), 0);
+        if (train.rows > 0) {
+            buildTree(tree, 0, train.rows, rng);
+        }
+    }
+}
+
+int KdForestIndex::buildTree(Tree& tree, int begin, int end, cv::RNG& rng)
+{
+    const int LEAF_SIZE = 8;
+    const int SAMPLES = 128;
+    const int CANDIDATE_DIMS = 5;
+
+    const int node_index = tree.nodes.size();
+    tree.nodes.push_back(Node{ -1, 0.0f, begin, end });
+
+    const int count = end - begin;
+    if (count <= LEAF_SIZE) {
+        return node_index;
+    }
+
+    // estimate mean and variance from a subset
+    const int dims = train_.cols;
+    const int samples = std::min(count, SAMPLES);
+    std::vector<double> mean(dims, 0.0);
+    std::vector<double> var(dims, 0.0);
+    for (int s = 0; s < samples; ++s) {
+        const float* row = train_.ptr<float>(tree.permutation[begin + s * count / samples]);
+        for (int d = 0; d < dims; ++d) {
+            mean[d] += row[d];
+        }
+    }
+    for (int d = 0; d < dims; ++d) {
+        mean[d] /= samples;
+    }
+    for (int s = 0; s < samples; ++s) {
+        const float* row = train_.ptr<float>(tree.permutation[begin + s * count / samples]);
+        for (int d = 0; d < dims; ++d) {
+            const double diff = row[d] - mean[d];
+            var[d] += diff * diff;
+        }
+    }
+
+    // split on a random one of the dimensions with the highest variance
+    std::vector<int> order(dims);
+    std::iota(order.begin(), order.end(), 0);
+    const int candidates = std::min(CANDIDATE_DIMS, dims);
+    std::partial_sort(order.begin(), order.begin() + candidates, order.end(), [&](int a, int b) { return var[a] > var[b]; });
+    const int dim = order[rng.uniform(0, candidates)];
+
+    auto coordinate = [&](int item) { return train_.ptr<float>(item)[dim]; };
+
+    float value = static_cast<float>(mean[dim]);
+    int* first = tree.permutation.data() + begin;
+    int* last = tree.permutation.data() + end;
+    int* middle = std::partition(first, last, [&](int item) { return coordinate(item) < value; });
+
+    if (middle == first || middle == last) {
+        // degenerate split, fall back to the median
+        middle = first + count / 2;
+        std::nth_element(first, middle, last, [&](int a, int b) { return coordinate(a) < coordinate(b); });
+        value = coordinate(*middle);
+    }
+
+    const int split = begin + static_cast<int>(middle - first);
+    const int left = buildTree(tree, begin, split, rng);
+    const int right = buildTree(tree, split, end, rng);
+
+    Node& node = tree.nodes[node_index];
+    node.dim = dim;
+    node.value = value;
+    node.first = left;
+    node.second = right;
+    return node_index;
+}
+
+void KdForestIndex::knnMatch(const cv::Mat& query, std::vector<std::vector<cv::DMatch>>& matches, int k) const
+{
+    matches.clear();
+    matches.resize(query.rows);
+    if (train_.empty() || query.empty()) {
+        return;
+    }
+    CV_Assert(query.type() == CV_32F && query.cols == train_.cols);
+
+    const int dims = train_.cols;
+
+    struct Branch
+    {
+        float min_distance;
+        int tree;
+        int node;
+
+        bool operator<(const Branch& other) const
+        {
+            // the heap functions build a max heap, the closest branch has to be on top
+            return min_distance > other.min_distance;
+        }
+    };
+
+    parallelFor(query.rows, [&](const cv::Range& range) {
+        Neighbours neighbours(k);
+        std::vector<uint32_t> visited(train_.rows, 0);
+        uint32_t stamp = 0;
+
+        std::vector<Branch> branches;
+
+        for (int q = range.start; q < range.end; ++q) {
+            const float* descriptor = query.ptr<float>(q);
+            neighbours.clear();
+            ++stamp;
+
+            branches.clear();
+            int checks = 0;
+
+            auto descend = [&](int tree_index, int node_index, float min_distance) {
+                const Tree& tree = trees_[tree_index];
+                const Node* node = &tree.nodes[node_index];
+                while (node->dim >= 0) {
+                    const float diff = descriptor[node->dim] - node->value;
+                    const int near = diff < 0 ? node->first : node->second;
+                    const int far = diff < 0 ? node->second : node->first;
+
+                    const float far_distance = min_distance + diff * diff;
+                    if (far_distance < neighbours.worst()) {
+                        branches.push_back(Branch{ far_distance, tree_index, far });
+                        std::push_heap(branches.begin(), branches.end());
+                    }
+                    node = &tree.nodes[near];
+                }
+
+                for (int i = node->first; i < node->second; ++i) {
+                    const int item = tree.permutation[i];
+                    if (visited[item] != stamp) {
+                        visited[item] = stamp;
+                        ++checks;
+                        neighbours.insert(item, squaredDistance(descriptor, train_.ptr<float>(item), dims));
+                    }
+                }
+            };
+
+            // one full descent per tree, then best bin first over all trees
+            for (int t = 0; t < trees_count_; ++t) {
+                descend(t, 0, 0.0f);
+            }
+            while (!branches.empty() && checks < max_checks_) {
+                std::pop_heap(branches.begin(), branches.end());
+                const Branch branch = branches.back();
+                branches.pop_back();
+                if (branch.min_distance >= neighbours.worst()) {
+                    break;
+                }
+                descend(branch.tree, branch.node, branch.min_distance);
+            }
+
+            neighbours.write(q, matches[q], true);
+        }
+    });
+}
+
+/// MATCH FILTERS
+
+void csapex::ratioTest(std::vector<std::vector<cv::DMatch>>& matches, float ratio)
+{
+    parallelFor(matches.size(), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            std::vector<cv::DMatch>& match = matches[i];
+            if (match.size() < 2 || match[0].distance / match[1].distance > ratio) {
+                match.clear();
+            }
+        }
+    });
+}
+
+void csapex::symmetryTest(const std::vector<std::vector<cv::DMatch>>& matches1, const std::vector<std::vector<cv::DMatch>>& matches2, std::vector<cv::DMatch>& symmetric)
+{
+    // best match in image 1 of every descriptor of image 2, replaces the search over all pairs
+    int max_train = -1;
+    for (const std::vector<cv::DMatch>& match2 : matches2) {
+        if (match2.size() >= 2) {
+            max_train = std::max(max_train, match2[0].queryIdx);
+        }
+    }
+    std::vector<int> reverse(max_train + 1, -1);
+    for (const std::vector<cv::DMatch>& match2 : matches2) {
+        if (match2.size() >= 2) {
+            reverse[match2[0].queryIdx] = match2[0].trainIdx;
+        }
+    }
+
+    std::vector<char> keep(matches1.size(), 0);
+    parallelFor(matches1.size(), [&](const cv::Range& range) {
+        for (int i = range.start; i < range.end; ++i) {
+            const std::vector<cv::DMatch>& match1 = matches1[i];
+            if (match1.size() >= 2) {
+                const int train = match1[0].trainIdx;
+                keep[i] = train >= 0 && train <= max_train && reverse[train] == match1[0].queryIdx;
+            }
+        }
+    });
+
+    for (std::size_t i = 0; i < matches1.size(); ++i) {
+        if (keep[i]) {
+            const cv::DMatch& best = matches1[i][0];
+            symmetric.push_back(cv::DMatch(best.queryIdx, best.trainIdx, best.distance));
+        }
+    }
+}
@@ -20,6 +20,7 @@
 
 /// SYSTEM
 #include <boost/lambda/lambda.hpp>
+#include <memory>
 
 CSAPEX_REGISTER_CLASS(csapex::ExtractDescriptors, csapex::Node)
 
@@ -53,6 +54,13 @@ void ExtractDescriptors::setupParameters(Parameterizable& parameters)
             parameters.addConditionalParameter(param_clone, condition, std::bind(&ExtractDescriptors::update, this));
         }
     }
+
+    csapex::param::Parameter::Ptr tiling =
+        csapex::param::ParameterFactory::declareBool("tiling/enabled", csapex::param::ParameterDescription("Compute the descriptors in parallel batches of keypoints."), false);
+    parameters.addParameter(tiling);
+    std::function<bool()> tiling_enabled = [tiling]() { return tiling->as<bool>(); };
+
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("tiling/batches", 1, 64, 8, 1), tiling_enabled);
 }
 
 void ExtractDescriptors::setup(NodeModifier& node_modifier)
@@ -69,18 +77,29 @@ void ExtractDescriptors::process()
         refresh_ = false;
 
         std::string method = readParameter<std::string>("method");
-        Extractor::Ptr next = ExtractorFactory::create("", method, param::StaticParameterProvider(getParameters()));
+        std::shared_ptr<param::StaticParameterProvider> provider = std::make_shared<param::StaticParameterProvider>(getParameters());
+        extractor_.setFactory([method, provider]() { return ExtractorFactory::create("", method, *provider); });
 
-        extractor = next;
+        // create the extractor of this thread right away, so that errors are reported here
+        extractor_.local();
     }
 
-    if (!extractor) {
+    if (!extractor_.hasFactory()) {
         node_modifier_->setError("no extractor set");
         return;
     }
 
     node_modifier_->setNoError();
 
+    TiledExtractor::Options options;
+    options.tiles_y = 1;
+    if (readParameter<bool>("tiling/enabled")) {
+        options.tiles_x = readParameter<int>("tiling/batches");
+    } else {
+        options.tiles_x = 1;
+    }
+    extractor_.setOptions(options);
+
     CvMatMessage::ConstPtr img_msg = msg::getMessage<CvMatMessage>(in_img);
 
     DescriptorMessage::Ptr des_msg(new DescriptorMessage);
@@ -88,7 +107,7 @@ void ExtractDescriptors::process()
     // need to clone keypoints, extractDescriptors will modify the vector
     KeypointMessage::Ptr key_msg = msg::getClonedMessage<KeypointMessage>(in_key);
 
-    extractor->extractDescriptors(img_msg->value, key_msg->value, des_msg->value);
+    extractor_.extractDescriptors(img_msg->value, key_msg->value, des_msg->value);
 
     msg::publish(out_des, des_msg);
 }
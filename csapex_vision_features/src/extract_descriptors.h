@@ -5,7 +5,7 @@
 #include <csapex/model/node.h>
 
 /// PROJECT
-#include <cslibs_vision/utils/extractor.h>
+#include <csapex_vision_features/tiled_extractor.h>
 
 namespace csapex
 {
@@ -23,7 +23,7 @@ private:
     void update();
 
 private:
-    Extractor::Ptr extractor;
+    TiledExtractor extractor_;
 
     Input* in_img;
     Input* in_key;
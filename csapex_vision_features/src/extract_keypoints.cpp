@@ -21,6 +21,7 @@
 
 /// SYSTEM
 #include <boost/lambda/lambda.hpp>
+#include <memory>
 
 CSAPEX_REGISTER_CLASS(csapex::ExtractKeypoints, csapex::Node)
 
@@ -54,6 +55,20 @@ void ExtractKeypoints::setupParameters(Parameterizable& parameters)
             parameters.addConditionalParameter(param_clone, condition, std::bind(&ExtractKeypoints::update, this));
         }
     }
+
+    csapex::param::Parameter::Ptr tiling = csapex::param::ParameterFactory::declareBool("tiling/enabled",
+                                                                                         csapex::param::ParameterDescription("Detect on overlapping tiles in parallel, "
+                                                                                                                             "limit the keypoints per tile for an even distribution."),
+                                                                                         false);
+    parameters.addParameter(tiling);
+    std::function<bool()> tiling_enabled = [tiling]() { return tiling->as<bool>(); };
+
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("tiling/tiles_x", 1, 32, 4, 1), tiling_enabled);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("tiling/tiles_y", 1, 32, 4, 1), tiling_enabled);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("tiling/overlap", 0, 128, 16, 1), tiling_enabled);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("tiling/max_per_tile", csapex::param::ParameterDescription("0 keeps all keypoints"), 0, 5000, 0, 1),
+                                       tiling_enabled);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("tiling/suppression_radius", 0.0, 16.0, 2.0, 0.5), tiling_enabled);
 }
 
 void ExtractKeypoints::setup(NodeModifier& node_modifier)
@@ -70,18 +85,34 @@ void ExtractKeypoints::process()
         refresh_ = false;
 
         std::string method = readParameter<std::string>("method");
-        Extractor::Ptr next = ExtractorFactory::create(method, "", param::StaticParameterProvider(getParameters()));
+        std::shared_ptr<param::StaticParameterProvider> provider = std::make_shared<param::StaticParameterProvider>(getParameters());
+        extractor_.setFactory([method, provider]() { return ExtractorFactory::create(method, "", *provider); });
 
-        extractor = next;
+        // create the extractor of this thread right away, so that errors are reported here
+        extractor_.local();
     }
 
-    if (!extractor) {
+    if (!extractor_.hasFactory()) {
         node_modifier_->setError("no extractor set");
         return;
     }
 
     node_modifier_->setNoError();
 
+    TiledExtractor::Options options;
+    if (readParameter<bool>("tiling/enabled")) {
+        options.tiles_x = readParameter<int>("tiling/tiles_x");
+        options.tiles_y = readParameter<int>("tiling/tiles_y");
+        options.overlap = readParameter<int>("tiling/overlap");
+        options.max_per_tile = readParameter<int>("tiling/max_per_tile");
+        options.suppression_radius = readParameter<double>("tiling/suppression_radius");
+    } else {
+        options.tiles_x = 1;
+        options.tiles_y = 1;
+        options.overlap = 0;
+    }
+    extractor_.setOptions(options);
+
     CvMatMessage::ConstPtr img_msg = msg::getMessage<CvMatMessage>(in_img);
 
     KeypointMessage::Ptr key_msg(new KeypointMessage);
@@ -89,10 +120,10 @@ void ExtractKeypoints::process()
     if (msg::hasMessage(in_mask)) {
         CvMatMessage::ConstPtr mask_msg = msg::getMessage<CvMatMessage>(in_mask);
 
-        extractor->extractKeypoints(img_msg->value, mask_msg->value, key_msg->value);
+        extractor_.extractKeypoints(img_msg->value, mask_msg->value, key_msg->value);
 
     } else {
-        extractor->extractKeypoints(img_msg->value, cv::Mat(), key_msg->value);
+        extractor_.extractKeypoints(img_msg->value, cv::Mat(), key_msg->value);
     }
 
     msg::publish(out_key, key_msg);
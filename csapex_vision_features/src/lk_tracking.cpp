@@ -8,6 +8,8 @@
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_opencv/cv_mat_message.h>
+#include <csapex_opencv/cv_pyramid_message.h>
+#include <csapex_opencv/parallel.h>
 #include <csapex_vision_features/keypoint_message.h>
 
 /// SYSTEM
@@ -25,19 +27,136 @@ void LKTracking::setupParameters(Parameterizable& parameters)
 {
     std::function<void(csapex::param::Parameter*)> cb = std::bind(&LKTracking::update, this, std::placeholders::_1);
 
-    parameters.addParameter(csapex::param::ParameterFactory::declareRange<int>("winSize", 10, 80, 31, 1));
+    // the retained pyramid depends on the window size and the level count
+    parameters.addParameter(csapex::param::ParameterFactory::declareRange<int>("winSize", 10, 80, 31, 1), cb);
+    parameters.addParameter(csapex::param::ParameterFactory::declareRange<int>("maxLevel", 0, 8, 3, 1), cb);
     parameters.addParameter(csapex::param::ParameterFactory::declareRange<int>("subPixWinSize", 1, 40, 10, 1), cb);
 
+    parameters.addParameter(csapex::param::ParameterFactory::declareRange<int>("batch_size", 16, 4096, 512, 16));
+
+    csapex::param::Parameter::Ptr fb = csapex::param::ParameterFactory::declareBool("forward_backward/enabled", false);
+    parameters.addParameter(fb);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange<double>("forward_backward/max_error", 0.1, 10.0, 1.0, 0.1), [fb]() { return fb->as<bool>(); });
+
     parameters.addParameter(csapex::param::ParameterFactory::declareTrigger("reset"), cb);
 
     parameters.addParameter(csapex::param::ParameterFactory::declareRange<int>("debug/circlesize", 1, 15, 2, 1));
 }
 
+void LKTracking::preparePyramid(const std::vector<cv::Mat>& levels, const cv::Size& win_size, int max_level, std::vector<cv::Mat>& pyramid) const
+{
+    // converts an external pyramid into the layout of cv::buildOpticalFlowPyramid with derivatives:
+    // image and Scharr derivative per level, the upper levels embedded into a border of the window size.
+    // Otherwise every call of calcOpticalFlowPyrLK would compute the derivatives again.
+    const int count = std::min<int>(levels.size(), max_level + 1);
+    pyramid.resize(2 * count);
+    for (int level = 0; level < count; ++level) {
+        const cv::Mat& src = levels[level];
+        if (src.type() != CV_8UC1) {
+            throw std::runtime_error("input pyramid must be 1-channel");
+        }
+
+        cv::Size full_size;
+        cv::Point offset;
+        src.locateROI(full_size, offset);
+        const bool has_border = offset.x >= win_size.width && offset.y >= win_size.height && offset.x + src.cols + win_size.width <= full_size.width &&
+                                offset.y + src.rows + win_size.height <= full_size.height;
+
+        if (level == 0 || has_border) {
+            pyramid[2 * level] = src;
+        } else {
+            cv::Mat padded;
+            cv::copyMakeBorder(src, padded, win_size.height, win_size.height, win_size.width, win_size.width, cv::BORDER_REFLECT_101 + cv::BORDER_ISOLATED);
+            pyramid[2 * level] = padded(cv::Rect(win_size.width, win_size.height, src.cols, src.rows));
+        }
+
+        cv::Mat dx, dy, deriv, padded_deriv;
+        cv::Scharr(src, dx, CV_16S, 1, 0);
+        cv::Scharr(src, dy, CV_16S, 0, 1);
+        cv::merge(std::vector<cv::Mat>{ dx, dy }, deriv);
+        cv::copyMakeBorder(deriv, padded_deriv, win_size.height, win_size.height, win_size.width, win_size.width, cv::BORDER_CONSTANT + cv::BORDER_ISOLATED);
+        pyramid[2 * level + 1] = padded_deriv(cv::Rect(win_size.width, win_size.height, src.cols, src.rows));
+    }
+}
+
+void LKTracking::track(const std::vector<cv::Mat>& next_pyramid, const cv::Size& win_size, int max_level, const cv::TermCriteria& termcrit, std::vector<uchar>& status)
+{
+    const std::vector<cv::Point2f>& from = points[0];
+    std::vector<cv::Point2f>& to = points[1];
+
+    to.resize(from.size());
+    status.assign(from.size(), 0);
+
+    const int batch_size = readParameter<int>("batch_size");
+    const int batches = (from.size() + batch_size - 1) / batch_size;
+
+    const bool forward_backward = readParameter<bool>("forward_backward/enabled");
+    const double max_fb_error = readParameter<double>("forward_backward/max_error");
+
+    const double max_fb_error_sqr = max_fb_error * max_fb_error;
+
+    parallel::forRange(batches, [&](const cv::Range& range) {
+        std::vector<cv::Point2f> src, dst, back;
+        std::vector<uchar> batch_status, status_back;
+        std::vector<float> err;
+
+        for (int batch = range.start; batch < range.end; ++batch) {
+            const std::size_t begin = static_cast<std::size_t>(batch) * batch_size;
+            const std::size_t end = std::min(from.size(), begin + batch_size);
+
+            src.assign(from.begin() + begin, from.begin() + end);
+            cv::calcOpticalFlowPyrLK(prev_pyramid_, next_pyramid, src, dst, batch_status, err, win_size, max_level, termcrit, 0, 0.001);
+
+            if (forward_backward) {
+                // track back to the previous frame, both pyramids are already available
+                cv::calcOpticalFlowPyrLK(next_pyramid, prev_pyramid_, dst, back, status_back, err, win_size, max_level, termcrit, 0, 0.001);
+                for (std::size_t i = 0; i < src.size(); ++i) {
+                    const cv::Point2f delta = back[i] - src[i];
+                    batch_status[i] = batch_status[i] && status_back[i] && delta.dot(delta) <= max_fb_error_sqr;
+                }
+            }
+
+            std::copy(dst.begin(), dst.end(), to.begin() + begin);
+            std::copy(batch_status.begin(), batch_status.end(), status.begin() + begin);
+        }
+    });
+}
+
 void LKTracking::process()
 {
-    CvMatMessage::ConstPtr img = msg::getMessage<CvMatMessage>(in_image_);
-    if (!img->hasChannels(1, CV_8U)) {
-        throw std::runtime_error("input image must be 1-channel");
+    int ws = readParameter<int>("winSize");
+    cv::Size winSize(ws, ws);
+    int max_level = readParameter<int>("maxLevel");
+
+    cv::Mat image;
+    std::vector<cv::Mat> pyramid;
+    std::string frame_id = "/";
+    Message::Stamp stamp = 0;
+
+    if (msg::hasMessage(in_pyramid_)) {
+        CvPyramidMessage::ConstPtr pyr = msg::getMessage<CvPyramidMessage>(in_pyramid_);
+        if (pyr->value.empty()) {
+            throw std::runtime_error("input pyramid is empty");
+        }
+        preparePyramid(pyr->value, winSize, max_level, pyramid);
+        image = pyr->value[0];
+        frame_id = pyr->frame_id;
+        stamp = pyr->stamp_micro_seconds;
+
+    } else if (msg::hasMessage(in_image_)) {
+        CvMatMessage::ConstPtr img = msg::getMessage<CvMatMessage>(in_image_);
+        if (!img->hasChannels(1, CV_8U)) {
+            throw std::runtime_error("input image must be 1-channel");
+        }
+        image = img->value;
+        frame_id = img->frame_id;
+        stamp = img->stamp_micro_seconds;
+
+        // with derivatives, so they are computed once per frame and not in every batch
+        cv::buildOpticalFlowPyramid(image, pyramid, winSize, max_level, true);
+
+    } else {
+        throw std::runtime_error("either an image or a pyramid is required");
     }
 
     KeypointMessage::ConstPtr keypoints = msg::getMessage<KeypointMessage>(in_keypoints_);
@@ -64,25 +183,20 @@ void LKTracking::process()
             const cv::KeyPoint& kp = *it;
             points[1].push_back(kp.pt);
         }
-        cv::cornerSubPix(img->value, points[1], subPixWinSize, cv::Size(-1, -1), termcrit);
+        cv::cornerSubPix(image, points[1], subPixWinSize, cv::Size(-1, -1), termcrit);
         init_ = false;
 
-    } else if (!points[0].empty()) {
-        int ws = readParameter<int>("winSize");
-        cv::Size winSize(ws, ws);
-
+    } else if (!points[0].empty() && !prev_pyramid_.empty()) {
         std::vector<uchar> status;
-        std::vector<float> err;
-
-        cv::calcOpticalFlowPyrLK(prevGray, img->value, points[0], points[1], status, err, winSize, 3, termcrit, 0, 0.001);
+        track(pyramid, winSize, max_level, termcrit, status);
 
         size_t k = 0;
 
-        CvMatMessage::Ptr out_dbg(new CvMatMessage(enc::bgr, img->frame_id, img->stamp_micro_seconds));
+        CvMatMessage::Ptr out_dbg(new CvMatMessage(enc::bgr, frame_id, stamp));
 
         bool debug = msg::isConnected(out_debug_);
         if (debug) {
-            cv::cvtColor(img->value, out_dbg->value, CV_GRAY2BGR);
+            cv::cvtColor(image, out_dbg->value, CV_GRAY2BGR);
         }
 
         int circlesize = readParameter<int>("debug/circlesize");
@@ -91,8 +205,8 @@ void LKTracking::process()
             if (!status[i])
                 continue;
 
+            points[1][k] = points[1][i];
             if (debug) {
-                points[1][k] = points[1][i];
                 cv::circle(out_dbg->value, points[1][i], circlesize, cv::Scalar(0, 255, 0), -1, 8);
             }
 
@@ -107,12 +221,14 @@ void LKTracking::process()
 
     std::swap(points[1], points[0]);
 
-    img->value.copyTo(prevGray);
+    // the levels share their data with immutable messages or were allocated here, no copy is needed
+    prev_pyramid_ = std::move(pyramid);
 }
 
 void LKTracking::reset()
 {
     init_ = true;
+    prev_pyramid_.clear();
 }
 
 void LKTracking::update(const csapex::param::Parameter*)
@@ -122,7 +238,8 @@ void LKTracking::update(const csapex::param::Parameter*)
 
 void LKTracking::setup(NodeModifier& node_modifier)
 {
-    in_image_ = node_modifier.addInput<CvMatMessage>("Image");
+    in_image_ = node_modifier.addOptionalInput<CvMatMessage>("Image");
+    in_pyramid_ = node_modifier.addOptionalInput<CvPyramidMessage>("Pyramid");
     in_keypoints_ = node_modifier.addInput<KeypointMessage>("Keypoints");
 
     out_debug_ = node_modifier.addOutput<CvMatMessage>("Debug");
@@ -24,8 +24,12 @@ public:
 private:
     void update(const csapex::param::Parameter*);
 
+    void preparePyramid(const std::vector<cv::Mat>& levels, const cv::Size& win_size, int max_level, std::vector<cv::Mat>& pyramid) const;
+    void track(const std::vector<cv::Mat>& next_pyramid, const cv::Size& win_size, int max_level, const cv::TermCriteria& termcrit, std::vector<uchar>& status);
+
 private:
     Input* in_image_;
+    Input* in_pyramid_;
     Input* in_keypoints_;
 
     Output* out_debug_;
@@ -34,8 +38,8 @@ private:
 
     std::vector<cv::Point2f> points[2];
 
-    cv::Mat gray;
-    cv::Mat prevGray;
+    /// pyramid of the previous frame, each frame's pyramid is built only once
+    std::vector<cv::Mat> prev_pyramid_;
 };
 
 }  // namespace csapex
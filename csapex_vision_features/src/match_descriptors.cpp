@@ -44,23 +44,19 @@ public:
 class RobustMatcher
 {
 private:
-    // pointer to the matcher object
-    cv::Ptr<cv::DescriptorMatcher> matcher;
+    // index over the descriptors of image 2, queried with image 1
+    DescriptorIndex& forward;
+    // index over the descriptors of image 1, queried with image 2
+    DescriptorIndex& backward;
     float ratio;        // max ratio between 1st and 2nd NN
     bool refineF;       // if true will refine the F matrix
     double confidence;  // confidence level (probability)
     double distance;    // min distance to epipolar
 public:
-    RobustMatcher(cv::Ptr<cv::DescriptorMatcher> m) : ratio(0.75f), refineF(true), confidence(0.99), distance(3.0)
+    RobustMatcher(DescriptorIndex& forward, DescriptorIndex& backward) : forward(forward), backward(backward), ratio(0.75f), refineF(true), confidence(0.99), distance(3.0)
     {
-        matcher = m;
     }
 
-    // Set the matcher
-    void setDescriptorMatcher(cv::Ptr<cv::DescriptorMatcher>& match)
-    {
-        matcher = match;
-    }
     // Set confidence level
     void setConfidenceLevel(double conf)
     {
@@ -78,50 +74,17 @@ public:
     }
 
     // Clear matches for which NN ratio is > than threshold
-    // return the number of removed points
     // (corresponding entries being cleared,
     // i.e. size will be 0)
-    int ratioTest(std::vector<std::vector<cv::DMatch>>& matches)
+    void ratioTest(std::vector<std::vector<cv::DMatch>>& matches)
     {
-        int removed = 0;
-        // for all matches
-        for (std::vector<std::vector<cv::DMatch>>::iterator matchIterator = matches.begin(); matchIterator != matches.end(); ++matchIterator) {
-            // if 2 NN has been identified
-            if (matchIterator->size() > 1) {
-                // check distance ratio
-                if ((*matchIterator)[0].distance / (*matchIterator)[1].distance > ratio) {
-                    matchIterator->clear();  // remove match
-                    removed++;
-                }
-            } else {                     // does not have 2 neighbours
-                matchIterator->clear();  // remove match
-                removed++;
-            }
-        }
-        return removed;
+        csapex::ratioTest(matches, ratio);
     }
 
     // Insert symmetrical matches in symMatches vector
     void symmetryTest(const std::vector<std::vector<cv::DMatch>>& matches1, const std::vector<std::vector<cv::DMatch>>& matches2, std::vector<cv::DMatch>& symMatches)
     {
-        // for all matches image 1 -> image 2
-        for (std::vector<std::vector<cv::DMatch>>::const_iterator matchIterator1 = matches1.begin(); matchIterator1 != matches1.end(); ++matchIterator1) {
-            // ignore deleted matches
-            if (matchIterator1->size() < 2)
-                continue;
-            // for all matches image 2 -> image 1
-            for (std::vector<std::vector<cv::DMatch>>::const_iterator matchIterator2 = matches2.begin(); matchIterator2 != matches2.end(); ++matchIterator2) {
-                // ignore deleted matches
-                if (matchIterator2->size() < 2)
-                    continue;
-                // Match symmetry test
-                if ((*matchIterator1)[0].queryIdx == (*matchIterator2)[0].trainIdx && (*matchIterator2)[0].queryIdx == (*matchIterator1)[0].trainIdx) {
-                    // add symmetrical match
-                    symMatches.push_back(cv::DMatch((*matchIterator1)[0].queryIdx, (*matchIterator1)[0].trainIdx, (*matchIterator1)[0].distance));
-                    break;  // next match in image 1 -> image 2
-                }
-            }
-        }
+        csapex::symmetryTest(matches1, matches2, symMatches);
     }
 
     // Identify good matches using RANSAC
@@ -192,42 +155,20 @@ public:
                   const cv::Mat& descriptors1, const cv::Mat& descriptors2)
     {
         // 2. Match the two image descriptors
-        // Construction of the matcher
-        // cv::BruteForceMatcher<cv::L2<float>> matcher;
+        // the indices are only rebuilt when their descriptors changed
+        forward.build(descriptors2);
+        backward.build(descriptors1);
+
         // from image 1 to image 2
         // based on k nearest neighbours (with k=2)
-        //        aerr << "d1: \n";
-        //        for(size_t r = 0; r < descriptors1.rows; ++r) {
-        //            for(size_t c = 0; c < descriptors1.cols; ++c) {
-        //                aerr << descriptors1.at<float>(r,c) <<"\t";
-        //            }
-        //            aerr << "\n";
-        //        }
-
-        //        aerr << std::endl;
-
-        //        aerr << "d2: \n";
-        //        for(size_t r = 0; r < descriptors2.rows; ++r) {
-        //            for(size_t c = 0; c < descriptors2.cols; ++c) {
-        //                aerr << descriptors2.at<float>(r,c) <<"\t";
-        //            }
-        //            aerr << "\n";
-        //        }
-
-        //        aerr << std::endl;
-
         std::vector<std::vector<cv::DMatch>> matches1;
-
-        matcher->knnMatch(descriptors1, descriptors2,
-                          matches1,  // vector of matches (up to 2 per entry)
-                          2);        // return 2 nearest neighbours
+        forward.knnMatch(descriptors1, matches1, 2);
 
         // from image 2 to image 1
         // based on k nearest neighbours (with k=2)
         std::vector<std::vector<cv::DMatch>> matches2;
-        matcher->knnMatch(descriptors2, descriptors1,
-                          matches2,  // vector of matches (up to 2 per entry)
-                          2);        // return 2 nearest neighbours
+        backward.knnMatch(descriptors2, matches2, 2);
+
         // 3. Remove matches for which NN ratio is
         // > than threshold
         // clean image 1 -> image 2 matches
@@ -246,7 +187,7 @@ public:
     }
 };
 
-MatchDescriptors::MatchDescriptors() : in_img_1(nullptr), current_method_(SIMPLE)
+MatchDescriptors::MatchDescriptors() : in_img_1(nullptr), current_method_(SIMPLE), index_descriptor_type_(-1), indices_dirty_(true)
 {
 }
 
@@ -275,6 +216,46 @@ void MatchDescriptors::setupParameters(Parameterizable& parameters)
     parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("peak/scaling", 1, 8, 1, 1), cond_peak);
     parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("peak/octaves", 1, 12, 1, 1), cond_peak);
     parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("peak/min_cluster_size", 1, 256, 1, 1), cond_peak);
+
+    // robust
+    std::function<bool()> cond_robust = [method]() { return method->as<int>() == ROBUST; };
+    std::function<void(csapex::param::Parameter*)> invalidate = [this](csapex::param::Parameter*) { indices_dirty_ = true; };
+
+    std::map<std::string, int> backends = { { "brute force", (int)BRUTE_FORCE }, { "approximate (LSH / k-d forest)", (int)APPROXIMATE } };
+    csapex::param::Parameter::Ptr backend = csapex::param::ParameterFactory::declareParameterSet("robust/backend", backends, (int)APPROXIMATE);
+    parameters.addConditionalParameter(backend, cond_robust, invalidate);
+
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("robust/ratio", 0.5, 1.0, 0.75, 0.01), cond_robust);
+
+    std::function<bool()> cond_approximate = [method, backend]() { return method->as<int>() == ROBUST && backend->as<int>() == APPROXIMATE; };
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("robust/lsh/tables", 1, 32, 8, 1), cond_approximate, invalidate);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("robust/lsh/key_bits", 4, 24, 12, 1), cond_approximate, invalidate);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareBool("robust/lsh/multi_probe", true), cond_approximate, invalidate);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("robust/kd/trees", 1, 16, 4, 1), cond_approximate, invalidate);
+    parameters.addConditionalParameter(csapex::param::ParameterFactory::declareRange("robust/kd/checks", 16, 2048, 128, 16), cond_approximate, invalidate);
+}
+
+void MatchDescriptors::updateIndices(int descriptor_type)
+{
+    if (!indices_dirty_ && descriptor_type == index_descriptor_type_ && forward_index_ && backward_index_) {
+        return;
+    }
+
+    auto create = [this, descriptor_type]() -> DescriptorIndex::Ptr {
+        if (readParameter<int>("robust/backend") == APPROXIMATE) {
+            if (descriptor_type == CV_8U) {
+                return std::make_shared<LshIndex>(readParameter<int>("robust/lsh/tables"), readParameter<int>("robust/lsh/key_bits"), readParameter<bool>("robust/lsh/multi_probe"));
+            } else if (descriptor_type == CV_32F) {
+                return std::make_shared<KdForestIndex>(readParameter<int>("robust/kd/trees"), readParameter<int>("robust/kd/checks"));
+            }
+        }
+        return std::make_shared<BruteForceIndex>(descriptor_type == CV_8U ? cv::NORM_HAMMING : cv::NORM_L2);
+    };
+
+    forward_index_ = create();
+    backward_index_ = create();
+    index_descriptor_type_ = descriptor_type;
+    indices_dirty_ = false;
 }
 
 void MatchDescriptors::update()
@@ -345,13 +326,10 @@ void MatchDescriptors::match(CvMatMessage::ConstPtr image1, CvMatMessage::ConstP
 void MatchDescriptors::matchRobust(CvMatMessage::ConstPtr image1, CvMatMessage::ConstPtr image2, KeypointMessage::ConstPtr keypoints1, KeypointMessage::ConstPtr keypoints2,
                                    DescriptorMessage::ConstPtr descriptors1, DescriptorMessage::ConstPtr descriptors2, std::vector<std::vector<cv::DMatch>>& matches)
 {
-    cv::Ptr<cv::DescriptorMatcher> matcher;
-    if (descriptors1->value.type() == CV_8U) {
-        matcher = new cv::BFMatcher(cv::NORM_HAMMING);
-    } else {
-        matcher = new cv::BFMatcher(cv::NORM_L2);
-    }
-    RobustMatcher m(matcher);
+    updateIndices(descriptors1->value.type());
+
+    RobustMatcher m(*forward_index_, *backward_index_);
+    m.setRatio(readParameter<double>("robust/ratio"));
 
     std::vector<cv::DMatch> tmp_matches;
 
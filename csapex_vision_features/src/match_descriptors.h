@@ -4,6 +4,7 @@
 /// COMPONENT
 #include <csapex/model/node.h>
 #include <csapex_opencv/cv_mat_message.h>
+#include <csapex_vision_features/descriptor_index.h>
 #include <csapex_vision_features/descriptor_message.h>
 #include <csapex_vision_features/keypoint_message.h>
 #include <csapex_vision_features/match_message.h>
@@ -20,6 +21,12 @@ private:
         ROBUST = 2
     };
 
+    enum Backend
+    {
+        BRUTE_FORCE = 0,
+        APPROXIMATE = 1
+    };
+
 public:
     MatchDescriptors();
 
@@ -29,6 +36,7 @@ public:
 
 private:
     void update();
+    void updateIndices(int descriptor_type);
 
     void match(connection_types::CvMatMessage::ConstPtr image1, connection_types::CvMatMessage::ConstPtr image2, connection_types::KeypointMessage::ConstPtr keypoints1,
                connection_types::KeypointMessage::ConstPtr keypoints2, connection_types::DescriptorMessage::ConstPtr descriptors1, connection_types::DescriptorMessage::ConstPtr descriptors2,
@@ -59,6 +67,12 @@ private:
     Output* out_match;
 
     Method current_method_;
+
+    /// kept across frames, so an unchanged train set is not indexed again
+    DescriptorIndex::Ptr forward_index_;
+    DescriptorIndex::Ptr backward_index_;
+    int index_descriptor_type_;
+    bool indices_dirty_;
 };
 
 }  // namespace csapex
@@ -0,0 +1,242 @@
+/// HEADER
+#include <csapex_vision_features/tiled_extractor.h>
+
+/// PROJECT
+#include <csapex_opencv/parallel.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace csapex;
+
+namespace
+{
+cv::Rect expand(const cv::Rect& rect, int border, const cv::Size& size)
+{
+    cv::Rect expanded(rect.x - border, rect.y - border, rect.width + 2 * border, rect.height + 2 * border);
+    return expanded & cv::Rect(cv::Point(0, 0), size);
+}
+
+void shift(std::vector<cv::KeyPoint>& keypoints, const cv::Point2f& offset)
+{
+    for (cv::KeyPoint& kp : keypoints) {
+        kp.pt += offset;
+    }
+}
+
+/**
+ * Removes keypoints that have a stronger keypoint of another tile within the radius.
+ * Keypoints of the same tile are left alone, the detector already decided about those.
+ */
+void suppressDuplicates(std::vector<cv::KeyPoint>& keypoints, const std::vector<int>& tiles, double radius)
+{
+    if (radius <= 0.0 || keypoints.size() < 2) {
+        return;
+    }
+
+    std::vector<int> order(keypoints.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&keypoints](int a, int b) { return keypoints[a].response > keypoints[b].response; });
+
+    // hash grid with the radius as cell size, only the 3x3 neighbourhood has to be checked
+    const float cell = static_cast<float>(radius);
+    const float radius_sqr = cell * cell;
+    auto key = [](int cx, int cy) { return (static_cast<int64_t>(cx) << 32) ^ static_cast<uint32_t>(cy); };
+
+    std::unordered_map<int64_t, std::vector<int>> grid;
+    grid.reserve(keypoints.size());
+
+    std::vector<bool> keep(keypoints.size(), false);
+    for (int i : order) {
+        const cv::Point2f& pt = keypoints[i].pt;
+        const int cx = static_cast<int>(std::floor(pt.x / cell));
+        const int cy = static_cast<int>(std::floor(pt.y / cell));
+
+        bool duplicate = false;
+        for (int dy = -1; dy <= 1 && !duplicate; ++dy) {
+            for (int dx = -1; dx <= 1 && !duplicate; ++dx) {
+                auto pos = grid.find(key(cx + dx, cy + dy));
+                if (pos == grid.end()) {
+                    continue;
+                }
+                for (int j : pos->second) {
+                    if (tiles[j] != tiles[i]) {
+                        const cv::Point2f delta = keypoints[j].pt - pt;
+                        if (delta.dot(delta) < radius_sqr) {
+                            duplicate = true;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!duplicate) {
+            keep[i] = true;
+            grid[key(cx, cy)].push_back(i);
+        }
+    }
+
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < keypoints.size(); ++i) {
+        if (keep[i]) {
+            keypoints[n++] = keypoints[i];
+        }
+    }
+    keypoints.resize(n);
+}
+
+}  // namespace
+
+TiledExtractor::TiledExtractor()
+{
+}
+
+void TiledExtractor::setFactory(Factory factory)
+{
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    factory_ = factory;
+    cache_.clear();
+}
+
+bool TiledExtractor::hasFactory() const
+{
+    return static_cast<bool>(factory_);
+}
+
+void TiledExtractor::setOptions(const Options& options)
+{
+    options_ = options;
+    options_.tiles_x = std::max(1, options_.tiles_x);
+    options_.tiles_y = std::max(1, options_.tiles_y);
+    options_.overlap = std::max(0, options_.overlap);
+}
+
+const TiledExtractor::Options& TiledExtractor::getOptions() const
+{
+    return options_;
+}
+
+Extractor::Ptr TiledExtractor::local()
+{
+    std::unique_lock<std::mutex> lock(cache_mutex_);
+    Extractor::Ptr& extractor = cache_[std::this_thread::get_id()];
+    if (!extractor && factory_) {
+        extractor = factory_();
+    }
+    return extractor;
+}
+
+std::vector<cv::Rect> TiledExtractor::cells(const cv::Size& size, int tiles_x, int tiles_y)
+{
+    tiles_x = std::max(1, std::min(tiles_x, size.width));
+    tiles_y = std::max(1, std::min(tiles_y, size.height));
+
+    std::vector<cv::Rect> result;
+    result.reserve(tiles_x * tiles_y);
+    for (int ty = 0; ty < tiles_y; ++ty) {
+        const int y0 = ty * size.height / tiles_y;
+        const int y1 = (ty + 1) * size.height / tiles_y;
+        for (int tx = 0; tx < tiles_x; ++tx) {
+            const int x0 = tx * size.width / tiles_x;
+            const int x1 = (tx + 1) * size.width / tiles_x;
+            result.push_back(cv::Rect(x0, y0, x1 - x0, y1 - y0));
+        }
+    }
+    return result;
+}
+
+void TiledExtractor::extractKeypoints(const cv::Mat& image, const cv::Mat& mask, std::vector<cv::KeyPoint>& keypoints)
+{
+    keypoints.clear();
+    if (image.empty()) {
+        return;
+    }
+
+    const std::vector<cv::Rect> tiles = cells(image.size(), options_.tiles_x, options_.tiles_y);
+    std::vector<std::vector<cv::KeyPoint>> per_tile(tiles.size());
+
+    parallel::forRange(static_cast<int>(tiles.size()), [&](const cv::Range& range) {
+        Extractor::Ptr extractor = local();
+        for (int t = range.start; t < range.end; ++t) {
+            const cv::Rect& cell = tiles[t];
+            const cv::Rect roi = expand(cell, options_.overlap, image.size());
+
+            std::vector<cv::KeyPoint>& found = per_tile[t];
+            extractor->extractKeypoints(image(roi), mask.empty() ? cv::Mat() : mask(roi), found);
+            shift(found, cv::Point2f(static_cast<float>(roi.x), static_cast<float>(roi.y)));
+
+            // a keypoint in the overlap belongs to the neighbouring tile
+            const cv::Rect_<float> owned(cell);
+            found.erase(std::remove_if(found.begin(), found.end(), [&owned](const cv::KeyPoint& kp) { return !owned.contains(kp.pt); }), found.end());
+
+            if (options_.max_per_tile > 0) {
+                cv::KeyPointsFilter::retainBest(found, options_.max_per_tile);
+                if (static_cast<int>(found.size()) > options_.max_per_tile) {
+                    // retainBest keeps all keypoints tied with the weakest retained one
+                    found.resize(options_.max_per_tile);
+                }
+            }
+        }
+    });
+
+    std::vector<int> owner;
+    for (std::size_t t = 0; t < per_tile.size(); ++t) {
+        keypoints.insert(keypoints.end(), per_tile[t].begin(), per_tile[t].end());
+        owner.resize(keypoints.size(), static_cast<int>(t));
+    }
+
+    if (tiles.size() > 1) {
+        suppressDuplicates(keypoints, owner, options_.suppression_radius);
+    }
+}
+
+void TiledExtractor::extractDescriptors(const cv::Mat& image, std::vector<cv::KeyPoint>& keypoints, cv::Mat& descriptors)
+{
+    descriptors = cv::Mat();
+    if (image.empty() || keypoints.empty()) {
+        return;
+    }
+
+    if (options_.tiles_x * options_.tiles_y <= 1) {
+        // a single batch needs neither a crop nor a copy of the keypoints
+        local()->extractDescriptors(image, keypoints, descriptors);
+        return;
+    }
+
+    const int n = static_cast<int>(keypoints.size());
+    const int batches = std::min(n, options_.tiles_x * options_.tiles_y);
+
+    std::vector<std::vector<cv::KeyPoint>> batch_keypoints(batches);
+    std::vector<cv::Mat> batch_descriptors(batches);
+
+    parallel::forRange(batches, [&](const cv::Range& range) {
+        Extractor::Ptr extractor = local();
+        for (int b = range.start; b < range.end; ++b) {
+            const int begin = static_cast<int>(static_cast<int64_t>(b) * n / batches);
+            const int end = static_cast<int>(static_cast<int64_t>(b + 1) * n / batches);
+
+            std::vector<cv::KeyPoint>& batch = batch_keypoints[b];
+            batch.assign(keypoints.begin() + begin, keypoints.begin() + end);
+
+            // the full image is passed, a crop would let the extractor drop keypoints at the artificial border
+            extractor->extractDescriptors(image, batch, batch_descriptors[b]);
+        }
+    });
+
+    keypoints.clear();
+    std::vector<cv::Mat> parts;
+    for (int b = 0; b < batches; ++b) {
+        if (!batch_descriptors[b].empty()) {
+            keypoints.insert(keypoints.end(), batch_keypoints[b].begin(), batch_keypoints[b].end());
+            parts.push_back(batch_descriptors[b]);
+        }
+    }
+    if (!parts.empty()) {
+        cv::vconcat(parts, descriptors);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef MULTI_CHANNEL_HISTOGRAM_H
+#define MULTI_CHANNEL_HISTOGRAM_H
+
+/// PROJECT
+#include <cslibs_vision/utils/histogram.hpp>
+
+/// SYSTEM
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace csapex
+{
+/**
+ * @brief The MultiChannelHistogram class computes uniform histograms of all channels in one pass.
+ *
+ * Bins follow cv::calcHist: a value v of channel c falls into bin
+ * floor((v - lo) * bins / (hi - lo)) if lo <= v < hi, other values are ignored.
+ * 8 bit images are binned with a lookup table, all other depths compute the
+ * bin indices of a whole row at once, with SSE2 if available.
+ * Large images are split into stripes, each counted into its own buffer and
+ * merged afterwards.
+ *
+ * Windows of the same size that are computed one after another on the same
+ * image are updated incrementally, only the pixels entering and leaving the
+ * window are visited. Call reset() if the image content changed in place.
+ */
+class MultiChannelHistogram
+{
+public:
+    typedef cslibs_vision::histogram::Rangef Range;
+
+public:
+    MultiChannelHistogram();
+
+    /// one range per channel, buffers are only rebuilt if something changed
+    void configure(int type, int bins, const std::vector<Range>& ranges);
+
+    /// counts all pixels with a non-zero mask value, an empty mask selects all pixels
+    void compute(const cv::Mat& image, const cv::Mat& mask);
+    void compute(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi);
+
+    /// forgets the previous window, so that the next compute starts from scratch
+    void reset();
+
+    int bins() const;
+    int channels() const;
+
+    /// bin b of channel c is at c * bins + b
+    const int* counts() const;
+
+    /// one CV_32FC1 column per channel
+    void histograms(std::vector<cv::Mat>& histograms) const;
+    /// all channels in one CV_32FC1 column
+    cv::Mat appended() const;
+
+private:
+    struct Workspace
+    {
+        std::vector<int> counts;
+        std::vector<float> values;
+        std::vector<int> indices;
+    };
+
+    void prepare(int width);
+    void accumulate(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& rect, int weight, Workspace& workspace, int* counts) const;
+    void indexRow(const uchar* row, int width, Workspace& workspace) const;
+    void computeFull(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi);
+    bool computeIncremental(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi);
+
+private:
+    int type_;
+    int depth_;
+    int channels_;
+    int bins_;
+    std::vector<Range> ranges_;
+
+    /// bin of every 8 bit value and channel, offset by channel
+    std::vector<int> lut_;
+    /// per element of a row, for computed bin indices
+    std::vector<float> lo_;
+    std::vector<float> hi_;
+    std::vector<float> scale_;
+    std::vector<int> offset_;
+    int prepared_width_;
+
+    /// channels * bins counts, followed by one slot that receives all ignored values
+    std::vector<int> counts_;
+    std::vector<Workspace> workspaces_;
+
+    bool has_window_;
+    cv::Rect window_;
+    const uchar* window_data_;
+    const uchar* window_mask_;
+    cv::Size window_image_size_;
+};
+
+}  // namespace csapex
+
+#endif  // MULTI_CHANNEL_HISTOGRAM_H
@@ -3,10 +3,12 @@
 
 /// PROJECT
 #include <csapex/model/node_modifier.h>
+#include <csapex/msg/generic_vector_message.hpp>
 #include <csapex/msg/io.h>
 #include <csapex/param/parameter_factory.h>
 #include <csapex/utility/register_apex_plugin.h>
 #include <csapex_opencv/cv_mat_message.h>
+#include <csapex_opencv/roi_message.h>
 #include <csapex_vision_histograms/histogram_msg.h>
 #include <cslibs_vision/utils/histogram.hpp>
 
@@ -103,23 +105,52 @@ void Histogram::process()
     std::vector<cslibs_vision::histogram::Rangef> ranges(in->value.channels(), range);
     bins.resize(in->value.channels(), bins_);
 
-    std::vector<cv::Mat> histograms;
-    cslibs_vision::histogram::histogram(in->value, histograms, mask, bins, ranges, uniform_, accumulate_);
-
-    if (append_) {
-        int length = histograms.front().rows;
-        cv::Mat all(histograms.size() * length, 1, CV_32FC1, cv::Scalar::all(0));
-        for (unsigned int i = 0; i < histograms.size(); ++i) {
-            cv::Mat rows(all, cv::Rect(0, i * length, 1, length));
-            histograms.at(i).copyTo(rows);
+    std::vector<cv::Rect> regions;
+    if (msg::hasMessage(rois_)) {
+        std::shared_ptr<std::vector<RoiMessage> const> rois = msg::getMessage<GenericVectorMessage, RoiMessage>(rois_);
+        for (const RoiMessage& roi : *rois) {
+            regions.push_back(roi.value.rect());
         }
-        out->value.histograms.push_back(all);
-        out->value.ranges.resize(1, range);
     } else {
-        for (std::vector<cv::Mat>::iterator it = histograms.begin(); it != histograms.end(); ++it) {
-            out->value.histograms.push_back(*it);
+        regions.push_back(cv::Rect(0, 0, in->value.cols, in->value.rows));
+    }
+
+    if (uniform_) {
+        engine_.configure(in->value.type(), bins_, ranges);
+        // the image buffer may be reused for the next message, windows are only updated incrementally within this one
+        engine_.reset();
+    }
+
+    for (const cv::Rect& region : regions) {
+        std::vector<cv::Mat> histograms;
+        if (uniform_) {
+            engine_.compute(in->value, mask, region);
+            if (append_) {
+                histograms.push_back(engine_.appended());
+            } else {
+                engine_.histograms(histograms);
+            }
+        } else {
+            const cv::Rect clipped = region & cv::Rect(0, 0, in->value.cols, in->value.rows);
+            cslibs_vision::histogram::histogram(in->value(clipped), histograms, mask.empty() ? mask : mask(clipped), bins, ranges, uniform_, accumulate_);
+        }
+
+        if (append_) {
+            if (histograms.size() > 1) {
+                int length = histograms.front().rows;
+                cv::Mat all(histograms.size() * length, 1, CV_32FC1, cv::Scalar::all(0));
+                for (unsigned int i = 0; i < histograms.size(); ++i) {
+                    cv::Mat rows(all, cv::Rect(0, i * length, 1, length));
+                    histograms.at(i).copyTo(rows);
+                }
+                histograms.assign(1, all);
+            }
+            out->value.histograms.push_back(histograms.front());
+            out->value.ranges.push_back(range);
+        } else {
+            out->value.histograms.insert(out->value.histograms.end(), histograms.begin(), histograms.end());
+            out->value.ranges.insert(out->value.ranges.end(), ranges.begin(), ranges.end());
         }
-        out->value.ranges = ranges;
     }
 
     msg::publish(output_, out);
@@ -129,6 +160,7 @@ void Histogram::setup(NodeModifier& node_modifier)
 {
     input_ = node_modifier.addInput<CvMatMessage>("input");
     mask_ = node_modifier.addOptionalInput<CvMatMessage>("mask");
+    rois_ = node_modifier.addOptionalInput<GenericVectorMessage, RoiMessage>("rois");
     output_ = node_modifier.addOutput<HistogramMessage>("histograms");
     update();
 }
@@ -3,6 +3,7 @@
 
 /// COMPONENT
 #include <csapex/model/node.h>
+#include <csapex_vision_histograms/multi_channel_histogram.h>
 
 namespace csapex
 {
@@ -19,6 +20,7 @@ protected:
     csapex::Output* output_;
     csapex::Input* input_;
     csapex::Input* mask_;
+    csapex::Input* rois_;
 
     int bins_;
     int last_type_;
@@ -29,6 +31,8 @@ protected:
     bool append_;
     std::pair<float, float> min_max_value_;
 
+    MultiChannelHistogram engine_;
+
     void update();
 
     void resetMinMax();
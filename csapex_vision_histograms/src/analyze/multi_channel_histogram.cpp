@@ -0,0 +1,371 @@
+/// HEADER
+#include <csapex_vision_histograms/multi_channel_histogram.h>
+
+/// PROJECT
+#include <csapex_opencv/parallel.h>
+
+/// SYSTEM
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace csapex;
+
+namespace
+{
+/// images smaller than this are not worth splitting into stripes
+const int PARALLEL_MIN_PIXELS = 1 << 16;
+const int STRIPE_MIN_ROWS = 16;
+
+template <typename T>
+void convertRow(const uchar* row, int n, float* dst)
+{
+    const T* src = reinterpret_cast<const T*>(row);
+    for (int i = 0; i < n; ++i) {
+        dst[i] = static_cast<float>(src[i]);
+    }
+}
+
+/// bin index of every element, sentinel for ignored values
+void binIndices(const float* values, const float* lo, const float* hi, const float* scale, const int* offset, float max_bin, int sentinel, int n, int* indices)
+{
+    int i = 0;
+#ifdef __SSE2__
+    const __m128 v_max_bin = _mm_set1_ps(max_bin);
+    const __m128i v_sentinel = _mm_set1_epi32(sentinel);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 v = _mm_loadu_ps(values + i);
+        const __m128 l = _mm_loadu_ps(lo + i);
+        const __m128i valid = _mm_castps_si128(_mm_and_ps(_mm_cmpge_ps(v, l), _mm_cmplt_ps(v, _mm_loadu_ps(hi + i))));
+        const __m128 bin = _mm_min_ps(_mm_mul_ps(_mm_sub_ps(v, l), _mm_loadu_ps(scale + i)), v_max_bin);
+        const __m128i index = _mm_add_epi32(_mm_cvttps_epi32(bin), _mm_loadu_si128(reinterpret_cast<const __m128i*>(offset + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(indices + i), _mm_or_si128(_mm_and_si128(valid, index), _mm_andnot_si128(valid, v_sentinel)));
+    }
+#endif
+    for (; i < n; ++i) {
+        const float v = values[i];
+        if (v >= lo[i] && v < hi[i]) {
+            indices[i] = offset[i] + static_cast<int>(std::min((v - lo[i]) * scale[i], max_bin));
+        } else {
+            indices[i] = sentinel;
+        }
+    }
+}
+
+}  // namespace
+
+MultiChannelHistogram::MultiChannelHistogram()
+  : type_(-1), depth_(-1), channels_(0), bins_(0), prepared_width_(0), workspaces_(1), has_window_(false), window_data_(nullptr), window_mask_(nullptr)
+{
+}
+
+void MultiChannelHistogram::configure(int type, int bins, const std::vector<Range>& ranges)
+{
+    const int channels = CV_MAT_CN(type);
+    if (bins < 1) {
+        throw std::runtime_error("A histogram needs at least one bin!");
+    }
+    if (static_cast<int>(ranges.size()) != channels) {
+        throw std::runtime_error("A histogram needs one range per channel!");
+    }
+    for (const Range& range : ranges) {
+        if (!(range.first < range.second)) {
+            throw std::runtime_error("Histogram ranges must not be empty!");
+        }
+    }
+
+    switch (CV_MAT_DEPTH(type)) {
+        case CV_8U:
+        case CV_8S:
+        case CV_16U:
+        case CV_16S:
+        case CV_32S:
+        case CV_32F:
+            break;
+        default:
+            throw std::runtime_error("Unsupported cv type!");
+    }
+
+    if (type == type_ && bins == bins_ && ranges == ranges_) {
+        return;
+    }
+
+    type_ = type;
+    depth_ = CV_MAT_DEPTH(type);
+    channels_ = channels;
+    bins_ = bins;
+    ranges_ = ranges;
+
+    const int sentinel = channels_ * bins_;
+    counts_.assign(sentinel + 1, 0);
+
+    lut_.clear();
+    if (depth_ == CV_8U || depth_ == CV_8S) {
+        lut_.resize(channels_ * 256);
+        for (int c = 0; c < channels_; ++c) {
+            const double lo = ranges_[c].first;
+            const double hi = ranges_[c].second;
+            for (int i = 0; i < 256; ++i) {
+                // the table is indexed with the raw byte, signed values are stored as two's complement
+                const double v = depth_ == CV_8U ? i : static_cast<signed char>(i);
+                int& index = lut_[c * 256 + i];
+                if (v >= lo && v < hi) {
+                    index = c * bins_ + std::min(static_cast<int>((v - lo) * bins_ / (hi - lo)), bins_ - 1);
+                } else {
+                    index = sentinel;
+                }
+            }
+        }
+    }
+
+    prepared_width_ = 0;
+    reset();
+}
+
+void MultiChannelHistogram::prepare(int width)
+{
+    if (width <= prepared_width_) {
+        return;
+    }
+    prepared_width_ = width;
+
+    // the pattern repeats every pixel, so one table serves every window of a row
+    const int n = width * channels_;
+    lo_.resize(n);
+    hi_.resize(n);
+    scale_.resize(n);
+    offset_.resize(n);
+    for (int i = 0; i < n; ++i) {
+        const int c = i % channels_;
+        lo_[i] = ranges_[c].first;
+        hi_[i] = ranges_[c].second;
+        scale_[i] = static_cast<float>(bins_ / (static_cast<double>(ranges_[c].second) - ranges_[c].first));
+        offset_[i] = c * bins_;
+    }
+}
+
+void MultiChannelHistogram::reset()
+{
+    has_window_ = false;
+    window_data_ = nullptr;
+    window_mask_ = nullptr;
+}
+
+int MultiChannelHistogram::bins() const
+{
+    return bins_;
+}
+
+int MultiChannelHistogram::channels() const
+{
+    return channels_;
+}
+
+const int* MultiChannelHistogram::counts() const
+{
+    return counts_.data();
+}
+
+void MultiChannelHistogram::histograms(std::vector<cv::Mat>& histograms) const
+{
+    histograms.resize(channels_);
+    for (int c = 0; c < channels_; ++c) {
+        cv::Mat& histogram = histograms[c];
+        histogram.create(bins_, 1, CV_32FC1);
+        float* dst = histogram.ptr<float>();
+        const int* src = counts_.data() + c * bins_;
+        for (int b = 0; b < bins_; ++b) {
+            dst[b] = static_cast<float>(src[b]);
+        }
+    }
+}
+
+cv::Mat MultiChannelHistogram::appended() const
+{
+    cv::Mat all(channels_ * bins_, 1, CV_32FC1);
+    float* dst = all.ptr<float>();
+    for (int i = 0; i < channels_ * bins_; ++i) {
+        dst[i] = static_cast<float>(counts_[i]);
+    }
+    return all;
+}
+
+void MultiChannelHistogram::compute(const cv::Mat& image, const cv::Mat& mask)
+{
+    compute(image, mask, cv::Rect(0, 0, image.cols, image.rows));
+}
+
+void MultiChannelHistogram::compute(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi)
+{
+    if (image.type() != type_) {
+        throw std::runtime_error("Histogram is not configured for this image type!");
+    }
+    if (!mask.empty() && (mask.type() != CV_8UC1 || mask.size() != image.size())) {
+        throw std::runtime_error("Mask must be single channel uchar of the image's size!");
+    }
+
+    const cv::Rect window = roi & cv::Rect(0, 0, image.cols, image.rows);
+    prepare(window.width);
+
+    if (!computeIncremental(image, mask, window)) {
+        computeFull(image, mask, window);
+    }
+
+    has_window_ = true;
+    window_ = window;
+    window_data_ = image.data;
+    window_mask_ = mask.empty() ? nullptr : mask.data;
+    window_image_size_ = image.size();
+}
+
+void MultiChannelHistogram::computeFull(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi)
+{
+    std::fill(counts_.begin(), counts_.end(), 0);
+
+    const int stripes = roi.area() < PARALLEL_MIN_PIXELS ? 1 : std::max(1, std::min(cv::getNumThreads(), roi.height / STRIPE_MIN_ROWS));
+    if (static_cast<int>(workspaces_.size()) < stripes) {
+        workspaces_.resize(stripes);
+    }
+
+    if (stripes == 1) {
+        accumulate(image, mask, roi, 1, workspaces_.front(), counts_.data());
+        return;
+    }
+
+    auto count_stripe = [&](const cv::Range& range) {
+        for (int s = range.start; s < range.end; ++s) {
+            const int y0 = roi.y + s * roi.height / stripes;
+            const int y1 = roi.y + (s + 1) * roi.height / stripes;
+
+            Workspace& workspace = workspaces_[s];
+            workspace.counts.assign(counts_.size(), 0);
+            accumulate(image, mask, cv::Rect(roi.x, y0, roi.width, y1 - y0), 1, workspace, workspace.counts.data());
+        }
+    };
+    parallel::forRange(stripes, count_stripe);
+
+    for (int s = 0; s < stripes; ++s) {
+        const std::vector<int>& partial = workspaces_[s].counts;
+        for (std::size_t i = 0; i < counts_.size(); ++i) {
+            counts_[i] += partial[i];
+        }
+    }
+}
+
+bool MultiChannelHistogram::computeIncremental(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi)
+{
+    if (!has_window_ || image.data != window_data_ || image.size() != window_image_size_ || (mask.empty() ? nullptr : mask.data) != window_mask_ || roi.size() != window_.size()) {
+        return false;
+    }
+
+    const int w = roi.width;
+    const int h = roi.height;
+    const int dx = roi.x - window_.x;
+    const int dy = roi.y - window_.y;
+    const int adx = std::abs(dx);
+    const int ady = std::abs(dy);
+
+    // every changed pixel is visited twice, once leaving and once entering
+    if (adx >= w || ady >= h || 2 * (adx * h + ady * (w - adx)) >= w * h) {
+        return false;
+    }
+
+    Workspace& workspace = workspaces_.front();
+
+    // columns that are in only one of the windows, over the full height
+    if (dx > 0) {
+        accumulate(image, mask, cv::Rect(window_.x, window_.y, dx, h), -1, workspace, counts_.data());
+        accumulate(image, mask, cv::Rect(roi.x + w - dx, roi.y, dx, h), 1, workspace, counts_.data());
+    } else if (dx < 0) {
+        accumulate(image, mask, cv::Rect(window_.x + w + dx, window_.y, -dx, h), -1, workspace, counts_.data());
+        accumulate(image, mask, cv::Rect(roi.x, roi.y, -dx, h), 1, workspace, counts_.data());
+    }
+
+    // rows that are in only one of the windows, over the shared columns
+    const int shared_x = std::max(roi.x, window_.x);
+    const int shared_w = w - adx;
+    if (dy > 0) {
+        accumulate(image, mask, cv::Rect(shared_x, window_.y, shared_w, dy), -1, workspace, counts_.data());
+        accumulate(image, mask, cv::Rect(shared_x, roi.y + h - dy, shared_w, dy), 1, workspace, counts_.data());
+    } else if (dy < 0) {
+        accumulate(image, mask, cv::Rect(shared_x, window_.y + h + dy, shared_w, -dy), -1, workspace, counts_.data());
+        accumulate(image, mask, cv::Rect(shared_x, roi.y, shared_w, -dy), 1, workspace, counts_.data());
+    }
+
+    return true;
+}
+
+void MultiChannelHistogram::accumulate(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& rect, int weight, Workspace& workspace, int* counts) const
+{
+    const int n = rect.width * channels_;
+    workspace.indices.resize(n);
+    const std::size_t elem_size = image.elemSize();
+
+    for (int y = rect.y; y < rect.y + rect.height; ++y) {
+        indexRow(image.ptr(y) + rect.x * elem_size, rect.width, workspace);
+        const int* indices = workspace.indices.data();
+
+        if (mask.empty()) {
+            for (int i = 0; i < n; ++i) {
+                counts[indices[i]] += weight;
+            }
+        } else {
+            const uchar* mask_row = mask.ptr<uchar>(y) + rect.x;
+            for (int x = 0; x < rect.width; ++x) {
+                if (mask_row[x]) {
+                    for (int c = 0; c < channels_; ++c) {
+                        counts[indices[x * channels_ + c]] += weight;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void MultiChannelHistogram::indexRow(const uchar* row, int width, Workspace& workspace) const
+{
+    const int n = width * channels_;
+    int* indices = workspace.indices.data();
+
+    if (!lut_.empty()) {
+        for (int i = 0; i < n; ++i) {
+            indices[i] = lut_[(i % channels_) * 256 + row[i]];
+        }
+        return;
+    }
+
+    if (depth_ == CV_32S) {
+        // not every int is representable as float, bin in double precision
+        const int* src = reinterpret_cast<const int*>(row);
+        for (int i = 0; i < n; ++i) {
+            const int c = i % channels_;
+            const double v = src[i];
+            const double lo = ranges_[c].first;
+            const double hi = ranges_[c].second;
+            if (v >= lo && v < hi) {
+                indices[i] = c * bins_ + std::min(static_cast<int>((v - lo) * bins_ / (hi - lo)), bins_ - 1);
+            } else {
+                indices[i] = channels_ * bins_;
+            }
+        }
+        return;
+    }
+
+    const float* values;
+    if (depth_ == CV_32F) {
+        values = reinterpret_cast<const float*>(row);
+    } else {
+        workspace.values.resize(n);
+        if (depth_ == CV_16U) {
+            convertRow<ushort>(row, n, workspace.values.data());
+        } else {
+            convertRow<short>(row, n, workspace.values.data());
+        }
+        values = workspace.values.data();
+    }
+
+    binIndices(values, lo_.data(), hi_.data(), scale_.data(), offset_.data(), static_cast<float>(bins_ - 1), channels_ * bins_, n, indices);
+}